@@ -0,0 +1,5 @@
+require "UnLua"
+
+local M = Class()
+
+return M
@@ -54,6 +54,10 @@ local function NewIndex(t, k, v)
 	rawset(t, k, v)
 end
 
+-- native versions keep methods in a per-class cache instead of copying them into every instance
+local ClassIndex = UnLua_ClassIndex or Index
+local ClassNewIndex = UnLua_ClassNewIndex or NewIndex
+
 local function Class(super_name)
 	local super_class = nil
 	if super_name ~= nil then
@@ -61,8 +65,8 @@ local function Class(super_name)
 	end
 
 	local new_class = {}
-	new_class.__index = Index
-	new_class.__newindex = NewIndex
+	new_class.__index = ClassIndex
+	new_class.__newindex = ClassNewIndex
 	new_class.Super = super_class
 
     return new_class
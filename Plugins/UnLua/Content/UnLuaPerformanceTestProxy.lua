@@ -26,6 +26,35 @@ function UnLuaPerformanceTestProxy:ReceiveBeginPlay()
 	EndTime = Seconds()
 	Message = Message .. "\n" ..  "write int32 ; " .. tostring((EndTime - StartTime) * Multiplier)
 
+	StartTime = Seconds()
+	for i=1, N do
+		local MeshID = self.MeshID
+	end
+	EndTime = Seconds()
+	Message = Message .. "\n" ..  "read int32 (self) ; " .. tostring((EndTime - StartTime) * Multiplier)
+
+	StartTime = Seconds()
+	for i=1, N do
+		self.MeshID = i
+	end
+	EndTime = Seconds()
+	Message = Message .. "\n" ..  "write int32 (self) ; " .. tostring((EndTime - StartTime) * Multiplier)
+
+	local Vector = UE4.FVector(1.0, 1.0, 1.0)
+	StartTime = Seconds()
+	for i=1, N do
+		local X = Vector.X
+	end
+	EndTime = Seconds()
+	Message = Message .. "\n" ..  "read FVector.X ; " .. tostring((EndTime - StartTime) * Multiplier)
+
+	StartTime = Seconds()
+	for i=1, N do
+		Vector.X = i
+	end
+	EndTime = Seconds()
+	Message = Message .. "\n" ..  "write FVector.X ; " .. tostring((EndTime - StartTime) * Multiplier)
+
 	StartTime = Seconds()
 	for i=1, N do
 		local MeshName = RawObject.MeshName
@@ -32,6 +32,28 @@ public class Lua : ModuleRules
             PrivateDefinitions.Add("LUA_USE_DLOPEN");
         }
 
+        // per-instruction inline caches for field accesses on UnLua userdata, see 'udataget' in lvm.c
+        bool bEnableUdataInlineCache = false;
+        if (bEnableUdataInlineCache)
+        {
+            PublicDefinitions.Add("LUA_UDATA_ICACHE=1");
+        }
+        else
+        {
+            PublicDefinitions.Add("LUA_UDATA_ICACHE=0");
+        }
+
+        // callback around GC steps, used by UnLua's adaptive GC controller to measure pauses
+        bool bEnableGCHook = true;
+        if (bEnableGCHook)
+        {
+            PublicDefinitions.Add("LUA_GC_HOOK=1");
+        }
+        else
+        {
+            PublicDefinitions.Add("LUA_GC_HOOK=0");
+        }
+
         PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "src"));
     }
 }
@@ -1307,6 +1307,37 @@ void lua_warning (lua_State *L, const char *msg, int tocont) {
 }
 
 
+#if LUA_UDATA_ICACHE
+LUA_API void lua_setudataicache (lua_State *L, lua_CFunction indexf,
+                                 lua_UdataICacheRead readf) {
+  global_State *g = G(L);
+  lua_lock(L);
+  g->icacheindex = indexf;
+  g->icacheread = readf;
+  g->icacheepoch++;  /* drop entries filled for a previous '__index' */
+  lua_unlock(L);
+}
+
+
+LUA_API void lua_invalidateudataicache (lua_State *L) {
+  lua_lock(L);
+  G(L)->icacheepoch++;
+  lua_unlock(L);
+}
+#endif
+
+
+#if LUA_GC_HOOK
+LUA_API void lua_setgchook (lua_State *L, lua_GCHook f, void *ud) {
+  global_State *g = G(L);
+  lua_lock(L);
+  g->gchook = f;
+  g->gchookud = ud;
+  lua_unlock(L);
+}
+#endif
+
+
 
 LUA_API void *lua_newuserdatauv (lua_State *L, size_t size, int nuvalue) {
   Udata *u;
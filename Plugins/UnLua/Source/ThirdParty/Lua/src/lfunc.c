@@ -266,6 +266,9 @@ Proto *luaF_newproto (lua_State *L) {
   f->linedefined = 0;
   f->lastlinedefined = 0;
   f->source = NULL;
+#if LUA_UDATA_ICACHE
+  f->icache = NULL;
+#endif
   return f;
 }
 
@@ -278,6 +281,10 @@ void luaF_freeproto (lua_State *L, Proto *f) {
   luaM_freearray(L, f->abslineinfo, f->sizeabslineinfo);
   luaM_freearray(L, f->locvars, f->sizelocvars);
   luaM_freearray(L, f->upvalues, f->sizeupvalues);
+#if LUA_UDATA_ICACHE
+  if (f->icache != NULL)
+    luaM_freearray(L, f->icache, f->sizecode);
+#endif
   luaM_free(L, f);
 }
 
@@ -60,6 +60,14 @@
 #define PAUSEADJ		100
 
 
+/* call the GC hook of the host, see 'lua_setgchook' */
+#if LUA_GC_HOOK
+#define gchook(L,g,ev)	{ if ((g)->gchook) (g)->gchook(L, (g)->gchookud, ev); }
+#else
+#define gchook(L,g,ev)	((void)0)
+#endif
+
+
 /* mask with all color bits */
 #define maskcolors	(bitmask(BLACKBIT) | WHITEBITS)
 
@@ -580,6 +588,21 @@ static int traverseproto (global_State *g, Proto *f) {
     markobjectN(g, f->p[i]);
   for (i = 0; i < f->sizelocvars; i++)  /* mark local-variable names */
     markobjectN(g, f->locvars[i].varname);
+#if LUA_UDATA_ICACHE
+  if (f->icache != NULL) {  /* mark live inline cache entries */
+    for (i = 0; i < f->sizecode; i++) {
+      UdataICache *ic = &f->icache[i];
+      if (ic->mt != NULL) {
+        if (ic->epoch == g->icacheepoch) {
+          markobject(g, ic->mt);
+          markvalue(g, &ic->v);
+        }
+        else  /* stale entry; let its objects be collected */
+          ic->mt = NULL;
+      }
+    }
+  }
+#endif
   return 1 + f->sizek + f->sizeupvalues + f->sizep + f->sizelocvars;
 }
 
@@ -1411,7 +1434,8 @@ static void stepgenfull (lua_State *L, global_State *g) {
 ** 'GCdebt <= 0' means an explicit call to GC step with "size" zero;
 ** in that case, do a minor collection.
 */
-static void genstep (lua_State *L, global_State *g) {
+static int genstep (lua_State *L, global_State *g) {
+  int major = 1;
   if (g->lastatomic != 0)  /* last collection was a bad one? */
     stepgenfull(L, g);  /* do a full step */
   else {
@@ -1433,9 +1457,11 @@ static void genstep (lua_State *L, global_State *g) {
       youngcollection(L, g);
       setminordebt(g);
       g->GCestimate = majorbase;  /* preserve base value */
+      major = 0;
     }
   }
   lua_assert(isdecGCmodegen(g));
+  return major;
 }
 
 /* }====================================================== */
@@ -1667,10 +1693,22 @@ void luaC_step (lua_State *L) {
   global_State *g = G(L);
   lua_assert(!g->gcemergency);
   if (g->gcrunning) {  /* running? */
+#if LUA_GC_HOOK
+    int ev;
+    gchook(L, g, LUA_GCEV_BEGIN);
+    if (isdecGCmodegen(g))
+      ev = genstep(L, g) ? LUA_GCEV_MAJOR : LUA_GCEV_MINOR;
+    else {
+      incstep(L, g);
+      ev = (g->gcstate == GCSpause) ? LUA_GCEV_CYCLE : LUA_GCEV_INCSTEP;
+    }
+    gchook(L, g, ev);
+#else
     if(isdecGCmodegen(g))
       genstep(L, g);
     else
       incstep(L, g);
+#endif
   }
 }
 
@@ -1704,10 +1742,12 @@ void luaC_fullgc (lua_State *L, int isemergency) {
   global_State *g = G(L);
   lua_assert(!g->gcemergency);
   g->gcemergency = isemergency;  /* set flag */
+  gchook(L, g, LUA_GCEV_BEGIN);
   if (g->gckind == KGC_INC)
     fullinc(L, g);
   else
     fullgen(L, g);
+  gchook(L, g, LUA_GCEV_FULL);
   g->gcemergency = 0;
 }
 
@@ -527,6 +527,18 @@ typedef struct AbsLineInfo {
 /*
 ** Function Prototypes
 */
+#if LUA_UDATA_ICACHE
+/*
+** Inline cache entry of a field access on a full userdata
+*/
+typedef struct UdataICache {
+  struct Table *mt;  /* metatable of the userdata; NULL if entry is empty */
+  TValue v;  /* raw 'mt[key]': a function or an accessor (light userdata) */
+  unsigned int epoch;  /* 'icacheepoch' when the entry was filled */
+} UdataICache;
+#endif
+
+
 typedef struct Proto {
   CommonHeader;
   lu_byte numparams;  /* number of fixed (named) parameters */
@@ -550,6 +562,9 @@ typedef struct Proto {
   LocVar *locvars;  /* information about local variables (debug information) */
   TString  *source;  /* used for debug information */
   GCObject *gclist;
+#if LUA_UDATA_ICACHE
+  UdataICache *icache;  /* one entry per instruction, created on demand */
+#endif
 } Proto;
 
 /* }================================================================== */
@@ -366,6 +366,15 @@ LUA_API lua_State *lua_newstate (lua_Alloc f, void *ud) {
   g->ud = ud;
   g->warnf = NULL;
   g->ud_warn = NULL;
+#if LUA_UDATA_ICACHE
+  g->icacheindex = NULL;
+  g->icacheread = NULL;
+  g->icacheepoch = 0;
+#endif
+#if LUA_GC_HOOK
+  g->gchook = NULL;
+  g->gchookud = NULL;
+#endif
   g->mainthread = L;
   g->seed = luai_makeseed(L);
   g->gcrunning = 0;  /* no GC while building state */
@@ -264,6 +264,15 @@ typedef struct global_State {
   TString *strcache[STRCACHE_N][STRCACHE_M];  /* cache for strings in API */
   lua_WarnFunction warnf;  /* warning function */
   void *ud_warn;         /* auxiliary data to 'warnf' */
+#if LUA_UDATA_ICACHE
+  lua_CFunction icacheindex;  /* '__index' understood by the inline caches */
+  lua_UdataICacheRead icacheread;  /* reads a field through an accessor */
+  unsigned int icacheepoch;  /* entries of older epochs are invalid */
+#endif
+#if LUA_GC_HOOK
+  lua_GCHook gchook;  /* called around GC steps */
+  void *gchookud;  /* auxiliary data to 'gchook' */
+#endif
 } global_State;
 
 
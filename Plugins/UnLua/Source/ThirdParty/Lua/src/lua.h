@@ -312,6 +312,44 @@ LUA_API void (lua_setwarnf) (lua_State *L, lua_WarnFunction f, void *ud);
 LUA_API void (lua_warning)  (lua_State *L, const char *msg, int tocont);
 
 
+#if LUA_UDATA_ICACHE
+/*
+** Inline caches for field accesses on full userdata (see 'udataget' in
+** lvm.c). 'indexf' is the '__index' C function whose metatables the
+** caches understand: a function in 'mt[key]' is the result itself, a
+** light userdata in 'mt[key]' is an accessor passed to 'readf' with the
+** userdata on the top of the stack. 'readf' pushes the result and
+** returns 1, or returns 0 to fall back to calling 'indexf'.
+** Call 'lua_invalidateudataicache' whenever raw fields of such
+** metatables change.
+*/
+typedef int (*lua_UdataICacheRead) (lua_State *L, void *accessor);
+
+LUA_API void (lua_setudataicache) (lua_State *L, lua_CFunction indexf,
+                                   lua_UdataICacheRead readf);
+LUA_API void (lua_invalidateudataicache) (lua_State *L);
+#endif
+
+
+#if LUA_GC_HOOK
+/*
+** GC hook, called with LUA_GCEV_BEGIN before every GC step or full
+** collection and with one of the other events after it. The hook runs
+** inside the collector: it must not allocate or call Lua.
+*/
+#define LUA_GCEV_BEGIN		0
+#define LUA_GCEV_INCSTEP	1  /* incremental step, cycle not finished */
+#define LUA_GCEV_CYCLE		2  /* incremental step that finished a cycle */
+#define LUA_GCEV_MINOR		3  /* generational minor collection */
+#define LUA_GCEV_MAJOR		4  /* generational major collection */
+#define LUA_GCEV_FULL		5  /* full collection ('collectgarbage()') */
+
+typedef void (*lua_GCHook) (lua_State *L, void *ud, int event);
+
+LUA_API void (lua_setgchook) (lua_State *L, lua_GCHook f, void *ud);
+#endif
+
+
 /*
 ** garbage-collection function and options
 */
@@ -727,6 +727,27 @@
 #define LUA_EXTRASPACE		(sizeof(void *))
 
 
+/*
+@@ LUA_UDATA_ICACHE enables per-instruction inline caches for field
+** accesses ('OP_GETFIELD'/'OP_SELF') on full userdata whose metatable
+** '__index' is the C function registered with 'lua_setudataicache'.
+** Off by default; the embedding host turns it on.
+*/
+#if !defined(LUA_UDATA_ICACHE)
+#define LUA_UDATA_ICACHE	0
+#endif
+
+
+/*
+@@ LUA_GC_HOOK enables 'lua_setgchook', a callback around every GC
+** step and full collection, so the host can measure GC pauses.
+** Off by default; the embedding host turns it on.
+*/
+#if !defined(LUA_GC_HOOK)
+#define LUA_GC_HOOK	0
+#endif
+
+
 /*
 @@ LUA_IDSIZE gives the maximum size for the description of the source
 @@ of a function in debug information.
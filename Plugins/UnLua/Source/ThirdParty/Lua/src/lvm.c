@@ -22,6 +22,7 @@
 #include "ldo.h"
 #include "lfunc.h"
 #include "lgc.h"
+#include "lmem.h"
 #include "lobject.h"
 #include "lopcodes.h"
 #include "lstate.h"
@@ -320,6 +321,75 @@ void luaV_finishget (lua_State *L, const TValue *t, TValue *key, StkId val,
 }
 
 
+#if LUA_UDATA_ICACHE
+/*
+** Field access 'val = t[key]' on a full userdata, through the inline
+** cache of the instruction at 'pc'. When the '__index' of the
+** userdata is the C function registered with 'lua_setudataicache',
+** the raw 'mt[key]' is cached per instruction, so a hit skips the
+** '__index' call and the metatable lookup: a function is the result
+** itself and an accessor (light userdata) is read with 'icacheread'.
+** Anything else goes the regular way through 'luaV_finishget'.
+*/
+static void udataget (lua_State *L, Proto *p, const Instruction *pc,
+                      const TValue *t, const TValue *key, StkId val) {
+  global_State *g = G(L);
+  Table *mt = uvalue(t)->metatable;
+  const TValue *tm;
+  UdataICache *ic;
+  TValue ut, kt;
+  ptrdiff_t res = savestack(L, val);
+  setobj(L, &ut, t);  /* 't' and 'key' may live in the stack */
+  setobj(L, &kt, key);
+  tm = (mt == NULL) ? NULL : fasttm(L, mt, TM_INDEX);
+  if (tm == NULL || !ttislcf(tm) || fvalue(tm) != g->icacheindex) {
+    luaV_finishget(L, &ut, &kt, val, NULL);
+    return;
+  }
+  if (p->icache == NULL) {  /* first cached access in this function? */
+    int i;
+    UdataICache *icache = luaM_newvector(L, p->sizecode, UdataICache);
+    for (i = 0; i < p->sizecode; i++)
+      icache[i].mt = NULL;
+    p->icache = icache;
+  }
+  ic = &p->icache[pcRel(pc, p)];
+  if (ic->mt != mt || ic->epoch != g->icacheepoch) {  /* miss? */
+    const TValue *slot = luaH_getstr(mt, tsvalue(&kt));
+    if (isempty(slot)) {  /* not resolved yet; let '__index' do it */
+      luaV_finishget(L, &ut, &kt, restorestack(L, res), NULL);
+      return;
+    }
+    ic->mt = mt;
+    setobj(L, &ic->v, slot);
+    ic->epoch = g->icacheepoch;
+    luaC_objbarrier(L, p, mt);
+    luaC_barrier(L, p, slot);
+  }
+  if (!ttislightuserdata(&ic->v))  /* cached value is the result? */
+    setobj2s(L, restorestack(L, res), &ic->v);
+  else {  /* read through the accessor */
+    void *accessor = pvalue(&ic->v);
+    CallInfo *ci = L->ci;
+    ptrdiff_t oldtop = savestack(L, L->top);
+    ptrdiff_t oldcitop = savestack(L, ci->top);
+    int n;
+    luaD_checkstack(L, LUA_MINSTACK + 1);
+    ci->top = L->top + LUA_MINSTACK + 1;  /* room for 'icacheread' */
+    setobj2s(L, L->top, &ut);
+    L->top++;
+    n = g->icacheread(L, accessor);
+    if (n > 0)
+      setobjs2s(L, restorestack(L, res), L->top - 1);
+    L->top = restorestack(L, oldtop);
+    ci->top = restorestack(L, oldcitop);
+    if (n == 0)  /* accessor refused; fall back to '__index' */
+      luaV_finishget(L, &ut, &kt, restorestack(L, res), NULL);
+  }
+}
+#endif
+
+
 /*
 ** Finish a table assignment 't[key] = val'.
 ** If 'slot' is NULL, 't' is not a table.  Otherwise, 'slot' points
@@ -1258,6 +1328,10 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         if (luaV_fastget(L, rb, key, slot, luaH_getshortstr)) {
           setobj2s(L, ra, slot);
         }
+#if LUA_UDATA_ICACHE
+        else if (ttisfulluserdata(rb) && G(L)->icacheindex != NULL)
+          Protect(udataget(L, cl->p, pc, rb, rc, ra));
+#endif
         else
           Protect(luaV_finishget(L, rb, rc, ra, slot));
         vmbreak;
@@ -1342,6 +1416,10 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         if (luaV_fastget(L, rb, key, slot, luaH_getstr)) {
           setobj2s(L, ra, slot);
         }
+#if LUA_UDATA_ICACHE
+        else if (ttisfulluserdata(rb) && G(L)->icacheindex != NULL)
+          Protect(udataget(L, cl->p, pc, rb, rc, ra));
+#endif
         else
           Protect(luaV_finishget(L, rb, rc, ra, slot));
         vmbreak;
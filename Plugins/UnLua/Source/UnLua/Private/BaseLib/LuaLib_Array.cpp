@@ -15,6 +15,7 @@
 #include "UnLuaEx.h"
 #include "LuaCore.h"
 #include "Containers/LuaArray.h"
+#include "Containers/LuaArrayView.h"
 
 static int32 TArray_New(lua_State *L)
 {
@@ -625,19 +626,514 @@ static int32 TArray_ToTable(lua_State *L)
         return 0;
     }
 
-    lua_newtable(L);
+    // 数值元素直接按类型读取，不经过ElementCache和虚函数
+    const FLuaArrayLayout &Layout = Array->GetLayout();
+    if (Layout.IsScalar())
+    {
+        const FLuaArrayView View = { Array, Layout };
+        View.ToTable(L);
+        return 1;
+    }
+
+    lua_createtable(L, Array->Num(), 0);
     Array->Inner->Initialize(Array->ElementCache);
     for (int32 i = 0; i < Array->Num(); ++i)
     {
-        lua_pushinteger(L, i + 1);
         Array->Get(i, Array->ElementCache);
         Array->Inner->Read(L, Array->ElementCache, true);
-        lua_rawset(L, -3);
+        lua_rawseti(L, -2, i + 1);
     }
     Array->Inner->Destruct(Array->ElementCache);
     return 1;
 }
 
+/**
+ * Create an array from a Lua table, e.g. UE.TArray.FromTable(UE.FVector, Positions). The array is presized and numeric
+ * elements are converted with typed loops
+ * 由Lua表创建数组，一次分配好空间，数值元素按类型直接转换
+ * @see FLuaArray::FromTable(...)
+ */
+static int32 TArray_FromTable(lua_State *L)
+{
+    int32 NumParams = lua_gettop(L);
+    if (NumParams != 2 || !lua_istable(L, 2))
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid parameters!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    TSharedPtr<UnLua::ITypeInterface> TypeInterface(CreateTypeInterface(L, 1));
+    if (!TypeInterface)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Failed to create TArray!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    FScriptArray *ScriptArray = new FScriptArray;
+    void *Userdata = NewScriptContainer(L, FScriptContainerDesc::Array);
+    FLuaArray *Array = new(Userdata) FLuaArray(ScriptArray, TypeInterface, FLuaArray::OwnedBySelf);
+    Array->FromTable(L, 2);
+    return 1;
+}
+
+/**
+ * Iterator of 'pairs(Array)', reads elements in place. Upvalues: the array, the next index, the length, the
+ * storage address and the modification count when the iteration started
+ * pairs(Array)的迭代器，直接从存储读取元素，不再构造整张Lua表
+ */
+static int32 TArray_Next(lua_State *L)
+{
+    FLuaArray *Array = (FLuaArray*)(GetCppInstanceFast(L, lua_upvalueindex(1)));
+    if (!Array)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid TArray!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    if (Array->NumModifications != (uint32)lua_tointeger(L, lua_upvalueindex(5))
+        || Array->Num() != lua_tointeger(L, lua_upvalueindex(3)) || Array->GetData() != lua_touserdata(L, lua_upvalueindex(4)))
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: TArray is modified during iteration!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    const int32 Index = (int32)lua_tointeger(L, lua_upvalueindex(2));
+    if (Index >= Array->Num())
+    {
+        return 0;
+    }
+
+    lua_pushinteger(L, Index + 1);
+    lua_copy(L, -1, lua_upvalueindex(2));
+    Array->Inner->Read(L, Array->GetData(Index), true);
+    return 2;
+}
+
+/**
+ * for i, v in pairs(Array) do ... end
+ */
+static int32 TArray_Pairs(lua_State *L)
+{
+    FLuaArray *Array = (FLuaArray*)(GetCppInstanceFast(L, 1));
+    if (!Array && lua_istable(L, 1))
+    {
+        // the class table 'UE.TArray' itself, iterate it as a plain table
+        lua_getglobal(L, "next");
+        lua_pushvalue(L, 1);
+        lua_pushnil(L);
+        return 3;
+    }
+    if (!Array)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid TArray!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    lua_pushvalue(L, 1);
+    lua_pushinteger(L, 0);
+    lua_pushinteger(L, Array->Num());
+    lua_pushlightuserdata(L, Array->GetData());
+    lua_pushinteger(L, Array->NumModifications);
+    lua_pushcclosure(L, TArray_Next, 5);
+    return 1;
+}
+
+/**
+ * Sort the array in place. Array:Sort() and Array:Sort(true) use the built-in ascending/descending ordering of numbers,
+ * FName and FString, Array:Sort(function(A, B) return A < B end) works for any element type
+ * 原地排序，不传比较函数时按内置顺序（数值、FName、FString）升序或降序排序，传入比较函数时支持任意元素类型
+ */
+static int32 TArray_Sort(lua_State *L)
+{
+    int32 NumParams = lua_gettop(L);
+    if (NumParams < 1 || NumParams > 2)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid parameters!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    FLuaArray *Array = (FLuaArray*)(GetCppInstanceFast(L, 1));
+    if (!Array)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid TArray!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    if (!lua_isfunction(L, 2))
+    {
+        if (!Array->Sort(!!lua_toboolean(L, 2)))
+        {
+            UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Elements of the TArray have no built-in ordering, a comparator is required!"), ANSI_TO_TCHAR(__FUNCTION__));
+        }
+        return 0;
+    }
+
+    // read every element once, the comparator only sees the cached values. The array isn't touched until the order
+    // is known, so an error raised by the comparator leaves it unchanged
+    // 每个元素只读取一次，排好下标后再一次性重排，比较函数出错时数组保持不变
+    const int32 N = Array->Num();
+    lua_createtable(L, N, 0);
+    for (int32 i = 0; i < N; ++i)
+    {
+        Array->Inner->Read(L, Array->GetData(i), true);
+        lua_rawseti(L, 3, i + 1);
+    }
+
+    int32 *Order = (int32*)lua_newuserdatauv(L, FMath::Max(N, 1) * sizeof(int32), 0);     // collected by Lua even if the comparator raises an error
+    for (int32 i = 0; i < N; ++i)
+    {
+        Order[i] = i;
+    }
+    TArrayView<int32> Indices(Order, N);
+    Algo::Sort(Indices, [L](int32 A, int32 B)
+    {
+        lua_pushvalue(L, 2);
+        lua_rawgeti(L, 3, A + 1);
+        lua_rawgeti(L, 3, B + 1);
+        lua_call(L, 2, 1);
+        const bool bLess = !!lua_toboolean(L, -1);
+        lua_pop(L, 1);
+        return bLess;
+    });
+
+    if (Array->Num() != N)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: TArray is modified during sorting!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+    Array->Permute(Order);
+    return 0;
+}
+
+/**
+ * Binary search in an array sorted with the built-in ordering, Array:BinarySearch(Value, bDescending)
+ * 在按内置顺序排好序的数组里二分查找，降序排列的数组需要传入true
+ *
+ * @see FLuaArray::BinarySearch(...)
+ */
+static int32 TArray_BinarySearch(lua_State *L)
+{
+    int32 NumParams = lua_gettop(L);
+    if (NumParams < 2 || NumParams > 3)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid parameters!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    FLuaArray *Array = (FLuaArray*)(GetCppInstanceFast(L, 1));
+    if (!Array)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid TArray!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    if (!Array->HasBuiltinOrder())
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Elements of the TArray have no built-in ordering!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    Array->Inner->Initialize(Array->ElementCache);
+    Array->Inner->Write(L, Array->ElementCache, 2);
+    int32 Index = Array->BinarySearch(Array->ElementCache, !!lua_toboolean(L, 3));
+    Array->Inner->Destruct(Array->ElementCache);
+    ++Index;
+    lua_pushinteger(L, Index);
+    return 1;
+}
+
+/**
+ * Index of the first element that satisfies the predicate, Array:IndexOfBy(function(Element, Index) ... end)
+ * 返回第一个满足条件的元素的索引，找不到时返回0
+ */
+static int32 TArray_IndexOfBy(lua_State *L)
+{
+    int32 NumParams = lua_gettop(L);
+    if (NumParams != 2 || !lua_isfunction(L, 2))
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid parameters!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    FLuaArray *Array = (FLuaArray*)(GetCppInstanceFast(L, 1));
+    if (!Array)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid TArray!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    // 每次调用之后都重新检查长度，条件函数可能修改数组
+    for (int32 i = 0; i < Array->Num(); ++i)
+    {
+        lua_pushvalue(L, 2);
+        Array->Inner->Read(L, Array->GetData(i), true);
+        lua_pushinteger(L, i + 1);
+        lua_call(L, 2, 1);
+        const bool bFound = !!lua_toboolean(L, -1);
+        lua_pop(L, 1);
+        if (bFound)
+        {
+            lua_pushinteger(L, i + 1);
+            return 1;
+        }
+    }
+
+    lua_pushinteger(L, 0);
+    return 1;
+}
+
+/**
+ * Create a new array with the elements that satisfy the predicate, Array:FilterByPredicate(function(Element, Index) ... end)
+ * 用满足条件的元素创建一个新数组，元素类型和原数组一致
+ */
+static int32 TArray_FilterByPredicate(lua_State *L)
+{
+    int32 NumParams = lua_gettop(L);
+    if (NumParams != 2 || !lua_isfunction(L, 2))
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid parameters!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    FLuaArray *Array = (FLuaArray*)(GetCppInstanceFast(L, 1));
+    if (!Array)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid TArray!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    FScriptArray *ScriptArray = new FScriptArray;
+    void *Userdata = NewScriptContainer(L, FScriptContainerDesc::Array);
+    FLuaArray *Result = new(Userdata) FLuaArray(ScriptArray, Array->Inner, FLuaArray::OwnedBySelf);
+
+    const int32 N = Array->Num();
+    for (int32 i = 0; i < N; ++i)
+    {
+        lua_pushvalue(L, 2);
+        Array->Inner->Read(L, Array->GetData(i), true);
+        lua_pushinteger(L, i + 1);
+        lua_call(L, 2, 1);
+        const bool bSelected = !!lua_toboolean(L, -1);
+        lua_pop(L, 1);
+        if (Array->Num() != N)
+        {
+            UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: TArray is modified during filtering!"), ANSI_TO_TCHAR(__FUNCTION__));
+            return 0;
+        }
+        if (bSelected)
+        {
+            Result->Add(Array->GetData(i));
+        }
+    }
+    return 1;
+}
+
+static const char* const ArrayViewMetatableName = "TArrayView";
+
+static FLuaArrayView* CheckArrayView(lua_State *L, int32 Index)
+{
+    return (FLuaArrayView*)luaL_checkudata(L, Index, ArrayViewMetatableName);
+}
+
+/**
+ * view[i], 1-based scalar index. Other keys are looked up in the method table
+ */
+static int32 TArrayView_Index(lua_State *L)
+{
+    const FLuaArrayView *View = CheckArrayView(L, 1);
+    if (lua_isinteger(L, 2))
+    {
+        const lua_Integer Index = lua_tointeger(L, 2) - 1;
+        if (Index >= 0 && Index < View->Num())
+        {
+            View->Read(L, (int32)Index);
+        }
+        else
+        {
+            lua_pushnil(L);
+        }
+        return 1;
+    }
+
+    lua_pushvalue(L, 2);
+    lua_rawget(L, lua_upvalueindex(1));
+    return 1;
+}
+
+/**
+ * view[i] = value
+ */
+static int32 TArrayView_NewIndex(lua_State *L)
+{
+    const FLuaArrayView *View = CheckArrayView(L, 1);
+    const lua_Integer Index = lua_isinteger(L, 2) ? lua_tointeger(L, 2) - 1 : -1;
+    if (Index < 0 || Index >= View->Num())
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: TArray view invalid index!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    View->Write(L, (int32)Index, 3);
+    return 0;
+}
+
+/**
+ * Number of scalars
+ */
+static int32 TArrayView_Length(lua_State *L)
+{
+    const FLuaArrayView *View = CheckArrayView(L, 1);
+    lua_pushinteger(L, View->Num());
+    return 1;
+}
+
+/**
+ * Number of elements
+ */
+static int32 TArrayView_Num(lua_State *L)
+{
+    const FLuaArrayView *View = CheckArrayView(L, 1);
+    lua_pushinteger(L, View->Array->Num());
+    return 1;
+}
+
+/**
+ * Number of scalars per element
+ */
+static int32 TArrayView_Components(lua_State *L)
+{
+    const FLuaArrayView *View = CheckArrayView(L, 1);
+    lua_pushinteger(L, View->Layout.NumComponents);
+    return 1;
+}
+
+/**
+ * Get all components of the i'th element, e.g. 'local X, Y, Z = View:Get(i)' for TArray<FVector>
+ */
+static int32 TArrayView_Get(lua_State *L)
+{
+    const FLuaArrayView *View = CheckArrayView(L, 1);
+    const int32 Index = (int32)luaL_checkinteger(L, 2) - 1;
+    if (!View->Array->IsValidIndex(Index))
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: TArray view invalid index!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    const int32 NumComponents = View->Layout.NumComponents;
+    luaL_checkstack(L, NumComponents, nullptr);
+    for (int32 c = 0; c < NumComponents; ++c)
+    {
+        View->Read(L, Index * NumComponents + c);
+    }
+    return NumComponents;
+}
+
+/**
+ * Set the components of the i'th element, e.g. 'View:Set(i, X, Y, Z)' for TArray<FVector>
+ */
+static int32 TArrayView_Set(lua_State *L)
+{
+    const FLuaArrayView *View = CheckArrayView(L, 1);
+    const int32 Index = (int32)luaL_checkinteger(L, 2) - 1;
+    if (!View->Array->IsValidIndex(Index))
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: TArray view invalid index!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    const int32 NumComponents = FMath::Min(lua_gettop(L) - 2, (int32)View->Layout.NumComponents);
+    for (int32 c = 0; c < NumComponents; ++c)
+    {
+        View->Write(L, Index * View->Layout.NumComponents + c, c + 3);
+    }
+    return 0;
+}
+
+/**
+ * @see FLuaArrayView::ToTable(...)
+ */
+static int32 TArrayView_ToTable(lua_State *L)
+{
+    const FLuaArrayView *View = CheckArrayView(L, 1);
+    View->ToTable(L);
+    return 1;
+}
+
+/**
+ * @see FLuaArrayView::FromTable(...)
+ */
+static int32 TArrayView_FromTable(lua_State *L)
+{
+    const FLuaArrayView *View = CheckArrayView(L, 1);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    lua_pushinteger(L, View->FromTable(L, 2));
+    return 1;
+}
+
+static const luaL_Reg TArrayViewLib[] =
+{
+    { "Num", TArrayView_Num },
+    { "Components", TArrayView_Components },
+    { "Get", TArrayView_Get },
+    { "Set", TArrayView_Set },
+    { "ToTable", TArrayView_ToTable },
+    { "FromTable", TArrayView_FromTable },
+    { nullptr, nullptr }
+};
+
+/**
+ * Create a typed view over the storage of an array of numbers or POD structs of numbers, see FLuaArrayView
+ * 为数值或者数值结构体数组创建标量视图，按下标直接读写底层存储，10k以上元素的批量读写不再逐个调用虚函数
+ */
+static int32 TArray_View(lua_State *L)
+{
+    int32 NumParams = lua_gettop(L);
+    if (NumParams != 1)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid parameters!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    FLuaArray *Array = (FLuaArray*)(GetCppInstanceFast(L, 1));
+    if (!Array)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid TArray!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    const FLuaArrayLayout &Layout = Array->GetLayout();
+    if (!Layout.IsValid())
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Elements of the TArray are neither numbers nor POD structs of numbers!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    FLuaArrayView *View = (FLuaArrayView*)lua_newuserdatauv(L, sizeof(FLuaArrayView), 1);
+    View->Array = Array;
+    View->Layout = Layout;
+    lua_pushvalue(L, 1);
+    lua_setiuservalue(L, -2, 1);                    // the view keeps the array alive
+
+    if (luaL_newmetatable(L, ArrayViewMetatableName))
+    {
+        lua_pushstring(L, "__index");
+        luaL_newlib(L, TArrayViewLib);
+        lua_pushcclosure(L, TArrayView_Index, 1);
+        lua_rawset(L, -3);
+
+        lua_pushstring(L, "__newindex");
+        lua_pushcfunction(L, TArrayView_NewIndex);
+        lua_rawset(L, -3);
+
+        lua_pushstring(L, "__len");
+        lua_pushcfunction(L, TArrayView_Length);
+        lua_rawset(L, -3);
+    }
+    lua_setmetatable(L, -2);
+    return 1;
+}
+
 /**
  * UE中数组类型为TArray，把TArray在lua中对应的数据结构是UserData，UserData里存的是FLuaArray
  * TArray底层使用FScriptArray来存储数据，因此FLuaArray内部维护了一个指向FScriptArray的指针来获取数组数据，并且实现了很多方法来对数组进行操作，比如常用的添加、删除等操作
@@ -665,6 +1161,13 @@ static const luaL_Reg TArrayLib[] =
     { "Contains", TArray_Contains },
     { "Append", TArray_Append },
     { "ToTable", TArray_ToTable },
+    { "FromTable", TArray_FromTable },
+    { "Sort", TArray_Sort },
+    { "BinarySearch", TArray_BinarySearch },
+    { "IndexOfBy", TArray_IndexOfBy },
+    { "FilterByPredicate", TArray_FilterByPredicate },
+    { "View", TArray_View },
+    { "__pairs", TArray_Pairs },
     { "__gc", TArray_Delete },
     { "__call", TArray_New },
     { nullptr, nullptr }
@@ -87,12 +87,16 @@ static int32 TMap_Add(lua_State *L)
     }
 
     void *ValueCache = (uint8*)Map->ElementCache + Map->MapLayout.ValueOffset;
-    Map->KeyInterface->Initialize(Map->ElementCache);
     Map->ValueInterface->Initialize(ValueCache);
-    Map->KeyInterface->Write(L, Map->ElementCache, 2);
     Map->ValueInterface->Write(L, Map->ValueInterface->GetOffset() > 0 ? Map->ElementCache : ValueCache, 3);
-    Map->Add(Map->ElementCache, ValueCache);
-    Map->KeyInterface->Destruct(Map->ElementCache);
+    // 常见的key类型直接由Lua值计算hash，不需要写到ElementCache
+    if (!Map->AddFromLua(L, 2, ValueCache))
+    {
+        Map->KeyInterface->Initialize(Map->ElementCache);
+        Map->KeyInterface->Write(L, Map->ElementCache, 2);
+        Map->Add(Map->ElementCache, ValueCache);
+        Map->KeyInterface->Destruct(Map->ElementCache);
+    }
     Map->ValueInterface->Destruct(ValueCache);
     return 0;
 }
@@ -116,10 +120,14 @@ static int32 TMap_Remove(lua_State *L)
         return 0;
     }
 
-    Map->KeyInterface->Initialize(Map->ElementCache);
-    Map->KeyInterface->Write(L, Map->ElementCache, 2);
-    bool bSuccess = Map->Remove(Map->ElementCache);
-    Map->KeyInterface->Destruct(Map->ElementCache);
+    bool bSuccess = false;
+    if (!Map->RemoveFromLua(L, 2, bSuccess))
+    {
+        Map->KeyInterface->Initialize(Map->ElementCache);
+        Map->KeyInterface->Write(L, Map->ElementCache, 2);
+        bSuccess = Map->Remove(Map->ElementCache);
+        Map->KeyInterface->Destruct(Map->ElementCache);
+    }
     lua_pushboolean(L, bSuccess);
     return 1;
 }
@@ -143,6 +151,21 @@ static int32 TMap_Find(lua_State *L)
         return 0;
     }
 
+    // 常见的key类型直接由Lua值查找，值也直接从Map里读取，不需要复制到ElementCache
+    uint8 *Value = nullptr;
+    if (Map->FindFromLua(L, 2, Value))
+    {
+        if (Value)
+        {
+            Map->ValueInterface->Read(L, Value - Map->ValueInterface->GetOffset(), true);
+        }
+        else
+        {
+            lua_pushnil(L);
+        }
+        return 1;
+    }
+
     void *ValueCache = (uint8*)Map->ElementCache + Map->MapLayout.ValueOffset;
     Map->KeyInterface->Initialize(Map->ElementCache);
     Map->ValueInterface->Initialize(ValueCache);
@@ -180,6 +203,20 @@ static int32 TMap_FindRef(lua_State *L)
         return 0;
     }
 
+    uint8 *FoundValue = nullptr;
+    if (Map->FindFromLua(L, 2, FoundValue))
+    {
+        if (FoundValue)
+        {
+            Map->ValueInterface->Read(L, FoundValue - Map->ValueInterface->GetOffset(), false);
+        }
+        else
+        {
+            lua_pushnil(L);
+        }
+        return 1;
+    }
+
     Map->KeyInterface->Initialize(Map->ElementCache);
     Map->KeyInterface->Write(L, Map->ElementCache, 2);
     void *Value = Map->Find(Map->ElementCache);
@@ -339,6 +376,75 @@ static int32 TMap_ToTable(lua_State *L)
     return 1;
 }
 
+/**
+ * Iterator of 'pairs(Map)', walks the sparse storage and reads pairs in place. Upvalues: the map, the next sparse
+ * index, the number of pairs, the storage address and the modification count when the iteration started
+ * pairs(Map)的迭代器，直接遍历稀疏存储，不再构造Keys数组和整张Lua表
+ */
+static int32 TMap_Next(lua_State *L)
+{
+    FLuaMap *Map = (FLuaMap*)(GetCppInstanceFast(L, lua_upvalueindex(1)));
+    if (!Map)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid TMap!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    if (Map->NumModifications != (uint32)lua_tointeger(L, lua_upvalueindex(5))
+        || Map->Num() != lua_tointeger(L, lua_upvalueindex(3)) || Map->GetData(0) != lua_touserdata(L, lua_upvalueindex(4)))
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: TMap is modified during iteration!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    const int32 Index = Map->FindNextIndex((int32)lua_tointeger(L, lua_upvalueindex(2)));
+    if (Index == INDEX_NONE)
+    {
+        return 0;
+    }
+
+    lua_pushinteger(L, Index + 1);
+    lua_replace(L, lua_upvalueindex(2));
+
+    uint8 *Pair = Map->GetData(Index);
+    int32 KeyOffset = 0;
+#if ENGINE_MAJOR_VERSION <= 4 && ENGINE_MINOR_VERSION < 22
+    KeyOffset = Map->MapLayout.KeyOffset;
+#endif
+    Map->KeyInterface->Read(L, Pair + KeyOffset, true);
+    Map->ValueInterface->Read(L, Map->ValueInterface->GetOffset() > 0 ? Pair : Pair + Map->MapLayout.ValueOffset, true);
+    return 2;
+}
+
+/**
+ * for k, v in pairs(Map) do ... end
+ */
+static int32 TMap_Pairs(lua_State *L)
+{
+    FLuaMap *Map = (FLuaMap*)(GetCppInstanceFast(L, 1));
+    if (!Map && lua_istable(L, 1))
+    {
+        // the class table 'UE.TMap' itself, iterate it as a plain table
+        lua_getglobal(L, "next");
+        lua_pushvalue(L, 1);
+        lua_pushnil(L);
+        return 3;
+    }
+    if (!Map)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid TMap!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    lua_pushvalue(L, 1);
+    lua_pushinteger(L, 0);
+    lua_pushinteger(L, Map->Num());
+    lua_pushlightuserdata(L, Map->GetData(0));
+    lua_pushinteger(L, Map->NumModifications);
+    lua_pushcclosure(L, TMap_Next, 5);
+    return 1;
+}
+
 static const luaL_Reg TMapLib[] =
 {
     { "Length", TMap_Length },
@@ -350,6 +456,7 @@ static const luaL_Reg TMapLib[] =
     { "Keys", TMap_Keys },
     { "Values", TMap_Values },
     { "ToTable", TMap_ToTable },
+    { "__pairs", TMap_Pairs },
     { "__gc", TMap_Delete },
     { "__call", TMap_New },
     { nullptr, nullptr }
@@ -80,10 +80,14 @@ static int32 TSet_Add(lua_State *L)
         return 0;
     }
 
-    Set->ElementInterface->Initialize(Set->ElementCache);
-    Set->ElementInterface->Write(L, Set->ElementCache, 2);
-    Set->Add(Set->ElementCache);
-    Set->ElementInterface->Destruct(Set->ElementCache);
+    // 常见的元素类型直接由Lua值计算hash，不需要写到ElementCache
+    if (!Set->AddFromLua(L, 2))
+    {
+        Set->ElementInterface->Initialize(Set->ElementCache);
+        Set->ElementInterface->Write(L, Set->ElementCache, 2);
+        Set->Add(Set->ElementCache);
+        Set->ElementInterface->Destruct(Set->ElementCache);
+    }
     return 0;
 }
 
@@ -106,10 +110,14 @@ static int32 TSet_Remove(lua_State *L)
         return 0;
     }
 
-    Set->ElementInterface->Initialize(Set->ElementCache);
-    Set->ElementInterface->Write(L, Set->ElementCache, 2);
-    bool bSuccess = Set->Remove(Set->ElementCache);
-    Set->ElementInterface->Destruct(Set->ElementCache);
+    bool bSuccess = false;
+    if (!Set->RemoveFromLua(L, 2, bSuccess))
+    {
+        Set->ElementInterface->Initialize(Set->ElementCache);
+        Set->ElementInterface->Write(L, Set->ElementCache, 2);
+        bSuccess = Set->Remove(Set->ElementCache);
+        Set->ElementInterface->Destruct(Set->ElementCache);
+    }
     lua_pushboolean(L, bSuccess);
     return 1;
 }
@@ -133,10 +141,19 @@ static int32 TSet_Contains(lua_State *L)
         return 0;
     }
 
-    Set->ElementInterface->Initialize(Set->ElementCache);
-    Set->ElementInterface->Write(L, Set->ElementCache, 2);
-    bool bSuccess = Set->Contains(Set->ElementCache);
-    Set->ElementInterface->Destruct(Set->ElementCache);
+    int32 Index = INDEX_NONE;
+    bool bSuccess = false;
+    if (Set->FindFromLua(L, 2, Index))
+    {
+        bSuccess = Index != INDEX_NONE;
+    }
+    else
+    {
+        Set->ElementInterface->Initialize(Set->ElementCache);
+        Set->ElementInterface->Write(L, Set->ElementCache, 2);
+        bSuccess = Set->Contains(Set->ElementCache);
+        Set->ElementInterface->Destruct(Set->ElementCache);
+    }
     lua_pushboolean(L, bSuccess);
     return 1;
 }
@@ -246,6 +263,74 @@ static int32 TSet_ToTable(lua_State *L)
     return 1;
 }
 
+/**
+ * Iterator of 'pairs(Set)', yields (n, element) like 'pairs(Set:ToTable())'. Upvalues: the set, the next sparse
+ * index, the number of elements, the storage address and the modification count when the iteration started, the
+ * ordinal of the next element
+ * pairs(Set)的迭代器，直接遍历稀疏存储，返回(序号, 元素)，和遍历ToTable()的结果一致
+ */
+static int32 TSet_Next(lua_State *L)
+{
+    FLuaSet *Set = (FLuaSet*)(GetCppInstanceFast(L, lua_upvalueindex(1)));
+    if (!Set)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid TSet!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    if (Set->NumModifications != (uint32)lua_tointeger(L, lua_upvalueindex(6))
+        || Set->Num() != lua_tointeger(L, lua_upvalueindex(3)) || Set->GetData(0) != lua_touserdata(L, lua_upvalueindex(4)))
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: TSet is modified during iteration!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    const int32 Index = Set->FindNextIndex((int32)lua_tointeger(L, lua_upvalueindex(2)));
+    if (Index == INDEX_NONE)
+    {
+        return 0;
+    }
+
+    lua_pushinteger(L, Index + 1);
+    lua_replace(L, lua_upvalueindex(2));
+
+    const lua_Integer Ordinal = lua_tointeger(L, lua_upvalueindex(5)) + 1;
+    lua_pushinteger(L, Ordinal);
+    lua_copy(L, -1, lua_upvalueindex(5));
+    Set->ElementInterface->Read(L, Set->GetData(Index), true);
+    return 2;
+}
+
+/**
+ * for _, Element in pairs(Set) do ... end
+ */
+static int32 TSet_Pairs(lua_State *L)
+{
+    FLuaSet *Set = (FLuaSet*)(GetCppInstanceFast(L, 1));
+    if (!Set && lua_istable(L, 1))
+    {
+        // the class table 'UE.TSet' itself, iterate it as a plain table
+        lua_getglobal(L, "next");
+        lua_pushvalue(L, 1);
+        lua_pushnil(L);
+        return 3;
+    }
+    if (!Set)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid TSet!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    lua_pushvalue(L, 1);
+    lua_pushinteger(L, 0);
+    lua_pushinteger(L, Set->Num());
+    lua_pushlightuserdata(L, Set->GetData(0));
+    lua_pushinteger(L, 0);
+    lua_pushinteger(L, Set->NumModifications);
+    lua_pushcclosure(L, TSet_Next, 6);
+    return 1;
+}
+
 static const luaL_Reg TSetLib[] =
 {
     { "Length", TSet_Length },
@@ -255,6 +340,7 @@ static const luaL_Reg TSetLib[] =
     { "Clear", TSet_Clear },
     { "ToArray", TSet_ToArray },
     { "ToTable", TSet_ToTable },
+    { "__pairs", TSet_Pairs },
     { "__gc", TSet_Delete },
     { "__call", TSet_New },
     { nullptr, nullptr }
@@ -15,6 +15,37 @@
 #pragma once
 
 #include "LuaContainerInterface.h"
+#include "LuaArrayLayout.h"
+#include "Algo/Sort.h"
+#include "Algo/BinarySearch.h"
+
+// 标量和Lua值之间的转换，和数值属性的Read/Write一致
+namespace UnLuaArrayView
+{
+    template <typename T>
+    FORCEINLINE typename TEnableIf<TIsFloatingPoint<T>::Value>::Type Push(lua_State *L, T Value)
+    {
+        lua_pushnumber(L, (lua_Number)Value);
+    }
+
+    template <typename T>
+    FORCEINLINE typename TEnableIf<!TIsFloatingPoint<T>::Value>::Type Push(lua_State *L, T Value)
+    {
+        lua_pushinteger(L, (lua_Integer)Value);
+    }
+
+    template <typename T>
+    FORCEINLINE typename TEnableIf<TIsFloatingPoint<T>::Value, T>::Type To(lua_State *L, int32 Index)
+    {
+        return (T)lua_tonumber(L, Index);
+    }
+
+    template <typename T>
+    FORCEINLINE typename TEnableIf<!TIsFloatingPoint<T>::Value, T>::Type To(lua_State *L, int32 Index)
+    {
+        return (T)lua_tointeger(L, Index);
+    }
+}
 
 class FLuaArray
 {
@@ -28,7 +59,7 @@ public:
     };
 
     FLuaArray(const FScriptArray *InScriptArray, TSharedPtr<UnLua::ITypeInterface> InInnerInterface, EScriptArrayFlag Flag = OwnedByOther)
-        : ScriptArray((FScriptArray*)InScriptArray), Inner(InInnerInterface), Interface(nullptr), ElementCache(nullptr), ElementSize(Inner->GetSize()), ScriptArrayFlag(Flag)
+        : ScriptArray((FScriptArray*)InScriptArray), Inner(InInnerInterface), Interface(nullptr), ElementCache(nullptr), ElementSize(Inner->GetSize()), ScriptArrayFlag(Flag), NumModifications(0), bLayoutInitialized(false)
     {
         // allocate cache for a single element
         // 为单个元素分配缓存
@@ -36,7 +67,7 @@ public:
     }
 
     FLuaArray(const FScriptArray *InScriptArray, TLuaContainerInterface<FLuaArray> *InArrayInterface, EScriptArrayFlag Flag = OwnedByOther)
-        : ScriptArray((FScriptArray*)InScriptArray), Interface(InArrayInterface), ElementCache(nullptr), ElementSize(0), ScriptArrayFlag(Flag)
+        : ScriptArray((FScriptArray*)InScriptArray), Interface(InArrayInterface), ElementCache(nullptr), ElementSize(0), ScriptArrayFlag(Flag), NumModifications(0), bLayoutInitialized(false)
     {
         if (Interface)
         {
@@ -139,6 +170,7 @@ public:
      */
     FORCEINLINE int32 AddDefaulted(int32 Count = 1)
     {
+        ++NumModifications;
         int32 Index = ScriptArray->Add(Count, ElementSize);
         Construct(Index, Count);
         return Index;
@@ -153,6 +185,7 @@ public:
      */
     FORCEINLINE int32 AddUninitialized(int32 Count = 1)
     {
+        ++NumModifications;
         return ScriptArray->Add(Count, ElementSize);
     }
 
@@ -165,6 +198,13 @@ public:
      */
     FORCEINLINE int32 Find(const void *Item) const
     {
+        // 数值和数值POD结构体直接按类型比较，不逐个调用虚函数Identical
+        const FLuaArrayLayout &ElementLayout = GetLayout();
+        if (ElementLayout.CanCompareComponents())
+        {
+            return ElementLayout.Find(GetData(0), Num(), ElementSize, Item);
+        }
+
         int32 Index = INDEX_NONE;
         for (int32 i = 0; i < Num(); ++i)
         {
@@ -190,6 +230,7 @@ public:
     {
         if (Index >= 0 && Index <= Num())
         {
+            ++NumModifications;
             ScriptArray->Insert(Index, 1, ElementSize);
             Construct(Index, 1);
             uint8 *Dest = GetData(Index);
@@ -207,6 +248,7 @@ public:
     {
         if (IsValidIndex(Index))
         {
+            ++NumModifications;
             Destruct(Index);
             ScriptArray->Remove(Index, 1, ElementSize);
         }
@@ -240,6 +282,7 @@ public:
     {
         if (Num())
         {
+            ++NumModifications;
             Destruct(0, Num());
             ScriptArray->Empty(0, ElementSize);
         }
@@ -258,6 +301,7 @@ public:
         {
             return false;
         }
+        ++NumModifications;
         ScriptArray->Empty(Size, ElementSize);
         return true;
     }
@@ -279,6 +323,7 @@ public:
             }
             else if (Count < 0)
             {
+                ++NumModifications;
                 Destruct(NewSize, -Count);
                 ScriptArray->Remove(NewSize, -Count, ElementSize);
             }
@@ -328,6 +373,7 @@ public:
         {
             if (IsValidIndex(A) && IsValidIndex(B))
             {
+                ++NumModifications;
                 ScriptArray->SwapMemory(A, B, ElementSize);
             }
         }
@@ -339,6 +385,7 @@ public:
      */
     FORCEINLINE void Shuffle()
     {
+        ++NumModifications;
         int32 LastIndex = Num() - 1;
         for (int32 i = 0; i <= LastIndex; ++i)
         {
@@ -370,6 +417,165 @@ public:
         }
     }
 
+    /**
+     * Replace the elements with the ones of a Lua table. A proper sequence (keys are exactly [1, #t]) is converted with
+     * the array resized once, and numeric elements are stored with typed loops instead of ITypeInterface::Write. Any
+     * other table, e.g. one with holes or non-integer keys, keeps every value in traversal order as before
+     * 用Lua表替换所有元素。严格的序列表(key正好是[1, #t])只调整一次大小，数值元素按类型直接写入，不经过虚函数；
+     * 其他表(有空洞或者非整数key)和以前一样按遍历顺序取出所有值
+     *
+     * @return - the number of elements
+     */
+    int32 FromTable(lua_State *L, int32 TableIndex)
+    {
+        ++NumModifications;
+        TableIndex = lua_absindex(L, TableIndex);
+        const int32 NumElements = (int32)lua_rawlen(L, TableIndex);
+        if (!IsSequence(L, TableIndex, NumElements))
+        {
+            Clear();
+            lua_pushnil(L);
+            while (lua_next(L, TableIndex) != 0)
+            {
+                const int32 Index = AddDefaulted();
+                Inner->Write(L, GetData(Index), -1);
+                lua_pop(L, 1);
+            }
+            return Num();
+        }
+
+        const FLuaArrayLayout &ElementLayout = GetLayout();
+        if (!ElementLayout.IsScalar())
+        {
+            Resize(NumElements);
+            for (int32 i = 0; i < NumElements; ++i)
+            {
+                lua_rawgeti(L, TableIndex, i + 1);
+                Inner->Write(L, GetData(i), -1);
+                lua_pop(L, 1);
+            }
+            return NumElements;
+        }
+
+        const int32 Count = NumElements - Num();
+        if (Count > 0)
+        {
+            AddUninitialized(Count);            // every element is written below
+        }
+        else if (Count < 0)
+        {
+            Resize(NumElements);
+        }
+        void *Data = GetData();
+        ElementLayout.Dispatch([L, TableIndex, NumElements, Data](auto *Type)
+        {
+            using T = typename TRemovePointer<decltype(Type)>::Type;
+            T *Elements = (T*)Data;
+            for (int32 i = 0; i < NumElements; ++i)
+            {
+                lua_rawgeti(L, TableIndex, i + 1);
+                Elements[i] = UnLuaArrayView::To<T>(L, -1);
+                lua_pop(L, 1);
+            }
+        });
+        return NumElements;
+    }
+
+    /**
+     * Get the scalar layout of the elements, computed on first use
+     * 获取元素的标量布局，第一次使用时计算
+     */
+    FORCEINLINE const FLuaArrayLayout& GetLayout() const
+    {
+        if (!bLayoutInitialized)
+        {
+            Layout.Initialize(Inner->GetUProperty());
+            bLayoutInitialized = true;
+        }
+        return Layout;
+    }
+
+    /**
+     * Check whether the elements have a built-in ordering: numbers, FName and FString
+     * 元素是否有内置的顺序，支持数值、FName和FString
+     */
+    FORCEINLINE bool HasBuiltinOrder() const
+    {
+        return DispatchOrdered([](auto *Type, auto Less) {});
+    }
+
+    /**
+     * Sort the elements with the built-in ordering. FName and FString are compared lexically and case-insensitively,
+     * same as UE
+     * 按内置的顺序排序，FName和FString按字符串比较，和UE一样不区分大小写
+     *
+     * @param bDescending - sort in descending order
+     * @return - false if the elements have no built-in ordering
+     */
+    bool Sort(bool bDescending)
+    {
+        ++NumModifications;
+        return DispatchOrdered([this, bDescending](auto *Type, auto Less)
+        {
+            using T = typename TRemovePointer<decltype(Type)>::Type;
+            TArrayView<T> Elements((T*)GetData(), Num());
+            if (bDescending)
+            {
+                Algo::Sort(Elements, [&Less](const T &A, const T &B) { return Less(B, A); });
+            }
+            else
+            {
+                Algo::Sort(Elements, Less);
+            }
+        });
+    }
+
+    /**
+     * Binary search in an array sorted with the built-in ordering
+     * 在按内置顺序排好序的数组里二分查找
+     *
+     * @param Item - the element
+     * @param bDescending - the array is sorted in descending order
+     * @return - index of the first element equal to 'Item', or INDEX_NONE if it's not found or the elements have no built-in ordering
+     */
+    int32 BinarySearch(const void *Item, bool bDescending) const
+    {
+        int32 Index = INDEX_NONE;
+        DispatchOrdered([this, Item, bDescending, &Index](auto *Type, auto Less)
+        {
+            using T = typename TRemovePointer<decltype(Type)>::Type;
+            auto Predicate = [&Less, bDescending](const T &A, const T &B) { return bDescending ? Less(B, A) : Less(A, B); };
+            const T &Value = *(const T*)Item;
+            const TArrayView<const T> Elements((const T*)GetData(), Num());
+            const int32 Found = Algo::LowerBound(Elements, Value, Predicate);
+            if (Found < Elements.Num() && !Predicate(Value, Elements[Found]))
+            {
+                Index = Found;
+            }
+        });
+        return Index;
+    }
+
+    /**
+     * Reorder the elements, the i'th element will be the one at Order[i]. Elements are relocated bitwise, the same
+     * way FScriptArray moves them
+     * 按给定的顺序重排元素，元素按内存搬移，和FScriptArray一样
+     *
+     * @param Order - a permutation of [0, Num)
+     */
+    void Permute(const int32 *Order)
+    {
+        ++NumModifications;
+        const int32 N = Num();
+        uint8 *Temp = (uint8*)FMemory::Malloc(FMath::Max(N * ElementSize, 1), Inner->GetAlignment());
+        for (int32 i = 0; i < N; ++i)
+        {
+            FMemory::Memcpy(Temp + i * ElementSize, GetData(Order[i]), ElementSize);
+        }
+        FMemory::Memcpy(GetData(), Temp, N * ElementSize);
+        FMemory::Free(Temp);
+    }
+
     /**
      * Get address of the i'th element
      * 获取索引处元素
@@ -409,8 +615,61 @@ public:
     void *ElementCache;            // can only hold one element...
     int32 ElementSize;
     EScriptArrayFlag ScriptArrayFlag;
+    uint32 NumModifications;       // bumped by every method that adds, removes or reorders elements, checked by pairs(Array)
 
 private:
+    mutable FLuaArrayLayout Layout;
+    mutable bool bLayoutInitialized;
+
+    /**
+     * Whether the keys of the table are exactly [1, Num]. Only the keys are visited, no value is converted
+     * 表的key是否正好是[1, Num]，只遍历key，不转换值
+     */
+    static bool IsSequence(lua_State *L, int32 TableIndex, int32 Num)
+    {
+        int32 NumKeys = 0;
+        lua_pushnil(L);
+        while (lua_next(L, TableIndex) != 0)
+        {
+            lua_pop(L, 1);
+            // keys are unique, so Num distinct integer keys in [1, Num] are all of them
+            const lua_Integer Key = lua_isinteger(L, -1) ? lua_tointeger(L, -1) : 0;
+            if (Key < 1 || Key > Num || ++NumKeys > Num)
+            {
+                lua_pop(L, 1);
+                return false;
+            }
+        }
+        return NumKeys == Num;
+    }
+
+    /**
+     * Call 'Func' with a typed null pointer and a 'less' predicate if the elements have a built-in ordering
+     * 按元素类型分派，同时传入比较函数
+     */
+    template <typename FuncType>
+    bool DispatchOrdered(FuncType &&Func) const
+    {
+        const FLuaArrayLayout &ElementLayout = GetLayout();
+        if (ElementLayout.IsScalar())
+        {
+            ElementLayout.Dispatch([&Func](auto *Type) { Func(Type, TLess<>()); });
+            return true;
+        }
+        const FProperty *Property = Inner->GetUProperty();
+        if (Property && Property->IsA<FNameProperty>())
+        {
+            Func((FName*)nullptr, [](const FName &A, const FName &B) { return A.Compare(B) < 0; });
+            return true;
+        }
+        if (Property && Property->IsA<FStrProperty>())
+        {
+            Func((FString*)nullptr, TLess<>());
+            return true;
+        }
+        return false;
+    }
+
     /**
      * Construct n elements
      * 构造N个元素
@@ -0,0 +1,219 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "UnLuaCompatibility.h"
+
+/**
+ * Layout of array elements that can be viewed as a flat buffer of scalars: a numeric property, or a POD struct
+ * made of numeric properties of the same type (FVector, FRotator, FColor, FIntPoint...)
+ * 可以看作扁平标量缓冲区的元素布局：数值属性，或者由同一种数值属性组成的POD结构体
+ * 结构体的分量按属性声明顺序排列，比如FColor是B,G,R,A
+ */
+struct FLuaArrayLayout
+{
+    enum EScalarType : uint8
+    {
+        None,
+        Int8,
+        UInt8,
+        Int16,
+        UInt16,
+        Int32,
+        UInt32,
+        Int64,
+        UInt64,
+        Float,
+        Double,
+    };
+
+    enum { MaxComponents = 16 };
+
+    EScalarType ScalarType;
+    uint8 NumComponents;
+    bool bStruct;
+    bool bIdenticalNative;              // the struct compares itself, components can't be compared one by one
+    uint16 Offsets[MaxComponents];      // byte offsets of the components in an element
+
+    FLuaArrayLayout()
+        : ScalarType(None), NumComponents(0), bStruct(false), bIdenticalNative(false)
+    {}
+
+    FORCEINLINE bool IsValid() const { return ScalarType != None; }
+
+    // 单个数值元素，可以直接当作T[]访问
+    FORCEINLINE bool IsScalar() const { return ScalarType != None && !bStruct; }
+
+    static EScalarType GetScalarType(const FProperty *Property)
+    {
+        if (!Property || Property->ArrayDim != 1)
+        {
+            return None;
+        }
+        if (Property->IsA<FFloatProperty>())    return Float;
+        if (Property->IsA<FIntProperty>())      return Int32;
+        if (Property->IsA<FByteProperty>())     return UInt8;
+        if (Property->IsA<FDoubleProperty>())   return Double;
+        if (Property->IsA<FInt64Property>())    return Int64;
+        if (Property->IsA<FUInt32Property>())   return UInt32;
+        if (Property->IsA<FInt8Property>())     return Int8;
+        if (Property->IsA<FInt16Property>())    return Int16;
+        if (Property->IsA<FUInt16Property>())   return UInt16;
+        if (Property->IsA<FUInt64Property>())   return UInt64;
+        if (const FEnumProperty *EnumProperty = CastField<FEnumProperty>(Property))
+        {
+            return GetScalarType(EnumProperty->GetUnderlyingProperty());
+        }
+        return None;
+    }
+
+    /**
+     * Build the layout for an element property
+     * 根据元素属性计算布局
+     *
+     * @return - true if the elements can be viewed as scalars, false otherwise
+     */
+    bool Initialize(const FProperty *Property)
+    {
+        ScalarType = GetScalarType(Property);
+        NumComponents = 0;
+        bStruct = false;
+        bIdenticalNative = false;
+        if (ScalarType != None)
+        {
+            NumComponents = 1;
+            Offsets[0] = 0;
+            return true;
+        }
+
+        const FStructProperty *StructProperty = Property && Property->ArrayDim == 1 ? CastField<FStructProperty>(Property) : nullptr;
+        if (!StructProperty || !(StructProperty->Struct->StructFlags & STRUCT_IsPlainOldData))
+        {
+            return false;
+        }
+
+        EScalarType ComponentType = None;
+        for (TFieldIterator<FProperty> It(StructProperty->Struct); It; ++It)
+        {
+            const EScalarType Type = GetScalarType(*It);
+            if (Type == None || (ComponentType != None && Type != ComponentType) || NumComponents >= MaxComponents)
+            {
+                NumComponents = 0;
+                return false;
+            }
+            ComponentType = Type;
+            Offsets[NumComponents++] = (uint16)It->GetOffset_ForInternal();
+        }
+        ScalarType = ComponentType;
+        bStruct = ScalarType != None;
+        bIdenticalNative = (StructProperty->Struct->StructFlags & STRUCT_IdenticalNative) != 0;
+        return bStruct;
+    }
+
+    /**
+     * Call 'Func' with a null pointer of the scalar type, so the kernels are instantiated once per type and the loops
+     * inside them only do typed loads and stores
+     * 按标量类型分派，循环内部只有类型确定的读写，没有虚函数调用
+     */
+    template <typename FuncType>
+    FORCEINLINE void Dispatch(FuncType &&Func) const
+    {
+        switch (ScalarType)
+        {
+        case Int8:      Func((int8*)nullptr); break;
+        case UInt8:     Func((uint8*)nullptr); break;
+        case Int16:     Func((int16*)nullptr); break;
+        case UInt16:    Func((uint16*)nullptr); break;
+        case Int32:     Func((int32*)nullptr); break;
+        case UInt32:    Func((uint32*)nullptr); break;
+        case Int64:     Func((int64*)nullptr); break;
+        case UInt64:    Func((uint64*)nullptr); break;
+        case Float:     Func((float*)nullptr); break;
+        case Double:    Func((double*)nullptr); break;
+        default:        break;
+        }
+    }
+
+    /**
+     * Whether elements can be compared with typed '==' on their components, which gives the same result as
+     * ITypeInterface::Identical
+     * 元素能否按分量直接判等，结果和ITypeInterface::Identical一致
+     */
+    FORCEINLINE bool CanCompareComponents() const { return ScalarType != None && !bIdenticalNative; }
+
+    /**
+     * Linear search with typed comparisons. Numeric elements are compared a block at a time without early exits
+     * inside the block, so the compiler can vectorize the comparisons
+     * 按类型直接比较的线性查找，数值元素按块比较，块内没有提前退出，编译器可以向量化
+     *
+     * @return - index of the first element equal to 'Item', or INDEX_NONE
+     */
+    int32 Find(const uint8 *Data, int32 NumElements, int32 ElementSize, const void *Item) const
+    {
+        int32 Index = INDEX_NONE;
+        Dispatch([&](auto *Type)
+        {
+            using T = typename TRemovePointer<decltype(Type)>::Type;
+            if (!bStruct)
+            {
+                enum { BlockSize = 16 };
+                const T Value = *(const T*)Item;
+                const T *Elements = (const T*)Data;
+                int32 i = 0;
+                for (; i + BlockSize <= NumElements; i += BlockSize)
+                {
+                    bool bFound = false;
+                    for (int32 j = 0; j < BlockSize; ++j)
+                    {
+                        bFound |= Elements[i + j] == Value;
+                    }
+                    if (bFound)
+                    {
+                        break;
+                    }
+                }
+                for (; i < NumElements; ++i)
+                {
+                    if (Elements[i] == Value)
+                    {
+                        Index = i;
+                        break;
+                    }
+                }
+                return;
+            }
+
+            T Values[MaxComponents];
+            for (int32 c = 0; c < NumComponents; ++c)
+            {
+                Values[c] = *(const T*)((const uint8*)Item + Offsets[c]);
+            }
+            for (int32 i = 0; i < NumElements && Index == INDEX_NONE; ++i)
+            {
+                const uint8 *Element = Data + i * ElementSize;
+                int32 c = 0;
+                while (c < NumComponents && *(const T*)(Element + Offsets[c]) == Values[c])
+                {
+                    ++c;
+                }
+                if (c == NumComponents)
+                {
+                    Index = i;
+                }
+            }
+        });
+        return Index;
+    }
+};
@@ -0,0 +1,130 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "LuaArray.h"
+
+/**
+ * A view over the storage of a TArray whose elements have a scalar layout, indexed by scalar (component) rather than
+ * by element. It doesn't own anything, the Lua userdata keeps the array userdata alive through its user value
+ * TArray存储的标量视图，按分量而不是按元素索引，例如TArray<FVector>的第i个元素是视图的[3i-2, 3i]
+ */
+struct FLuaArrayView
+{
+    FLuaArray *Array;
+    FLuaArrayLayout Layout;
+
+    // 标量的个数
+    FORCEINLINE int32 Num() const { return Array->Num() * Layout.NumComponents; }
+
+    // 0-based scalar index -> address
+    FORCEINLINE uint8* GetScalarPtr(int32 Index) const
+    {
+        const int32 ElementIndex = Index / Layout.NumComponents;
+        const int32 Component = Index - ElementIndex * Layout.NumComponents;
+        return Array->GetData(ElementIndex) + Layout.Offsets[Component];
+    }
+
+    /**
+     * Push the scalar at the given 0-based index
+     * 读取一个标量
+     */
+    FORCEINLINE void Read(lua_State *L, int32 Index) const
+    {
+        const uint8 *Ptr = GetScalarPtr(Index);
+        Layout.Dispatch([L, Ptr](auto *Type) { UnLuaArrayView::Push(L, *(decltype(Type))Ptr); });
+    }
+
+    /**
+     * Store the Lua value at 'IndexInStack' to the scalar at the given 0-based index
+     * 写入一个标量
+     */
+    FORCEINLINE void Write(lua_State *L, int32 Index, int32 IndexInStack) const
+    {
+        uint8 *Ptr = GetScalarPtr(Index);
+        Layout.Dispatch([L, Ptr, IndexInStack](auto *Type) { *(decltype(Type))Ptr = UnLuaArrayView::To<typename TRemovePointer<decltype(Type)>::Type>(L, IndexInStack); });
+    }
+
+    /**
+     * Push a flat table of all scalars, presized
+     * 转成扁平的Lua表，预先分配好数组部分
+     */
+    void ToTable(lua_State *L) const
+    {
+        const int32 NumElements = Array->Num();
+        const int32 NumComponents = Layout.NumComponents;
+        const int32 ElementSize = Array->ElementSize;
+        const uint16 *Offsets = Layout.Offsets;
+        const uint8 *Data = (const uint8*)Array->GetData();
+        lua_createtable(L, NumElements * NumComponents, 0);
+        Layout.Dispatch([=](auto *Type)
+        {
+            using T = typename TRemovePointer<decltype(Type)>::Type;
+            lua_Integer n = 0;
+            for (int32 i = 0; i < NumElements; ++i)
+            {
+                const uint8 *Element = Data + i * ElementSize;
+                for (int32 c = 0; c < NumComponents; ++c)
+                {
+                    UnLuaArrayView::Push(L, *(const T*)(Element + Offsets[c]));
+                    lua_rawseti(L, -2, ++n);
+                }
+            }
+        });
+    }
+
+    /**
+     * Resize the array to hold all scalars of the flat table at 'TableIndex', then store them. Trailing scalars that
+     * don't make a whole element are ignored
+     * 从扁平的Lua表写入，数组先一次性调整到合适的大小，凑不满一个元素的尾部标量忽略
+     *
+     * @return - number of elements
+     */
+    int32 FromTable(lua_State *L, int32 TableIndex) const
+    {
+        TableIndex = lua_absindex(L, TableIndex);
+        const int32 NumComponents = Layout.NumComponents;
+        const int32 NumElements = (int32)(lua_rawlen(L, TableIndex) / NumComponents);
+        const int32 Count = NumElements - Array->Num();
+        if (Count > 0)
+        {
+            Array->AddUninitialized(Count);             // every component is written below
+        }
+        else if (Count < 0)
+        {
+            Array->Resize(NumElements);
+        }
+
+        const int32 ElementSize = Array->ElementSize;
+        const uint16 *Offsets = Layout.Offsets;
+        uint8 *Data = (uint8*)Array->GetData();
+        Layout.Dispatch([=](auto *Type)
+        {
+            using T = typename TRemovePointer<decltype(Type)>::Type;
+            lua_Integer n = 0;
+            for (int32 i = 0; i < NumElements; ++i)
+            {
+                uint8 *Element = Data + i * ElementSize;
+                for (int32 c = 0; c < NumComponents; ++c)
+                {
+                    lua_rawgeti(L, TableIndex, ++n);
+                    *(T*)(Element + Offsets[c]) = UnLuaArrayView::To<T>(L, -1);
+                    lua_pop(L, 1);
+                }
+            }
+        });
+        return NumElements;
+    }
+};
@@ -0,0 +1,140 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaContainerKey.h"
+#include "LuaArrayView.h"
+#include "LuaContext.h"
+
+namespace UnLuaContainerKey
+{
+    template <typename T>
+    static uint32 HashKey(const void *Key)
+    {
+        return GetTypeHash(*(const T*)Key);
+    }
+
+    template <typename T>
+    static bool KeysEqual(const void *Key, const void *ElementKey)
+    {
+        return *(const T*)Key == *(const T*)ElementKey;
+    }
+
+    // 不含'\0'的ASCII字符串，按字符计算的hash和对应FString相同
+    static bool IsPlainAscii(const char *Chars, size_t Len)
+    {
+        for (size_t i = 0; i < Len; ++i)
+        {
+            if ((uint8)(Chars[i] - 1) >= 0x7F)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Same as GetTypeHash(const FString&). The ANSICHAR overload of Strihash_DEPRECATED mixes in one byte per character
+     * while the TCHAR one mixes in two, so the characters are widened to TCHAR first, on the stack for usual keys
+     * ANSICHAR版本的Strihash_DEPRECATED每个字符只算一个字节，和FString的hash不同，先把字符扩展成TCHAR
+     */
+    static uint32 HashAscii(const void *Key)
+    {
+        const ANSICHAR *Chars = (const ANSICHAR*)Key;
+        const int32 Len = FCStringAnsi::Strlen(Chars);
+        TArray<TCHAR, TInlineAllocator<128>> Wide;
+        Wide.SetNumUninitialized(Len + 1);
+        for (int32 i = 0; i <= Len; ++i)
+        {
+            Wide[i] = (TCHAR)Chars[i];
+        }
+        return FCrc::Strihash_DEPRECATED(Wide.GetData());
+    }
+
+    // FScriptSet passes the key being searched first and the element second
+    static bool AsciiEquals(const void *Key, const void *ElementKey)
+    {
+        const ANSICHAR *A = (const ANSICHAR*)Key;
+        const TCHAR *B = **(const FString*)ElementKey;
+        for (;; ++A, ++B)
+        {
+            const TCHAR CharA = (TCHAR)*A;
+            if (CharA != *B && (*B >= 0x80 || FChar::ToUpper(CharA) != FChar::ToUpper(*B)))
+            {
+                return false;
+            }
+            if (!CharA)
+            {
+                return true;
+            }
+        }
+    }
+}
+
+bool FLuaContainerKey::Visit(lua_State *L, int32 Index, bool bFindOnly, TFunctionRef<void(const void*, FGetKeyHash, FKeyEquals)> Func) const
+{
+    switch (Kind)
+    {
+    case Scalar:
+        if (lua_type(L, Index) != LUA_TNUMBER)
+        {
+            return false;
+        }
+        Layout.Dispatch([L, Index, &Func](auto *Type)
+        {
+            using T = typename TRemovePointer<decltype(Type)>::Type;
+            const T Key = UnLuaArrayView::To<T>(L, Index);
+            Func(&Key, &UnLuaContainerKey::HashKey<T>, &UnLuaContainerKey::KeysEqual<T>);
+        });
+        return true;
+    case Name:
+        {
+            if (lua_type(L, Index) != LUA_TSTRING)
+            {
+                return false;
+            }
+            FName Key;
+            if (!bFindOnly)
+            {
+                Key = GLuaCxt->GetNameCache().ToName(L, Index);
+            }
+            else if (!GLuaCxt->GetNameCache().FindName(L, Index, Key))
+            {
+                return true;                    // no such name, no such key
+            }
+            Func(&Key, &UnLuaContainerKey::HashKey<FName>, &UnLuaContainerKey::KeysEqual<FName>);
+            return true;
+        }
+    case String:
+        {
+            if (lua_type(L, Index) != LUA_TSTRING)
+            {
+                return false;
+            }
+            size_t Len = 0;
+            const char *Chars = lua_tolstring(L, Index, &Len);
+            if (bFindOnly && UnLuaContainerKey::IsPlainAscii(Chars, Len))
+            {
+                // hash and compare the Lua string in place, no FString is created
+                Func(Chars, &UnLuaContainerKey::HashAscii, &UnLuaContainerKey::AsciiEquals);
+                return true;
+            }
+            FString Key;
+            UnLua::GetFString(L, Index, Key);
+            Func(&Key, &UnLuaContainerKey::HashKey<FString>, &UnLuaContainerKey::KeysEqual<FString>);
+            return true;
+        }
+    default:
+        return false;
+    }
+}
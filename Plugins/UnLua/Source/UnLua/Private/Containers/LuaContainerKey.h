@@ -0,0 +1,79 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "LuaArrayLayout.h"
+
+struct lua_State;
+
+/**
+ * Keys of TMap and TSet that are hashed and compared from the Lua value directly: numbers, enums, FName and FString.
+ * The hashes are the same as FProperty::GetValueTypeHash, so containers shared with C++ stay valid
+ * TMap/TSet中可以直接由Lua值计算hash和判等的key类型：数值、枚举、FName和FString，不需要先经过ITypeInterface写到
+ * ElementCache，也不需要调用虚函数GetValueTypeHash/Identical。hash和FProperty::GetValueTypeHash一致，和C++共享的容器不受影响
+ */
+struct UNLUA_API FLuaContainerKey
+{
+    enum EKind : uint8
+    {
+        Unknown,        // not initialized yet
+        None,           // no fast path, go through the ITypeInterface
+        Scalar,
+        Name,
+        String,
+    };
+
+    typedef uint32 (*FGetKeyHash)(const void *Key);
+    typedef bool (*FKeyEquals)(const void *Key, const void *ElementKey);
+
+    EKind Kind;
+    FLuaArrayLayout Layout;
+
+    FLuaContainerKey()
+        : Kind(Unknown)
+    {}
+
+    FORCEINLINE bool IsInitialized() const { return Kind != Unknown; }
+
+    void Initialize(const FProperty *Property)
+    {
+        Kind = None;
+        if (Layout.Initialize(Property) && Layout.IsScalar())
+        {
+            Kind = Scalar;
+        }
+        else if (Property && Property->ArrayDim == 1 && Property->IsA<FNameProperty>())
+        {
+            Kind = Name;
+        }
+        else if (Property && Property->ArrayDim == 1 && Property->IsA<FStrProperty>())
+        {
+            Kind = String;
+        }
+    }
+
+    /**
+     * Call 'Func' with a key built from the Lua value at 'Index', and the functions to hash and compare it
+     * 用Index处的Lua值构造key，连同hash和判等函数一起传给Func
+     *
+     * @param bFindOnly - the key is only used to find an element. It may then be a proxy of the Lua value that only the
+     *                    given functions understand, and FNames missing in the name table are not added. Keys used to
+     *                    add elements must be real keys, since the container may rehash the existing elements with
+     *                    the same hash function
+     * @return - false if the Lua value can't take the fast path, it should go through the ITypeInterface then. 'Func'
+     *           is not called if the key can't be in the container
+     */
+    bool Visit(lua_State *L, int32 Index, bool bFindOnly, TFunctionRef<void(const void*, FGetKeyHash, FKeyEquals)> Func) const;
+};
@@ -15,6 +15,7 @@
 #pragma once
 
 #include "LuaArray.h"
+#include "LuaContainerKey.h"
 #include "ReflectionUtils/PropertyCreator.h"
 #include "Runtime/Launch/Resources/Version.h"
 
@@ -31,7 +32,7 @@ public:
 
     FLuaMap(const FScriptMap *InScriptMap, TSharedPtr<UnLua::ITypeInterface> InKeyInterface, TSharedPtr<UnLua::ITypeInterface> InValueInterface, FScriptMapFlag Flag = OwnedByOther)
         : Map((FScriptMap*)InScriptMap), MapLayout(FScriptMap::GetScriptLayout(InKeyInterface->GetSize(), InKeyInterface->GetAlignment(), InValueInterface->GetSize(), InValueInterface->GetAlignment()))
-        , KeyInterface(InKeyInterface), ValueInterface(InValueInterface), Interface(nullptr), ElementCache(nullptr), ScriptMapFlag(Flag)
+        , KeyInterface(InKeyInterface), ValueInterface(InValueInterface), Interface(nullptr), ElementCache(nullptr), ScriptMapFlag(Flag), NumModifications(0)
     {
         FStructBuilder StructBuilder;
         StructBuilder.AddMember(InKeyInterface->GetSize(), InKeyInterface->GetAlignment());
@@ -42,7 +43,7 @@ public:
     }
 
     FLuaMap(const FScriptMap *InScriptMap, TLuaContainerInterface<FLuaMap> *InMapInterface, FScriptMapFlag Flag = OwnedByOther)
-        : Map((FScriptMap*)InScriptMap), Interface(InMapInterface), ElementCache(nullptr), ScriptMapFlag(Flag)
+        : Map((FScriptMap*)InScriptMap), Interface(InMapInterface), ElementCache(nullptr), ScriptMapFlag(Flag), NumModifications(0)
     {
         if (Interface)
         {
@@ -108,41 +109,27 @@ public:
     {
         //MapHelper.AddPair(Key, Value);
         const UnLua::ITypeInterface *LocalKeyInterface = KeyInterface.Get();
-        const UnLua::ITypeInterface *LocalValueInterface = ValueInterface.Get();
-        Map->Add(Key, Value, MapLayout,
+        AddInternal(Key, Value,
             [LocalKeyInterface](const void* ElementKey) { return LocalKeyInterface->GetValueTypeHash(ElementKey); },
-            [LocalKeyInterface](const void* A, const void* B) { return LocalKeyInterface->Identical(A, B); },
-            [LocalKeyInterface, Key](void* NewElementKey)
-            {
-                LocalKeyInterface->Initialize(NewElementKey);
-                LocalKeyInterface->Copy(NewElementKey, Key);
-            },
-            [LocalValueInterface, Value](void* NewElementValue)
-            {
-                LocalValueInterface->Initialize(NewElementValue);
-                LocalValueInterface->Copy(NewElementValue, Value);
-            },
-            [LocalValueInterface, Value](void* ExistingElementValue)
-            {
-                LocalValueInterface->Copy(ExistingElementValue, Value);
-            },
-            [LocalKeyInterface](void* ElementKey)
-            {
-                if (!LocalKeyInterface->IsPODType() && !LocalKeyInterface->IsTriviallyDestructible())
-                {
-                    LocalKeyInterface->Destruct(ElementKey);
-                }
-            },
-            [LocalValueInterface](void* ElementValue)
-            {
-                if (!LocalValueInterface->IsPODType() && !LocalValueInterface->IsTriviallyDestructible())
-                {
-                    LocalValueInterface->Destruct(ElementValue);
-                }
-            }
+            [LocalKeyInterface](const void* A, const void* B) { return LocalKeyInterface->Identical(A, B); }
         );
     }
 
+    /**
+     * Add a pair, the key is the Lua value at 'KeyIndex'
+     * 新增元素，key直接从Lua栈上读取，按类型计算hash，不经过ElementCache
+     *
+     * @param Value - the value
+     * @return - false if the key type has no fast path, see FLuaContainerKey
+     */
+    bool AddFromLua(lua_State *L, int32 KeyIndex, const void *Value)
+    {
+        return GetKeyType().Visit(L, KeyIndex, false, [this, Value](const void *Key, FLuaContainerKey::FGetKeyHash GetKeyHash, FLuaContainerKey::FKeyEquals KeyEquals)
+        {
+            AddInternal(Key, Value, GetKeyHash, KeyEquals);
+        });
+    }
+
     /**
      * Remove a pair from the map
      * 移除元素
@@ -158,14 +145,35 @@ public:
             [LocalKeyInterface](const void* A, const void* B) { return LocalKeyInterface->Identical(A, B); }
         ))
         {
-            int32 Idx = (Entry - (uint8*)Map->GetData(0, MapLayout)) / MapLayout.SetLayout.Size;
-            DestructItems(Idx, 1);
-            Map->RemoveAt(Idx, MapLayout);
+            RemoveEntry(Entry);
             return true;
         }
         return false;
     }
 
+    /**
+     * Remove a pair, the key is the Lua value at 'KeyIndex'
+     * 移除元素，key直接从Lua栈上读取
+     *
+     * @param bRemoved - whether the key is found and removed
+     * @return - false if the key type has no fast path, see FLuaContainerKey
+     */
+    bool RemoveFromLua(lua_State *L, int32 KeyIndex, bool &bRemoved)
+    {
+        uint8 *Entry = nullptr;
+        bRemoved = false;
+        if (!FindFromLua(L, KeyIndex, Entry))
+        {
+            return false;
+        }
+        if (Entry)
+        {
+            RemoveEntry(Entry);
+            bRemoved = true;
+        }
+        return true;
+    }
+
     /**
      * Find the associated value of a Key from the map
      * 通过键获取值
@@ -215,6 +223,23 @@ public:
         );
     }
 
+    /**
+     * Find the associated value of the key at 'KeyIndex' in the Lua stack. The key is hashed and compared from the Lua
+     * value directly, without marshalling it to ElementCache
+     * 通过Lua栈上的key查找值，直接由Lua值计算hash和判等，不需要先写到ElementCache
+     *
+     * @param OutValue - the address of the associated value, nullptr if the key is not found
+     * @return - false if the key type has no fast path, see FLuaContainerKey
+     */
+    bool FindFromLua(lua_State *L, int32 KeyIndex, uint8 *&OutValue)
+    {
+        OutValue = nullptr;
+        return GetKeyType().Visit(L, KeyIndex, true, [this, &OutValue](const void *Key, FLuaContainerKey::FGetKeyHash GetKeyHash, FLuaContainerKey::FKeyEquals KeyEquals)
+        {
+            OutValue = Map->FindValue(Key, MapLayout, GetKeyHash, KeyEquals);
+        });
+    }
+
     /**
      * Empty the map, and reallocate it for the expected number of pairs.
      * 清空Map,同时重新分配给定大小个键值对
@@ -231,10 +256,51 @@ public:
         }
         if (OldNum || Slack)
         {
+            ++NumModifications;
             Map->Empty(Slack, MapLayout);
         }
     }
 
+    /**
+     * Replace the pairs with the ones of a Lua table. The pairs are counted first so the map is allocated once, and
+     * keys of common types are hashed straight from the Lua values, see FLuaContainerKey
+     * 用Lua表的键值对替换所有元素，先统计个数一次性分配好空间，常见类型的key直接由Lua值计算hash
+     *
+     * @return - the number of pairs in the table
+     */
+    int32 FromTable(lua_State *L, int32 TableIndex)
+    {
+        TableIndex = lua_absindex(L, TableIndex);
+        int32 NumPairs = 0;
+        lua_pushnil(L);
+        while (lua_next(L, TableIndex) != 0)
+        {
+            ++NumPairs;
+            lua_pop(L, 1);
+        }
+        Clear(NumPairs);
+
+        void *ValueCache = (uint8*)ElementCache + MapLayout.ValueOffset;
+        lua_pushnil(L);
+        while (lua_next(L, TableIndex) != 0)
+        {
+            // read a copy of the key, converting the key itself (lua_tostring on a number) breaks lua_next
+            lua_pushvalue(L, -2);
+            ValueInterface->Initialize(ValueCache);
+            ValueInterface->Write(L, ValueInterface->GetOffset() > 0 ? ElementCache : ValueCache, -2);
+            if (!AddFromLua(L, -1, ValueCache))
+            {
+                KeyInterface->Initialize(ElementCache);
+                KeyInterface->Write(L, ElementCache, -1);
+                Add(ElementCache, ValueCache);
+                KeyInterface->Destruct(ElementCache);
+            }
+            ValueInterface->Destruct(ValueCache);
+            lua_pop(L, 2);
+        }
+        return NumPairs;
+    }
+
     /**
      * Get address of the i'th pair
      * 获取索引处元素
@@ -252,6 +318,26 @@ public:
         return (uint8*)Map->GetData(Index, MapLayout);
     }
 
+    /**
+     * Find the first valid pair at or after the given sparse index
+     * 从给定的稀疏索引开始查找下一个有效的键值对，用于遍历
+     *
+     * @param Index - the sparse index to start from
+     * @return - the index of the pair, INDEX_NONE if there are no more pairs
+     */
+    FORCEINLINE int32 FindNextIndex(int32 Index) const
+    {
+        const int32 MaxIndex = Map->GetMaxIndex();
+        for (; Index < MaxIndex; ++Index)
+        {
+            if (IsValidIndex(Index))
+            {
+                return Index;
+            }
+        }
+        return INDEX_NONE;
+    }
+
     /**
      * Adds an uninitialized pair to the map. The map needs rehashing to make it valid.
      * 新增一个未初始化的键值对,Map需要重新Hash来确保有效
@@ -261,6 +347,7 @@ public:
     FORCEINLINE int32 AddUninitializedValue()
     {
         checkSlow(Num() >= 0);
+        ++NumModifications;
         return Map->AddUninitialized(MapLayout);
     }
 
@@ -285,6 +372,7 @@ public:
      */
     FORCEINLINE void Rehash()
     {
+        ++NumModifications;
         Map->Rehash(MapLayout, [=](const void* Src) { return KeyInterface->GetValueTypeHash(Src); });
     }
 
@@ -356,8 +444,77 @@ public:
     //FScriptMapHelper MapHelper;
     void *ElementCache;             // can only hold a key-value pair
     FScriptMapFlag ScriptMapFlag;
+    uint32 NumModifications;        // bumped whenever a pair is added or removed, checked by pairs(Map)
 
 private:
+    mutable FLuaContainerKey KeyType;
+
+    // 第一次使用时根据key的属性确定
+    FORCEINLINE const FLuaContainerKey& GetKeyType() const
+    {
+        if (!KeyType.IsInitialized())
+        {
+            KeyType.Initialize(KeyInterface->GetUProperty());
+        }
+        return KeyType;
+    }
+
+    /**
+     * Add a pair with the given functions to hash and compare keys
+     * 使用给定的hash和判等函数新增元素
+     */
+    template <typename GetKeyHashType, typename KeyEqualsType>
+    FORCEINLINE void AddInternal(const void *Key, const void *Value, GetKeyHashType GetKeyHash, KeyEqualsType KeyEquals)
+    {
+        const UnLua::ITypeInterface *LocalKeyInterface = KeyInterface.Get();
+        const UnLua::ITypeInterface *LocalValueInterface = ValueInterface.Get();
+        const int32 OldNum = Num();
+        Map->Add(Key, Value, MapLayout, GetKeyHash, KeyEquals,
+            [LocalKeyInterface, Key](void* NewElementKey)
+            {
+                LocalKeyInterface->Initialize(NewElementKey);
+                LocalKeyInterface->Copy(NewElementKey, Key);
+            },
+            [LocalValueInterface, Value](void* NewElementValue)
+            {
+                LocalValueInterface->Initialize(NewElementValue);
+                LocalValueInterface->Copy(NewElementValue, Value);
+            },
+            [LocalValueInterface, Value](void* ExistingElementValue)
+            {
+                LocalValueInterface->Copy(ExistingElementValue, Value);
+            },
+            [LocalKeyInterface](void* ElementKey)
+            {
+                if (!LocalKeyInterface->IsPODType() && !LocalKeyInterface->IsTriviallyDestructible())
+                {
+                    LocalKeyInterface->Destruct(ElementKey);
+                }
+            },
+            [LocalValueInterface](void* ElementValue)
+            {
+                if (!LocalValueInterface->IsPODType() && !LocalValueInterface->IsTriviallyDestructible())
+                {
+                    LocalValueInterface->Destruct(ElementValue);
+                }
+            }
+        );
+        // assigning the value of an existing key doesn't change the layout
+        if (Num() != OldNum)
+        {
+            ++NumModifications;
+        }
+    }
+
+    // remove the pair whose value is at 'Entry'
+    FORCEINLINE void RemoveEntry(uint8 *Entry)
+    {
+        int32 Idx = (Entry - (uint8*)Map->GetData(0, MapLayout)) / MapLayout.SetLayout.Size;
+        ++NumModifications;
+        DestructItems(Idx, 1);
+        Map->RemoveAt(Idx, MapLayout);
+    }
+
     // 从Index处开始销毁Count个元素
     void DestructItems(int32 Index, int32 Count)
     {
@@ -15,6 +15,7 @@
 #pragma once
 
 #include "LuaArray.h"
+#include "LuaContainerKey.h"
 
 class FLuaSet
 {
@@ -29,7 +30,7 @@ public:
 
     FLuaSet(const FScriptSet *InScriptSet, TSharedPtr<UnLua::ITypeInterface> InElementInterface, FScriptSetFlag Flag = OwnedByOther)
         : Set((FScriptSet*)InScriptSet), SetLayout(FScriptSet::GetScriptLayout(InElementInterface->GetSize(), InElementInterface->GetAlignment()))
-        , ElementInterface(InElementInterface), Interface(nullptr), ElementCache(nullptr), ScriptSetFlag(Flag)
+        , ElementInterface(InElementInterface), Interface(nullptr), ElementCache(nullptr), ScriptSetFlag(Flag), NumModifications(0)
     {
         // allocate cache for a single element
         // 为单个元素分配缓存
@@ -37,7 +38,7 @@ public:
     }
 
     FLuaSet(const FScriptSet *InScriptSet, TLuaContainerInterface<FLuaSet> *InSetInterface, FScriptSetFlag Flag = OwnedByOther)
-        : Set((FScriptSet*)InScriptSet), Interface(InSetInterface), ElementCache(nullptr), ScriptSetFlag(Flag)
+        : Set((FScriptSet*)InScriptSet), Interface(InSetInterface), ElementCache(nullptr), ScriptSetFlag(Flag), NumModifications(0)
     {
         if (Interface)
         {
@@ -98,25 +99,26 @@ public:
     {
         //SetHelper.AddElement(Item);
         const UnLua::ITypeInterface *LocalElementInterface = ElementInterface.Get();
-        FScriptSetLayout& LocalSetLayoutForCapture = SetLayout;
-        Set->Add(Item, SetLayout,
+        AddInternal(Item,
             [LocalElementInterface](const void* Element) { return LocalElementInterface->GetValueTypeHash(Element); },
-            [LocalElementInterface](const void* A, const void* B) { return LocalElementInterface->Identical(A, B); },
-            [LocalElementInterface, Item, LocalSetLayoutForCapture](void* NewElement)
-            {
-                LocalElementInterface->Initialize(NewElement);
-                LocalElementInterface->Copy(NewElement, Item);
-            },
-            [LocalElementInterface](void* Element)
-            {
-                if (!LocalElementInterface->IsPODType() && !LocalElementInterface->IsTriviallyDestructible())
-                {
-                    LocalElementInterface->Destruct(Element);
-                }
-            }
+            [LocalElementInterface](const void* A, const void* B) { return LocalElementInterface->Identical(A, B); }
         );
     }
 
+    /**
+     * Add the Lua value at 'Index' to the set
+     * 新增元素，直接从Lua栈上读取，按类型计算hash，不经过ElementCache
+     *
+     * @return - false if the element type has no fast path, see FLuaContainerKey
+     */
+    bool AddFromLua(lua_State *L, int32 Index)
+    {
+        return GetElementType().Visit(L, Index, false, [this](const void *Item, FLuaContainerKey::FGetKeyHash GetKeyHash, FLuaContainerKey::FKeyEquals KeyEquals)
+        {
+            AddInternal(Item, GetKeyHash, KeyEquals);
+        });
+    }
+
     /**
      * Remove an element from the set
      * 移除元素
@@ -133,6 +135,7 @@ public:
         );
         if (FoundIndex != INDEX_NONE)
         {
+            ++NumModifications;
             DestructItems(FoundIndex, 1);
             Set->RemoveAt(FoundIndex, SetLayout);
             return true;
@@ -156,6 +159,47 @@ public:
         ) != INDEX_NONE;
     }
 
+    /**
+     * Find the Lua value at 'Index' in the set. It's hashed and compared directly, without marshalling it to ElementCache
+     * 查找Lua栈上的元素，直接由Lua值计算hash和判等，不需要先写到ElementCache
+     *
+     * @param OutIndex - the index of the element, INDEX_NONE if it is not found
+     * @return - false if the element type has no fast path, see FLuaContainerKey
+     */
+    bool FindFromLua(lua_State *L, int32 Index, int32 &OutIndex)
+    {
+        OutIndex = INDEX_NONE;
+        return GetElementType().Visit(L, Index, true, [this, &OutIndex](const void *Item, FLuaContainerKey::FGetKeyHash GetKeyHash, FLuaContainerKey::FKeyEquals KeyEquals)
+        {
+            OutIndex = Set->FindIndex(Item, SetLayout, GetKeyHash, KeyEquals);
+        });
+    }
+
+    /**
+     * Remove the Lua value at 'Index' from the set
+     * 移除Lua栈上的元素
+     *
+     * @param bRemoved - whether the element is found and removed
+     * @return - false if the element type has no fast path, see FLuaContainerKey
+     */
+    bool RemoveFromLua(lua_State *L, int32 Index, bool &bRemoved)
+    {
+        int32 FoundIndex = INDEX_NONE;
+        bRemoved = false;
+        if (!FindFromLua(L, Index, FoundIndex))
+        {
+            return false;
+        }
+        if (FoundIndex != INDEX_NONE)
+        {
+            ++NumModifications;
+            DestructItems(FoundIndex, 1);
+            Set->RemoveAt(FoundIndex, SetLayout);
+            bRemoved = true;
+        }
+        return true;
+    }
+
     /**
      * Empty the set, and reallocate it for the expected number of elements.
      * 清空Set,同时重新分配给定大小个元素
@@ -172,10 +216,45 @@ public:
         }
         if (OldNum || Slack)
         {
+            ++NumModifications;
             Set->Empty(Slack, SetLayout);
         }
     }
 
+    /**
+     * Replace the elements with the values of a Lua table. The values are counted first so the set is allocated once,
+     * and elements of common types are hashed straight from the Lua values, see FLuaContainerKey
+     * 用Lua表的值替换所有元素，先统计个数一次性分配好空间，常见类型的元素直接由Lua值计算hash
+     *
+     * @return - the number of values in the table
+     */
+    int32 FromTable(lua_State *L, int32 TableIndex)
+    {
+        TableIndex = lua_absindex(L, TableIndex);
+        int32 NumValues = 0;
+        lua_pushnil(L);
+        while (lua_next(L, TableIndex) != 0)
+        {
+            ++NumValues;
+            lua_pop(L, 1);
+        }
+        Clear(NumValues);
+
+        lua_pushnil(L);
+        while (lua_next(L, TableIndex) != 0)
+        {
+            if (!AddFromLua(L, -1))
+            {
+                ElementInterface->Initialize(ElementCache);
+                ElementInterface->Write(L, ElementCache, -1);
+                Add(ElementCache);
+                ElementInterface->Destruct(ElementCache);
+            }
+            lua_pop(L, 1);
+        }
+        return NumValues;
+    }
+
     /**
      * Get address of the i'th element
      * 获取索引处元素
@@ -193,6 +272,26 @@ public:
         return (uint8*)Set->GetData(Index, SetLayout);
     }
 
+    /**
+     * Find the first valid element at or after the given sparse index
+     * 从给定的稀疏索引开始查找下一个有效的元素，用于遍历
+     *
+     * @param Index - the sparse index to start from
+     * @return - the index of the element, INDEX_NONE if there are no more elements
+     */
+    FORCEINLINE int32 FindNextIndex(int32 Index) const
+    {
+        const int32 MaxIndex = Set->GetMaxIndex();
+        for (; Index < MaxIndex; ++Index)
+        {
+            if (IsValidIndex(Index))
+            {
+                return Index;
+            }
+        }
+        return INDEX_NONE;
+    }
+
     /**
      * Adds an uninitialized element to the set. The set needs rehashing to make it valid.
      * 新增一个未初始化的元素,Set需要重新Hash来确保有效
@@ -202,6 +301,7 @@ public:
     FORCEINLINE int32 AddUninitializedValue()
     {
         checkSlow(Num() >= 0);
+        ++NumModifications;
         return Set->AddUninitialized(SetLayout);
     }
 
@@ -225,6 +325,7 @@ public:
      */
     FORCEINLINE void Rehash()
     {
+        ++NumModifications;
         Set->Rehash(SetLayout, [=](const void* Src) { return ElementInterface->GetValueTypeHash(Src); });
     }
 
@@ -262,8 +363,52 @@ public:
     //FScriptSetHelper SetHelper;
     void *ElementCache;            // can only hold one element...
     FScriptSetFlag ScriptSetFlag;
+    uint32 NumModifications;       // bumped whenever an element is added or removed, checked by pairs(Set)
 
 private:
+    mutable FLuaContainerKey ElementType;
+
+    // 第一次使用时根据元素的属性确定
+    FORCEINLINE const FLuaContainerKey& GetElementType() const
+    {
+        if (!ElementType.IsInitialized())
+        {
+            ElementType.Initialize(ElementInterface->GetUProperty());
+        }
+        return ElementType;
+    }
+
+    /**
+     * Add an element with the given functions to hash and compare elements
+     * 使用给定的hash和判等函数新增元素
+     */
+    template <typename GetKeyHashType, typename KeyEqualsType>
+    FORCEINLINE void AddInternal(const void *Item, GetKeyHashType GetKeyHash, KeyEqualsType KeyEquals)
+    {
+        const UnLua::ITypeInterface *LocalElementInterface = ElementInterface.Get();
+        FScriptSetLayout& LocalSetLayoutForCapture = SetLayout;
+        const int32 OldNum = Num();
+        Set->Add(Item, SetLayout, GetKeyHash, KeyEquals,
+            [LocalElementInterface, Item, LocalSetLayoutForCapture](void* NewElement)
+            {
+                LocalElementInterface->Initialize(NewElement);
+                LocalElementInterface->Copy(NewElement, Item);
+            },
+            [LocalElementInterface](void* Element)
+            {
+                if (!LocalElementInterface->IsPODType() && !LocalElementInterface->IsTriviallyDestructible())
+                {
+                    LocalElementInterface->Destruct(Element);
+                }
+            }
+        );
+        // adding an existing element replaces it in place
+        if (Num() != OldNum)
+        {
+            ++NumModifications;
+        }
+    }
+
     // 从Index处开始销毁Count个元素
     void DestructItems(int32 Index, int32 Count)
     {
@@ -0,0 +1,273 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaAllocator.h"
+#include "UnLuaBase.h"
+
+FLuaAllocator::FLuaAllocator()
+{
+    for (uint32 i = 0; i < NumSizeClasses; ++i)
+    {
+        Classes[i].BlockSize = (i + 1) * Granularity;
+        Classes[i].BlocksPerPage = (PageSize - PageHeaderSize) / Classes[i].BlockSize;
+    }
+}
+
+FLuaAllocator::~FLuaAllocator()
+{
+    Reset();
+}
+
+/**
+ * Allocate, resize or free a block for Lua
+ */
+void* FLuaAllocator::Realloc(void *Ptr, size_t OldSize, size_t NewSize)
+{
+    if (!Ptr)
+    {
+        OldSize = 0;
+    }
+
+    const bool bOldSmall = OldSize > 0 && OldSize <= MaxSmallSize;
+    const bool bNewSmall = NewSize > 0 && NewSize <= MaxSmallSize;
+    FSizeClassStats &OldStats = bOldSmall ? Classes[GetClassIndex(OldSize)].Stats : LargeStats;
+    FSizeClassStats &NewStats = bNewSmall ? Classes[GetClassIndex(NewSize)].Stats : LargeStats;
+
+    void *NewPtr = nullptr;
+    if (NewSize == 0)
+    {
+        if (bOldSmall)
+        {
+            FreeSmall(Ptr, GetClassIndex(OldSize));
+        }
+        else
+        {
+            FMemory::Free(Ptr);
+        }
+    }
+    else if (bNewSmall)
+    {
+        if (bOldSmall && GetClassIndex(OldSize) == GetClassIndex(NewSize))
+        {
+            NewPtr = Ptr;                                   // same block size, nothing to move
+        }
+        else
+        {
+            NewPtr = AllocSmall(GetClassIndex(NewSize));
+            if (!NewPtr)
+            {
+                return nullptr;
+            }
+            if (Ptr)
+            {
+                FMemory::Memcpy(NewPtr, Ptr, FMath::Min(OldSize, NewSize));
+                if (bOldSmall)
+                {
+                    FreeSmall(Ptr, GetClassIndex(OldSize));
+                }
+                else
+                {
+                    FMemory::Free(Ptr);
+                }
+            }
+        }
+    }
+    else if (!Ptr || !bOldSmall)
+    {
+        NewPtr = FMemory::Realloc(Ptr, NewSize);            // large -> large
+        if (!NewPtr)
+        {
+            return nullptr;
+        }
+    }
+    else
+    {
+        NewPtr = FMemory::Malloc(NewSize);                  // small -> large
+        if (!NewPtr)
+        {
+            return nullptr;
+        }
+        FMemory::Memcpy(NewPtr, Ptr, OldSize);
+        FreeSmall(Ptr, GetClassIndex(OldSize));
+    }
+
+    if (OldSize > 0)
+    {
+        OldStats.LiveBytes -= OldSize;
+        --OldStats.NumBlocks;
+    }
+    if (NewSize > 0)
+    {
+        NewStats.LiveBytes += NewSize;
+        NewStats.PeakBytes = FMath::Max(NewStats.PeakBytes, NewStats.LiveBytes);
+        ++NewStats.NumBlocks;
+    }
+    return NewPtr;
+}
+
+/**
+ * Free all pages, every block must have been freed by 'lua_close' already
+ */
+void FLuaAllocator::Reset()
+{
+    for (uint32 i = 0; i < NumSizeClasses; ++i)
+    {
+        FSizeClass &Class = Classes[i];
+        if (Class.Stats.NumBlocks > 0)
+        {
+            // 还有块没有释放，对应的页已经不在空闲链表里，只能泄漏
+            UE_LOG(LogUnLua, Warning, TEXT("%s: %u blocks of %u bytes are still alive!"), ANSI_TO_TCHAR(__FUNCTION__), Class.Stats.NumBlocks, Class.BlockSize);
+        }
+        while (Class.Partial)
+        {
+            FPage *Page = Class.Partial;
+            UnlinkPage(Class, Page);
+            FMemory::Free(Page);
+        }
+        Class.Stats = FSizeClassStats();
+    }
+    LargeStats = FSizeClassStats();
+}
+
+uint64 FLuaAllocator::GetLiveBytes() const
+{
+    uint64 Bytes = LargeStats.LiveBytes;
+    for (const FSizeClass &Class : Classes)
+    {
+        Bytes += Class.Stats.LiveBytes;
+    }
+    return Bytes;
+}
+
+uint64 FLuaAllocator::GetReservedBytes() const
+{
+    uint64 Bytes = LargeStats.LiveBytes;
+    for (const FSizeClass &Class : Classes)
+    {
+        Bytes += (uint64)Class.Stats.NumPages * PageSize;
+    }
+    return Bytes;
+}
+
+void FLuaAllocator::DumpStats(FOutputDevice &Ar) const
+{
+    Ar.Logf(TEXT("Lua allocator: %.2f MB live, %.2f MB reserved"), GetLiveBytes() / (1024.0 * 1024.0), GetReservedBytes() / (1024.0 * 1024.0));
+    Ar.Logf(TEXT("%8s %12s %12s %10s %8s"), TEXT("Size"), TEXT("Live(KB)"), TEXT("Peak(KB)"), TEXT("Blocks"), TEXT("Pages"));
+    for (const FSizeClass &Class : Classes)
+    {
+        Ar.Logf(TEXT("%8u %12.1f %12.1f %10u %8u"), Class.BlockSize, Class.Stats.LiveBytes / 1024.0, Class.Stats.PeakBytes / 1024.0, Class.Stats.NumBlocks, Class.Stats.NumPages);
+    }
+    Ar.Logf(TEXT("%8s %12.1f %12.1f %10u %8s"), TEXT("large"), LargeStats.LiveBytes / 1024.0, LargeStats.PeakBytes / 1024.0, LargeStats.NumBlocks, TEXT("-"));
+}
+
+void* FLuaAllocator::AllocSmall(uint32 ClassIndex)
+{
+    FSizeClass &Class = Classes[ClassIndex];
+    FPage *Page = Class.Partial;
+    if (!Page)
+    {
+        Page = NewPage(ClassIndex);
+        if (!Page)
+        {
+            return nullptr;
+        }
+    }
+
+    void *Block = Page->FreeList;
+    if (Block)
+    {
+        Page->FreeList = *(void**)Block;
+    }
+    else
+    {
+        // 页里没有空闲块但还没满，说明尾部还有从未分配过的块
+        Block = Page->Bump;
+        Page->Bump += Class.BlockSize;
+    }
+
+    if (++Page->NumUsed == Class.BlocksPerPage)
+    {
+        UnlinkPage(Class, Page);                            // full
+    }
+    return Block;
+}
+
+void FLuaAllocator::FreeSmall(void *Ptr, uint32 ClassIndex)
+{
+    FSizeClass &Class = Classes[ClassIndex];
+    FPage *Page = GetPage(Ptr);
+    check(Page->ClassIndex == ClassIndex);
+
+    if (Page->NumUsed == Class.BlocksPerPage)
+    {
+        LinkPage(Class, Page);                              // full -> partial
+    }
+    *(void**)Ptr = Page->FreeList;
+    Page->FreeList = Ptr;
+
+    // 空页归还，但每级至少留一页，避免在页边界上反复申请释放
+    if (--Page->NumUsed == 0 && (Page->Prev || Page->Next))
+    {
+        UnlinkPage(Class, Page);
+        FMemory::Free(Page);
+        --Class.Stats.NumPages;
+    }
+}
+
+FLuaAllocator::FPage* FLuaAllocator::NewPage(uint32 ClassIndex)
+{
+    FSizeClass &Class = Classes[ClassIndex];
+    FPage *Page = (FPage*)FMemory::Malloc(PageSize, PageSize);
+    if (!Page)
+    {
+        return nullptr;
+    }
+
+    Page->Prev = Page->Next = nullptr;
+    Page->FreeList = nullptr;
+    Page->Bump = (uint8*)Page + PageHeaderSize;
+    Page->NumUsed = 0;
+    Page->ClassIndex = ClassIndex;
+    LinkPage(Class, Page);
+    ++Class.Stats.NumPages;
+    return Page;
+}
+
+void FLuaAllocator::LinkPage(FSizeClass &Class, FPage *Page)
+{
+    Page->Prev = nullptr;
+    Page->Next = Class.Partial;
+    if (Class.Partial)
+    {
+        Class.Partial->Prev = Page;
+    }
+    Class.Partial = Page;
+}
+
+void FLuaAllocator::UnlinkPage(FSizeClass &Class, FPage *Page)
+{
+    if (Page->Prev)
+    {
+        Page->Prev->Next = Page->Next;
+    }
+    else
+    {
+        Class.Partial = Page->Next;
+    }
+    if (Page->Next)
+    {
+        Page->Next->Prev = Page->Prev;
+    }
+    Page->Prev = Page->Next = nullptr;
+}
@@ -0,0 +1,96 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Small object allocator for a Lua state
+ * Lua虚拟机专用的小对象分配器
+ *
+ * 不超过MaxSmallSize的块按16字节分级，每级从64KB对齐的页(slab)中切分，页头记录该页自己的空闲链表和使用计数，
+ * 释放时由地址对齐找到页，不需要额外的块头；页全部空闲且该级还有其他可用页时归还给FMemory。
+ * 更大的块直接走FMemory。Lua在释放和realloc时会传入原大小，所以也不需要GetAllocSize。
+ * 一个Lua状态机同时只会在一个线程上运行，分配器不加锁。
+ */
+class UNLUA_API FLuaAllocator
+{
+public:
+    static constexpr uint32 PageSize = 64 * 1024;
+    static constexpr uint32 Granularity = 16;
+    static constexpr uint32 MaxSmallSize = 256;
+    static constexpr uint32 NumSizeClasses = MaxSmallSize / Granularity;
+
+    struct FSizeClassStats
+    {
+        uint64 LiveBytes = 0;               // bytes requested by Lua
+        uint64 PeakBytes = 0;
+        uint32 NumBlocks = 0;
+        uint32 NumPages = 0;
+    };
+
+    FLuaAllocator();
+    ~FLuaAllocator();
+
+    /**
+     * Same contract as 'lua_Alloc', 'OldSize' is ignored when 'Ptr' is null
+     * 和lua_Alloc的语义一致，Ptr为空时OldSize是对象类型，忽略
+     */
+    void* Realloc(void *Ptr, size_t OldSize, size_t NewSize);
+
+    // 释放所有页，只能在Lua状态机关闭后调用
+    void Reset();
+
+    const FSizeClassStats& GetSizeClassStats(uint32 ClassIndex) const { return Classes[ClassIndex].Stats; }
+    const FSizeClassStats& GetLargeStats() const { return LargeStats; }
+    uint64 GetLiveBytes() const;
+    // 实际占用的内存(页+大块)，和GetLiveBytes的差就是碎片
+    uint64 GetReservedBytes() const;
+
+    void DumpStats(FOutputDevice &Ar) const;
+
+private:
+    struct FPage
+    {
+        FPage *Prev;                        // links of pages with free blocks in the same size class
+        FPage *Next;
+        void *FreeList;
+        uint8 *Bump;                        // blocks after this one were never allocated
+        uint32 NumUsed;
+        uint32 ClassIndex;
+    };
+
+    struct FSizeClass
+    {
+        FPage *Partial = nullptr;           // pages with free blocks
+        uint32 BlockSize = 0;
+        uint32 BlocksPerPage = 0;
+        FSizeClassStats Stats;
+    };
+
+    static constexpr uint32 PageHeaderSize = (sizeof(FPage) + Granularity - 1) & ~(Granularity - 1);
+
+    static FORCEINLINE uint32 GetClassIndex(size_t Size) { return (uint32)((Size - 1) / Granularity); }
+    static FORCEINLINE FPage* GetPage(void *Ptr) { return (FPage*)((UPTRINT)Ptr & ~(UPTRINT)(PageSize - 1)); }
+
+    void* AllocSmall(uint32 ClassIndex);
+    void FreeSmall(void *Ptr, uint32 ClassIndex);
+    FPage* NewPage(uint32 ClassIndex);
+    void LinkPage(FSizeClass &Class, FPage *Page);
+    void UnlinkPage(FSizeClass &Class, FPage *Page);
+
+    FSizeClass Classes[NumSizeClasses];
+    FSizeClassStats LargeStats;
+};
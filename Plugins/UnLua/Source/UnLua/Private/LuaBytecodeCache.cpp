@@ -0,0 +1,168 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaBytecodeCache.h"
+#include "LuaCore.h"
+#include "Hash/CityHash.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+
+int32 FLuaBytecodeCache::NumHits = 0;
+int32 FLuaBytecodeCache::NumMisses = 0;
+double FLuaBytecodeCache::SecondsSaved = 0.0;
+double FLuaBytecodeCache::SecondsParsing = 0.0;
+
+namespace
+{
+    // bump 'Magic' whenever the layout changes
+    struct FBytecodeCacheHeader
+    {
+        uint32 Magic;
+        uint32 LuaVersion;
+        uint64 SourceHash;
+        uint32 SourceSize;
+        uint32 ParseMicroseconds;       // time spent compiling the source, counted as saved on every hit
+        uint64 BytecodeHash;            // catches torn or truncated files, not tampering: the cache is never enabled in shipping builds
+        uint32 BytecodeSize;
+    };
+
+    static constexpr uint32 BytecodeCacheMagic = 0x32424C55;       // 'ULB2'
+
+    static int WriteBytecode(lua_State *L, const void *Data, size_t Size, void *Buffer)
+    {
+        ((TArray<uint8>*)Buffer)->Append((const uint8*)Data, Size);
+        return 0;
+    }
+
+    // set 'env' as the 1st upvalue of the loaded function, same as 'UnLua::LoadChunk'
+    static void SetChunkEnv(lua_State *L, int32 Env)
+    {
+        if (Env != 0)
+        {
+            lua_pushvalue(L, Env);
+            if (!lua_setupvalue(L, -2, 1))
+            {
+                lua_pop(L, 1);
+            }
+        }
+    }
+}
+
+/**
+ * Load a Lua source chunk, from cached bytecode if the source is unchanged
+ */
+bool FLuaBytecodeCache::LoadChunk(lua_State *L, const char *Chunk, int32 ChunkSize, const char *ChunkName, const char *Mode, int32 Env)
+{
+#if ENABLE_BYTECODE_CACHE
+    // 只缓存源码，已经是字节码的chunk或者只允许一种格式的加载不走缓存
+    const bool bCacheable = ChunkName && Mode && FCStringAnsi::Strchr(Mode, 'b') && FCStringAnsi::Strchr(Mode, 't')
+        && !(ChunkSize > 0 && Chunk[0] == LUA_SIGNATURE[0]);
+    // 字节码不做任何校验，不能从可写目录加载到发布版本里，cooked版本使用脚本包
+    if (!bCacheable || FPlatformProperties::RequiresCookedData())
+    {
+        return UnLua::LoadChunk(L, Chunk, ChunkSize, ChunkName, Mode, Env);
+    }
+
+    const uint64 SourceHash = CityHash64(Chunk, ChunkSize);
+    const FString CacheFilePath = GetCacheFilePath(ChunkName);
+
+    TArray<uint8> CacheData;
+    if (FFileHelper::LoadFileToArray(CacheData, *CacheFilePath, FILEREAD_Silent) && CacheData.Num() > sizeof(FBytecodeCacheHeader))
+    {
+        FBytecodeCacheHeader Header;
+        FMemory::Memcpy(&Header, CacheData.GetData(), sizeof(Header));
+        const char *Bytecode = (const char*)CacheData.GetData() + sizeof(Header);
+        const int32 BytecodeSize = CacheData.Num() - sizeof(Header);
+        if (Header.Magic == BytecodeCacheMagic && Header.LuaVersion == LUA_VERSION_RELEASE_NUM && Header.SourceSize == (uint32)ChunkSize && Header.SourceHash == SourceHash
+            && Header.BytecodeSize == (uint32)BytecodeSize && Header.BytecodeHash == CityHash64(Bytecode, BytecodeSize))
+        {
+            if (luaL_loadbufferx(L, Bytecode, BytecodeSize, ChunkName, "b") == LUA_OK)
+            {
+                SetChunkEnv(L, Env);
+
+                ++NumHits;
+                SecondsSaved += Header.ParseMicroseconds * 1e-6;
+                INC_DWORD_STAT(STAT_UnLua_BytecodeCache_Hits);
+                INC_FLOAT_STAT_BY(STAT_UnLua_BytecodeCache_MsSaved, Header.ParseMicroseconds * 1e-3f);
+                return true;
+            }
+
+            // written by another Lua build, compile the source instead
+            UE_LOG(LogUnLua, Verbose, TEXT("%s: Invalid bytecode cache for %s: %s"), ANSI_TO_TCHAR(__FUNCTION__), UTF8_TO_TCHAR(ChunkName), UTF8_TO_TCHAR(lua_tostring(L, -1)));
+            lua_pop(L, 1);
+        }
+    }
+
+    const double StartTime = FPlatformTime::Seconds();
+    if (!UnLua::LoadChunk(L, Chunk, ChunkSize, ChunkName, Mode, Env))
+    {
+        return false;
+    }
+    const double ParseSeconds = FPlatformTime::Seconds() - StartTime;
+
+    ++NumMisses;
+    SecondsParsing += ParseSeconds;
+    INC_DWORD_STAT(STAT_UnLua_BytecodeCache_Misses);
+
+    // keep debug info so error messages and debuggers still see file names and lines
+    TArray<uint8> NewCacheData;
+    NewCacheData.AddUninitialized(sizeof(FBytecodeCacheHeader));
+    if (lua_dump(L, WriteBytecode, &NewCacheData, 0) == 0)
+    {
+        FBytecodeCacheHeader Header;
+        Header.Magic = BytecodeCacheMagic;
+        Header.LuaVersion = LUA_VERSION_RELEASE_NUM;
+        Header.SourceHash = SourceHash;
+        Header.SourceSize = (uint32)ChunkSize;
+        Header.ParseMicroseconds = (uint32)FMath::Min(ParseSeconds * 1e6, (double)MAX_uint32);
+        Header.BytecodeSize = (uint32)(NewCacheData.Num() - sizeof(Header));
+        Header.BytecodeHash = CityHash64((const char*)NewCacheData.GetData() + sizeof(Header), Header.BytecodeSize);
+        FMemory::Memcpy(NewCacheData.GetData(), &Header, sizeof(Header));
+
+        // write a temp file then rename it, a crash while writing never leaves a torn cache file behind
+        const FString TempFilePath = FString::Printf(TEXT("%s.%s.tmp"), *CacheFilePath, *FGuid::NewGuid().ToString());
+        if (!FFileHelper::SaveArrayToFile(NewCacheData, *TempFilePath) || !IFileManager::Get().Move(*CacheFilePath, *TempFilePath, true, true, false, true))
+        {
+            IFileManager::Get().Delete(*TempFilePath, false, false, true);
+            UE_LOG(LogUnLua, Verbose, TEXT("%s: Failed to write bytecode cache %s"), ANSI_TO_TCHAR(__FUNCTION__), *CacheFilePath);
+        }
+    }
+    return true;
+#else
+    return UnLua::LoadChunk(L, Chunk, ChunkSize, ChunkName, Mode, Env);
+#endif
+}
+
+void FLuaBytecodeCache::LogStats()
+{
+    const int32 NumLoads = NumHits + NumMisses;
+    if (NumLoads > 0)
+    {
+        UE_LOG(LogUnLua, Log, TEXT("Lua bytecode cache: %d/%d hits (%.1f%%), %.1f ms parse time saved, %.1f ms spent parsing"),
+            NumHits, NumLoads, NumHits * 100.0 / NumLoads, SecondsSaved * 1000.0, SecondsParsing * 1000.0);
+    }
+}
+
+/**
+ * One cache file per chunk name, the content is validated against the source when loading
+ * 每个chunk对应一个缓存文件，加载时再校验源码
+ */
+FString FLuaBytecodeCache::GetCacheFilePath(const char *ChunkName)
+{
+    static const FString CacheDir = FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() / TEXT("UnLua/BytecodeCache"));
+    const uint64 NameHash = CityHash64(ChunkName, FCStringAnsi::Strlen(ChunkName));
+    return CacheDir / FString::Printf(TEXT("%016llx.luac"), NameHash);
+}
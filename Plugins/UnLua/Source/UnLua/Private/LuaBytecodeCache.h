@@ -0,0 +1,47 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct lua_State;
+
+/**
+ * On-disk cache of compiled Lua chunks, under 'Saved/UnLua/BytecodeCache'
+ * Lua字节码磁盘缓存，位于'Saved/UnLua/BytecodeCache'
+ *
+ * 缓存文件以chunk名区分，文件头记录源码的大小、哈希、字节码的哈希以及Lua版本，全部一致才直接加载字节码，否则重新编译源码并更新缓存。
+ * Lua不校验字节码，能写Saved目录就能执行任意代码，所以只用于编辑器和开发版本，默认关闭(UnLua.Build.cs中的bEnableBytecodeCache)。
+ */
+class FLuaBytecodeCache
+{
+public:
+    /**
+     * Load a Lua source chunk without running it, from cached bytecode if the source is unchanged. Same as 'UnLua::LoadChunk' otherwise
+     * 加载Lua源码，源码没有变化时直接加载缓存的字节码，其余行为和'UnLua::LoadChunk'一致
+     */
+    static bool LoadChunk(lua_State *L, const char *Chunk, int32 ChunkSize, const char *ChunkName, const char *Mode = "bt", int32 Env = 0);
+
+    // 输出命中率和节省的编译时间
+    static void LogStats();
+
+private:
+    static FString GetCacheFilePath(const char *ChunkName);
+
+    static int32 NumHits;
+    static int32 NumMisses;
+    static double SecondsSaved;             // parse time recorded in the cache files that were hit
+    static double SecondsParsing;           // parse time spent on misses
+};
@@ -0,0 +1,278 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaClassCache.h"
+#include "LuaCore.h"
+
+int32 FLuaClassCache::CacheRef = LUA_NOREF;
+uint32 FLuaClassCache::Version = 0;
+
+// marks keys that neither the Lua class nor the UClass has, same as '_NotExist' in UnLua.lua. It's stored in the Lua
+// class table, so defining the key on the class later simply overwrites it
+// 标记Lua类和UClass都没有的key，等同于UnLua.lua中的'_NotExist'。存放在Lua类表里，之后定义这个key时直接被覆盖
+static int32 NotExistTag = 0;
+
+static FORCEINLINE bool IsNotExist(lua_State *L, int32 Index)
+{
+    return lua_islightuserdata(L, Index) && lua_touserdata(L, Index) == &NotExistTag;
+}
+
+/**
+ * __index meta method for instances of Lua classes, replaces 'Index' in UnLua.lua
+ */
+int32 FLuaClassCache::Index(lua_State *L)
+{
+    // 传入时Lua栈从底到顶情况：LuaInstance、key
+    lua_settop(L, 2);
+    if (!lua_getmetatable(L, 1))                        // 3, the Lua class
+    {
+        return 0;
+    }
+
+    if (FindField(L, 3, 2))                             // 4
+    {
+        // UProperty，和GetUProperty(t, p)一样读取
+        lua_replace(L, 2);
+        lua_settop(L, 2);
+        return Global_GetUProperty(L);
+    }
+    return 1;
+}
+
+/**
+ * __newindex meta method for instances of Lua classes, replaces 'NewIndex' in UnLua.lua
+ */
+int32 FLuaClassCache::NewIndex(lua_State *L)
+{
+    // 传入时Lua栈从底到顶情况：LuaInstance、key、value
+    lua_settop(L, 3);
+    if (lua_getmetatable(L, 1) && FindField(L, 4, 2))  // 4, 5
+    {
+        // UProperty，和SetUProperty(t, p, v)一样写入
+        lua_replace(L, 2);
+        lua_settop(L, 3);
+        return Global_SetUProperty(L);
+    }
+
+    // 其他情况都是实例自己的字段
+    lua_settop(L, 3);
+    lua_rawset(L, 1);
+    return 0;
+}
+
+void FLuaClassCache::Initialize(lua_State *L)
+{
+    CreateWeakKeyTable(L);
+    CacheRef = luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+void FLuaClassCache::Cleanup()
+{
+    CacheRef = LUA_NOREF;
+}
+
+/**
+ * Drop the caches of a Lua class and of every class whose Super chain contains it,
+ * or of every Lua class bound to it if it's a UClass metatable
+ * 使Lua类及其子类的缓存失效，如果是UClass元表，则使绑定到它的Lua类的缓存失效
+ */
+void FLuaClassCache::Invalidate(lua_State *L, int32 TableIndex)
+{
+    if (CacheRef == LUA_NOREF)
+    {
+        return;
+    }
+
+    TableIndex = lua_absindex(L, TableIndex);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, CacheRef);
+    const int32 CachesIndex = lua_gettop(L);
+    lua_pushnil(L);
+    while (lua_next(L, CachesIndex) != 0)
+    {
+        // 传入时Lua栈从底到顶情况：..., Caches, Class, Entry
+        lua_rawgeti(L, -1, Entry_Metatable);
+        bool bStale = lua_rawequal(L, -1, TableIndex) != 0;
+        lua_pop(L, 1);
+
+        lua_pushvalue(L, -2);                           // walk the Super chain from the class itself
+        while (!bStale && lua_istable(L, -1))
+        {
+            bStale = lua_rawequal(L, -1, TableIndex) != 0;
+            lua_pushstring(L, "Super");
+            lua_rawget(L, -2);
+            lua_remove(L, -2);
+        }
+        lua_pop(L, 2);
+
+        if (bStale)
+        {
+            // clearing an existing field is allowed during traversal
+            lua_pushvalue(L, -1);
+            lua_pushnil(L);
+            lua_rawset(L, CachesIndex);
+        }
+    }
+    lua_pop(L, 1);
+}
+
+/**
+ * Push the method table and the field table of a Lua class, rebuild them if they are out of date
+ * 将Lua类的方法表和属性表压栈，版本过期或者绑定了其他UClass时重建
+ */
+void FLuaClassCache::PushClassCache(lua_State *L, int32 ClassIndex)
+{
+    if (CacheRef == LUA_NOREF)
+    {
+        Initialize(L);
+    }
+
+    ClassIndex = lua_absindex(L, ClassIndex);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, CacheRef);        // caches
+    const int32 CachesIndex = lua_gettop(L);
+    if (!lua_getmetatable(L, ClassIndex))               // UClass metatable
+    {
+        lua_pushnil(L);
+    }
+    const int32 MetatableIndex = CachesIndex + 1;
+
+    lua_pushvalue(L, ClassIndex);
+    bool bValid = false;
+    if (lua_rawget(L, CachesIndex) == LUA_TTABLE)       // entry
+    {
+        lua_rawgeti(L, -1, Entry_Metatable);
+        lua_rawgeti(L, -2, Entry_Version);
+        bValid = lua_rawequal(L, -2, MetatableIndex) && lua_tointeger(L, -1) == (lua_Integer)Version;
+        lua_pop(L, 2);
+    }
+
+    if (!bValid)
+    {
+        lua_pop(L, 1);
+        lua_createtable(L, 4, 0);
+        lua_newtable(L);
+        lua_rawseti(L, -2, Entry_Methods);
+        lua_newtable(L);
+        lua_rawseti(L, -2, Entry_Fields);
+        lua_pushvalue(L, MetatableIndex);
+        lua_rawseti(L, -2, Entry_Metatable);
+        lua_pushinteger(L, (lua_Integer)Version);
+        lua_rawseti(L, -2, Entry_Version);
+        lua_pushvalue(L, ClassIndex);
+        lua_pushvalue(L, -2);
+        lua_rawset(L, CachesIndex);
+    }
+
+    lua_rawgeti(L, -1, Entry_Methods);
+    lua_rawgeti(L, -2, Entry_Fields);
+    lua_replace(L, CachesIndex + 1);
+    lua_replace(L, CachesIndex);
+    lua_settop(L, CachesIndex + 1);
+}
+
+/**
+ * Push the value of a key seen by instances of a Lua class
+ * 查找Lua类实例上的key，结果压栈
+ *
+ * @return - true if the pushed value is a UProperty (light userdata), false if it's the value itself
+ */
+bool FLuaClassCache::FindField(lua_State *L, int32 ClassIndex, int32 KeyIndex)
+{
+    PushClassCache(L, ClassIndex);
+    const int32 FieldsIndex = lua_gettop(L);
+    const int32 MethodsIndex = FieldsIndex - 1;
+
+    // 1. 方法表：Lua类及其Super链上的成员，以及UFunction闭包
+    lua_pushvalue(L, KeyIndex);
+    int32 Type = lua_rawget(L, MethodsIndex);
+    if (Type != LUA_TNIL)
+    {
+        lua_replace(L, MethodsIndex);
+        lua_settop(L, MethodsIndex);
+        return false;
+    }
+    lua_pop(L, 1);
+
+    // 2. 属性表：UProperty
+    lua_pushvalue(L, KeyIndex);
+    Type = lua_rawget(L, FieldsIndex);
+    if (Type == LUA_TNIL)
+    {
+        lua_pop(L, 1);
+
+        // 3. 未命中，查找顺序和UnLua.lua中的Index一致：先沿Super链rawget，再通过UClass的元表查找
+        const bool bCacheable = lua_type(L, KeyIndex) == LUA_TSTRING;
+        lua_pushvalue(L, ClassIndex);                   // super
+        while (lua_istable(L, -1))
+        {
+            lua_pushvalue(L, KeyIndex);
+            if (lua_rawget(L, -2) != LUA_TNIL)
+            {
+                if (IsNotExist(L, -1))
+                {
+                    lua_pushnil(L);
+                    lua_replace(L, MethodsIndex);
+                    lua_settop(L, MethodsIndex);
+                    return false;
+                }
+                if (bCacheable)
+                {
+                    lua_pushvalue(L, KeyIndex);
+                    lua_pushvalue(L, -2);
+                    lua_rawset(L, MethodsIndex);
+                }
+                lua_replace(L, MethodsIndex);
+                lua_settop(L, MethodsIndex);
+                return false;
+            }
+            lua_pop(L, 1);
+            lua_pushstring(L, "Super");
+            lua_rawget(L, -2);
+            lua_remove(L, -2);
+        }
+        lua_pop(L, 1);
+
+        lua_pushvalue(L, KeyIndex);
+        Type = lua_gettable(L, ClassIndex);             // calls 'Class_Index' of the UClass metatable
+        if (bCacheable)
+        {
+            if (Type == LUA_TFUNCTION)
+            {
+                lua_pushvalue(L, KeyIndex);
+                lua_pushvalue(L, -2);
+                lua_rawset(L, MethodsIndex);
+            }
+            else if (Type == LUA_TLIGHTUSERDATA || Type == LUA_TUSERDATA)
+            {
+                lua_pushvalue(L, KeyIndex);
+                lua_pushvalue(L, -2);
+                lua_rawset(L, FieldsIndex);
+            }
+            else if (Type == LUA_TNIL)
+            {
+                lua_pushvalue(L, KeyIndex);
+                lua_pushlightuserdata(L, &NotExistTag);
+                lua_rawset(L, ClassIndex);
+            }
+        }
+    }
+
+    bool bProperty = false;
+    if (Type == LUA_TLIGHTUSERDATA || Type == LUA_TUSERDATA)
+    {
+        bProperty = true;
+    }
+    lua_replace(L, MethodsIndex);
+    lua_settop(L, MethodsIndex);
+    return bProperty;
+}
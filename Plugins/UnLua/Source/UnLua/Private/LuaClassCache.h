@@ -0,0 +1,62 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct lua_State;
+
+/**
+ * Native __index/__newindex for Lua classes created by 'Class()' in UnLua.lua
+ * UnLua.lua中Class()创建的Lua类的原生__index/__newindex
+ *
+ * 每个Lua类在C++侧持有两张扁平化的表：方法表(自身及Super链上的成员、UFunction闭包)，属性表(UProperty访问器)。
+ * 不存在的key和UnLua.lua一样标记在Lua类表自己里，之后给类表赋值会直接覆盖标记，不需要失效缓存。
+ * 查找时不再沿Super链逐层rawget，也不再把方法拷贝到每个实例表里，实例表中只保留真正的实例字段。
+ * 缓存放在一张弱key表里(Lua类 -> 缓存)，不会让已经卸载的模块常驻内存。
+ * 缓存记录了Lua类当时绑定的UClass元表，模块被绑定到其他UClass后只重建这一个类的缓存；
+ * 类表被写入新key、类被反注册时只失效相关的类，热更新时整体失效，下次访问时按需重建。
+ */
+class FLuaClassCache
+{
+public:
+    static int32 Index(lua_State *L);
+    static int32 NewIndex(lua_State *L);
+
+    // 创建缓存表，Lua虚拟机创建时调用
+    static void Initialize(lua_State *L);
+    // 使所有Lua类的缓存失效，热更新后调用
+    static void Invalidate() { ++Version; }
+    // 使某个Lua类及其子类的缓存失效；传入UClass元表时，使绑定到它的Lua类的缓存失效
+    static void Invalidate(lua_State *L, int32 TableIndex);
+    // 忘掉所有缓存，Lua虚拟机关闭时调用
+    static void Cleanup();
+
+private:
+    // entry of the cache table, a Lua array
+    enum EEntryField
+    {
+        Entry_Methods = 1,
+        Entry_Fields,
+        Entry_Metatable,        // the UClass metatable the Lua class was bound to when the entry was built
+        Entry_Version,
+    };
+
+    static void PushClassCache(lua_State *L, int32 ClassIndex);
+    static bool FindField(lua_State *L, int32 ClassIndex, int32 KeyIndex);
+
+    static int32 CacheRef;      // weak key table, Lua class -> entry
+    static uint32 Version;
+};
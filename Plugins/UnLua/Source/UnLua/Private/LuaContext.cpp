@@ -14,6 +14,14 @@
 
 #include "LuaContext.h"
 #include "LuaCore.h"
+#include "LuaBytecodeCache.h"
+#include "LuaClassCache.h"
+#include "LuaCrossHeapGC.h"
+#include "LuaGCController.h"
+#include "LuaGCScheduler.h"
+#include "LuaMemoryTracker.h"
+#include "LuaPropertyAccessor.h"
+#include "LuaScriptBundle.h"
 #include "LuaDynamicBinding.h"
 #include "UnLuaEx.h"
 #include "UnLuaManager.h"
@@ -27,6 +35,7 @@
 #include "DefaultParamCollection.h"
 #include "ReflectionUtils/ReflectionRegistry.h"
 #include "Interfaces/IPluginManager.h"
+#include "HAL/IConsoleManager.h"
 #include "DelegateHelper.h"
 
 #if WITH_EDITOR
@@ -35,6 +44,27 @@
 #endif
 
 
+static TAutoConsoleVariable<int32> CVarGCPolicy(
+    TEXT("unlua.GC.Policy"),
+    ENABLE_GC_SCHEDULER ? 1 : 0,
+    TEXT("Lua GC used when FUnLuaDelegates::ConfigureLuaGC isn't bound, read when the Lua state is created.\n")
+    TEXT("0: Lua defaults (generational), 1: frame-budgeted incremental GC, 2: adaptive generational/incremental"),
+    ECVF_Default);
+
+// 只有启用小对象分配器时Lua内存才经过它，否则统计全是0
+#if ENABLE_SMALL_OBJECT_ALLOCATOR
+static FAutoConsoleCommandWithOutputDevice CmdDumpLuaAllocator(
+    TEXT("unlua.DumpAllocator"),
+    TEXT("Print live/peak bytes of each size class of the Lua allocator."),
+    FConsoleCommandWithOutputDeviceDelegate::CreateStatic([](FOutputDevice& Ar)
+    {
+        if (GLuaCxt)
+        {
+            GLuaCxt->GetAllocator().DumpStats(Ar);
+        }
+    }));
+#endif
+
 /**
  * Statically exported callback for 'Hotfix'
  * 热修复
@@ -96,6 +126,7 @@ void FLuaContext::RegisterDelegates()
     FCoreDelegates::OnHandleSystemEnsure.AddRaw(this, &FLuaContext::OnCrash);
     FCoreUObjectDelegates::PostLoadMapWithWorld.AddRaw(this, &FLuaContext::PostLoadMapWithWorld);
     //FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddRaw(this, &FLuaContext::OnPreGarbageCollect);
+    OnPostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddRaw(this, &FLuaContext::OnPostGarbageCollect);
 
 #if WITH_EDITOR
     FEditorDelegates::PreBeginPIE.AddRaw(this, &FLuaContext::PreBeginPIE);
@@ -123,7 +154,11 @@ void FLuaContext::CreateState()
     {
 
         // 创建Lua主线程
+#if ENABLE_SMALL_OBJECT_ALLOCATOR
+        L = lua_newstate(FLuaContext::LuaAllocator, &Allocator);    // create main Lua thread
+#else
         L = lua_newstate(FLuaContext::LuaAllocator, nullptr);       // create main Lua thread
+#endif
         check(L);
         // 打开所有的Lua标准库
         luaL_openlibs(L);                                           // open all standard Lua libraries
@@ -134,16 +169,15 @@ void FLuaContext::CreateState()
         AddSearcher(LoadFromFileSystem, 3);
         // 编译的库
         AddSearcher(LoadFromBuiltinLibs, 4);
+        // 打包的脚本包，放在文件系统之前，require时不再读取文件；ProjectPersistentDownloadDir中有热更新脚本的模块除外
+        if (FLuaScriptBundle::Mount())
+        {
+            AddSearcher(FLuaScriptBundle::LoadFromBundle, 3);
+        }
 
-        // 创建ObjectMap(弱表v)
-        lua_pushstring(L, "ObjectMap");                             // create weak table 'ObjectMap'
-        CreateWeakValueTable(L);
-        lua_rawset(L, LUA_REGISTRYINDEX);
-
-        // 创建StructMap(弱表v)
-        lua_pushstring(L, "StructMap");                             // create weak table 'StructMap'
-        CreateWeakValueTable(L);
-        lua_rawset(L, LUA_REGISTRYINDEX);
+        // UObject和结构体的代理索引(替代原来的ObjectMap/StructMap弱表)
+        ObjectIndex.Initialize(L);
+        NameCache.Initialize(L);
 
         // 创建ScriptContainerMap(弱表v)
         lua_pushstring(L, "ScriptContainerMap");                    // create weak table 'ScriptContainerMap'
@@ -181,10 +215,21 @@ void FLuaContext::CreateState()
         lua_register(L, "UnLua_RemoveFromClassWhiteSet", Global_RemoveFromClassWhiteSet);
         // 反注册Class
         lua_register(L, "UnLua_UnRegisterClass", Global_UnRegisterClass);
+        // Lua类的原生__index/__newindex，见UnLua.lua中的Class()
+        lua_register(L, "UnLua_ClassIndex", FLuaClassCache::Index);
+        lua_register(L, "UnLua_ClassNewIndex", FLuaClassCache::NewIndex);
+        FLuaClassCache::Initialize(L);
+        lua_register(L, "UnLua_InvalidateClassCache", Global_InvalidateClassCache);
 
         // UE打印
         lua_register(L, "UEPrint", Global_Print);
 
+        // 属性批量读写和属性路径，见LuaPropertyAccessor.h
+        FLuaPropertyAccessor::Register(L);
+
+        // 虚拟机内联缓存，需要在Lua.Build.cs中开启
+        SetupUdataInlineCache(L);
+
         // register collision related enums
         // 注册碰撞Enum
         FCollisionHelper::Initialize();     // initialize collision helper stuff
@@ -196,6 +241,16 @@ void FLuaContext::CreateState()
         {
             FUnLuaDelegates::ConfigureLuaGC.Execute(L);
         }
+        else if (CVarGCPolicy.GetValueOnGameThread() == 1)
+        {
+            // 关闭自动GC，按帧预算增量回收
+            FLuaGCScheduler::Start(L);
+        }
+        else if (CVarGCPolicy.GetValueOnGameThread() == 2)
+        {
+            // 根据实测停顿自动选择分代/增量模式
+            FLuaGCController::Start(L);
+        }
         else
         {
             // UnLua默认使用的Lua5.4.2,区别SLua默认使用的是5.3.4
@@ -209,6 +264,9 @@ void FLuaContext::CreateState()
 #endif
         }
 
+        // 回收Lua实例表和GObjectReferencer之间的循环引用，由'unlua.CrossGC.IntervalSeconds'开启
+        FLuaCrossHeapGC::Start(L);
+
         // add new package path
         // 新增包路径
         FString LuaSrcPath = GLuaSrcFullPath + TEXT("?.lua");
@@ -617,6 +675,15 @@ void FLuaContext::OnPreExit()
     Cleanup(true);                                  // full clean up
 }
 
+/**
+ * Callback for FCoreUObjectDelegates::GetPostGarbageCollect
+ */
+void FLuaContext::OnPostGarbageCollect()
+{
+    // tables still being probed by other threads (e.g. async loading) are kept until a later call
+    UObjPtr2Idx.ReclaimRetiredTables();
+}
+
 /**
  * Callback for FCoreDelegates::OnAsyncLoadingFlushUpdate
  */
@@ -822,14 +889,14 @@ int32 FLuaContext::FindThread(lua_State* Thread)
  */
 void FLuaContext::NotifyUObjectCreated(const UObjectBase* InObject, int32 Index)
 {
+    // 把所有新创建的UObject添加到一个列表中，用于后续判断Object的有效性
+    UObjPtr2Idx.Add(InObject, Index);
+#if UNLUA_ENABLE_DEBUG != 0
     {
         FScopeLock Lock(&Async2MainCS);
-        // 把所有新创建的UObject添加到一个列表中，用于后续判断Object的有效性
-        UObjPtr2Idx.Add(const_cast<UObjectBase*>(InObject), Index);
-#if UNLUA_ENABLE_DEBUG != 0
         UObjPtr2Name.Add(const_cast<UObjectBase*>(InObject), InObject->GetFName().ToString());
-#endif
     }
+#endif
 
     if (!bEnable)
     {
@@ -880,10 +947,10 @@ void FLuaContext::NotifyUObjectDeleted(const UObjectBase* InObject, int32 Index)
 {
     if (!bEnable)
     {
-        FScopeLock Lock(&Async2MainCS);
         UObjPtr2Idx.Remove(InObject);
 
 #if UNLUA_ENABLE_DEBUG != 0
+        FScopeLock Lock(&Async2MainCS);
         UObjPtr2Name.Remove(InObject);
 #endif
 
@@ -907,9 +974,12 @@ void FLuaContext::NotifyUObjectDeleted(const UObjectBase* InObject, int32 Index)
         }
     }
 
-    FScopeLock Lock(&Async2MainCS);
     UObjPtr2Idx.Remove(InObject);
+
+#if UNLUA_ENABLE_DEBUG != 0
+    FScopeLock Lock(&Async2MainCS);
     UObjPtr2Name.Remove(InObject);
+#endif
 }
 
 
@@ -945,16 +1015,9 @@ bool FLuaContext::IsUObjectValid(UObjectBase* UObjPtr)
         return false;
     }
 
-    int32 UObjIdx = -1;
-    {
-        FScopeLock Lock(&Async2MainCS);
-        if (UObjPtr2Idx.Contains(UObjPtr))
-        {
-            UObjIdx = UObjPtr2Idx[UObjPtr];
-        }
-    }
-
-    if (-1 != UObjIdx)
+    // 无锁查找，不会和异步加载线程的NotifyUObjectCreated/NotifyUObjectDeleted互相阻塞
+    const int32 UObjIdx = UObjPtr2Idx.Find(UObjPtr);
+    if (INDEX_NONE != UObjIdx)
     {
         FUObjectItem* UObjectItem = GUObjectArray.IndexToObject(UObjIdx);
         if (!UObjectItem)
@@ -1010,10 +1073,10 @@ FLuaContext::~FLuaContext()
     GUObjectArray.RemoveUObjectDeleteListener(GLuaCxt);
 #endif
 
-    FScopeLock Lock(&Async2MainCS);
     UObjPtr2Idx.Empty();
 
 #if UNLUA_ENABLE_DEBUG != 0
+    FScopeLock Lock(&Async2MainCS);
     UObjPtr2Name.Empty();
 #endif
 }
@@ -1024,12 +1087,41 @@ FLuaContext::~FLuaContext()
  */
 void* FLuaContext::LuaAllocator(void* ud, void* ptr, size_t osize, size_t nsize)
 {
+    if (ud)
+    {
+        // Lua给出了原大小，统计不需要GetAllocSize
+        void* Buffer = ((FLuaAllocator*)ud)->Realloc(ptr, osize, nsize);
+        if (FLuaMemoryTracker::IsEnabled())
+        {
+            FLuaMemoryTracker::OnRealloc(ptr, ptr ? osize : 0, Buffer, nsize);
+        }
+#if STATS
+        const size_t OldSize = ptr ? osize : 0;
+        if (nsize == 0 || Buffer)
+        {
+            if (nsize > OldSize)
+            {
+                INC_MEMORY_STAT_BY(STAT_UnLua_Lua_Memory, nsize - OldSize);
+            }
+            else
+            {
+                DEC_MEMORY_STAT_BY(STAT_UnLua_Lua_Memory, OldSize - nsize);
+            }
+        }
+#endif
+        return Buffer;
+    }
+
     if (nsize == 0)
     {
 #if STATS
         const uint32 Size = FMemory::GetAllocSize(ptr);
         DEC_MEMORY_STAT_BY(STAT_UnLua_Lua_Memory, Size);
 #endif
+        if (FLuaMemoryTracker::IsEnabled())
+        {
+            FLuaMemoryTracker::OnRealloc(ptr, osize, nullptr, 0);
+        }
         FMemory::Free(ptr);
         return nullptr;
     }
@@ -1061,6 +1153,10 @@ void* FLuaContext::LuaAllocator(void* ud, void* ptr, size_t osize, size_t nsize)
         }
 #endif
     }
+    if (FLuaMemoryTracker::IsEnabled())
+    {
+        FLuaMemoryTracker::OnRealloc(ptr, ptr ? osize : 0, Buffer, nsize);
+    }
     return Buffer;
 }
 
@@ -1074,6 +1170,12 @@ void FLuaContext::Initialize()
         // 创建Lua主线程
         CreateState();  // create Lua main thread
 
+        // removed by the last full clean up
+        if (!OnPostGarbageCollectHandle.IsValid())
+        {
+            OnPostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddRaw(this, &FLuaContext::OnPostGarbageCollect);
+        }
+
         // create UnLuaManager and add it to root
         // 创建UUnLuaManager,同时AddToRoot
         Manager = NewObject<UUnLuaManager>();
@@ -1118,8 +1220,18 @@ void FLuaContext::Cleanup(bool bFullCleanup, UWorld* World)
 
             // close lua state first
             // 先关闭Lua虚拟机
+            FLuaGCScheduler::Stop();
+            FLuaGCController::Stop();
+            FLuaCrossHeapGC::Stop();
+            FLuaMemoryTracker::Stop();
             lua_close(L);
             L = nullptr;
+            Allocator.Reset();
+            ObjectIndex.Reset();
+            NameCache.Reset();
+            FLuaClassCache::Cleanup();
+            FLuaBytecodeCache::LogStats();
+            FLuaScriptBundle::Unmount();
 
             // clean ue side modules,es static data structes
             FCollisionHelper::Cleanup();                        // clean up collision helper stuff
@@ -1144,6 +1256,7 @@ void FLuaContext::Cleanup(bool bFullCleanup, UWorld* World)
             GameInstances.Empty();
             CandidateInputComponents.Empty();
             FCoreUObjectDelegates::GetPostGarbageCollect().Remove(OnPostGarbageCollectHandle);
+            OnPostGarbageCollectHandle.Reset();
             FWorldDelegates::OnWorldTickStart.Remove(OnWorldTickStartHandle);
 
             // old manager
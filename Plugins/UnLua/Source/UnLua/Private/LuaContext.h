@@ -19,6 +19,10 @@
 #include "GenericPlatform/GenericApplication.h"
 #include "Runtime/Launch/Resources/Version.h"
 #include "UnLuaBase.h"
+#include "ObjectValidityTable.h"
+#include "LuaAllocator.h"
+#include "LuaObjectIndex.h"
+#include "LuaNameCache.h"
 
 class FLuaContext : public FUObjectArray::FUObjectCreateListener, public FUObjectArray::FUObjectDeleteListener
 {
@@ -138,6 +142,15 @@ public:
     // 获取Manage
     UUnLuaManager* GetUnLuaManager();
 
+    // 主线程的内存分配器
+    const FLuaAllocator& GetAllocator() const { return Allocator; }
+
+    // C++对象到Lua代理的索引
+    FORCEINLINE FLuaObjectIndex& GetObjectIndex() { return ObjectIndex; }
+
+    // FName和Lua字符串的双向缓存
+    FORCEINLINE FLuaNameCache& GetNameCache() { return NameCache; }
+
 private:
     FLuaContext();
     ~FLuaContext();
@@ -157,6 +170,12 @@ private:
 
     lua_State *L;
 
+    FLuaAllocator Allocator;            // small object allocator for the main Lua state
+
+    FLuaObjectIndex ObjectIndex;        // proxies of UObjects and structs
+
+    FLuaNameCache NameCache;            // interned FName <-> Lua string conversions
+
     UUnLuaManager *Manager;
 
     FDelegateHandle OnActorSpawnedHandle;
@@ -184,9 +203,9 @@ private:
     //thread need refine
     TMap<lua_State*, int32> ThreadToRef;                                // coroutine -> ref
     TMap<int32, lua_State*> RefToThread;                                // ref -> coroutine
-	TMap<UObjectBase *, int32> UObjPtr2Idx;                             // UObject pointer -> index in GUObjectArray
+    FObjectValidityTable UObjPtr2Idx;                                   // UObject pointer -> index in GUObjectArray, lock free for readers
     TMap<UObjectBase*, FString> UObjPtr2Name;                           // UObject pointer -> Name for debug purpose
-    FCriticalSection Async2MainCS;                                      // async loading thread and main thread sync lock
+    FCriticalSection Async2MainCS;                                      // async loading thread and main thread sync lock (candidates and debug names)
 
 #if WITH_EDITOR
     void *LuaHandle;
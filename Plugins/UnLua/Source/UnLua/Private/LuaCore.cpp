@@ -13,6 +13,9 @@
 // See the License for the specific language governing permissions and limitations under the License.
 
 #include "LuaCore.h"
+#include "LuaBytecodeCache.h"
+#include "LuaClassCache.h"
+#include "LuaMemoryTracker.h"
 #include "LuaDynamicBinding.h"
 #include "LuaContext.h"
 #include "UnLua.h"
@@ -66,19 +69,26 @@ static int32 UE4_Index(lua_State *L)
 }
 
 /**
- * Get lua file full path from relative path
+ * Get the path of a downloaded (hot patched) lua file from relative path, the file may not exist
  */
-FString GetFullPathFromRelativePath(const FString& RelativePath)
+FString GetDownloadPathFromRelativePath(const FString& RelativePath)
 {
-    FString FullFilePath = GLuaSrcFullPath + RelativePath;
     FString ProjectDir = FPaths::ConvertRelativePathToFull(FPaths::ProjectDir());
     FString ProjectPersistentDownloadDir = FPaths::ConvertRelativePathToFull(FPaths::ProjectPersistentDownloadDir());
     if (!ProjectPersistentDownloadDir.EndsWith("/"))
     {
         ProjectPersistentDownloadDir.Append("/");
     }
+    return (GLuaSrcFullPath + RelativePath).Replace(*ProjectDir, *ProjectPersistentDownloadDir);
+}
 
-    FString RealFullFilePath = FullFilePath.Replace(*ProjectDir, *ProjectPersistentDownloadDir);        // try to load the file from 'ProjectPersistentDownloadDir' first
+/**
+ * Get lua file full path from relative path
+ */
+FString GetFullPathFromRelativePath(const FString& RelativePath)
+{
+    FString FullFilePath = GLuaSrcFullPath + RelativePath;
+    FString RealFullFilePath = GetDownloadPathFromRelativePath(RelativePath);                            // try to load the file from 'ProjectPersistentDownloadDir' first
     if (IFileManager::Get().FileExists(*RealFullFilePath))
     {
         FullFilePath = RealFullFilePath;
@@ -466,11 +476,32 @@ void* GetUserdataFast(lua_State *L, int32 Index, bool *OutTwoLvlPtr)
     return Userdata;
 }
 
+/**
+ * Set the metatable cached on a class descriptor for the userdata on the top of the stack
+ * 用类描述上缓存的元表引用设置元表
+ */
+static bool TryToSetCachedMetatable(lua_State *L, FClassDesc *ClassDesc)
+{
+    if (!ClassDesc || ClassDesc->GetMetatableRef() == LUA_NOREF)
+    {
+        return false;
+    }
+    lua_rawgeti(L, LUA_REGISTRYINDEX, ClassDesc->GetMetatableRef());
+    lua_setmetatable(L, -2);
+    ClassDesc->AddRef();
+    return true;
+}
+
 /**
  * Set metatable for the userdata/table on the top of the stack
  */
-bool TryToSetMetatable(lua_State* L, const char* MetatableName, UObject* Object)
+bool TryToSetMetatable(lua_State* L, const char* MetatableName, FClassDesc* ClassDesc)
 {
+    if (TryToSetCachedMetatable(L, ClassDesc))
+    {
+        return true;
+    }
+
     int32 Type = LUA_TNIL;
 
     // exported non reflected class only need check metatable
@@ -493,7 +524,7 @@ bool TryToSetMetatable(lua_State* L, const char* MetatableName, UObject* Object)
     else
     {   
         // other class,check classdesc
-        FClassDesc* ClassDesc = GReflectionRegistry.FindClass(MetatableName);
+        ClassDesc = GReflectionRegistry.FindClass(MetatableName);
         if (!ClassDesc)
         {
             UnLua::FAutoStack AutoStack;
@@ -506,6 +537,13 @@ bool TryToSetMetatable(lua_State* L, const char* MetatableName, UObject* Object)
         }
         else
         {
+            // cache the metatable reference, later pushes don't look it up by name
+            // 缓存元表引用，之后不再按名字查找
+            if (ClassDesc->GetMetatableRef() == LUA_NOREF)
+            {
+                lua_pushvalue(L, -1);
+                ClassDesc->SetMetatableRef(luaL_ref(L, LUA_REGISTRYINDEX));
+            }
             // 直接设置元表
             lua_setmetatable(L, -2);                                    // set the metatable directly
             ClassDesc->AddRef();
@@ -716,6 +754,20 @@ void RemoveCachedScriptContainer(lua_State *L, void *Key)
  */
 void PushObjectCore(lua_State *L, UObjectBaseUtility *Object)
 {
+    // fast path, the class is registered and its metatable is cached, no metatable name is built
+    // 快速路径：类已注册并缓存了元表引用，不需要拼接元表名和按名字查找
+    // UStruct/UEnum对象用的是它们自身对应的元表，走下面的常规路径
+    if (GLuaCxt->IsUObjectValid((UObjectBase*)Object) && !Object->IsA<UStruct>() && !Object->IsA<UEnum>())
+    {
+        FClassDesc *ClassDesc = GReflectionRegistry.FindClassByStruct(Object->GetClass());
+        if (ClassDesc && ClassDesc->GetMetatableRef() != LUA_NOREF)
+        {
+            NewUserdataWithTwoLvPtrTag(L, sizeof(void*), Object);
+            TryToSetCachedMetatable(L, ClassDesc);
+            return;
+        }
+    }
+
     FString MetatableName = GetMetatableName(Object);
     if (MetatableName.IsEmpty())
     {
@@ -731,17 +783,107 @@ void PushObjectCore(lua_State *L, UObjectBaseUtility *Object)
     // 创建一个userdata，是一个二级指针
     // 注意lightuserdata和userdata的区别，lightuserdata就是用来保存一个指针，是不会被Lua GC的
     // 而userdata是lua分配了一块特定大小的内存，不用是会被GC掉的
-    // 执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、LuaInstance、userdata
+    // 执行完的Lua栈从底到顶情况：旧栈顶、LuaInstance、userdata
     NewUserdataWithTwoLvPtrTag(L, sizeof(void*), Object);  // create a userdata and store the UObject address
     // 设置元表
     // 将类型名对应的元表设为userdata的metatable
-    bool bSuccess = TryToSetMetatable(L, TCHAR_TO_UTF8(*MetatableName), (UObject*)Object);
+    bool bSuccess = TryToSetMetatable(L, TCHAR_TO_UTF8(*MetatableName));
 	if (!bSuccess)
 	{
 		UNLUA_LOGERROR(L, LogUnLua, Warning, TEXT("%s, Invalid metatable,Name %s, Object %s,%p!"), ANSI_TO_TCHAR(__FUNCTION__), *MetatableName, *Object->GetName(), Object);
 	}
 }
 
+/**
+ * Push a pointer with the name of meta table
+ */
+int32 PushPointerCore(lua_State *L, void *Value, const char *MetatableName, FClassDesc *ClassDesc, bool bAlwaysCreate)
+{
+    if (!Value
+        || !MetatableName)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    bool bCreateUserdata = bAlwaysCreate;
+    if (!bAlwaysCreate)
+    {
+        // find the pointer from the object index first
+        // 由于FStruct不被GC管理，因此UnLua不需要像UObject一样添加引用
+        if (GLuaCxt->GetObjectIndex().PushStruct(L, Value))
+        {
+            // check metatable is same?
+            bool bMTSame = false;
+            if (lua_getmetatable(L, -1))
+            {   
+                if (ClassDesc && ClassDesc->GetMetatableRef() != LUA_NOREF)
+                {
+                    lua_rawgeti(L, LUA_REGISTRYINDEX, ClassDesc->GetMetatableRef());
+                }
+                else
+                {
+                    luaL_getmetatable(L, MetatableName);
+                }
+                if (lua_rawequal(L,-1,-2))
+                {   
+                    bMTSame = true;
+                }
+
+                lua_pop(L, 2);
+            }
+
+			if (!bMTSame)
+            {
+#if UNLUA_ENABLE_DEBUG != 0
+                FString CurMetatableName;
+                if (lua_getmetatable(L, -1))
+                {
+                    lua_pushstring(L, "__name");
+                    int32 Type = lua_rawget(L,-2);
+                    if (LUA_TSTRING == Type)
+                    {
+                        CurMetatableName = UTF8_TO_TCHAR(lua_tostring(L,-1));
+                    }
+                    lua_pop(L, 2);
+                }
+				UE_LOG(LogTemp, Log, TEXT("%s : userdata with difference metatable finded! need %s,get %s,may be local or stack variable pushed to lua..."),
+                    ANSI_TO_TCHAR(__FUNCTION__), UTF8_TO_TCHAR(MetatableName), *CurMetatableName);
+#endif
+                bool bSuccess = TryToSetMetatable(L, MetatableName, ClassDesc);        // set metatable
+                if (!bSuccess)
+                {
+                    UNLUA_LOGERROR(L, LogUnLua, Warning, TEXT("%s, Invalid metatable, metatable name: !"),  UTF8_TO_TCHAR(MetatableName));
+                    return 1;
+                }
+            }
+        }
+        else
+        {
+            bCreateUserdata = true;     // create a new userdata if the value is not found
+        }
+    }
+
+    if (bCreateUserdata)
+    {
+        NewUserdataWithTwoLvPtrTag(L, sizeof(void*), Value);
+        bool bSuccess = TryToSetMetatable(L, MetatableName, ClassDesc);        // set metatable
+        if (!bSuccess)
+        {
+            UNLUA_LOGERROR(L, LogUnLua, Warning, TEXT("%s, Invalid metatable, metatable name: !"), ANSI_TO_TCHAR(__FUNCTION__), UTF8_TO_TCHAR(MetatableName));
+            return 1;
+        }
+
+        if (!bAlwaysCreate)
+        {
+            // cache the new userdata in the object index
+            GLuaCxt->GetObjectIndex().AddStruct(L, Value, -1);
+        }
+    }
+
+    return 1;
+}
+
 
 /**
  * Push a integer
@@ -772,7 +914,7 @@ static void PushEnumElement(lua_State *L, FNumericProperty *Property, void *Valu
  */
 static void PushFNameElement(lua_State *L, FNameProperty *Property, void *Value)
 {
-    lua_pushstring(L, TCHAR_TO_UTF8(*Property->GetPropertyValue(Value).ToString()));
+    GLuaCxt->GetNameCache().PushName(L, Property->GetPropertyValue(Value));
 }
 
 /**
@@ -780,7 +922,7 @@ static void PushFNameElement(lua_State *L, FNameProperty *Property, void *Value)
  */
 static void PushFStringElement(lua_State *L, FStrProperty *Property, void *Value)
 {
-    lua_pushstring(L, TCHAR_TO_UTF8(*Property->GetPropertyValue(Value)));
+    UnLua::PushFString(L, Property->GetPropertyValue(Value));
 }
 
 /**
@@ -788,7 +930,7 @@ static void PushFStringElement(lua_State *L, FStrProperty *Property, void *Value
  */
 static void PushFTextElement(lua_State *L, FTextProperty *Property, void *Value)
 {
-    lua_pushstring(L, TCHAR_TO_UTF8(*Property->GetPropertyValue(Value).ToString()));
+    UnLua::PushFString(L, Property->GetPropertyValue(Value).ToString());
 }
 
 /**
@@ -985,7 +1127,7 @@ void PushStructArray(lua_State *L, FProperty *Property, void *Value, const char
  * 4.将LuaInstance存入Lua Registry表，并返回Index
  * 5.设置Lua模块.metatable = 类型元表
  * 6.设置Lua模块.Overridden = 类型元表
- * 7.设置ObjectMap.lightuserdata(Object指针) = LuaInstance
+ * 7.在代理索引中记录UObject的LuaInstance
  */
 int32 NewLuaObject(lua_State *L, UObjectBaseUtility *Object, UClass *Class, const char *ModuleName)
 {
@@ -994,33 +1136,29 @@ int32 NewLuaObject(lua_State *L, UObjectBaseUtility *Object, UClass *Class, cons
     // 获取Lua栈顶的Index
 	int OldTop = lua_gettop(L);
 
-    // 获取ObjectMap表放入栈顶，执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表
-    lua_getfield(L, LUA_REGISTRYINDEX, "ObjectMap");
-    // 把UObject的指针Push到栈顶，执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）
-    lua_pushlightuserdata(L, Object);
-    // 栈顶创建一个LuaInstance，执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、LuaInstance
+    // 栈顶创建一个LuaInstance，执行完的Lua栈从底到顶情况：旧栈顶、LuaInstance
     lua_newtable(L);                                            // create a Lua table ('INSTANCE')
     // 在lua栈中创建了一个userdata，然后将它的值设为一个指向UObject指针的指针，
     // 它的元表设为RegisterClass时创建的、类型对应的元表
-    // 执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、LuaInstance、userdata(指向UObject指针的指针，元表为“类型元表”)
+    // 执行完的Lua栈从底到顶情况：旧栈顶、LuaInstance、userdata(指向UObject指针的指针，元表为“类型元表”)
     PushObjectCore(L, Object);                                  // push UObject ('RAW_UOBJECT')
-    // Push "Object"到栈顶，执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、
+    // Push "Object"到栈顶，执行完的Lua栈从底到顶情况：旧栈顶、
     // LuaInstance、userdata(指向UObject指针的指针，元表为“类型元表”)、“Object”
     lua_pushstring(L, "Object");
-    // 复制index为-2的内容到栈顶，执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、
+    // 复制index为-2的内容到栈顶，执行完的Lua栈从底到顶情况：旧栈顶、
     // LuaInstance、userdata(指向UObject指针的指针，元表为“类型元表”)、“Object”、userdata(指向UObject指针的指针，元表为“类型元表”)
     lua_pushvalue(L, -2);
-    // LuaInstance.Object = userdata，执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、
+    // LuaInstance.Object = userdata，执行完的Lua栈从底到顶情况：旧栈顶、
     // LuaInstance、userdata(指向UObject指针的指针，元表为“类型元表”)
     lua_rawset(L, -4);                                          // INSTANCET.Object = RAW_UOBJECT
 
 	// in some case may occur module or object metatable can 
 	// not be found problem
     // 在某些情况下可能会出现找不到模块或对象元表的问题
-    // 获取Lua模块到栈顶，执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、LuaInstance、
+    // 获取Lua模块到栈顶，执行完的Lua栈从底到顶情况：旧栈顶、LuaInstance、
     // userdata(指向UObject指针的指针，元表为“类型元表”)、Lua模块
 	int32 TypeModule = GetLoadedModule(L, ModuleName);          // push the required module/table ('REQUIRED_MODULE') to the top of the stack
-    // 获取userdata的元表，执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、LuaInstance、
+    // 获取userdata的元表，执行完的Lua栈从底到顶情况：旧栈顶、LuaInstance、
     // userdata(指向UObject指针的指针，元表为“类型元表”)、Lua模块、Object元表
 	int32 TypeMetatable = lua_getmetatable(L, -2);              // get the metatable ('METATABLE_UOBJECT') of 'RAW_UOBJECT' 
 	if ((TypeModule != LUA_TTABLE)
@@ -1031,39 +1169,38 @@ int32 NewLuaObject(lua_State *L, UObjectBaseUtility *Object, UClass *Class, cons
 	}
 
 #if ENABLE_CALL_OVERRIDDEN_FUNCTION
-    // Push "Overridden"到栈顶，执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、
+    // Push "Overridden"到栈顶，执行完的Lua栈从底到顶情况：旧栈顶、
     // LuaInstance、userdata(指向UObject指针的指针，元表为“类型元表”)、Lua模块、Object元表、“Overridden”
     lua_pushstring(L, "Overridden");
-    // 执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、LuaInstance、
+    // 执行完的Lua栈从底到顶情况：旧栈顶、LuaInstance、
     // userdata(指向UObject指针的指针，元表为“类型元表”)、Lua模块、Object元表、“Overridden”、Object元表
     lua_pushvalue(L, -2);
-    // Lua模块.Overridden = Object元表。执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、
-    // Object指针（lightuserdata）、LuaInstance、userdata(指向UObject指针的指针，元表为“类型元表”)、
+    // Lua模块.Overridden = Object元表。执行完的Lua栈从底到顶情况：旧栈顶、
+    // LuaInstance、userdata(指向UObject指针的指针，元表为“类型元表”)、
     // Lua模块、Object元表
     lua_rawset(L, -4);
 #endif
-    // Lua模块.metatable = Object元表。执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、
+    // Lua模块.metatable = Object元表。执行完的Lua栈从底到顶情况：旧栈顶、
     // LuaInstance、userdata(指向UObject指针的指针，元表为“类型元表”)、Lua模块
     lua_setmetatable(L, -2);                                    // REQUIRED_MODULE.metatable = METATABLE_UOBJECT
-    // LuaInstance.metatable = Lua模块。执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、
+    // LuaInstance.metatable = Lua模块。执行完的Lua栈从底到顶情况：旧栈顶、
     // LuaInstance、userdata(指向UObject指针的指针，元表为“类型元表”)
     lua_setmetatable(L, -3);                                    // INSTANCE.metatable = REQUIRED_MODULE
-    // 执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、LuaInstance
+    // 执行完的Lua栈从底到顶情况：旧栈顶、LuaInstance
     lua_pop(L, 1);
-    // 执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、LuaInstance、LuaInstance
+    // 执行完的Lua栈从底到顶情况：旧栈顶、LuaInstance、LuaInstance
     lua_pushvalue(L, -1);
     // luaL_ref(L, LUA_REGISTRYINDEX)功能：在Registry表中，创建一个对象，对象是当前栈顶的元素，即LuaInstance，
     // 然后返回创建对象在Registry表中的索引值，同时pop栈顶对象
     // 因为Registry表是全局表，因此LuaInstance之后就不会被GC
-    // 执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表、Object指针（lightuserdata）、LuaInstance
+    // 执行完的Lua栈从底到顶情况：旧栈顶、LuaInstance
     int32 ObjectRef = luaL_ref(L, LUA_REGISTRYINDEX);           // keep a reference for 'INSTANCE'
 
     // 广播绑定事件
     FUnLuaDelegates::OnObjectBinded.Broadcast(Object);          // 'INSTANCE' is on the top of stack now
 
-    // ObjectMap.lightuserdata = LuaInstance，执行完的Lua栈从底到顶情况：旧栈顶、ObjectMap表
-    lua_rawset(L, -3);
-    // 执行完的Lua栈从底到顶情况：旧栈顶
+    // 在代理索引中记录LuaInstance，执行完的Lua栈从底到顶情况：旧栈顶
+    GLuaCxt->GetObjectIndex().AddObject(L, Object, -1);
     lua_pop(L, 1);
     // 返回LuaInstance在lua Registry表中index
     return ObjectRef;
@@ -1079,18 +1216,16 @@ void DeleteLuaObject(lua_State *L, UObjectBaseUtility *Object)
         return;
     }
 
-    lua_getfield(L, LUA_REGISTRYINDEX, "ObjectMap");            // get the object instance from 'ObjectMap'
-    lua_pushlightuserdata(L, Object);
-    int32 Type = lua_rawget(L, -2);
-    if (Type == LUA_TTABLE || Type == LUA_TUSERDATA)
+    FLuaObjectIndex &ObjectIndex = GLuaCxt->GetObjectIndex();
+    if (ObjectIndex.PushObject(L, Object))                      // get the object instance from the object index
     {
         FUnLuaDelegates::OnObjectUnbinded.Broadcast(Object);    // object instance ('INSTANCE') is on the top of stack now
 
-        // todo: add comments here...
-        if (Type == LUA_TTABLE)
+        // 清空代理中的UObject指针，Lua中还持有的代理之后访问会得到nil
+        if (lua_type(L, -1) == LUA_TTABLE)
         {
             lua_pushstring(L, "Object");
-            Type = lua_rawget(L, -2);
+            int32 Type = lua_rawget(L, -2);
             check(Type == LUA_TUSERDATA);
             void *Userdata = lua_touserdata(L, -1);
             *((void**)Userdata) = nullptr;
@@ -1103,16 +1238,7 @@ void DeleteLuaObject(lua_State *L, UObjectBaseUtility *Object)
             lua_pop(L, 1);
         }
 
-        // INSTANCE.Object = nil
-        lua_pushlightuserdata(L, Object);
-        lua_pushnil(L);
-        lua_rawset(L, -3);
-        lua_pop(L, 1);
-    }
-    else
-    {
-        check(Type == LUA_TNIL);
-        lua_pop(L, 2);
+        ObjectIndex.RemoveObject(L, Object);
     }
 }
 
@@ -1233,16 +1359,7 @@ bool GetObjectMapping(lua_State *L, UObjectBaseUtility *Object)
         return false;
     }
 
-    lua_getfield(L, LUA_REGISTRYINDEX, "ObjectMap");
-    lua_pushlightuserdata(L, Object);
-    int32 Type = lua_rawget(L, -2);
-    if (Type != LUA_TNIL)
-    {
-        lua_remove(L, -2);
-        return true;
-    }
-    lua_pop(L, 2);
-    return false;
+    return GLuaCxt->GetObjectIndex().PushObject(L, Object);
 }
 
 /**
@@ -1317,6 +1434,7 @@ bool PushFunction(lua_State *L, UObjectBaseUtility *Object, int32 FunctionRef)
  */
 bool CallFunction(lua_State *L, int32 NumArgs, int32 NumResults)
 {
+    FLuaMemoryTracker::FScope MemoryScope(L, NumArgs);      // attribute allocations to the called function, only when tracking
     int32 ErrorReporterIdx = lua_gettop(L) - NumArgs - 1;
     int32 Code = lua_pcall(L, NumArgs, NumResults, -(NumArgs + 2));
     if (Code == LUA_OK)
@@ -1329,6 +1447,154 @@ bool CallFunction(lua_State *L, int32 NumArgs, int32 NumResults)
     return false;
 }
 
+/**
+ * Accessors for POD properties of native types. Kind, bool mask and offset are packed into a light userdata
+ * that's tagged with 0b10 in the lowest two bits, it never collides with a descriptor handle (lowest bit set) or
+ * a (aligned) pointer to a statically exported property
+ * 原生类型的POD属性访问器：类型、bool掩码和偏移直接编码在lightuserdata里，低两位是0b10，
+ * 和描述句柄(最低位为1)、静态导出属性的指针(对齐，低两位为0)都不冲突。读写时不需要校验描述，也没有虚函数调用
+ */
+namespace PODAccessor
+{
+    enum EKind
+    {
+        Int8, Int16, Int32, Int64, UInt8, UInt16, UInt32, UInt64, Float, Double, Bool, Name,
+    };
+
+    static constexpr UPTRINT Tag = 2;
+    static constexpr UPTRINT TagMask = 3;
+    static constexpr uint32 KindShift = 2;
+    static constexpr UPTRINT KindMask = 0x0F;
+    static constexpr uint32 BoolMaskShift = 6;
+    static constexpr uint32 OffsetShift = 14;
+    static constexpr UPTRINT MaxOffset = ~(UPTRINT)0 >> OffsetShift;
+
+    static FORCEINLINE bool IsAccessor(const void *Userdata) { return ((UPTRINT)Userdata & TagMask) == Tag; }
+
+    static bool GetKind(const FProperty *Property, EKind &OutKind)
+    {
+        if (const FEnumProperty *EnumProperty = CastField<FEnumProperty>(Property))
+        {
+            return GetKind(EnumProperty->GetUnderlyingProperty(), OutKind);
+        }
+        if (Property->IsA<FInt8Property>())         { OutKind = Int8; }
+        else if (Property->IsA<FInt16Property>())   { OutKind = Int16; }
+        else if (Property->IsA<FIntProperty>())     { OutKind = Int32; }
+        else if (Property->IsA<FInt64Property>())   { OutKind = Int64; }
+        else if (Property->IsA<FByteProperty>())    { OutKind = UInt8; }
+        else if (Property->IsA<FUInt16Property>())  { OutKind = UInt16; }
+        else if (Property->IsA<FUInt32Property>())  { OutKind = UInt32; }
+        else if (Property->IsA<FUInt64Property>())  { OutKind = UInt64; }
+        else if (Property->IsA<FFloatProperty>())   { OutKind = Float; }
+        else if (Property->IsA<FDoubleProperty>())  { OutKind = Double; }
+        else if (Property->IsA<FBoolProperty>())    { OutKind = Bool; }
+        else if (Property->IsA<FNameProperty>())    { OutKind = Name; }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Create an accessor for the property, returns nullptr if the property doesn't qualify
+     * 只有原生类/结构体的非数组POD属性才会创建访问器，它们的内存布局在运行时不会变化
+     */
+    static void* Create(const FProperty *Property)
+    {
+        EKind Kind;
+        if (!Property || Property->ArrayDim != 1 || !GetKind(Property, Kind))
+        {
+            return nullptr;
+        }
+
+        const UStruct *Owner = Property->GetOwnerStruct();
+        const UClass *OwnerClass = Cast<UClass>(Owner);
+        const UScriptStruct *OwnerStruct = Cast<UScriptStruct>(Owner);
+        const bool bNativeOwner = (OwnerClass && OwnerClass->HasAnyClassFlags(CLASS_Native))
+            || (OwnerStruct && (OwnerStruct->StructFlags & STRUCT_Native) != 0);
+        if (!bNativeOwner)
+        {
+            return nullptr;
+        }
+
+        UPTRINT Offset = Property->GetOffset_ForInternal();
+        UPTRINT BoolMask = 0;
+        if (Kind == Bool)
+        {
+            const FBoolProperty *BoolProperty = CastFieldChecked<FBoolProperty>(Property);
+            if (BoolProperty->GetFieldSize() != 1)
+            {
+                return nullptr;
+            }
+            Offset += BoolProperty->GetByteOffset();
+            BoolMask = BoolProperty->GetFieldMask();        // 0xFF for a native bool, the bit for a bitfield
+        }
+        if (Offset > MaxOffset)
+        {
+            return nullptr;
+        }
+
+        return (void*)((Offset << OffsetShift) | (BoolMask << BoolMaskShift) | ((UPTRINT)Kind << KindShift) | Tag);
+    }
+
+    /**
+     * Push the property value of 'Container' to the stack
+     */
+    static void Read(lua_State *L, const void *Accessor, const void *Container)
+    {
+        const UPTRINT Value = (UPTRINT)Accessor;
+        const uint8 *ValuePtr = (const uint8*)Container + (Value >> OffsetShift);
+        switch ((EKind)((Value >> KindShift) & KindMask))
+        {
+        case Int8:      lua_pushinteger(L, *(const int8*)ValuePtr); break;
+        case Int16:     lua_pushinteger(L, *(const int16*)ValuePtr); break;
+        case Int32:     lua_pushinteger(L, *(const int32*)ValuePtr); break;
+        case Int64:     lua_pushinteger(L, *(const int64*)ValuePtr); break;
+        case UInt8:     lua_pushinteger(L, *(const uint8*)ValuePtr); break;
+        case UInt16:    lua_pushinteger(L, *(const uint16*)ValuePtr); break;
+        case UInt32:    lua_pushinteger(L, *(const uint32*)ValuePtr); break;
+        case UInt64:    lua_pushinteger(L, (lua_Integer)*(const uint64*)ValuePtr); break;
+        case Float:     lua_pushnumber(L, *(const float*)ValuePtr); break;
+        case Double:    lua_pushnumber(L, *(const double*)ValuePtr); break;
+        case Bool:      lua_pushboolean(L, (*ValuePtr & (uint8)(Value >> BoolMaskShift)) != 0); break;
+        case Name:      GLuaCxt->GetNameCache().PushName(L, *(const FName*)ValuePtr); break;
+        default:        lua_pushnil(L); break;
+        }
+    }
+
+    /**
+     * Set the property value of 'Container' with the Lua value at 'IndexInStack'
+     */
+    static void Write(lua_State *L, const void *Accessor, void *Container, int32 IndexInStack)
+    {
+        const UPTRINT Value = (UPTRINT)Accessor;
+        uint8 *ValuePtr = (uint8*)Container + (Value >> OffsetShift);
+        switch ((EKind)((Value >> KindShift) & KindMask))
+        {
+        case Int8:      *(int8*)ValuePtr = (int8)lua_tointeger(L, IndexInStack); break;
+        case Int16:     *(int16*)ValuePtr = (int16)lua_tointeger(L, IndexInStack); break;
+        case Int32:     *(int32*)ValuePtr = (int32)lua_tointeger(L, IndexInStack); break;
+        case Int64:     *(int64*)ValuePtr = (int64)lua_tointeger(L, IndexInStack); break;
+        case UInt8:     *(uint8*)ValuePtr = (uint8)lua_tointeger(L, IndexInStack); break;
+        case UInt16:    *(uint16*)ValuePtr = (uint16)lua_tointeger(L, IndexInStack); break;
+        case UInt32:    *(uint32*)ValuePtr = (uint32)lua_tointeger(L, IndexInStack); break;
+        case UInt64:    *(uint64*)ValuePtr = (uint64)lua_tointeger(L, IndexInStack); break;
+        case Float:     *(float*)ValuePtr = (float)lua_tonumber(L, IndexInStack); break;
+        case Double:    *(double*)ValuePtr = (double)lua_tonumber(L, IndexInStack); break;
+        case Bool:
+            {
+                const uint8 FieldMask = (uint8)(Value >> BoolMaskShift);
+                const uint8 ByteMask = FieldMask == 0xFF ? 1 : FieldMask;
+                *ValuePtr = (*ValuePtr & ~FieldMask) | (lua_toboolean(L, IndexInStack) ? ByteMask : 0);
+            }
+            break;
+        case Name:      *(FName*)ValuePtr = GLuaCxt->GetNameCache().ToName(L, IndexInStack); break;
+        default:        break;
+        }
+    }
+}
+
 /**
  * Push a field (property or function)
  * Push一个Field(属性或者方法)
@@ -1340,14 +1606,16 @@ static void PushField(lua_State *L, FFieldDesc *Field)
     // 如果Field是一个属性，则获取它的FPropertyDesc，UnLua自己的反射类型，然后把它作为指针Push到Lua栈顶
     if (Field->IsProperty())
     {
+        // POD属性直接缓存访问器，其他属性缓存描述句柄
         FPropertyDesc *Property = Field->AsProperty();
-        lua_pushlightuserdata(L, Property);                     // Property
+        void *Accessor = PODAccessor::Create(Property->GetProperty());
+        lua_pushlightuserdata(L, Accessor ? Accessor : Property->GetHandle());  // POD accessor / Property handle
     }
     else
     {
         // 如果Field是一个方法，则推入一个闭包，即C Function ClassCallUFunction + FFunctionDesc的指针
         FFunctionDesc *Function = Field->AsFunction();
-        lua_pushlightuserdata(L, Function);                     // Function
+        lua_pushlightuserdata(L, Function->GetHandle());        // Function handle
         if (Function->IsLatentFunction())
         {
             lua_pushcclosure(L, Class_CallLatentFunction, 1);   // closure
@@ -1359,6 +1627,26 @@ static void PushField(lua_State *L, FFieldDesc *Field)
     }
 }
 
+/**
+ * Resolve the light userdata cached for a property, either a property descriptor handle or a statically exported property
+ * 解析属性对应的lightuserdata，可能是属性描述句柄，也可能是静态导出属性的指针
+ */
+static UnLua::ITypeOps* GetPropertyFromLightUserdata(lua_State *L, int32 Index)
+{
+    void *Userdata = lua_touserdata(L, Index);
+    if (PODAccessor::IsAccessor(Userdata))
+    {
+        return nullptr;
+    }
+    if (FReflectionRegistry::IsDescHandle(Userdata))
+    {
+        return (FPropertyDesc*)GReflectionRegistry.FindDescByHandleWithObjectCheck(Userdata, DESC_PROPERTY);
+    }
+
+    UnLua::ITypeOps *Property = (UnLua::ITypeOps*)Userdata;
+    return Property && Property->StaticExported ? Property : nullptr;
+}
+
 /**
  * Get a field (property or function)
  * 获取一个Field(属性或者方法)
@@ -1399,9 +1687,10 @@ static int32 GetField(lua_State* L)
         check(Type == LUA_TSTRING);
 
         // 获取栈顶的Class名赋值给ClassName，栈不变
-        const char* ClassName = lua_tostring(L, -1);
+        // 类名和字段名都是短字符串，通过缓存转换成FName，不需要查找全局的FName表
+        const FName ClassName = GLuaCxt->GetNameCache().ToName(L, -1);
         // 获取index为2的值key赋值给FieldName，栈不变
-        const char* FieldName = lua_tostring(L, 2);
+        const FName FieldName = GLuaCxt->GetNameCache().ToName(L, 2);
         // pop栈顶，执行完的lua栈从底到顶情况：Class表、key、Class表
         lua_pop(L, 1);
 
@@ -1647,6 +1936,14 @@ void ClearLibrary(lua_State *L, const char *LibrayName)
 {
     if (L)
     {
+        // only Lua classes bound to this metatable cache its UProperties/UFunctions
+        lua_getfield(L, LUA_REGISTRYINDEX, LibrayName);
+        if (lua_istable(L, -1))
+        {
+            FLuaClassCache::Invalidate(L, -1);
+        }
+        lua_pop(L, 1);
+        InvalidateUdataInlineCache(L);
         lua_pushnil(L);
         SetTableForClass(L, LibrayName);
         lua_pushnil(L);
@@ -1927,6 +2224,24 @@ int32 Global_UnRegisterClass(lua_State* L)
     return 0;
 }
 
+/**
+ * Invalidate cached members of Lua classes, call it after modifying existing members of a Lua class at runtime
+ * 使Lua类的成员缓存失效，运行时修改Lua类中已有的成员后需要调用。传入Lua类时只失效该类及其子类
+ */
+int32 Global_InvalidateClassCache(lua_State* L)
+{
+    if (lua_istable(L, 1))
+    {
+        FLuaClassCache::Invalidate(L, 1);
+    }
+    else
+    {
+        FLuaClassCache::Invalidate();
+    }
+    InvalidateUdataInlineCache(L);
+    return 0;
+}
+
 /**
 * （1）根据传入的类型名，通过UE反射得到它的类型信息，然后记录这个类型信息，
 * 以FClassDesc（UnLua自己的数据结构）的形式存入UnLua的反射库GReflectionRegistry中，方便后续Lua、C++交互调用
@@ -2019,7 +2334,7 @@ static bool RegisterClassCore(lua_State *L, FClassDesc *InClass, const FClassDes
     UScriptStruct *ScriptStruct = InClass->AsScriptStruct();
     if (ScriptStruct)
     {
-        lua_pushlightuserdata(L, InClass);                  // FClassDesc
+        lua_pushlightuserdata(L, InClass->GetHandle());     // FClassDesc handle
 
         lua_pushstring(L, "Copy");                          // Key
         lua_pushvalue(L, -2);                               // FClassDesc
@@ -2063,7 +2378,7 @@ static bool RegisterClassCore(lua_State *L, FClassDesc *InClass, const FClassDes
             lua_rawset(L, -3);
 
             lua_pushstring(L, "StaticClass");               // Key
-            lua_pushlightuserdata(L, InClass);              // FClassDesc
+            lua_pushlightuserdata(L, InClass->GetHandle()); // FClassDesc handle
             // 赋值的是一个闭包，功能就是当调用StaticClass时，C Function Class_StaticClass会被调用，
             // 同时FClassDesc的指针会同时被压入Lua栈中，因为FClassDesc的指针和C Function Class_StaticClass作为了一个闭包，赋值给了StaticClass
             lua_pushcclosure(L, Class_StaticClass, 1);      // closure
@@ -2216,27 +2531,27 @@ int32 Global_GetUProperty(lua_State *L)
     // 传入时Lua栈从底到顶情况：LuaInstance，FPropertyDesc(lightuserdata)
     if (lua_islightuserdata(L, 2))
     {   
-        bool bValid = false;
-        // 将lightuserdata转成userdata，准备传回给Lua
-        UnLua::ITypeOps* Property = (UnLua::ITypeOps*)lua_touserdata(L, 2);
-        if (Property)
+        void *Accessor = lua_touserdata(L, 2);
+        if (PODAccessor::IsAccessor(Accessor))
         {
-			if (GReflectionRegistry.IsDescValidWithObjectCheck(Property, DESC_PROPERTY))
-			{
-				bValid = true;
-			}
-
-			if ((!bValid)
-				&& (Property->StaticExported))
-			{
-				bValid = true;
-			}
+            UObject* Object = UnLua::GetUObject(L, 1);
+            if (GLuaCxt->IsUObjectValid(Object))
+            {
+                PODAccessor::Read(L, Accessor, Object);
+                return 1;
+            }
+            lua_pushnil(L);
+            return 1;
+        }
 
+        // 将lightuserdata(属性描述句柄或静态导出属性)解析成属性
+        UnLua::ITypeOps* Property = GetPropertyFromLightUserdata(L, 2);
+        if (Property)
+        {
             // 通过LuaInstance，获取UObject，从NewLuaObject函数知道，LuaInstance的Object变量保存有UObject的二级指针，
             // 因此通过LuaInstance就可以直接获取到
             UObject* Object = UnLua::GetUObject(L, 1);
-            if ((bValid)
-                && (GLuaCxt->IsUObjectValid(Object)))
+            if (GLuaCxt->IsUObjectValid(Object))
             {
                 // 默认是引用
                 Property->Read(L, Object, false);           // get UProperty value
@@ -2253,24 +2568,22 @@ int32 Global_SetUProperty(lua_State *L)
 {
     if (lua_islightuserdata(L, 2))
     {
-        bool bValid = false;
-        UnLua::ITypeOps* Property = (UnLua::ITypeOps*)lua_touserdata(L, 2);
-        if (Property)
-        {   
-			if (GReflectionRegistry.IsDescValidWithObjectCheck(Property, DESC_PROPERTY))
-			{
-				bValid = true;
-			}
-
-            if ((!bValid)
-                && (Property->StaticExported))
+        void *Accessor = lua_touserdata(L, 2);
+        if (PODAccessor::IsAccessor(Accessor))
+        {
+            UObject* Object = UnLua::GetUObject(L, 1);
+            if (GLuaCxt->IsUObjectValid(Object))
             {
-                bValid = true;
+                PODAccessor::Write(L, Accessor, Object, 3);
             }
+            return 0;
+        }
 
+        UnLua::ITypeOps* Property = GetPropertyFromLightUserdata(L, 2);
+        if (Property)
+        {   
             UObject* Object = UnLua::GetUObject(L, 1);
-            if ((bValid)
-                && (GLuaCxt->IsUObjectValid(Object)))
+            if (GLuaCxt->IsUObjectValid(Object))
             {
                 Property->Write(L, Object, 3);              // set UProperty value
             }
@@ -2409,7 +2722,7 @@ int LoadFromCustomLoader(lua_State *L)
 
     const auto Chunk = (const char*)Data.GetData();
     const auto ChunkName = TCHAR_TO_UTF8(*FileName);
-    if(!UnLua::LoadChunk(L, Chunk, Data.Num(), ChunkName))
+    if(!FLuaBytecodeCache::LoadChunk(L, Chunk, Data.Num(), ChunkName))
         return luaL_error(L, "file loading from custom loader error");
 
     return 1;
@@ -2429,7 +2742,7 @@ int LoadFromFileSystem(lua_State *L)
     const auto ChunkName = TCHAR_TO_UTF8(*RelativePath);
     const auto Chunk = (const char*)(Data.GetData() + SkipLen);
     const auto ChunkSize = Data.Num() - SkipLen;
-    if(!UnLua::LoadChunk(L, Chunk, ChunkSize, ChunkName))
+    if(!FLuaBytecodeCache::LoadChunk(L, Chunk, ChunkSize, ChunkName))
         return luaL_error(L, "file loading from file system error");
 
     return 1;
@@ -2489,14 +2802,14 @@ int32 Enum_Index(lua_State *L)
     lua_rawget(L, 1);                   // 3
     check(lua_isstring(L, -1));
     
-    const FEnumDesc *Enum = GReflectionRegistry.FindEnum(lua_tostring(L, -1));
+    const FEnumDesc *Enum = GReflectionRegistry.FindEnum(GLuaCxt->GetNameCache().ToName(L, -1));
 	if ((!Enum) 
         || (!Enum->IsValid()))
 	{
 		lua_pop(L, 1);
 		return 0;
 	}
-    int64 Value = Enum->GetValue(lua_tostring(L, 2));
+    int64 Value = Enum->GetValue(GLuaCxt->GetNameCache().ToName(L, 2));
     
     lua_pop(L, 1);
     lua_pushvalue(L, 2);
@@ -2603,25 +2916,25 @@ int32 Class_Index(lua_State *L)
     // 对于静态导出类型，类型为lightuserdata，且为ITypeOps子类
     if (lua_islightuserdata(L, -1))
     {   
-        bool bValid = false;
-		UnLua::ITypeOps *Property = (UnLua::ITypeOps*)lua_touserdata(L, -1);
-        if (Property)
+        // POD属性快速路径，偏移已编码在访问器里，跳过描述校验和虚函数调用
+        void *Accessor = lua_touserdata(L, -1);
+        if (PODAccessor::IsAccessor(Accessor))
         {
-			if (GReflectionRegistry.IsDescValidWithObjectCheck(Property, DESC_PROPERTY))
-			{
-				bValid = true;
-			}
-
-			if ((!bValid)
-				&& (Property->StaticExported))
-			{
-				bValid = true;
-			}
+            void* ContainerPtr = GetCppInstance(L, 1);
+            if (ContainerPtr)
+            {
+                PODAccessor::Read(L, Accessor, ContainerPtr);
+                lua_remove(L, -2);
+            }
+            return 1;
+        }
 
+        // 属性描述句柄校验只需一次数组下标+比较，不再查DescSet
+		UnLua::ITypeOps *Property = GetPropertyFromLightUserdata(L, -1);
+        if (Property)
+        {
 			void* ContainerPtr = GetCppInstance(L, 1);
-
-			if ((bValid)
-				&& (ContainerPtr))
+			if (ContainerPtr)
 			{
 				Property->Read(L, ContainerPtr, false);
 				lua_remove(L, -2);
@@ -2638,6 +2951,64 @@ int32 Class_Index(lua_State *L)
     return 1;
 }
 
+#if LUA_UDATA_ICACHE
+/**
+ * Read a field through an accessor cached by the Lua VM, the userdata is on the top of the stack. Same as 'Class_Index' after 'GetField'
+ * 虚拟机内联缓存命中时读取属性，userdata在栈顶，等同于'Class_Index'中'GetField'之后的部分
+ */
+static int UdataICacheRead(lua_State *L, void *Accessor)
+{
+    void *ContainerPtr = GetCppInstance(L, -1);
+    if (!ContainerPtr)
+    {
+        return 0;
+    }
+    if (PODAccessor::IsAccessor(Accessor))
+    {
+        PODAccessor::Read(L, Accessor, ContainerPtr);
+        return 1;
+    }
+
+    lua_pushlightuserdata(L, Accessor);
+    UnLua::ITypeOps *Property = GetPropertyFromLightUserdata(L, -1);
+    lua_pop(L, 1);
+    if (Property)
+    {
+        Property->Read(L, ContainerPtr, false);
+    }
+    else
+    {
+        lua_pushnil(L);
+    }
+    return 1;
+}
+#endif
+
+/**
+ * Let the Lua VM cache field accesses on userdata whose metatable uses 'Class_Index'
+ * 让Lua虚拟机对使用'Class_Index'的userdata做字段访问的内联缓存
+ */
+void SetupUdataInlineCache(lua_State *L)
+{
+#if LUA_UDATA_ICACHE
+    lua_setudataicache(L, Class_Index, UdataICacheRead);
+#endif
+}
+
+/**
+ * Drop all inline caches of the Lua VM, must be called whenever cached metatables change
+ * 清除虚拟机的所有内联缓存，缓存的元表发生变化(热更新、反注册类等)时必须调用
+ */
+void InvalidateUdataInlineCache(lua_State *L)
+{
+#if LUA_UDATA_ICACHE
+    if (L)
+    {
+        lua_invalidateudataicache(L);
+    }
+#endif
+}
+
 /**
  * __newindex meta methods for class
  */
@@ -2647,25 +3018,19 @@ int32 Class_NewIndex(lua_State *L)
     // 对于静态导出类型，类型为lightuserdata，且为ITypeOps子类
     if (lua_islightuserdata(L, -1))
     {
-        bool bValid = false;
-        UnLua::ITypeOps* Property = (UnLua::ITypeOps*)lua_touserdata(L, -1);
-        if (Property)
+        void *Accessor = lua_touserdata(L, -1);
+        if (PODAccessor::IsAccessor(Accessor))
+        {
+            void* ContainerPtr = GetCppInstance(L, 1);
+            if (ContainerPtr)
+            {
+                PODAccessor::Write(L, Accessor, ContainerPtr, 3);
+            }
+        }
+        else if (UnLua::ITypeOps* Property = GetPropertyFromLightUserdata(L, -1))
         {
-			if (GReflectionRegistry.IsDescValidWithObjectCheck(Property, DESC_PROPERTY))
-			{
-				bValid = true;
-			}
-
-			if ((!bValid)
-				&& (Property->StaticExported))
-			{
-				bValid = true;
-			}
-
 			void* ContainerPtr = GetCppInstance(L, 1);
-
-			if ((bValid)
-				&& (ContainerPtr))
+			if (ContainerPtr)
 			{
 				Property->Write(L, ContainerPtr, 3);
 			}
@@ -2679,6 +3044,8 @@ int32 Class_NewIndex(lua_State *L)
             lua_pushvalue(L, 2);
             lua_pushvalue(L, 3);
             lua_rawset(L, 1);
+            FLuaClassCache::Invalidate(L, 1);
+            InvalidateUdataInlineCache(L);
 
             //UE_LOG(LogUnLua, Warning, TEXT("%s: You are modifying metatable! Please make sure you know what you are doing!"), ANSI_TO_TCHAR(__FUNCTION__));
         }
@@ -2695,11 +3062,12 @@ int32 Class_CallUFunction(lua_State *L)
 {
     //!!!Fix!!!
     //delete desc when is not valid
-    // 获取【ClassCallUFunction + 包含Create函数的FFunctionDesc指针】闭包的UpValue，即包含Create函数的FFunctionDesc指针
-    FFunctionDesc *Function = (FFunctionDesc*)lua_touserdata(L, lua_upvalueindex(1));
-    if (!GReflectionRegistry.IsDescValidWithObjectCheck(Function,DESC_FUNCTION))
+    // 获取【ClassCallUFunction + FFunctionDesc句柄】闭包的UpValue，通过句柄取得FFunctionDesc
+    void *Handle = lua_touserdata(L, lua_upvalueindex(1));
+    FFunctionDesc *Function = (FFunctionDesc*)GReflectionRegistry.FindDescByHandleWithObjectCheck(Handle, DESC_FUNCTION);
+    if (!Function)
     {
-        UE_LOG(LogUnLua, Log, TEXT("%s: Invalid function descriptor! %p"), ANSI_TO_TCHAR(__FUNCTION__), Function);
+        UE_LOG(LogUnLua, Log, TEXT("%s: Invalid function descriptor! %p"), ANSI_TO_TCHAR(__FUNCTION__), Handle);
         return 0;
     }
     // 获取栈的长度，即参数个数
@@ -2714,8 +3082,8 @@ int32 Class_CallUFunction(lua_State *L)
  */
 int32 Class_CallLatentFunction(lua_State *L)
 {
-    FFunctionDesc *Function = (FFunctionDesc*)lua_touserdata(L, lua_upvalueindex(1));
-	if (!GReflectionRegistry.IsDescValidWithObjectCheck(Function, DESC_FUNCTION))
+    FFunctionDesc *Function = (FFunctionDesc*)GReflectionRegistry.FindDescByHandleWithObjectCheck(lua_touserdata(L, lua_upvalueindex(1)), DESC_FUNCTION);
+	if (!Function)
     {
         UE_LOG(LogUnLua, Log, TEXT("%s: Invalid function descriptor!"), ANSI_TO_TCHAR(__FUNCTION__));
         return 0;
@@ -2744,9 +3112,8 @@ int32 Class_CallLatentFunction(lua_State *L)
 
 FClassDesc* Class_CheckParam(lua_State *L)
 {
-    FClassDesc *ClassDesc = (FClassDesc*)lua_touserdata(L, lua_upvalueindex(1));
-    if ((!ClassDesc)
-        || (!GReflectionRegistry.IsDescValid(ClassDesc, DESC_CLASS)))
+    FClassDesc *ClassDesc = (FClassDesc*)GReflectionRegistry.FindDescByHandle(lua_touserdata(L, lua_upvalueindex(1)), DESC_CLASS);
+    if (!ClassDesc)
     {
         UE_LOG(LogUnLua, Log, TEXT("Class : Invalid FClassDesc!"));
         return NULL;
@@ -2820,9 +3187,8 @@ int32 Class_Cast(lua_State* L)
 
 FClassDesc* ScriptStruct_CheckParam(lua_State *L)
 {
-    FClassDesc *ClassDesc = (FClassDesc*)lua_touserdata(L, lua_upvalueindex(1));
-    if ((!ClassDesc)
-        || (!GReflectionRegistry.IsDescValid(ClassDesc, DESC_CLASS)))
+    FClassDesc *ClassDesc = (FClassDesc*)GReflectionRegistry.FindDescByHandle(lua_touserdata(L, lua_upvalueindex(1)), DESC_CLASS);
+    if (!ClassDesc)
     {
         UE_LOG(LogUnLua, Log, TEXT("ScriptStruct : Invalid FClassDesc!"));
         return NULL;
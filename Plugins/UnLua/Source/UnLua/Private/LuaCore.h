@@ -36,6 +36,8 @@ private:
     const char *Name;
 };
 
+// 从相对路径获取热更新下载目录中的Lua文件路径，文件不一定存在
+FString GetDownloadPathFromRelativePath(const FString& RelativePath);
 // 从相对路径获取Lua文件完整路径
 FString GetFullPathFromRelativePath(const FString& RelativePath);
 // 创建命名'UE'空间(一个Lua表)
@@ -47,7 +49,7 @@ void SetTableForClass(lua_State *L, const char *Name);
  * Set metatable for the userdata/table on the top of the stack
  * 为栈顶的userdata/table设置元表
  */
-bool TryToSetMetatable(lua_State *L, const char *MetatableName, UObject* Object = nullptr);
+bool TryToSetMetatable(lua_State *L, const char *MetatableName, class FClassDesc *ClassDesc = nullptr);
 // 获取元表的名字
 FString GetMetatableName(const UObjectBaseUtility* Object);
 
@@ -106,6 +108,12 @@ void PushStructArray(lua_State *L, FProperty *Property, void *Value, const char
  */
 void PushObjectCore(lua_State *L, UObjectBaseUtility *Object);
 
+/**
+ * Push a pointer with the name of meta table, the metatable reference cached on ClassDesc is used if there is one
+ * Push一个指针到Lua栈，有ClassDesc时用它缓存的元表引用，不需要按名字查找元表
+ */
+int32 PushPointerCore(lua_State *L, void *Value, const char *MetatableName, class FClassDesc *ClassDesc, bool bAlwaysCreate);
+
 /**
  * Functions to New/Delete Lua instance for UObjectBaseUtility
  * 新建/释放对应UObjectBaseUtility的Lua实例的方法
@@ -191,6 +199,7 @@ bool RegisterEnum(lua_State *L, UEnum *Enum);
  * 注册UClass
  */
 int32 Global_UnRegisterClass(lua_State* L);
+int32 Global_InvalidateClassCache(lua_State* L);
 int32 Global_RegisterClass(lua_State *L);
 class FClassDesc* RegisterClass(lua_State *L, const char *ClassName, const char *SuperClassName = nullptr);
 class FClassDesc* RegisterClass(lua_State *L, UStruct *Struct, UStruct *SuperStruct = nullptr);
@@ -226,6 +235,8 @@ int32 Class_CallUFunction(lua_State *L);
 int32 Class_CallLatentFunction(lua_State *L);
 int32 Class_StaticClass(lua_State *L);
 int32 Class_Cast(lua_State* L);
+void SetupUdataInlineCache(lua_State *L);
+void InvalidateUdataInlineCache(lua_State *L);
 
 /**
  * Functions to handle UScriptStruct
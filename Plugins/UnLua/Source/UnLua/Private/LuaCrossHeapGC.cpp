@@ -0,0 +1,711 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaCrossHeapGC.h"
+#include "LuaCore.h"
+#include "LuaContext.h"
+#include "UnLuaManager.h"
+#include "UnLuaPrivate.h"
+#include "UEObjectReferencer.h"
+#include "Components/ActorComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectGlobals.h"
+
+static TAutoConsoleVariable<float> CVarCrossGCInterval(
+    TEXT("unlua.CrossGC.IntervalSeconds"),
+    0.0f,
+    TEXT("Seconds between passes looking for UObjects only kept alive by their own Lua instance tables, 0 to disable."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarCrossGCMaxChecks(
+    TEXT("unlua.CrossGC.MaxChecksPerPass"),
+    2,
+    TEXT("Max UObjects tested with IsReferenced (a full reachability analysis) per pass."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarCrossGCMaxPassMs(
+    TEXT("unlua.CrossGC.MaxPassMs"),
+    10.0f,
+    TEXT("Time budget of an automatic pass. The Lua heap walk can't be split across frames, a walk running over it is abandoned without releasing anything;\n")
+    TEXT("no new group is checked with IsReferenced once it's used up. 0 for no limit."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarCrossGCRecheckSeconds(
+    TEXT("unlua.CrossGC.RecheckSeconds"),
+    600.0f,
+    TEXT("Seconds before a UObject still referenced by UE is tested again."),
+    ECVF_Default);
+
+static FAutoConsoleCommand CmdCrossGCCollect(
+    TEXT("unlua.CrossGC.Collect"),
+    TEXT("Run a pass reclaiming cycles between Lua instance tables and UObjects referenced from Lua."),
+    FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic([](const TArray<FString>&, UWorld*, FOutputDevice& Ar)
+    {
+        FLuaCrossHeapGC::Collect(&Ar);
+    }));
+
+namespace UnLuaCrossHeapGC
+{
+    /**
+     * Breadth first walk of the Lua heap through the Lua API, the work queue is a Lua table so the Lua stack stays small
+     * 通过Lua API广度优先遍历Lua堆，待处理队列放在Lua表里，避免Lua栈过深
+     */
+    struct FHeapWalker
+    {
+        FHeapWalker(lua_State *InL, const TMap<const void*, UObject*> &InInstances, const TSet<UObject*> &InReferenced)
+            : L(InL), Instances(InInstances), Referenced(InReferenced), BaseVisited(nullptr), Owner(nullptr), Deadline(0.0), bAborted(false), BaseTop(lua_gettop(InL)), Head(0), Tail(0)
+        {
+            lua_createtable(L, 1024, 0);
+            Queue = lua_gettop(L);
+        }
+
+        ~FHeapWalker()
+        {
+            lua_settop(L, BaseTop);
+        }
+
+        // 遍历注册表，跳过LuaInstance的绑定引用
+        void WalkRegistry(const TSet<int32> &SkippedRefs)
+        {
+            lua_pushvalue(L, LUA_REGISTRYINDEX);
+            Visited.Add(lua_topointer(L, -1));
+            lua_pop(L, 1);
+
+            lua_pushnil(L);
+            while (lua_next(L, LUA_REGISTRYINDEX) != 0)
+            {
+                if (!lua_isinteger(L, -2) || !SkippedRefs.Contains((int32)lua_tointeger(L, -2)))
+                {
+                    lua_pushvalue(L, -1);
+                    Enqueue();
+                    lua_pushvalue(L, -2);
+                    Enqueue();
+                }
+                lua_pop(L, 1);
+            }
+
+            lua_pushliteral(L, "");
+            if (lua_getmetatable(L, -1))
+            {
+                Enqueue();
+            }
+            lua_pop(L, 1);
+
+            Run();
+        }
+
+        // 从栈顶的对象开始遍历
+        void WalkFrom(UObject *InOwner)
+        {
+            Owner = InOwner;
+            Enqueue();
+            Run();
+        }
+
+        // 值在栈顶，弹出
+        void Enqueue()
+        {
+            const int32 Type = lua_type(L, -1);
+            if (Type != LUA_TTABLE && Type != LUA_TFUNCTION && Type != LUA_TUSERDATA && Type != LUA_TTHREAD)
+            {
+                lua_pop(L, 1);
+                return;
+            }
+
+            const void *Ptr = lua_topointer(L, -1);
+            bool bAlreadyVisited = BaseVisited && BaseVisited->Contains(Ptr);
+            if (!bAlreadyVisited)
+            {
+                Visited.Add(Ptr, &bAlreadyVisited);
+            }
+            if (bAlreadyVisited)
+            {
+                lua_pop(L, 1);
+                return;
+            }
+            lua_rawseti(L, Queue, ++Tail);
+        }
+
+        void Run()
+        {
+            while (Head < Tail)
+            {
+                // 遍历不能分帧(堆会变化)，超出预算直接放弃
+                if (Deadline > 0.0 && (Head & 255) == 0 && FPlatformTime::Seconds() > Deadline)
+                {
+                    bAborted = true;
+                    return;
+                }
+                lua_rawgeti(L, Queue, ++Head);
+                lua_pushnil(L);
+                lua_rawseti(L, Queue, Head);
+                Visit();
+                lua_pop(L, 1);
+            }
+        }
+
+        void Visit()
+        {
+            luaL_checkstack(L, 8, "cross heap gc");
+            const int32 Index = lua_gettop(L);
+            switch (lua_type(L, Index))
+            {
+            case LUA_TTABLE:
+                {
+                    if (UObject * const *Object = Instances.Find(lua_topointer(L, Index)))
+                    {
+                        if (!OnUObject(*Object, true))
+                        {
+                            return;
+                        }
+                    }
+
+                    bool bWeakKeys = false, bWeakValues = false;
+                    if (lua_getmetatable(L, Index))
+                    {
+                        lua_pushliteral(L, "__mode");
+                        if (lua_rawget(L, -2) == LUA_TSTRING)
+                        {
+                            const char *Mode = lua_tostring(L, -1);
+                            bWeakKeys = FCStringAnsi::Strchr(Mode, 'k') != nullptr;
+                            bWeakValues = FCStringAnsi::Strchr(Mode, 'v') != nullptr;
+                        }
+                        lua_pop(L, 1);
+                        Enqueue();
+                    }
+
+                    // 弱键表的值按强引用处理，只会少回收不会错误回收
+                    lua_pushnil(L);
+                    while (lua_next(L, Index) != 0)
+                    {
+                        if (!bWeakValues)
+                        {
+                            lua_pushvalue(L, -1);
+                            Enqueue();
+                        }
+                        if (!bWeakKeys)
+                        {
+                            lua_pushvalue(L, -2);
+                            Enqueue();
+                        }
+                        lua_pop(L, 1);
+                    }
+                }
+                break;
+            case LUA_TFUNCTION:
+                for (int32 i = 1; lua_getupvalue(L, Index, i); ++i)
+                {
+                    Enqueue();
+                }
+                break;
+            case LUA_TUSERDATA:
+                {
+                    UObject * const *Object = Instances.Find(lua_topointer(L, Index));
+                    bool bTwoLvlPtr = false;
+                    void *Userdata = GetUserdataFast(L, Index, &bTwoLvlPtr);
+                    if (Object)
+                    {
+                        OnUObject(*Object, false);
+                    }
+                    else if (bTwoLvlPtr && Userdata && Referenced.Contains(*(UObject**)Userdata))
+                    {
+                        OnUObject(*(UObject**)Userdata, false);         // container elements are not cached in the object index
+                    }
+
+                    if (lua_getmetatable(L, Index))
+                    {
+                        Enqueue();
+                    }
+                    for (int32 i = 1; lua_getiuservalue(L, Index, i) != LUA_TNONE; ++i)
+                    {
+                        Enqueue();
+                    }
+                    lua_pop(L, 1);
+                }
+                break;
+            case LUA_TTHREAD:
+                VisitThread(lua_tothread(L, Index));
+                break;
+            }
+        }
+
+        void VisitThread(lua_State *Thread)
+        {
+            if (Thread == L)
+            {
+                // 只有C++调用时才会执行，主线程上没有Lua函数，只看遍历之前的栈
+                for (int32 i = 1; i <= BaseTop; ++i)
+                {
+                    lua_pushvalue(L, i);
+                    Enqueue();
+                }
+                return;
+            }
+
+            if (!lua_checkstack(Thread, 2))
+            {
+                return;
+            }
+
+            lua_Debug ar;
+            for (int32 Level = 0; lua_getstack(Thread, Level, &ar); ++Level)
+            {
+                lua_getinfo(Thread, "f", &ar);
+                lua_xmove(Thread, L, 1);
+                Enqueue();
+                for (int32 i = 1; lua_getlocal(Thread, &ar, i); ++i)
+                {
+                    lua_xmove(Thread, L, 1);
+                    Enqueue();
+                }
+                for (int32 i = -1; lua_getlocal(Thread, &ar, i); --i)
+                {
+                    lua_xmove(Thread, L, 1);
+                    Enqueue();
+                }
+            }
+
+            // 未启动的函数和参数，或者yield的值
+            const int32 Top = lua_gettop(Thread);
+            for (int32 i = 1; i <= Top; ++i)
+            {
+                lua_pushvalue(Thread, i);
+                lua_xmove(Thread, L, 1);
+                Enqueue();
+            }
+        }
+
+        // 返回false表示不继续遍历这个对象
+        bool OnUObject(UObject *Object, bool bInstance)
+        {
+            if (!Owner)
+            {
+                LuaLive.Add(Object);
+                return true;
+            }
+            if (Object == Owner)
+            {
+                return true;
+            }
+            Held.Add(Object);
+            return !bInstance;                                          // other LuaInstances are walked as their own nodes
+        }
+
+        lua_State *L;
+        const TMap<const void*, UObject*> &Instances;                   // proxies in the object index -> UObject
+        const TSet<UObject*> &Referenced;
+        const TSet<const void*> *BaseVisited;
+        UObject *Owner;
+        double Deadline;                                                // 0 for no limit
+        bool bAborted;
+        int32 BaseTop;
+        int32 Queue;
+        int32 Head;
+        int32 Tail;
+        TSet<const void*> Visited;
+        TSet<UObject*> LuaLive;
+        TSet<UObject*> Held;
+    };
+}
+
+lua_State* FLuaCrossHeapGC::State = nullptr;
+FDelegateHandle FLuaCrossHeapGC::TickHandle;
+uint64 FLuaCrossHeapGC::LastTickFrame = 0;
+double FLuaCrossHeapGC::NextCollectTime = 0.0;
+bool FLuaCrossHeapGC::bLastPassAbandoned = false;
+int32 FLuaCrossHeapGC::NumConsecutiveAbandons = 0;
+float FLuaCrossHeapGC::AbandonedBudgetMs = 0.0f;
+
+// automatic passes stop after this many abandoned walks in a row, the interval doubles after each of them
+static constexpr int32 MaxConsecutiveAbandons = 5;
+TMap<UObject*, double> FLuaCrossHeapGC::RecheckTimes;
+
+void FLuaCrossHeapGC::Start(lua_State *L)
+{
+    if (State)
+    {
+        Stop();
+    }
+
+    State = L;
+    LastTickFrame = 0;
+    NextCollectTime = 0.0;
+    NumConsecutiveAbandons = 0;
+    TickHandle = FWorldDelegates::OnWorldTickStart.AddStatic(&FLuaCrossHeapGC::OnWorldTickStart);
+}
+
+void FLuaCrossHeapGC::Stop()
+{
+    if (!State)
+    {
+        return;
+    }
+
+    FWorldDelegates::OnWorldTickStart.Remove(TickHandle);
+    TickHandle.Reset();
+    RecheckTimes.Empty();
+    State = nullptr;
+}
+
+/**
+ * Callback for FWorldDelegates::OnWorldTickStart
+ */
+#if ENGINE_MAJOR_VERSION > 4 || (ENGINE_MAJOR_VERSION == 4 && ENGINE_MINOR_VERSION > 23)
+void FLuaCrossHeapGC::OnWorldTickStart(UWorld *World, ELevelTick TickType, float DeltaTime)
+#else
+void FLuaCrossHeapGC::OnWorldTickStart(ELevelTick TickType, float DeltaTime)
+#endif
+{
+    if (!State || LastTickFrame == GFrameCounter)
+    {
+        return;
+    }
+    LastTickFrame = GFrameCounter;
+
+    const float Interval = CVarCrossGCInterval.GetValueOnGameThread();
+    if (Interval <= 0.0f)
+    {
+        return;
+    }
+
+    // a new budget may let the walk finish, start over
+    const float BudgetMs = FMath::Max(CVarCrossGCMaxPassMs.GetValueOnGameThread(), 0.0f);
+    if (NumConsecutiveAbandons > 0 && BudgetMs != AbandonedBudgetMs)
+    {
+        NumConsecutiveAbandons = 0;
+        NextCollectTime = 0.0;
+    }
+    if (NumConsecutiveAbandons >= MaxConsecutiveAbandons)
+    {
+        return;
+    }
+
+    const double Now = FPlatformTime::Seconds();
+    if (NextCollectTime == 0.0)
+    {
+        NextCollectTime = Now + Interval;
+    }
+    else if (Now >= NextCollectTime)
+    {
+        Collect(nullptr, BudgetMs);
+        if (!bLastPassAbandoned)
+        {
+            NumConsecutiveAbandons = 0;
+            NextCollectTime = Now + Interval;
+            return;
+        }
+
+        // every retry would burn the whole budget again, back off
+        AbandonedBudgetMs = BudgetMs;
+        NextCollectTime = Now + Interval * (double)(1 << NumConsecutiveAbandons);
+        if (++NumConsecutiveAbandons >= MaxConsecutiveAbandons)
+        {
+            UE_LOG(LogUnLua, Warning, TEXT("Cross heap GC: the Lua heap walk ran over unlua.CrossGC.MaxPassMs (%.1f ms) %d times in a row, automatic passes stopped; raise the budget or run unlua.CrossGC.Collect"),
+                BudgetMs, NumConsecutiveAbandons);
+        }
+    }
+}
+
+int32 FLuaCrossHeapGC::Collect(FOutputDevice *Ar, float BudgetMs)
+{
+    using namespace UnLuaCrossHeapGC;
+
+    FOutputDevice &Log = Ar ? *Ar : *GLog;
+    bLastPassAbandoned = false;
+    UUnLuaManager *Manager = GLuaCxt ? GLuaCxt->GetManager() : nullptr;
+    lua_Debug ar;
+    if (!State || !Manager || IsGarbageCollecting() || lua_getstack(State, 0, &ar))
+    {
+        Log.Logf(TEXT("Cross heap GC skipped, no Lua state or Lua/UE GC is running"));
+        return 0;
+    }
+
+    const double StartTime = FPlatformTime::Seconds();
+    const double Deadline = BudgetMs > 0.0f ? StartTime + BudgetMs / 1000.0 : 0.0;
+    lua_State *L = State;
+
+    // 遍历期间不能回收，否则记录的指针可能被复用
+    const bool bLuaGCRunning = lua_gc(L, LUA_GCISRUNNING, 0) != 0;
+    lua_gc(L, LUA_GCSTOP, 0);
+
+    auto Abandon = [&]()
+    {
+        if (bLuaGCRunning)
+        {
+            lua_gc(L, LUA_GCRESTART, 0);
+        }
+        bLastPassAbandoned = true;
+        if (Ar)
+        {
+            Ar->Logf(TEXT("Cross heap GC: walking the Lua heap took more than %.1f ms, pass abandoned; raise unlua.CrossGC.MaxPassMs to allow it"), BudgetMs);
+        }
+        else
+        {
+            UE_LOG(LogUnLua, Verbose, TEXT("Cross heap GC: walking the Lua heap took more than %.1f ms, pass abandoned"), BudgetMs);
+        }
+        return 0;
+    };
+
+    const TSet<UObject*> &Referenced = GObjectReferencer.GetReferencedObjects();
+    const TMap<UObjectBaseUtility*, int32> &AttachedObjects = Manager->GetAttachedObjects();
+
+    TSet<int32> BindingRefs;
+    for (const TPair<UObjectBaseUtility*, int32> &Pair : AttachedObjects)
+    {
+        BindingRefs.Add(Pair.Value);
+    }
+
+    TMap<const void*, UObject*> Instances;
+    GLuaCxt->GetObjectIndex().ForEachObject(L, [L, &Instances](UObjectBase *Object)
+    {
+        Instances.Add(lua_topointer(L, -1), (UObject*)Object);
+    });
+
+    // 1. Lua正在使用的UObject
+    FHeapWalker RootWalker(L, Instances, Referenced);
+    RootWalker.Deadline = Deadline;
+    RootWalker.WalkRegistry(BindingRefs);
+    if (RootWalker.bAborted)
+    {
+        return Abandon();
+    }
+
+    // 2. 候选对象以及它们的LuaInstance之间的引用
+    const double Now = FPlatformTime::Seconds();
+    TArray<FNode> Nodes;
+    TMap<UObject*, int32> NodeIndices;
+    for (UObject *Object : Referenced)
+    {
+        if (!RootWalker.LuaLive.Contains(Object))
+        {
+            const int32 *LuaRef = AttachedObjects.Find(Object);
+            NodeIndices.Add(Object, Nodes.Num());
+            Nodes.Add({ Object, LuaRef && *LuaRef != LUA_REFNIL ? *LuaRef : LUA_NOREF, IsKnownReferenced(Object, Now), false });
+        }
+    }
+
+    for (int32 i = 0; i < Nodes.Num(); ++i)
+    {
+        if (Nodes[i].LuaRef == LUA_NOREF)
+        {
+            continue;
+        }
+        FHeapWalker Walker(L, Instances, Referenced);
+        Walker.BaseVisited = &RootWalker.Visited;
+        Walker.Deadline = Deadline;
+        lua_rawgeti(L, LUA_REGISTRYINDEX, Nodes[i].LuaRef);
+        Walker.WalkFrom(Nodes[i].Object);
+        if (Walker.bAborted)
+        {
+            return Abandon();
+        }
+        Nodes[i].LuaObjects = Walker.Visited.Array();
+        for (UObject *HeldObject : Walker.Held)
+        {
+            if (const int32 *HeldIndex = NodeIndices.Find(HeldObject))
+            {
+                Nodes[i].Held.Add(*HeldIndex);
+                Nodes[*HeldIndex].Holders.Add(i);
+            }
+        }
+    }
+    const double WalkMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+    // 3. 按组确认UE侧没有其他引用后释放
+    const int32 MaxChecks = FMath::Max(CVarCrossGCMaxChecks.GetValueOnGameThread(), 1);
+    const float RecheckSeconds = CVarCrossGCRecheckSeconds.GetValueOnGameThread();
+    int32 NumChecks = 0, NumCandidates = 0, NumReclaimed = 0;
+    int64 ReclaimedBytes = 0;
+    TSet<const void*> ReclaimedLuaObjects;                  // Lua objects may be reachable from several LuaInstances, count them once
+    for (int32 Seed = 0; Seed < Nodes.Num() && NumChecks < MaxChecks; ++Seed)
+    {
+        if (Nodes[Seed].bDone || Nodes[Seed].LuaRef == LUA_NOREF)
+        {
+            continue;
+        }
+
+        // 一组内的检查必须在同一帧完成，预算用完后不再开始新的一组
+        if (Deadline > 0.0 && NumChecks > 0 && FPlatformTime::Seconds() > Deadline)
+        {
+            break;
+        }
+
+        TArray<int32> Group;
+        GatherGroup(Nodes, Seed, Group);
+        ++NumCandidates;
+
+        bool bKeep = false;
+        TSet<UObject*> GroupObjects;
+        for (int32 Index : Group)
+        {
+            Nodes[Index].bDone = true;
+            bKeep |= Nodes[Index].bKeep;
+            GroupObjects.Add(Nodes[Index].Object);
+        }
+        if (bKeep)
+        {
+            continue;
+        }
+
+        // 未绑定的对象没有LuaInstance，不会通过Lua持有组内对象，只需要检查绑定的对象
+        GObjectReferencer.SetExcludedObjects(&GroupObjects);
+        for (int32 Index : Group)
+        {
+            if (Nodes[Index].LuaRef != LUA_NOREF)
+            {
+                ++NumChecks;
+                UObject *Object = Nodes[Index].Object;
+                if (IsReferenced(Object, GARBAGE_COLLECTION_KEEPFLAGS, EInternalObjectFlags::GarbageCollectionKeepFlags, false))
+                {
+                    bKeep = true;
+                    break;
+                }
+            }
+        }
+        GObjectReferencer.SetExcludedObjects(nullptr);
+
+        if (bKeep)
+        {
+            for (int32 Index : Group)
+            {
+                RecheckTimes.Add(Nodes[Index].Object, Now + RecheckSeconds);
+            }
+            continue;
+        }
+
+        for (int32 Index : Group)
+        {
+            const FNode &Node = Nodes[Index];
+            UE_LOG(LogUnLua, Log, TEXT("Cross heap GC: release %s, held by its LuaInstance cycle only"), *Node.Object->GetFullName());
+            if (Node.LuaRef != LUA_NOREF)
+            {
+                Manager->ReleaseAttachedObjectLuaRef(Node.Object);
+            }
+            GObjectReferencer.RemoveObjectRef(Node.Object);
+            ReclaimedBytes += Node.Object->GetClass()->GetStructureSize();
+            ReclaimedLuaObjects.Append(Node.LuaObjects);
+            ++NumReclaimed;
+        }
+    }
+
+    // 手动执行时两边立即回收，便于观察效果；自动执行时交给两边正常的GC，不再额外卡顿
+    int64 LuaBytes = 0;
+    if (NumReclaimed > 0 && Deadline == 0.0)
+    {
+        const int64 HeapBefore = (int64)lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+        lua_gc(L, LUA_GCCOLLECT, 0);
+        LuaBytes = FMath::Max<int64>(HeapBefore - ((int64)lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0)), 0);
+        if (GEngine)
+        {
+            GEngine->ForceGarbageCollection(false);
+        }
+    }
+    if (bLuaGCRunning)
+    {
+        lua_gc(L, LUA_GCRESTART, 0);
+    }
+
+    for (auto It = RecheckTimes.CreateIterator(); It; ++It)
+    {
+        if (It.Value() <= Now || !Referenced.Contains(It.Key()))
+        {
+            It.RemoveCurrent();
+        }
+    }
+
+    INC_DWORD_STAT_BY(STAT_UnLua_CrossGC_Objects, NumReclaimed);
+    INC_MEMORY_STAT_BY(STAT_UnLua_CrossGC_Memory, ReclaimedBytes + LuaBytes);
+
+    Log.Logf(TEXT("Cross heap GC: %d referenced UObjects, %d not used by Lua, %d groups checked with %d IsReferenced calls; reclaimed %d UObjects (%lld bytes), %d Lua objects (%lld bytes freed by a full Lua GC); walk %.2f ms, total %.2f ms"),
+        Referenced.Num(), Nodes.Num(), NumCandidates, NumChecks, NumReclaimed, ReclaimedBytes, ReclaimedLuaObjects.Num(), LuaBytes,
+        WalkMs, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+    return NumReclaimed;
+}
+
+/**
+ * Cheap tests for UObjects referenced by UE, so IsReferenced is not wasted on them
+ */
+bool FLuaCrossHeapGC::IsKnownReferenced(UObject *Object, double Now)
+{
+    if (Object->IsRooted() || Object->HasAnyFlags(GARBAGE_COLLECTION_KEEPFLAGS))
+    {
+        return true;
+    }
+
+    // 场景里的Actor和组件由关卡引用，销毁时由OnActorDestroyed释放
+    if (AActor *Actor = Cast<AActor>(Object))
+    {
+        return !Actor->IsPendingKill() && Actor->GetLevel() != nullptr;
+    }
+    if (UActorComponent *Component = Cast<UActorComponent>(Object))
+    {
+        return !Component->IsPendingKill() && Component->GetOwner() != nullptr;
+    }
+
+    const double *RecheckTime = RecheckTimes.Find(Object);
+    return RecheckTime && *RecheckTime > Now;
+}
+
+/**
+ * The seed, every node holding it directly or indirectly, and the nodes held by the group only
+ * 种子节点及其所有(间接)持有者，再加上只被这一组持有的节点
+ */
+void FLuaCrossHeapGC::GatherGroup(TArray<FNode> &Nodes, int32 Seed, TArray<int32> &OutGroup)
+{
+    TSet<int32> InGroup;
+    OutGroup.Add(Seed);
+    InGroup.Add(Seed);
+    for (int32 i = 0; i < OutGroup.Num(); ++i)
+    {
+        for (int32 Holder : Nodes[OutGroup[i]].Holders)
+        {
+            bool bAlreadyInGroup = false;
+            InGroup.Add(Holder, &bAlreadyInGroup);
+            if (!bAlreadyInGroup)
+            {
+                OutGroup.Add(Holder);
+            }
+        }
+    }
+
+    bool bChanged = true;
+    while (bChanged)
+    {
+        bChanged = false;
+        for (int32 i = 0; i < OutGroup.Num(); ++i)
+        {
+            for (int32 HeldIndex : Nodes[OutGroup[i]].Held)
+            {
+                if (InGroup.Contains(HeldIndex))
+                {
+                    continue;
+                }
+                bool bOnlyHeldByGroup = true;
+                for (int32 Holder : Nodes[HeldIndex].Holders)
+                {
+                    bOnlyHeldByGroup &= InGroup.Contains(Holder);
+                }
+                if (bOnlyHeldByGroup)
+                {
+                    InGroup.Add(HeldIndex);
+                    OutGroup.Add(HeldIndex);
+                    bChanged = true;
+                }
+            }
+        }
+    }
+}
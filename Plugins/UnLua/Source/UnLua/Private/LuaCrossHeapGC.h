@@ -0,0 +1,84 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+
+struct lua_State;
+class UWorld;
+
+/**
+ * Collects cycles between Lua instance tables and GObjectReferencer that neither GC can see
+ * 回收Lua实例表和GObjectReferencer之间两边GC都看不到的循环引用
+ *
+ * 绑定的UObject通过AttachedObjects引用自己的LuaInstance，LuaInstance(或者它引用的Lua对象)又通过代理userdata
+ * 让GObjectReferencer引用UObject，UE和Lua都不再使用时这些对象也不会被回收(常见于没有调用Release的UI)。
+ * 每'unlua.CrossGC.IntervalSeconds'秒执行一次：
+ * 1. 遍历Lua堆，根节点是注册表(不包括AttachedObjects的引用，弱表只算强引用的部分)、线程栈和字符串元表，
+ *    到达的代理/实例对应的UObject是Lua正在使用的；
+ * 2. 其余被GObjectReferencer引用的UObject作为候选，从每个已绑定候选的LuaInstance遍历，得到"候选A的LuaInstance引用了候选B"；
+ * 3. 取一个已绑定候选的所有"持有者"(闭包)，再加上只被它们持有的候选，组成一组；
+ *    临时从GObjectReferencer排除这一组，用IsReferenced确认UE侧也没有其他引用，然后释放绑定和引用，交给两边的GC回收。
+ * IsReferenced是一次完整的可达性分析，每轮最多检查'unlua.CrossGC.MaxChecksPerPass'个对象，UE仍在引用的对象一段时间内不再检查。
+ *
+ * 一轮在一帧内同步完成，遍历期间Lua堆不能变化，所以无法分帧。卡顿约为：遍历可达Lua对象(大约每10万个对象几毫秒到十几毫秒)
+ * 加上每次IsReferenced(和UE GC的标记阶段相当，通常几毫秒到几十毫秒)。自动执行的一轮受'unlua.CrossGC.MaxPassMs'限制：
+ * 遍历超时直接放弃，不释放任何对象；预算用完后不再开始新的检查。自动执行不会强制UE或Lua做全量GC。
+ * 连续放弃时间隔按2的幂增加，连续放弃MaxConsecutiveAbandons次后停止自动执行，修改'unlua.CrossGC.MaxPassMs'后重新开始。
+ */
+class UNLUA_API FLuaCrossHeapGC
+{
+public:
+    static void Start(lua_State *L);
+    static void Stop();
+
+    /**
+     * Run a pass now, returns the number of reclaimed UObjects
+     * 立即执行一轮，返回回收的UObject数量
+     *
+     * @param BudgetMs - time budget of the pass, 0 for no limit. Passes without a budget run a full Lua GC and request a UE GC when something was reclaimed
+     */
+    static int32 Collect(FOutputDevice *Ar = nullptr, float BudgetMs = 0.0f);
+
+private:
+    struct FNode
+    {
+        UObject *Object;
+        int32 LuaRef;                       // LuaInstance in the registry, LUA_NOREF if not bound
+        bool bKeep;                         // known to be referenced by UE
+        bool bDone;
+        TArray<const void*> LuaObjects;     // Lua objects only reachable from the LuaInstance, may be shared with other nodes
+        TArray<int32> Holders;              // nodes whose LuaInstance references this one
+        TArray<int32> Held;
+    };
+
+#if ENGINE_MAJOR_VERSION > 4 || (ENGINE_MAJOR_VERSION == 4 && ENGINE_MINOR_VERSION > 23)
+    static void OnWorldTickStart(UWorld *World, ELevelTick TickType, float DeltaTime);
+#else
+    static void OnWorldTickStart(ELevelTick TickType, float DeltaTime);
+#endif
+    static bool IsKnownReferenced(UObject *Object, double Now);
+    static void GatherGroup(TArray<FNode> &Nodes, int32 Seed, TArray<int32> &OutGroup);
+
+    static lua_State *State;
+    static FDelegateHandle TickHandle;
+    static uint64 LastTickFrame;
+    static double NextCollectTime;
+    static bool bLastPassAbandoned;
+    static int32 NumConsecutiveAbandons;
+    static float AbandonedBudgetMs;                 // budget the abandoned passes ran with
+    static TMap<UObject*, double> RecheckTimes;      // UObjects referenced by UE at the last check
+};
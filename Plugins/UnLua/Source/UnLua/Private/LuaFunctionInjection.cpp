@@ -64,13 +64,19 @@ DEFINE_FUNCTION(FLuaInvoker::execCallLua)
 
     bool bRpcCall = false;
 #if SUPPORTS_RPC_CALL
-    AActor *Actor = Cast<AActor>(Stack.Object);
-    if (!Actor)
+    // only a net function can be called remotely, skip the callspace query for everything else
+    // 只有网络方法才可能是远程调用，其他方法不需要查询callspace
+    AActor *Actor = nullptr;
+    if (Func->HasAnyFunctionFlags(FUNC_Net))
     {
-        UActorComponent *ActorComponent = Cast<UActorComponent>(Stack.Object);
-        if (ActorComponent)
+        Actor = Cast<AActor>(Stack.Object);
+        if (!Actor)
         {
-            Actor = ActorComponent->GetOwner();
+            UActorComponent *ActorComponent = Cast<UActorComponent>(Stack.Object);
+            if (ActorComponent)
+            {
+                Actor = ActorComponent->GetOwner();
+            }
         }
     }
     if (Actor)
@@ -0,0 +1,298 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaGCController.h"
+#include "LuaCore.h"
+#include "UnLuaPrivate.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarGCTargetPauseMs(
+    TEXT("unlua.GC.TargetPauseMs"),
+    1.0f,
+    TEXT("Longest Lua GC pause the adaptive GC controller aims for."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarGCAdaptiveWindowSeconds(
+    TEXT("unlua.GC.AdaptiveWindowSeconds"),
+    2.0f,
+    TEXT("How often the adaptive GC controller reviews the measured pauses."),
+    ECVF_Default);
+
+// 参数范围，和Lua的默认值(分代minor 20，增量pause 200/stepmul 100)一起决定调整的起点和边界
+static constexpr int32 MinMinorMul = 5;
+static constexpr int32 MaxMinorMul = 100;
+static constexpr int32 DefaultMinorMul = 20;
+static constexpr int32 MajorMul = 100;
+static constexpr int32 MinPause = 120;
+static constexpr int32 MaxPause = 400;
+static constexpr int32 DefaultPause = 200;
+static constexpr int32 MinStepMul = 100;
+static constexpr int32 MaxStepMul = 1000;
+static constexpr double MinRetryGenerationalSeconds = 30.0;
+static constexpr double MaxRetryGenerationalSeconds = 600.0;
+
+lua_State* FLuaGCController::State = nullptr;
+FDelegateHandle FLuaGCController::TickHandle;
+uint64 FLuaGCController::LastTickFrame = 0;
+uint64 FLuaGCController::StepStartCycles = 0;
+double FLuaGCController::FrameMs = 0.0;
+FLuaGCController::FWindow FLuaGCController::Window;
+bool FLuaGCController::bGenerational = true;
+int32 FLuaGCController::MinorMul = DefaultMinorMul;
+int32 FLuaGCController::Pause = DefaultPause;
+int32 FLuaGCController::StepMul = MinStepMul;
+double FLuaGCController::ModeSwitchTime = 0.0;
+double FLuaGCController::RetryGenerationalSeconds = MinRetryGenerationalSeconds;
+
+void FLuaGCController::Start(lua_State *L)
+{
+    if (State)
+    {
+        Stop();
+    }
+
+#if LUA_GC_HOOK
+    State = L;
+    lua_setgchook(L, &FLuaGCController::OnGCEvent, nullptr);
+
+    MinorMul = DefaultMinorMul;
+    Pause = DefaultPause;
+    StepMul = MinStepMul;
+    RetryGenerationalSeconds = MinRetryGenerationalSeconds;
+    FrameMs = 0.0;
+    LastTickFrame = 0;
+    Window = FWindow();
+    Window.StartTime = FPlatformTime::Seconds();
+    Window.StartHeapBytes = GetHeapBytes();
+    SetGenerational(TEXT("start"));
+
+    TickHandle = FWorldDelegates::OnWorldTickStart.AddStatic(&FLuaGCController::OnWorldTickStart);
+#else
+    // 没有GC hook量不到停顿，退回到固定的分代模式
+    UE_LOG(LogUnLua, Warning, TEXT("%s: LUA_GC_HOOK is off in Lua.Build.cs, using generational GC"), ANSI_TO_TCHAR(__FUNCTION__));
+    lua_gc(L, LUA_GCGEN, 0, 0);
+#endif
+}
+
+void FLuaGCController::Stop()
+{
+    if (!State)
+    {
+        return;
+    }
+
+#if LUA_GC_HOOK
+    lua_setgchook(State, nullptr, nullptr);
+#endif
+    FWorldDelegates::OnWorldTickStart.Remove(TickHandle);
+    TickHandle.Reset();
+    State = nullptr;
+}
+
+/**
+ * GC hook, only timing here, it runs inside the collector
+ */
+void FLuaGCController::OnGCEvent(lua_State *L, void *UserData, int Event)
+{
+#if LUA_GC_HOOK
+    if (Event == LUA_GCEV_BEGIN)
+    {
+        StepStartCycles = FPlatformTime::Cycles64();
+        return;
+    }
+
+    const float Ms = (float)FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StepStartCycles);
+    FrameMs += Ms;
+    Window.TotalMs += Ms;
+    ++Window.NumSteps;
+    switch (Event)
+    {
+    case LUA_GCEV_CYCLE:
+        ++Window.NumCycles;
+        // fall through
+    case LUA_GCEV_INCSTEP:
+        Window.MaxStepMs = FMath::Max(Window.MaxStepMs, Ms);
+        break;
+    case LUA_GCEV_MINOR:
+        ++Window.NumMinor;
+        Window.MaxMinorMs = FMath::Max(Window.MaxMinorMs, Ms);
+        break;
+    case LUA_GCEV_MAJOR:
+        ++Window.NumMajor;
+        Window.MaxMajorMs = FMath::Max(Window.MaxMajorMs, Ms);
+        break;
+    default:
+        break;                                              // explicit full collections aren't ours to tune
+    }
+#endif
+}
+
+/**
+ * Callback for FWorldDelegates::OnWorldTickStart
+ */
+#if ENGINE_MAJOR_VERSION > 4 || (ENGINE_MAJOR_VERSION == 4 && ENGINE_MINOR_VERSION > 23)
+void FLuaGCController::OnWorldTickStart(UWorld *World, ELevelTick TickType, float DeltaTime)
+#else
+void FLuaGCController::OnWorldTickStart(ELevelTick TickType, float DeltaTime)
+#endif
+{
+    if (!State || LastTickFrame == GFrameCounter)
+    {
+        return;
+    }
+    LastTickFrame = GFrameCounter;
+
+    SET_FLOAT_STAT(STAT_UnLua_GC_Time, (float)FrameMs);
+    SET_MEMORY_STAT(STAT_UnLua_GC_Heap, GetHeapBytes());
+    FrameMs = 0.0;
+
+    const double Now = FPlatformTime::Seconds();
+    if (Now - Window.StartTime >= FMath::Max(CVarGCAdaptiveWindowSeconds.GetValueOnGameThread(), 0.1f))
+    {
+        Evaluate(Now);
+    }
+}
+
+/**
+ * Review the last window and adjust the mode or the parameters
+ */
+void FLuaGCController::Evaluate(double Now)
+{
+    // 先开始新的窗口，切换模式的开销(见ApplyParameters)计入新窗口，参与下一次评估
+    const FWindow Last = Window;
+    const int64 HeapBytes = GetHeapBytes();
+    Window = FWindow();
+    Window.StartTime = Now;
+    Window.StartHeapBytes = HeapBytes;
+
+    const float TargetMs = FMath::Max(CVarGCTargetPauseMs.GetValueOnGameThread(), 0.01f);
+    const double Seconds = Now - Last.StartTime;
+    const double HeapGrowth = Last.StartHeapBytes > 0 ? (double)(HeapBytes - Last.StartHeapBytes) / Last.StartHeapBytes : 0.0;
+    const double GCFraction = Last.TotalMs / (Seconds * 1000.0);
+
+    SET_FLOAT_STAT(STAT_UnLua_GC_MaxPause, FMath::Max3(Last.MaxStepMs, Last.MaxMinorMs, Last.MaxMajorMs));
+    SET_DWORD_STAT(STAT_UnLua_GC_Steps, Last.NumSteps);
+    SET_DWORD_STAT(STAT_UnLua_GC_MinorCollections, Last.NumMinor);
+    SET_DWORD_STAT(STAT_UnLua_GC_MajorCollections, Last.NumMajor);
+
+    bool bChanged = false;
+    if (bGenerational)
+    {
+        // major回收是一次完整标记，又慢又频繁说明大部分对象都活过了minor回收，分代不划算；切到分代时的完整标记也算一次major停顿
+        if (Last.MaxMajorMs > TargetMs * 2 || (Last.NumMajor > 0 && Last.NumMajor * 4 > Last.NumMinor))
+        {
+            // 刚重试分代就又退回来，下次等久一点
+            RetryGenerationalSeconds = Now - ModeSwitchTime < RetryGenerationalSeconds * 2
+                ? FMath::Min(RetryGenerationalSeconds * 2, MaxRetryGenerationalSeconds) : MinRetryGenerationalSeconds;
+            SetIncremental(*FString::Printf(TEXT("%d major / %d minor collections, longest major %.2f ms"), Last.NumMajor, Last.NumMinor, Last.MaxMajorMs));
+        }
+        else if (Last.MaxMinorMs > TargetMs && MinorMul > MinMinorMul)
+        {
+            // 年轻代越小minor回收越快
+            MinorMul = FMath::Max(MinorMul * 3 / 4, MinMinorMul);
+            bChanged = true;
+        }
+        else if (Last.MaxMinorMs < TargetMs / 2 && GCFraction > 0.02 && MinorMul < MaxMinorMul)
+        {
+            // 停顿有余量但回收太频繁，放大年轻代
+            MinorMul = FMath::Min(MinorMul * 5 / 4 + 1, MaxMinorMul);
+            bChanged = true;
+        }
+    }
+    else
+    {
+        if (Now - ModeSwitchTime > RetryGenerationalSeconds)
+        {
+            SetGenerational(TEXT("retry"));
+        }
+        else
+        {
+            // 单步停顿由STEPMUL决定；跟不上分配时加大STEPMUL，GC耗时占比高时推迟下一轮(PAUSE)
+            if (Last.MaxStepMs > TargetMs && StepMul > MinStepMul)
+            {
+                StepMul = FMath::Max(StepMul * 3 / 4, MinStepMul);
+                bChanged = true;
+            }
+            else if (HeapGrowth > 0.5 && Last.NumCycles == 0 && Last.MaxStepMs < TargetMs / 2 && StepMul < MaxStepMul)
+            {
+                StepMul = FMath::Min(StepMul * 5 / 4, MaxStepMul);
+                bChanged = true;
+            }
+
+            if (GCFraction > 0.05 && Pause < MaxPause)
+            {
+                Pause = FMath::Min(Pause + 25, MaxPause);
+                bChanged = true;
+            }
+            else if (GCFraction < 0.01 && Pause > MinPause)
+            {
+                Pause = FMath::Max(Pause - 25, MinPause);
+                bChanged = true;
+            }
+        }
+    }
+
+    if (bChanged)
+    {
+        UE_LOG(LogUnLua, Log, TEXT("Lua GC: %s, pause %.2f/%.2f/%.2f ms (step/minor/major), %.1f%% of time in GC, heap %+.0f%%"),
+            bGenerational ? *FString::Printf(TEXT("minor multiplier %d"), MinorMul) : *FString::Printf(TEXT("pause %d, step multiplier %d"), Pause, StepMul),
+            Last.MaxStepMs, Last.MaxMinorMs, Last.MaxMajorMs, GCFraction * 100.0, HeapGrowth * 100.0);
+        ApplyParameters();
+    }
+}
+
+void FLuaGCController::SetGenerational(const TCHAR *Reason)
+{
+    UE_LOG(LogUnLua, Log, TEXT("Lua GC: generational mode (%s), minor multiplier %d"), Reason, MinorMul);
+    bGenerational = true;
+    ModeSwitchTime = FPlatformTime::Seconds();
+    ApplyParameters();
+}
+
+void FLuaGCController::SetIncremental(const TCHAR *Reason)
+{
+    UE_LOG(LogUnLua, Log, TEXT("Lua GC: incremental mode (%s), pause %d, step multiplier %d, retry generational in %.0f s"), Reason, Pause, StepMul, RetryGenerationalSeconds);
+    bGenerational = false;
+    ModeSwitchTime = FPlatformTime::Seconds();
+    ApplyParameters();
+}
+
+void FLuaGCController::ApplyParameters()
+{
+    if (bGenerational)
+    {
+        // 从增量模式切过来时Lua会做一次完整的原子标记(entergen)，GC hook收不到，按major停顿计时
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        lua_gc(State, LUA_GCGEN, MinorMul, MajorMul);
+        const float Ms = (float)FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+        FrameMs += Ms;
+        Window.TotalMs += Ms;
+        Window.MaxMajorMs = FMath::Max(Window.MaxMajorMs, Ms);
+    }
+    else
+    {
+        lua_gc(State, LUA_GCINC, Pause, StepMul, 0);
+    }
+
+    SET_DWORD_STAT(STAT_UnLua_GC_Mode, bGenerational ? 1 : 0);
+    SET_DWORD_STAT(STAT_UnLua_GC_MinorMul, MinorMul);
+    SET_DWORD_STAT(STAT_UnLua_GC_PauseParam, Pause);
+    SET_DWORD_STAT(STAT_UnLua_GC_StepMul, StepMul);
+}
+
+int64 FLuaGCController::GetHeapBytes()
+{
+    return (int64)lua_gc(State, LUA_GCCOUNT, 0) * 1024 + lua_gc(State, LUA_GCCOUNTB, 0);
+}
@@ -0,0 +1,80 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+
+struct lua_State;
+class UWorld;
+
+/**
+ * Adaptive Lua GC, switches between generational and incremental mode and tunes their parameters by measured pauses
+ * 自适应Lua GC：根据实测的GC停顿在分代和增量模式之间切换，并调整参数
+ *
+ * 通过lua_setgchook(需要Lua.Build.cs中开启LUA_GC_HOOK)记录每次GC步骤的耗时，每'unlua.GC.AdaptiveWindowSeconds'秒评估一次：
+ * 分代模式下major回收太慢或太频繁(大部分对象都活过了minor回收)时切到增量模式，否则按minor停顿调整minor multiplier；
+ * 切换到分代模式时Lua做的完整标记不经过GC hook，单独计时并按major停顿计入下一个窗口；
+ * 增量模式下按单步停顿调整STEPMUL，按GC耗时占比和堆增长调整PAUSE，并定期重新尝试分代模式。
+ * 可以在FUnLuaDelegates::ConfigureLuaGC中调用Start(L)，或者设置'unlua.GC.Policy=2'作为默认配置。
+ */
+class UNLUA_API FLuaGCController
+{
+public:
+    static void Start(lua_State *L);
+    static void Stop();
+    static bool IsRunning() { return State != nullptr; }
+
+private:
+    struct FWindow
+    {
+        double StartTime = 0.0;
+        int64 StartHeapBytes = 0;
+        double TotalMs = 0.0;
+        float MaxStepMs = 0.0f;             // incremental steps
+        float MaxMinorMs = 0.0f;
+        float MaxMajorMs = 0.0f;
+        int32 NumSteps = 0;
+        int32 NumCycles = 0;
+        int32 NumMinor = 0;
+        int32 NumMajor = 0;
+    };
+
+    static void OnGCEvent(lua_State *L, void *UserData, int Event);
+#if ENGINE_MAJOR_VERSION > 4 || (ENGINE_MAJOR_VERSION == 4 && ENGINE_MINOR_VERSION > 23)
+    static void OnWorldTickStart(UWorld *World, ELevelTick TickType, float DeltaTime);
+#else
+    static void OnWorldTickStart(ELevelTick TickType, float DeltaTime);
+#endif
+    static void Evaluate(double Now);
+    static void SetGenerational(const TCHAR *Reason);
+    static void SetIncremental(const TCHAR *Reason);
+    static void ApplyParameters();
+    static int64 GetHeapBytes();
+
+    static lua_State *State;
+    static FDelegateHandle TickHandle;
+    static uint64 LastTickFrame;
+    static uint64 StepStartCycles;
+    static double FrameMs;
+    static FWindow Window;
+
+    static bool bGenerational;
+    static int32 MinorMul;
+    static int32 Pause;
+    static int32 StepMul;
+    static double ModeSwitchTime;
+    static double RetryGenerationalSeconds;
+};
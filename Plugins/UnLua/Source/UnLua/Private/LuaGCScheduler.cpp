@@ -0,0 +1,209 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaGCScheduler.h"
+#include "LuaCore.h"
+#include "UnLuaPrivate.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+CSV_DEFINE_CATEGORY(UnLua, true);
+
+static TAutoConsoleVariable<float> CVarGCFrameBudgetMs(
+    TEXT("unlua.GC.FrameBudgetMs"),
+    1.0f,
+    TEXT("Milliseconds of incremental Lua GC work per frame."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarGCMaxFrameBudgetMs(
+    TEXT("unlua.GC.MaxFrameBudgetMs"),
+    4.0f,
+    TEXT("Upper bound of the per-frame Lua GC budget, including idle time and catching up when the heap grows too fast."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarGCIdleTimeFraction(
+    TEXT("unlua.GC.IdleTimeFraction"),
+    0.5f,
+    TEXT("Fraction of the time the engine slept last frame to hold the max tick rate that may be added to the Lua GC budget."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarGCPause(
+    TEXT("unlua.GC.Pause"),
+    150,
+    TEXT("A new Lua GC cycle starts when the heap reaches this percentage of the heap left by the last cycle, same as LUA_GCSETPAUSE."),
+    ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarGCHardLimitPause(
+    TEXT("unlua.GC.HardLimitPause"),
+    400,
+    TEXT("Lua's own collector runs as a backstop once the heap reaches this percentage of the heap left by the last cycle,\n")
+    TEXT("e.g. while no world ticks (loading screens, commandlets) or when one frame allocates more than the scheduler can keep up with."),
+    ECVF_Default);
+
+lua_State* FLuaGCScheduler::State = nullptr;
+FDelegateHandle FLuaGCScheduler::TickHandle;
+uint64 FLuaGCScheduler::LastTickFrame = 0;
+bool FLuaGCScheduler::bCycleInProgress = false;
+int64 FLuaGCScheduler::LastHeapBytes = 0;
+int64 FLuaGCScheduler::HeapAfterLastCycle = 0;
+int64 FLuaGCScheduler::HeapAtCycleStart = 0;
+double FLuaGCScheduler::CycleMs = 0.0;
+double FLuaGCScheduler::AllocBytesPerFrame = 0.0;
+double FLuaGCScheduler::StepBytesPerMs = 256.0 * 1024.0;        // rough guess until the first cycle is measured
+float FLuaGCScheduler::LastFrameMs = 0.0f;
+
+/**
+ * Take over the collection, Lua's automatic GC is only kept as a backstop
+ */
+void FLuaGCScheduler::Start(lua_State *L)
+{
+    if (State)
+    {
+        Stop();
+    }
+
+    State = L;
+    // 自动GC不关闭，只把它的触发阈值调到'unlua.GC.HardLimitPause'%：World不Tick或者单帧分配过多时由Lua自己回收，不会涨到分配失败
+    const int32 HardLimitPause = FMath::Clamp(CVarGCHardLimitPause.GetValueOnGameThread(), FMath::Max(CVarGCPause.GetValueOnGameThread(), 100) + 50, 1000);     // stored in a byte as pause/4
+#if 504 == LUA_VERSION_NUM
+    lua_gc(L, LUA_GCINC, HardLimitPause, 0, 0);     // generational mode does a whole young collection per step
+#else
+    lua_gc(L, LUA_GCSETPAUSE, HardLimitPause);
+#endif
+
+    LastTickFrame = 0;
+    bCycleInProgress = false;
+    LastHeapBytes = HeapAfterLastCycle = GetHeapBytes();
+    CycleMs = 0.0;
+    AllocBytesPerFrame = 0.0;
+    LastFrameMs = 0.0f;
+
+    TickHandle = FWorldDelegates::OnWorldTickStart.AddStatic(&FLuaGCScheduler::OnWorldTickStart);
+}
+
+/**
+ * Give the collection back to Lua
+ */
+void FLuaGCScheduler::Stop()
+{
+    if (!State)
+    {
+        return;
+    }
+
+    FWorldDelegates::OnWorldTickStart.Remove(TickHandle);
+    TickHandle.Reset();
+    lua_gc(State, LUA_GCSETPAUSE, 200);             // Lua's default pause
+    State = nullptr;
+}
+
+/**
+ * Callback for FWorldDelegates::OnWorldTickStart
+ */
+#if ENGINE_MAJOR_VERSION > 4 || (ENGINE_MAJOR_VERSION == 4 && ENGINE_MINOR_VERSION > 23)
+void FLuaGCScheduler::OnWorldTickStart(UWorld *World, ELevelTick TickType, float DeltaTime)
+#else
+void FLuaGCScheduler::OnWorldTickStart(ELevelTick TickType, float DeltaTime)
+#endif
+{
+    // 多个World(如PIE)每帧只执行一次
+    if (!State || LastTickFrame == GFrameCounter)
+    {
+        return;
+    }
+    LastTickFrame = GFrameCounter;
+
+    Tick();
+}
+
+void FLuaGCScheduler::Tick()
+{
+    const double StartTime = FPlatformTime::Seconds();
+
+    // 正常情况下只有这里的GC会释放对象，两帧之间的增长近似为这段时间的分配量
+    const int64 HeapBytes = GetHeapBytes();
+    AllocBytesPerFrame = AllocBytesPerFrame * 0.9 + FMath::Max<int64>(HeapBytes - LastHeapBytes, 0) * 0.1;
+
+    const float BaseBudgetMs = FMath::Max(CVarGCFrameBudgetMs.GetValueOnGameThread(), 0.0f);
+    const float MaxBudgetMs = FMath::Max(CVarGCMaxFrameBudgetMs.GetValueOnGameThread(), BaseBudgetMs);
+    const int64 Threshold = HeapAfterLastCycle * FMath::Max(CVarGCPause.GetValueOnGameThread(), 100) / 100;
+
+    if (!bCycleInProgress)
+    {
+        // 按当前预算完成一轮需要的帧数，期间堆还会继续增长；预计会超过阈值时提前开始
+        const double FramesPerCycle = HeapBytes / FMath::Max(StepBytesPerMs * FMath::Max(BaseBudgetMs, 0.1f), 1.0);
+        const double ProjectedBytes = HeapBytes + AllocBytesPerFrame * FramesPerCycle;
+        if (ProjectedBytes < Threshold)
+        {
+            LastHeapBytes = HeapBytes;
+            LastFrameMs = 0.0f;
+            SET_FLOAT_STAT(STAT_UnLua_GC_Time, 0.0f);
+            SET_DWORD_STAT(STAT_UnLua_GC_Steps, 0);
+            SET_MEMORY_STAT(STAT_UnLua_GC_Heap, HeapBytes);
+            CSV_CUSTOM_STAT(UnLua, GCTimeMs, 0.0f, ECsvCustomStatOp::Set);
+            CSV_CUSTOM_STAT(UnLua, LuaHeapMB, (float)(HeapBytes / (1024.0 * 1024.0)), ECsvCustomStatOp::Set);
+            return;
+        }
+        bCycleInProgress = true;
+        HeapAtCycleStart = HeapBytes;
+        CycleMs = 0.0;
+    }
+
+    // 限帧(如30Hz的DS)时上一帧sleep的时间是空闲的，拿出一部分给GC；堆增长过快追不上时直接用最大预算
+    float BudgetMs = BaseBudgetMs + FApp::GetIdleTime() * 1000.0 * FMath::Clamp(CVarGCIdleTimeFraction.GetValueOnGameThread(), 0.0f, 1.0f);
+    if (HeapBytes > Threshold * 2)
+    {
+        BudgetMs = MaxBudgetMs;
+    }
+    BudgetMs = FMath::Min(BudgetMs, MaxBudgetMs);
+
+    const double EndTime = StartTime + BudgetMs / 1000.0;
+    int32 NumSteps = 0;
+    do
+    {
+        ++NumSteps;
+        if (lua_gc(State, LUA_GCSTEP, 0))
+        {
+            bCycleInProgress = false;
+            break;
+        }
+    } while (FPlatformTime::Seconds() < EndTime);
+
+    LastHeapBytes = GetHeapBytes();
+    LastFrameMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+    CycleMs += LastFrameMs;
+
+    if (!bCycleInProgress)
+    {
+        // 一轮结束，更新存活内存和GC速度
+        HeapAfterLastCycle = LastHeapBytes;
+        if (CycleMs > 0.0)
+        {
+            StepBytesPerMs = StepBytesPerMs * 0.5 + HeapAtCycleStart / CycleMs * 0.5;
+        }
+    }
+
+    SET_FLOAT_STAT(STAT_UnLua_GC_Time, LastFrameMs);
+    SET_DWORD_STAT(STAT_UnLua_GC_Steps, NumSteps);
+    SET_MEMORY_STAT(STAT_UnLua_GC_Heap, LastHeapBytes);
+    CSV_CUSTOM_STAT(UnLua, GCTimeMs, LastFrameMs, ECsvCustomStatOp::Set);
+    CSV_CUSTOM_STAT(UnLua, LuaHeapMB, (float)(LastHeapBytes / (1024.0 * 1024.0)), ECsvCustomStatOp::Set);
+}
+
+int64 FLuaGCScheduler::GetHeapBytes()
+{
+    return (int64)lua_gc(State, LUA_GCCOUNT, 0) * 1024 + lua_gc(State, LUA_GCCOUNTB, 0);
+}
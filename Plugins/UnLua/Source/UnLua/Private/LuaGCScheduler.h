@@ -0,0 +1,62 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+
+struct lua_State;
+class UWorld;
+
+/**
+ * Frame-budgeted incremental Lua GC
+ * 按帧预算执行的Lua增量GC
+ *
+ * 每帧在OnWorldTickStart里以小步(LUA_GCSTEP)推进，直到用完本帧预算或者一轮GC结束。
+ * Lua的自动GC保留为兜底，触发阈值调高到'unlua.GC.HardLimitPause'%，World不Tick或者单帧分配过多时仍然会回收。
+ * 堆大小超过上一轮GC后存活内存的'unlua.GC.Pause'%时开始新一轮；按分配速率估计一轮需要的帧数，来不及时提前开始。
+ * 预算为'unlua.GC.FrameBudgetMs'，再加上上一帧为了限帧而空闲的时间，最多'unlua.GC.MaxFrameBudgetMs'。
+ */
+class FLuaGCScheduler
+{
+public:
+    static void Start(lua_State *L);
+    static void Stop();
+    static bool IsRunning() { return State != nullptr; }
+
+    // 最近一帧的GC耗时(毫秒)
+    static float GetLastFrameMs() { return LastFrameMs; }
+
+private:
+#if ENGINE_MAJOR_VERSION > 4 || (ENGINE_MAJOR_VERSION == 4 && ENGINE_MINOR_VERSION > 23)
+    static void OnWorldTickStart(UWorld *World, ELevelTick TickType, float DeltaTime);
+#else
+    static void OnWorldTickStart(ELevelTick TickType, float DeltaTime);
+#endif
+    static void Tick();
+    static int64 GetHeapBytes();
+
+    static lua_State *State;
+    static FDelegateHandle TickHandle;
+    static uint64 LastTickFrame;
+    static bool bCycleInProgress;
+    static int64 LastHeapBytes;
+    static int64 HeapAfterLastCycle;
+    static int64 HeapAtCycleStart;
+    static double CycleMs;                  // GC time spent on the current cycle
+    static double AllocBytesPerFrame;       // moving average of the allocation rate
+    static double StepBytesPerMs;           // moving average of heap bytes traversed per ms of GC work
+    static float LastFrameMs;
+};
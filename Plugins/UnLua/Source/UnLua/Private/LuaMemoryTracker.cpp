@@ -0,0 +1,230 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaMemoryTracker.h"
+#include "LuaCore.h"
+#include "HAL/IConsoleManager.h"
+
+bool FLuaMemoryTracker::bEnabled = false;
+int32 FLuaMemoryTracker::SampleInterval = 64 * 1024;
+int64 FLuaMemoryTracker::BytesUntilSample = 0;
+TArray<FLuaMemoryTracker::FTag> FLuaMemoryTracker::TagStack;
+TArray<FLuaMemoryTracker::FSite> FLuaMemoryTracker::Sites;
+TMap<TPair<const char*, int32>, int32> FLuaMemoryTracker::SiteLookup;
+TMap<const void*, FLuaMemoryTracker::FSample> FLuaMemoryTracker::Samples;
+TArray<uint16> FLuaMemoryTracker::SampledCounts;
+
+static constexpr uint32 NumSampledCounts = 1 << 17;
+
+static FAutoConsoleCommand CmdMemTrackStart(
+    TEXT("unlua.MemTrack.Start"),
+    TEXT("Start attributing the Lua heap to Lua modules. Optional argument: sample interval in bytes, 65536 by default."),
+    FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+    {
+        FLuaMemoryTracker::Start(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 64 * 1024);
+    }));
+
+static FAutoConsoleCommand CmdMemTrackStop(
+    TEXT("unlua.MemTrack.Stop"),
+    TEXT("Stop attributing the Lua heap and discard the samples."),
+    FConsoleCommandDelegate::CreateStatic(&FLuaMemoryTracker::Stop));
+
+static FAutoConsoleCommand CmdMemTrackDump(
+    TEXT("unlua.MemTrack.Dump"),
+    TEXT("Print live Lua heap per module and the top allocation sites. Optional argument: number of sites, 20 by default."),
+    FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic([](const TArray<FString>& Args, UWorld*, FOutputDevice& Ar)
+    {
+        FLuaMemoryTracker::Dump(Ar, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 20);
+    }));
+
+void FLuaMemoryTracker::Start(int32 InSampleInterval)
+{
+    Stop();
+
+    SampleInterval = FMath::Max(InSampleInterval, 256);
+    BytesUntilSample = FMath::RandRange(1, SampleInterval);        // random phase, avoids locking onto a periodic allocation pattern
+    SampledCounts.SetNumZeroed(NumSampledCounts);
+    bEnabled = true;
+    UE_LOG(LogUnLua, Log, TEXT("Lua memory tracking started, sample interval %d bytes"), SampleInterval);
+}
+
+void FLuaMemoryTracker::Stop()
+{
+    bEnabled = false;
+    TagStack.Empty();
+    Sites.Empty();
+    SiteLookup.Empty();
+    Samples.Empty();
+    SampledCounts.Empty();
+}
+
+/**
+ * Sample the allocation and release the sample of the freed block, a realloc is both
+ */
+void FLuaMemoryTracker::OnRealloc(void *OldPtr, size_t OldSize, void *NewPtr, size_t NewSize)
+{
+    if (NewSize > 0 && !NewPtr)
+    {
+        return;                                             // failed, the old block is untouched
+    }
+
+    if (OldPtr)
+    {
+        uint16 &Count = SampledCounts[HashPointer(OldPtr) & (NumSampledCounts - 1)];
+        if (Count > 0)
+        {
+            FSample Sample;
+            if (Samples.RemoveAndCopyValue(OldPtr, Sample))
+            {
+                Sites[Sample.SiteIndex].LiveBytes -= Sample.Bytes;
+                --Count;
+            }
+        }
+    }
+
+    if (NewSize == 0)
+    {
+        return;
+    }
+
+    BytesUntilSample -= NewSize;
+    if (BytesUntilSample > 0)
+    {
+        return;
+    }
+
+    // 一次分配可能跨过多个采样点
+    const int64 NumCrossed = 1 - BytesUntilSample / SampleInterval;
+    BytesUntilSample += NumCrossed * SampleInterval;
+
+    static const FTag Untagged = { "<untagged>", 0 };
+    FSample Sample;
+    Sample.SiteIndex = FindOrAddSite(TagStack.Num() > 0 ? TagStack.Last() : Untagged);
+    Sample.Bytes = (int32)FMath::Min<int64>(NumCrossed * SampleInterval, MAX_int32);
+
+    uint16 &Count = SampledCounts[HashPointer(NewPtr) & (NumSampledCounts - 1)];
+    if (Count < MAX_uint16)
+    {
+        ++Count;
+        Samples.Add(NewPtr, Sample);
+        Sites[Sample.SiteIndex].LiveBytes += Sample.Bytes;
+    }
+}
+
+void FLuaMemoryTracker::Dump(FOutputDevice &Ar, int32 NumTopSites)
+{
+    if (!bEnabled)
+    {
+        Ar.Logf(TEXT("Lua memory tracking is off, run 'unlua.MemTrack.Start' first"));
+        return;
+    }
+
+    TMap<FString, int64> Modules;
+    int64 TotalBytes = 0;
+    for (const FSite &Site : Sites)
+    {
+        Modules.FindOrAdd(Site.Module) += Site.LiveBytes;
+        TotalBytes += Site.LiveBytes;
+    }
+    Modules.ValueSort([](int64 A, int64 B) { return A > B; });
+
+    Ar.Logf(TEXT("Sampled live Lua heap: %.2f MB in %d samples (interval %d bytes)"), TotalBytes / (1024.0 * 1024.0), Samples.Num(), SampleInterval);
+    for (const TPair<FString, int64> &Module : Modules)
+    {
+        if (Module.Value > 0)
+        {
+            Ar.Logf(TEXT("%10.1f KB  %s"), Module.Value / 1024.0, *Module.Key);
+        }
+    }
+
+    TArray<const FSite*> SortedSites;
+    for (const FSite &Site : Sites)
+    {
+        if (Site.LiveBytes > 0)
+        {
+            SortedSites.Add(&Site);
+        }
+    }
+    SortedSites.Sort([](const FSite &A, const FSite &B) { return A.LiveBytes > B.LiveBytes; });
+
+    Ar.Logf(TEXT("Top allocation sites (function called from C++, by line defined):"));
+    for (int32 i = 0; i < FMath::Min(NumTopSites, SortedSites.Num()); ++i)
+    {
+        Ar.Logf(TEXT("%10.1f KB  %s:%d"), SortedSites[i]->LiveBytes / 1024.0, *SortedSites[i]->Module, SortedSites[i]->Line);
+    }
+}
+
+bool FLuaMemoryTracker::PushTag(lua_State *L, int32 NumArgs)
+{
+    lua_Debug ar;
+    lua_pushvalue(L, -(NumArgs + 1));
+    if (!lua_getinfo(L, ">S", &ar))                         // pops the function
+    {
+        return false;
+    }
+    TagStack.Add({ ar.source, ar.linedefined });
+    return true;
+}
+
+void FLuaMemoryTracker::PopTag()
+{
+    if (TagStack.Num() > 0)                                 // tracking may be restarted during the call
+    {
+        TagStack.Pop(false);
+    }
+}
+
+/**
+ * Chunk name pointers are only valid while the function is alive, so the name is compared again when a pointer is seen before
+ */
+int32 FLuaMemoryTracker::FindOrAddSite(const FTag &Tag)
+{
+    const TPair<const char*, int32> Key(Tag.Source, Tag.Line);
+    const FString Module = GetModuleName(Tag.Source);
+    if (const int32 *Index = SiteLookup.Find(Key))
+    {
+        const FSite &Site = Sites[*Index];
+        if (Site.Module == Module)
+        {
+            return *Index;
+        }
+    }
+
+    int32 Index = Sites.IndexOfByPredicate([&Module, &Tag](const FSite &Site) { return Site.Line == Tag.Line && Site.Module == Module; });
+    if (Index == INDEX_NONE)
+    {
+        Index = Sites.Add({ Module, Tag.Line, 0 });
+    }
+    SiteLookup.Add(Key, Index);
+    return Index;
+}
+
+/**
+ * Chunks loaded from strings (e.g. by RunChunk) are named by their source code, only the first line is kept like luaO_chunkid
+ */
+FString FLuaMemoryTracker::GetModuleName(const char *Source)
+{
+    if (Source[0] == '@' || Source[0] == '=')
+    {
+        return UTF8_TO_TCHAR(Source + 1);
+    }
+
+    FString Name = UTF8_TO_TCHAR(Source);
+    int32 LineEnd = INDEX_NONE;
+    if (Name.FindChar(TEXT('\n'), LineEnd) || Name.Len() > 40)
+    {
+        Name = Name.Left(FMath::Min(LineEnd == INDEX_NONE ? Name.Len() : LineEnd, 40)) + TEXT("...");
+    }
+    return FString::Printf(TEXT("[string \"%s\"]"), *Name);
+}
@@ -0,0 +1,110 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct lua_State;
+
+/**
+ * Sampling attribution of the Lua heap to Lua modules and functions, opt-in by 'unlua.MemTrack.Start'
+ * 按采样把Lua堆内存归属到Lua模块和函数，通过'unlua.MemTrack.Start'开启
+ *
+ * CallFunction(包括FFunctionDesc::CallLua)、UnLua::Call/CallTableFunc和RunChunk调用Lua函数时把被调函数的chunk名和定义行压入"当前模块"栈；
+ * 分配器每分配SampleInterval字节采样一次，采样的块记录当前栈顶，权重为SampleInterval，释放时扣除。
+ * 未采样块的释放只需要查一次计数表，开启后的额外开销很小；关闭时只有一次布尔判断。
+ */
+class FLuaMemoryTracker
+{
+public:
+    static FORCEINLINE bool IsEnabled() { return bEnabled; }
+
+    static void Start(int32 InSampleInterval);
+    static void Stop();
+
+    // 分配器回调，参数和lua_Alloc一致，NewPtr是分配结果
+    static void OnRealloc(void *OldPtr, size_t OldSize, void *NewPtr, size_t NewSize);
+
+    // 输出各模块的存活内存以及存活内存最多的函数
+    static void Dump(FOutputDevice &Ar, int32 NumTopSites);
+
+    /**
+     * Tag allocations with the Lua function about to be called, the function is at -(NumArgs + 1)
+     * 在调用期间把分配归属到将要调用的Lua函数
+     */
+    struct FScope
+    {
+        FScope(lua_State *L, int32 NumArgs)
+            : bPushed(false)
+        {
+            if (bEnabled)
+            {
+                bPushed = PushTag(L, NumArgs);
+            }
+        }
+
+        ~FScope()
+        {
+            if (bPushed)
+            {
+                PopTag();
+            }
+        }
+
+        bool bPushed;
+    };
+
+private:
+    struct FTag
+    {
+        const char *Source;                 // kept alive by the function on the Lua stack
+        int32 Line;
+    };
+
+    struct FSample
+    {
+        int32 SiteIndex;
+        int32 Bytes;
+    };
+
+    struct FSite
+    {
+        FString Module;
+        int32 Line;
+        int64 LiveBytes;
+    };
+
+    static bool PushTag(lua_State *L, int32 NumArgs);
+    static void PopTag();
+    static int32 FindOrAddSite(const FTag &Tag);
+    static FString GetModuleName(const char *Source);
+    static FORCEINLINE uint32 HashPointer(const void *Ptr)
+    {
+        uint64 Key = (uint64)(UPTRINT)Ptr;
+        Key ^= Key >> 33;
+        Key *= 0xff51afd7ed558ccdull;
+        Key ^= Key >> 33;
+        return (uint32)Key;
+    }
+
+    static bool bEnabled;
+    static int32 SampleInterval;
+    static int64 BytesUntilSample;
+    static TArray<FTag> TagStack;
+    static TArray<FSite> Sites;
+    static TMap<TPair<const char*, int32>, int32> SiteLookup;     // last seen chunk name pointer and line -> site
+    static TMap<const void*, FSample> Samples;
+    static TArray<uint16> SampledCounts;                            // sampled blocks per pointer hash, skips the map for most frees
+};
@@ -0,0 +1,180 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+
+#include "LuaNameCache.h"
+#include "lua.hpp"
+#include "lstate.h"
+
+static constexpr int32 MaxNames = 16384;
+
+FLuaNameCache::FLuaNameCache()
+    : Owner(nullptr)
+{
+}
+
+void FLuaNameCache::Initialize(lua_State *L)
+{
+    Reset();
+    Owner = G(L);
+}
+
+void FLuaNameCache::Reset()
+{
+    Owner = nullptr;
+    NameRefs.Empty();
+    StringNames.Empty();
+}
+
+void FLuaNameCache::PushName(lua_State *L, FName Name)
+{
+    if (!IsOwner(L))
+    {
+        lua_pushstring(L, TCHAR_TO_UTF8(*Name.ToString()));
+        return;
+    }
+
+    if (const int32 *Ref = NameRefs.Find(Name))
+    {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *Ref);
+        return;
+    }
+
+    if (NameRefs.Num() >= MaxNames)
+    {
+        EvictNames(L);
+    }
+
+    size_t Len = 0;
+    lua_pushstring(L, TCHAR_TO_UTF8(*Name.ToString()));
+    lua_tolstring(L, -1, &Len);
+    lua_pushvalue(L, -1);
+    NameRefs.Add(Name, luaL_ref(L, LUA_REGISTRYINDEX));
+
+    // FName(Name.ToString()) == Name, so the string can be converted back without a lookup as well
+    CacheString(L, -1, Len, Name);
+}
+
+FName FLuaNameCache::ToName(lua_State *L, int32 Index)
+{
+    if (lua_type(L, Index) != LUA_TSTRING || !IsOwner(L))
+    {
+        const char *String = lua_tostring(L, Index);
+        return String ? FName(UTF8_TO_TCHAR(String)) : NAME_None;
+    }
+
+    const void *Key = lua_topointer(L, Index);
+    if (const FStringName *Entry = StringNames.Find(Key))
+    {
+        return Entry->Name;
+    }
+
+    size_t Len = 0;
+    const char *String = lua_tolstring(L, Index, &Len);
+    const FName Name(UTF8_TO_TCHAR(String));
+    CacheString(L, Index, Len, Name);
+    return Name;
+}
+
+bool FLuaNameCache::FindName(lua_State *L, int32 Index, FName &OutName)
+{
+    if (lua_type(L, Index) != LUA_TSTRING)
+    {
+        OutName = ToName(L, Index);
+        return true;
+    }
+
+    const bool bOwner = IsOwner(L);
+    if (bOwner)
+    {
+        if (const FStringName *Entry = StringNames.Find(lua_topointer(L, Index)))
+        {
+            OutName = Entry->Name;
+            return true;
+        }
+    }
+
+    size_t Len = 0;
+    const char *String = lua_tolstring(L, Index, &Len);
+    OutName = FName(UTF8_TO_TCHAR(String), FNAME_Find);
+    // FNAME_Find返回NAME_None表示没找到，但""和"None"本身就是NAME_None
+    if (OutName.IsNone() && Len > 0 && FCStringAnsi::Stricmp(String, "None") != 0)
+    {
+        return false;
+    }
+    if (bOwner)
+    {
+        CacheString(L, Index, Len, OutName);
+    }
+    return true;
+}
+
+/**
+ * Only short strings are cached, long strings with the same content may have different addresses
+ * 只缓存短字符串，长字符串内容相同时地址也可能不同
+ */
+void FLuaNameCache::CacheString(lua_State *L, int32 Index, size_t Len, FName Name)
+{
+    if (Len > LUAI_MAXSHORTLEN)
+    {
+        return;
+    }
+
+    const void *Key = lua_topointer(L, Index);
+    if (StringNames.Contains(Key))
+    {
+        return;
+    }
+    if (StringNames.Num() >= MaxNames)
+    {
+        EvictStrings(L);
+    }
+    lua_pushvalue(L, Index);
+    StringNames.Add(Key, { Name, luaL_ref(L, LUA_REGISTRYINDEX) });
+}
+
+/**
+ * Unpin every cached string of a direction when it's full, names still in use are cached again on their next conversion
+ * 缓存满了之后释放全部固定的字符串，仍在使用的名字下次转换时重新缓存
+ */
+void FLuaNameCache::EvictNames(lua_State *L)
+{
+    for (const TPair<FName, int32> &Pair : NameRefs)
+    {
+        luaL_unref(L, LUA_REGISTRYINDEX, Pair.Value);
+    }
+    NameRefs.Reset();
+}
+
+void FLuaNameCache::EvictStrings(lua_State *L)
+{
+    for (const TPair<const void*, FStringName> &Pair : StringNames)
+    {
+        luaL_unref(L, LUA_REGISTRYINDEX, Pair.Value.Ref);
+    }
+    StringNames.Reset();
+}
+
+int32 FLuaNameCache::GetMaxNames()
+{
+    return MaxNames;
+}
+
+/**
+ * Threads of the owner share its registry
+ */
+bool FLuaNameCache::IsOwner(lua_State *L) const
+{
+    return G(L) == Owner;
+}
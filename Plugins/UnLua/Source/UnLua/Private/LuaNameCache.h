@@ -0,0 +1,88 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct lua_State;
+
+/**
+ * Two-way cache between FNames and Lua strings
+ * FName和Lua字符串的双向缓存
+ *
+ * FName -> Lua字符串：第一次push时把字符串转换好并用luaL_ref固定在注册表里，之后push只需要一次lua_rawgeti，不再分配内存；
+ * Lua字符串 -> FName：短字符串在Lua里是唯一的(内部化)，用TString的地址做key，不需要转换编码和查找全局的FName表。
+ * 作为key的字符串同样固定在注册表里，保证地址在缓存期间有效。两个方向最多各缓存MaxNames个，
+ * 满了之后释放这个方向的全部固定引用再重新开始缓存，常用的名字很快会重新进入缓存，不会一直占着注册表。
+ * 其他lua_State(不共享注册表)直接转换，不走缓存。
+ */
+class UNLUA_API FLuaNameCache
+{
+public:
+    FLuaNameCache();
+
+    // 缓存只对L(和它的线程)有效，L关闭后需要调用Reset
+    void Initialize(lua_State *L);
+    void Reset();
+
+    /**
+     * Push a FName as a Lua string
+     * 把FName作为Lua字符串push
+     */
+    void PushName(lua_State *L, FName Name);
+
+    /**
+     * Convert the Lua value at Index to a FName, NAME_None if it isn't a string or a number
+     * 把Index处的Lua值转换成FName，不是字符串或数字时返回NAME_None
+     */
+    FName ToName(lua_State *L, int32 Index);
+
+    /**
+     * Find the FName of the Lua value at Index without adding a new name to the global name table. Used by lookups
+     * in TMap/TSet, a key can't be there if its name doesn't exist
+     * 查找Index处Lua值对应的FName，不会往全局FName表里添加新名字。用于TMap/TSet的查找，名字不存在时key也一定不存在
+     *
+     * @return - false if there is no such FName
+     */
+    bool FindName(lua_State *L, int32 Index, FName &OutName);
+
+    int32 GetNumNames() const { return NameRefs.Num(); }
+    int32 GetNumStrings() const { return StringNames.Num(); }
+    static int32 GetMaxNames();
+
+private:
+    // 区分大小写，编辑器里"Foo"和"foo"是同一个FName但显示字符串不同
+    struct FNameKeyFuncs : TDefaultMapKeyFuncs<FName, int32, false>
+    {
+        static FORCEINLINE bool Matches(const FName &A, const FName &B) { return A.IsEqual(B, ENameCase::CaseSensitive); }
+        static FORCEINLINE uint32 GetKeyHash(const FName &Key) { return GetTypeHash(Key); }
+    };
+
+    struct FStringName
+    {
+        FName Name;
+        int32 Ref;                                                          // pins the string, its address is the key
+    };
+
+    bool IsOwner(lua_State *L) const;
+    void CacheString(lua_State *L, int32 Index, size_t Len, FName Name);
+    void EvictNames(lua_State *L);
+    void EvictStrings(lua_State *L);
+
+    const void *Owner;                                                      // global state of the Lua state owning the registry references
+    TMap<FName, int32, FDefaultSetAllocator, FNameKeyFuncs> NameRefs;      // FName -> registry reference of the Lua string
+    TMap<const void*, FStringName> StringNames;                             // pinned short Lua string (TString*) -> FName
+};
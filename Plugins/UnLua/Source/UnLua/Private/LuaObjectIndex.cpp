@@ -0,0 +1,228 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaObjectIndex.h"
+#include "LuaCore.h"
+#include "UObject/UObjectArray.h"
+
+static constexpr int32 MinSweepThreshold = 1024;
+
+FLuaObjectIndex::FLuaObjectIndex()
+    : TableRef(LUA_NOREF), SweepThreshold(MinSweepThreshold)
+{
+    Slots.Add({ nullptr, INDEX_NONE });
+}
+
+void FLuaObjectIndex::Initialize(lua_State *L)
+{
+    Reset();
+    CreateWeakValueTable(L);
+    TableRef = luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+void FLuaObjectIndex::Reset()
+{
+    TableRef = LUA_NOREF;
+    ObjectSlots.Empty();
+    StructSlots.Empty();
+    Slots.Reset();
+    Slots.Add({ nullptr, INDEX_NONE });
+    FreeSlots.Empty();
+    SweepThreshold = MinSweepThreshold;
+}
+
+bool FLuaObjectIndex::PushObject(lua_State *L, const UObjectBase *Object)
+{
+    const int32 Slot = FindObjectSlot(Object);
+    return Slot && PushSlot(L, Slot);
+}
+
+void FLuaObjectIndex::AddObject(lua_State *L, const UObjectBase *Object, int32 Index)
+{
+    Index = lua_absindex(L, Index);
+    const int32 ObjectIndex = GUObjectArray.ObjectToIndex(Object);
+    if (ObjectIndex >= ObjectSlots.Num())
+    {
+        ObjectSlots.SetNumZeroed(FMath::RoundUpToPowerOfTwo(ObjectIndex + 1));
+    }
+
+    int32 Slot = ObjectSlots[ObjectIndex];
+    if (Slot && Slots[Slot].Key != Object)
+    {
+        // 同一个InternalIndex上已删除的对象
+        lua_pushnil(L);
+        SetSlot(L, Slot, -1);
+        lua_pop(L, 1);
+        FreeSlot(Slot);
+        Slot = 0;
+    }
+    if (!Slot)
+    {
+        Slot = AllocSlot(L, Object, ObjectIndex);
+        ObjectSlots[ObjectIndex] = Slot;
+    }
+    SetSlot(L, Slot, Index);
+}
+
+void FLuaObjectIndex::RemoveObject(lua_State *L, const UObjectBase *Object)
+{
+    const int32 Slot = FindObjectSlot(Object);
+    if (Slot)
+    {
+        lua_pushnil(L);
+        SetSlot(L, Slot, -1);
+        lua_pop(L, 1);
+        FreeSlot(Slot);
+    }
+}
+
+void FLuaObjectIndex::ForEachObject(lua_State *L, TFunctionRef<void(UObjectBase*)> Func)
+{
+    lua_rawgeti(L, LUA_REGISTRYINDEX, TableRef);
+    for (int32 Slot = 1; Slot < Slots.Num(); ++Slot)
+    {
+        if (Slots[Slot].ObjectIndex != INDEX_NONE)
+        {
+            if (lua_rawgeti(L, -1, Slot) != LUA_TNIL)
+            {
+                Func((UObjectBase*)Slots[Slot].Key);
+            }
+            lua_pop(L, 1);
+        }
+    }
+    lua_pop(L, 1);
+}
+
+bool FLuaObjectIndex::PushStruct(lua_State *L, const void *Ptr)
+{
+    const int32 *Slot = StructSlots.Find(Ptr);
+    return Slot && PushSlot(L, *Slot);
+}
+
+void FLuaObjectIndex::AddStruct(lua_State *L, const void *Ptr, int32 Index)
+{
+    Index = lua_absindex(L, Index);
+    int32 Slot;
+    if (const int32 *Found = StructSlots.Find(Ptr))
+    {
+        Slot = *Found;
+    }
+    else
+    {
+        Slot = AllocSlot(L, Ptr, INDEX_NONE);
+        StructSlots.Add(Ptr, Slot);
+    }
+    SetSlot(L, Slot, Index);
+}
+
+/**
+ * Slot of a UObject, 0 if none or the slot belongs to a deleted object with the same internal index
+ */
+int32 FLuaObjectIndex::FindObjectSlot(const UObjectBase *Object) const
+{
+    const int32 ObjectIndex = GUObjectArray.ObjectToIndex(Object);
+    const int32 Slot = ObjectSlots.IsValidIndex(ObjectIndex) ? ObjectSlots[ObjectIndex] : 0;
+    return Slot && Slots[Slot].Key == Object ? Slot : 0;
+}
+
+/**
+ * Push the proxy in a slot, a slot cleared by Lua GC is released
+ */
+bool FLuaObjectIndex::PushSlot(lua_State *L, int32 Slot)
+{
+    lua_rawgeti(L, LUA_REGISTRYINDEX, TableRef);
+    if (lua_rawgeti(L, -1, Slot) == LUA_TNIL)
+    {
+        lua_pop(L, 2);
+        FreeSlot(Slot);
+        return false;
+    }
+    lua_remove(L, -2);
+    return true;
+}
+
+void FLuaObjectIndex::SetSlot(lua_State *L, int32 Slot, int32 Index)
+{
+    Index = lua_absindex(L, Index);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, TableRef);
+    lua_pushvalue(L, Index);
+    lua_rawseti(L, -2, Slot);
+    lua_pop(L, 1);
+}
+
+int32 FLuaObjectIndex::AllocSlot(lua_State *L, const void *Key, int32 ObjectIndex)
+{
+    if (FreeSlots.Num() == 0 && Slots.Num() > SweepThreshold)
+    {
+        Sweep(L);
+    }
+
+    int32 Slot;
+    if (FreeSlots.Num() > 0)
+    {
+        Slot = FreeSlots.Pop(false);
+        Slots[Slot] = { Key, ObjectIndex };
+    }
+    else
+    {
+        Slot = Slots.Add({ Key, ObjectIndex });
+    }
+    return Slot;
+}
+
+void FLuaObjectIndex::FreeSlot(int32 Slot)
+{
+    FSlot &Entry = Slots[Slot];
+    if (Entry.ObjectIndex != INDEX_NONE)
+    {
+        if (ObjectSlots[Entry.ObjectIndex] == Slot)
+        {
+            ObjectSlots[Entry.ObjectIndex] = 0;
+        }
+    }
+    else
+    {
+        const int32 *StructSlot = StructSlots.Find(Entry.Key);
+        if (StructSlot && *StructSlot == Slot)
+        {
+            StructSlots.Remove(Entry.Key);
+        }
+    }
+    Entry = { nullptr, INDEX_NONE };
+    FreeSlots.Add(Slot);
+}
+
+/**
+ * Release the slots cleared by Lua GC, runs when the slots double, so the cost is amortized
+ * 回收被Lua GC清掉的槽位，槽位数翻倍时才执行一次，均摊开销是常数
+ */
+void FLuaObjectIndex::Sweep(lua_State *L)
+{
+    lua_rawgeti(L, LUA_REGISTRYINDEX, TableRef);
+    for (int32 Slot = 1; Slot < Slots.Num(); ++Slot)
+    {
+        if (Slots[Slot].Key)
+        {
+            const bool bCleared = lua_rawgeti(L, -1, Slot) == LUA_TNIL;
+            lua_pop(L, 1);
+            if (bCleared)
+            {
+                FreeSlot(Slot);
+            }
+        }
+    }
+    lua_pop(L, 1);
+
+    SweepThreshold = FMath::Max(MinSweepThreshold, (Slots.Num() - FreeSlots.Num()) * 2);
+}
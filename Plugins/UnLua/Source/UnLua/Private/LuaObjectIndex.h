@@ -0,0 +1,77 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct lua_State;
+class UObjectBase;
+
+/**
+ * Index of the Lua proxies (userdata or LuaInstance) of C++ objects, replaces the 'ObjectMap'/'StructMap' weak tables
+ * C++对象到Lua代理(userdata或LuaInstance)的索引，替代'ObjectMap'/'StructMap'弱表
+ *
+ * 代理存放在一张弱值表的数组部分，C++侧记录每个对象占用的槽位：UObject按InternalIndex直接下标访问，结构体指针用TMap。
+ * 查找一个已有代理只需要两次数组读取(注册表里的代理表、槽位)，不再需要字符串键的lua_getfield和lightuserdata的哈希查找。
+ * 代理没有其他引用时仍然由Lua GC清掉(槽位变成nil)，保持原来弱表的语义；
+ * UObject删除时显式释放槽位，其他已被清掉的槽位在查找未命中或槽位用完时回收。
+ */
+class UNLUA_API FLuaObjectIndex
+{
+public:
+    FLuaObjectIndex();
+
+    // 创建代理表，L关闭后需要调用Reset
+    void Initialize(lua_State *L);
+    void Reset();
+
+    /**
+     * Push the proxy of a UObject, returns false and pushes nothing if there isn't one
+     * Push UObject的代理，没有时返回false且不push
+     */
+    bool PushObject(lua_State *L, const UObjectBase *Object);
+    // 把Index处的值记录为UObject的代理
+    void AddObject(lua_State *L, const UObjectBase *Object, int32 Index);
+    void RemoveObject(lua_State *L, const UObjectBase *Object);
+
+    // 遍历存活的UObject代理，回调时代理在栈顶
+    void ForEachObject(lua_State *L, TFunctionRef<void(UObjectBase*)> Func);
+
+    bool PushStruct(lua_State *L, const void *Ptr);
+    void AddStruct(lua_State *L, const void *Ptr, int32 Index);
+
+    int32 GetNumSlots() const { return Slots.Num() - 1 - FreeSlots.Num(); }
+
+private:
+    struct FSlot
+    {
+        const void *Key;
+        int32 ObjectIndex;                  // INDEX_NONE for structs
+    };
+
+    int32 FindObjectSlot(const UObjectBase *Object) const;
+    bool PushSlot(lua_State *L, int32 Slot);
+    void SetSlot(lua_State *L, int32 Slot, int32 Index);
+    int32 AllocSlot(lua_State *L, const void *Key, int32 ObjectIndex);
+    void FreeSlot(int32 Slot);
+    void Sweep(lua_State *L);
+
+    int32 TableRef;
+    TArray<int32> ObjectSlots;              // UObject internal index -> slot, 0 if none
+    TMap<const void*, int32> StructSlots;
+    TArray<FSlot> Slots;                    // slot 0 is unused, so a slot is also the Lua array index
+    TArray<int32> FreeSlots;
+    int32 SweepThreshold;
+};
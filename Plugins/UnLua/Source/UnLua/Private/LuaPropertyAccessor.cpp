@@ -0,0 +1,571 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaPropertyAccessor.h"
+#include "LuaCore.h"
+#include "LuaContext.h"
+#include "UnLuaBase.h"
+#include "ReflectionUtils/FieldDesc.h"
+#include "ReflectionUtils/PropertyDesc.h"
+#include "ReflectionUtils/ReflectionRegistry.h"
+
+static const char* const PropertySetMetatableName = "UnLua_PropertySet";
+static const char* const PropertyPathMetatableName = "UnLua_PropertyPath";
+
+static FPropertyDesc* FindProperty(FClassDesc *ClassDesc, FName PropertyName)
+{
+    FFieldDesc *Field = ClassDesc->RegisterField(PropertyName, ClassDesc);
+    return Field && Field->IsProperty() ? Field->AsProperty() : nullptr;
+}
+
+static FClassDesc* FindOrRegisterClass(lua_State *L, UStruct *Struct)
+{
+    FClassDesc *ClassDesc = GReflectionRegistry.FindClassByStruct(Struct);
+    return ClassDesc ? ClassDesc : RegisterClass(L, Struct);
+}
+
+/**
+ * Get the class descriptor from 'metatable.__name' of the value at the given index
+ * 通过元表的__name获取类描述，结构体实例和UE.FVector这样的类表都适用
+ */
+static FClassDesc* GetClassDescFromMetatable(lua_State *L, int32 Index)
+{
+    if (!lua_getmetatable(L, Index))
+    {
+        return nullptr;
+    }
+    lua_pushstring(L, "__name");
+    FClassDesc *ClassDesc = lua_rawget(L, -2) == LUA_TSTRING ? GReflectionRegistry.FindClass(UnLua::GetFName(L, -1)) : nullptr;
+    lua_pop(L, 2);
+    return ClassDesc && ClassDesc->IsValid() ? ClassDesc : nullptr;
+}
+
+static bool IsPlainTable(lua_State *L, int32 Index)
+{
+    if (lua_type(L, Index) != LUA_TTABLE)
+    {
+        return false;
+    }
+    if (lua_getmetatable(L, Index))
+    {
+        lua_pop(L, 1);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Create a metatable whose '__index' holds the 'Get' and 'Set' methods, leave it on the top of the stack
+ * 创建元表，__index中是Get/Set方法，元表留在栈顶
+ */
+static void CreateAccessorMetatable(lua_State *L, const char *MetatableName, lua_CFunction Getter, lua_CFunction Setter)
+{
+    luaL_newmetatable(L, MetatableName);
+    lua_pushstring(L, "__index");
+    lua_newtable(L);
+    lua_pushstring(L, "Get");
+    lua_pushcfunction(L, Getter);
+    lua_rawset(L, -3);
+    lua_pushstring(L, "Set");
+    lua_pushcfunction(L, Setter);
+    lua_rawset(L, -3);
+    lua_rawset(L, -3);
+}
+
+void FLuaPropertyAccessor::Register(lua_State *L)
+{
+    CreateAccessorMetatable(L, PropertySetMetatableName, PropertySet_Get, PropertySet_Set);
+    lua_pushstring(L, "__len");
+    lua_pushcfunction(L, PropertySet_Len);
+    lua_rawset(L, -3);
+    lua_pop(L, 1);
+
+    CreateAccessorMetatable(L, PropertyPathMetatableName, PropertyPath_Get, PropertyPath_Set);
+    lua_pop(L, 1);
+
+    lua_pushcfunction(L, GetProperties);
+    SetTableForClass(L, "GetProperties");
+    lua_pushcfunction(L, SetProperties);
+    SetTableForClass(L, "SetProperties");
+    lua_pushcfunction(L, CreatePropertySet);
+    SetTableForClass(L, "PropertySet");
+    lua_pushcfunction(L, CompilePath);
+    SetTableForClass(L, "CompilePath");
+    lua_pushcfunction(L, StructToTable);
+    SetTableForClass(L, "StructToTable");
+    lua_pushcfunction(L, TableToStruct);
+    SetTableForClass(L, "TableToStruct");
+}
+
+/**
+ * Resolve the instance at the given index to its class descriptor and the address of the container
+ * 解析实例，返回类描述和属性容器的地址
+ */
+FClassDesc* FLuaPropertyAccessor::GetInstance(lua_State *L, int32 Index, void *&OutContainer)
+{
+    OutContainer = nullptr;
+    if (lua_type(L, Index) == LUA_TUSERDATA)
+    {
+        FClassDesc *ClassDesc = GetClassDescFromMetatable(L, Index);
+        if (ClassDesc && ClassDesc->IsScriptStruct())
+        {
+            OutContainer = GetCppInstanceFast(L, Index);
+            return OutContainer ? ClassDesc : nullptr;
+        }
+    }
+
+    UObject *Object = UnLua::GetUObject(L, Index);
+    if (!Object)
+    {
+        return nullptr;
+    }
+    OutContainer = Object;
+    return FindOrRegisterClass(L, Object->GetClass());
+}
+
+/**
+ * Resolve a type from a class table (UE.AActor), a UClass/UScriptStruct, an instance or a class name
+ * 解析类型，可以是类表(UE.AActor)、UClass/UScriptStruct、实例或者类名
+ */
+FClassDesc* FLuaPropertyAccessor::GetType(lua_State *L, int32 Index)
+{
+    if (lua_type(L, Index) == LUA_TSTRING)
+    {
+        return RegisterClass(L, lua_tostring(L, Index));
+    }
+
+    UObject *Object = UnLua::GetUObject(L, Index);
+    if (Object)
+    {
+        UStruct *Struct = Cast<UStruct>(Object);
+        return FindOrRegisterClass(L, Struct ? Struct : Object->GetClass());
+    }
+    return GetClassDescFromMetatable(L, Index);
+}
+
+FLuaPropertyAccessor::FPropertySet* FLuaPropertyAccessor::ToPropertySet(lua_State *L, int32 Index)
+{
+    return (FPropertySet*)luaL_testudata(L, Index, PropertySetMetatableName);
+}
+
+/**
+ * Check that the instance is a (sub)type of the type a set or a path is compiled for
+ * 检查实例是否是Set/Path编译时类型(或者它的子类)
+ */
+FClassDesc* FLuaPropertyAccessor::CheckClass(lua_State *L, void *ClassHandle, FClassDesc *InstanceClass)
+{
+    FClassDesc *ClassDesc = (FClassDesc*)GReflectionRegistry.FindDescByHandle(ClassHandle, DESC_CLASS);
+    if (!ClassDesc || !ClassDesc->IsValid())
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: The compiled class has been released!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return nullptr;
+    }
+    if (InstanceClass != ClassDesc && !InstanceClass->AsStruct()->IsChildOf(ClassDesc->AsStruct()))
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: %s is not a %s!"), ANSI_TO_TCHAR(__FUNCTION__), *InstanceClass->GetName(), *ClassDesc->GetName());
+        return nullptr;
+    }
+    return ClassDesc;
+}
+
+int32 FLuaPropertyAccessor::GetProperties(lua_State *L)
+{
+    const FPropertySet *Set = ToPropertySet(L, 2);
+    const int32 NumProperties = Set ? Set->NumProperties : FMath::Max(lua_gettop(L) - 1, 0);
+    luaL_checkstack(L, NumProperties, nullptr);
+
+    void *Container = nullptr;
+    FClassDesc *ClassDesc = GetInstance(L, 1, Container);
+    if (!ClassDesc)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid instance!"), ANSI_TO_TCHAR(__FUNCTION__));
+    }
+    else if (Set)
+    {
+        if (CheckClass(L, Set->ClassHandle, ClassDesc))
+        {
+            for (int32 i = 0; i < NumProperties; ++i)
+            {
+                FPropertyDesc *Property = (FPropertyDesc*)GReflectionRegistry.FindDescByHandleWithObjectCheck(Set->PropertyHandles[i], DESC_PROPERTY);
+                if (Property)
+                {
+                    Property->GetValue(L, Container, false);
+                }
+                else
+                {
+                    lua_pushnil(L);
+                }
+            }
+            return NumProperties;
+        }
+    }
+    else
+    {
+        for (int32 i = 2; i <= NumProperties + 1; ++i)
+        {
+            FPropertyDesc *Property = lua_type(L, i) == LUA_TSTRING ? FindProperty(ClassDesc, UnLua::GetFName(L, i)) : nullptr;
+            if (Property)
+            {
+                Property->GetValue(L, Container, false);
+            }
+            else
+            {
+                lua_pushnil(L);
+            }
+        }
+        return NumProperties;
+    }
+
+    for (int32 i = 0; i < NumProperties; ++i)
+    {
+        lua_pushnil(L);
+    }
+    return NumProperties;
+}
+
+int32 FLuaPropertyAccessor::SetProperties(lua_State *L)
+{
+    void *Container = nullptr;
+    FClassDesc *ClassDesc = GetInstance(L, 1, Container);
+    if (!ClassDesc)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid instance!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    const FPropertySet *Set = ToPropertySet(L, 2);
+    if (Set)
+    {
+        if (!CheckClass(L, Set->ClassHandle, ClassDesc))
+        {
+            return 0;
+        }
+        // 按位置写入，少传的值保持不变
+        const int32 NumValues = FMath::Min(lua_gettop(L) - 2, Set->NumProperties);
+        for (int32 i = 0; i < NumValues; ++i)
+        {
+            FPropertyDesc *Property = (FPropertyDesc*)GReflectionRegistry.FindDescByHandleWithObjectCheck(Set->PropertyHandles[i], DESC_PROPERTY);
+            if (Property)
+            {
+                SetValue(L, Property, Container, i + 3);
+            }
+        }
+        return 0;
+    }
+
+    if (lua_type(L, 2) != LUA_TTABLE)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid parameters!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+    SetFromTable(L, ClassDesc, Container, 2);
+    return 0;
+}
+
+int32 FLuaPropertyAccessor::CreatePropertySet(lua_State *L)
+{
+    FClassDesc *ClassDesc = GetType(L, 1);
+    if (!ClassDesc || !ClassDesc->IsValid())
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid type!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    const int32 NumProperties = FMath::Max(lua_gettop(L) - 1, 0);
+    FPropertySet *Set = (FPropertySet*)lua_newuserdatauv(L, sizeof(FPropertySet) + sizeof(void*) * FMath::Max(NumProperties - 1, 0), 0);
+    Set->ClassHandle = ClassDesc->GetHandle();
+    Set->NumProperties = NumProperties;
+    for (int32 i = 0; i < NumProperties; ++i)
+    {
+        FPropertyDesc *Property = lua_type(L, i + 2) == LUA_TSTRING ? FindProperty(ClassDesc, UnLua::GetFName(L, i + 2)) : nullptr;
+        if (!Property)
+        {
+            UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: %s has no property named %s!"), ANSI_TO_TCHAR(__FUNCTION__), *ClassDesc->GetName(), UTF8_TO_TCHAR(luaL_tolstring(L, i + 2, nullptr)));
+            lua_pop(L, 2);
+            return 0;
+        }
+        Set->PropertyHandles[i] = Property->GetHandle();
+    }
+    luaL_setmetatable(L, PropertySetMetatableName);
+    return 1;
+}
+
+int32 FLuaPropertyAccessor::PropertySet_Get(lua_State *L)
+{
+    // Set:Get(Instance) => UE.GetProperties(Instance, Set)
+    luaL_checkudata(L, 1, PropertySetMetatableName);
+    lua_settop(L, 2);
+    lua_insert(L, 1);
+    return GetProperties(L);
+}
+
+int32 FLuaPropertyAccessor::PropertySet_Set(lua_State *L)
+{
+    // Set:Set(Instance, ...) => UE.SetProperties(Instance, Set, ...)
+    luaL_checkudata(L, 1, PropertySetMetatableName);
+    lua_pushvalue(L, 2);
+    lua_pushvalue(L, 1);
+    lua_replace(L, 2);
+    lua_replace(L, 1);
+    return SetProperties(L);
+}
+
+int32 FLuaPropertyAccessor::PropertySet_Len(lua_State *L)
+{
+    const FPropertySet *Set = (FPropertySet*)luaL_checkudata(L, 1, PropertySetMetatableName);
+    lua_pushinteger(L, Set->NumProperties);
+    return 1;
+}
+
+int32 FLuaPropertyAccessor::CompilePath(lua_State *L)
+{
+    FClassDesc *ClassDesc = GetType(L, 1);
+    const char *PathString = lua_tostring(L, 2);
+    if (!ClassDesc || !ClassDesc->IsValid() || !PathString)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid parameters!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    TArray<FString> Names;
+    FString(UTF8_TO_TCHAR(PathString)).ParseIntoArray(Names, TEXT("."));
+    if (Names.Num() < 1)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Empty property path!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    FPropertyPath *Path = (FPropertyPath*)lua_newuserdatauv(L, sizeof(FPropertyPath) + sizeof(void*) * (Names.Num() - 1), 0);
+    Path->ClassHandle = ClassDesc->GetHandle();
+    Path->Offset = 0;
+    Path->NumProperties = Names.Num();
+
+    // 中间层必须是内联的结构体属性，偏移量可以直接累加，叶子节点可以是任意属性
+    FClassDesc *OuterClass = ClassDesc;
+    for (int32 i = 0; i < Names.Num(); ++i)
+    {
+        FPropertyDesc *Property = FindProperty(OuterClass, FName(*Names[i]));
+        if (!Property)
+        {
+            UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: %s has no property named %s!"), ANSI_TO_TCHAR(__FUNCTION__), *OuterClass->GetName(), *Names[i]);
+            lua_pop(L, 1);
+            return 0;
+        }
+        Path->PropertyHandles[i] = Property->GetHandle();
+
+        if (i < Names.Num() - 1)
+        {
+            FStructProperty *StructProperty = CastField<FStructProperty>(Property->GetProperty());
+            OuterClass = StructProperty && StructProperty->ArrayDim == 1 ? FindOrRegisterClass(L, StructProperty->Struct) : nullptr;
+            if (!OuterClass)
+            {
+                UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: %s in %s is not a struct!"), ANSI_TO_TCHAR(__FUNCTION__), *Names[i], UTF8_TO_TCHAR(PathString));
+                lua_pop(L, 1);
+                return 0;
+            }
+            Path->Offset += StructProperty->GetOffset_ForInternal();
+        }
+    }
+    luaL_setmetatable(L, PropertyPathMetatableName);
+    return 1;
+}
+
+/**
+ * Resolve the container of the leaf property of a path, only the root instance and the descriptors are checked
+ * 获取路径叶子属性所在容器的地址，只校验根实例和描述句柄
+ */
+FPropertyDesc* FLuaPropertyAccessor::ResolvePath(lua_State *L, const FPropertyPath *Path, int32 InstanceIndex, void *&OutContainer)
+{
+    void *Container = nullptr;
+    FClassDesc *ClassDesc = GetInstance(L, InstanceIndex, Container);
+    if (!ClassDesc)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid instance!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return nullptr;
+    }
+    if (!CheckClass(L, Path->ClassHandle, ClassDesc))
+    {
+        return nullptr;
+    }
+
+    // 任意一层的描述失效(比如蓝图结构体重新编译)，偏移量都不再可信
+    FPropertyDesc *Property = nullptr;
+    for (int32 i = 0; i < Path->NumProperties; ++i)
+    {
+        Property = (FPropertyDesc*)GReflectionRegistry.FindDescByHandleWithObjectCheck(Path->PropertyHandles[i], DESC_PROPERTY);
+        if (!Property)
+        {
+            UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: The property path has been released, compile it again!"), ANSI_TO_TCHAR(__FUNCTION__));
+            return nullptr;
+        }
+    }
+
+    OutContainer = (uint8*)Container + Path->Offset;
+    return Property;
+}
+
+int32 FLuaPropertyAccessor::PropertyPath_Get(lua_State *L)
+{
+    const FPropertyPath *Path = (FPropertyPath*)luaL_checkudata(L, 1, PropertyPathMetatableName);
+    void *Container = nullptr;
+    FPropertyDesc *Property = ResolvePath(L, Path, 2, Container);
+    if (Property)
+    {
+        Property->GetValue(L, Container, false);
+    }
+    else
+    {
+        lua_pushnil(L);
+    }
+    return 1;
+}
+
+int32 FLuaPropertyAccessor::PropertyPath_Set(lua_State *L)
+{
+    const FPropertyPath *Path = (FPropertyPath*)luaL_checkudata(L, 1, PropertyPathMetatableName);
+    void *Container = nullptr;
+    FPropertyDesc *Property = ResolvePath(L, Path, 2, Container);
+    if (Property)
+    {
+        SetValue(L, Property, Container, 3);
+    }
+    return 0;
+}
+
+/**
+ * Push a plain table with all properties of a struct, nested structs are converted to tables as well
+ * 结构体转成普通表，嵌套的结构体同样转成表，其他属性都是拷贝
+ */
+void FLuaPropertyAccessor::PushStructTable(lua_State *L, FClassDesc *ClassDesc, const void *Container)
+{
+    luaL_checkstack(L, 3, nullptr);
+    UStruct *Struct = ClassDesc->AsStruct();
+    lua_newtable(L);
+    for (TFieldIterator<FProperty> It(Struct); It; ++It)
+    {
+        FProperty *Property = *It;
+        FPropertyDesc *PropertyDesc = FindProperty(ClassDesc, Property->GetFName());
+        if (!PropertyDesc)
+        {
+            continue;
+        }
+
+        // 蓝图结构体的属性名带GUID后缀，使用编辑器里的名字，RegisterField也能识别
+        if (Struct->IsNative())
+        {
+            UnLua::PushFName(L, Property->GetFName());
+        }
+        else
+        {
+            UnLua::PushFString(L, Property->GetAuthoredName());
+        }
+
+        FStructProperty *StructProperty = CastField<FStructProperty>(Property);
+        FClassDesc *InnerClass = StructProperty && Property->ArrayDim == 1 ? FindOrRegisterClass(L, StructProperty->Struct) : nullptr;
+        if (InnerClass)
+        {
+            PushStructTable(L, InnerClass, StructProperty->ContainerPtrToValuePtr<void>(Container));
+        }
+        else
+        {
+            PropertyDesc->GetValue(L, Container, true);
+        }
+        lua_rawset(L, -3);
+    }
+}
+
+/**
+ * Write the fields of the table at the given index to properties with the same names, unknown keys are ignored
+ * 按名字把表中的字段写入属性，不认识的key忽略
+ */
+void FLuaPropertyAccessor::SetFromTable(lua_State *L, FClassDesc *ClassDesc, void *Container, int32 TableIndex)
+{
+    luaL_checkstack(L, 3, nullptr);
+    TableIndex = lua_absindex(L, TableIndex);
+    lua_pushnil(L);
+    while (lua_next(L, TableIndex) != 0)
+    {
+        FPropertyDesc *Property = lua_type(L, -2) == LUA_TSTRING ? FindProperty(ClassDesc, UnLua::GetFName(L, -2)) : nullptr;
+        if (Property)
+        {
+            SetValue(L, Property, Container, -1);
+        }
+        lua_pop(L, 1);
+    }
+}
+
+/**
+ * Set a property from the value at the given index, a plain table is accepted by struct properties
+ * 设置属性的值，结构体属性也可以直接给普通表
+ */
+void FLuaPropertyAccessor::SetValue(lua_State *L, FPropertyDesc *Property, void *Container, int32 IndexInStack)
+{
+    FStructProperty *StructProperty = CastField<FStructProperty>(Property->GetProperty());
+    if (StructProperty && StructProperty->ArrayDim == 1 && IsPlainTable(L, IndexInStack))
+    {
+        FClassDesc *InnerClass = FindOrRegisterClass(L, StructProperty->Struct);
+        if (InnerClass)
+        {
+            SetFromTable(L, InnerClass, StructProperty->ContainerPtrToValuePtr<void>(Container), IndexInStack);
+        }
+        return;
+    }
+    Property->SetValue(L, Container, IndexInStack, true);
+}
+
+int32 FLuaPropertyAccessor::StructToTable(lua_State *L)
+{
+    void *Container = nullptr;
+    FClassDesc *ClassDesc = lua_type(L, 1) == LUA_TUSERDATA ? GetInstance(L, 1, Container) : nullptr;
+    if (!ClassDesc || !ClassDesc->IsScriptStruct())
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid struct!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    PushStructTable(L, ClassDesc, Container);
+    return 1;
+}
+
+int32 FLuaPropertyAccessor::TableToStruct(lua_State *L)
+{
+    if (lua_type(L, 1) != LUA_TTABLE)
+    {
+        UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid parameters!"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 0;
+    }
+
+    // 传入结构体实例时原地写入
+    void *Container = nullptr;
+    FClassDesc *ClassDesc = lua_type(L, 2) == LUA_TUSERDATA ? GetInstance(L, 2, Container) : nullptr;
+    if (ClassDesc && ClassDesc->IsScriptStruct())
+    {
+        lua_settop(L, 2);
+    }
+    else
+    {
+        ClassDesc = GetType(L, 2);
+        UScriptStruct *ScriptStruct = ClassDesc ? ClassDesc->AsScriptStruct() : nullptr;
+        if (!ScriptStruct)
+        {
+            UNLUA_LOGERROR(L, LogUnLua, Log, TEXT("%s: Invalid struct type!"), ANSI_TO_TCHAR(__FUNCTION__));
+            return 0;
+        }
+        Container = NewUserdataWithPadding(L, ClassDesc->GetSize(), TCHAR_TO_UTF8(*ClassDesc->GetName()), ClassDesc->GetUserdataPadding());
+        ScriptStruct->InitializeStruct(Container);
+    }
+
+    SetFromTable(L, ClassDesc, Container, 1);
+    return 1;
+}
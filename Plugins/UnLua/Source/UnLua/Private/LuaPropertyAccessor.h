@@ -0,0 +1,90 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct lua_State;
+class FClassDesc;
+class FPropertyDesc;
+
+/**
+ * Bulk property access for UObjects and UScriptStructs
+ * UObject和UScriptStruct属性的批量读写
+ *
+ * UE.GetProperties(Instance, 'A', 'B', ...)       -- 返回多个值，只校验一次实例
+ * UE.SetProperties(Instance, {A = 1, B = 2})      -- 按名字写入，结构体属性可以直接给普通表
+ * local Set = UE.PropertySet(UE.AActor, 'A', 'B') -- 预先解析好属性，之后的调用不再查名字
+ * UE.GetProperties(Instance, Set) / Set:Get(Instance)
+ * UE.SetProperties(Instance, Set, 1, 2) / Set:Set(Instance, 1, 2)
+ * local Path = UE.CompilePath(UE.AActor, 'A.B.X')  -- 预先算好嵌套结构体属性的偏移，中间层不再创建userdata
+ * Path:Get(Instance) / Path:Set(Instance, 1)
+ * UE.StructToTable(Struct)                        -- 结构体转普通表，嵌套的结构体也转成表
+ * UE.TableToStruct(Table, UE.FVector | Struct)    -- 普通表转结构体，传入结构体实例时原地写入
+ */
+class FLuaPropertyAccessor
+{
+public:
+    // 注册到UE命名空间，创建Lua虚拟机时调用
+    static void Register(lua_State *L);
+
+    static int32 GetProperties(lua_State *L);
+    static int32 SetProperties(lua_State *L);
+    static int32 CreatePropertySet(lua_State *L);
+    static int32 CompilePath(lua_State *L);
+    static int32 StructToTable(lua_State *L);
+    static int32 TableToStruct(lua_State *L);
+
+private:
+    /**
+     * A precompiled property list, lives in a Lua full userdata. Descriptors are kept as handles, so a set
+     * outliving its class (unregistered, hot reloaded) reads nil instead of touching freed memory
+     * 预编译的属性列表，保存的是描述句柄，类被反注册后残留的Set只会读到nil
+     */
+    struct FPropertySet
+    {
+        void *ClassHandle;
+        int32 NumProperties;
+        void *PropertyHandles[1];
+    };
+
+    /**
+     * A precompiled chain of struct properties, the leaf lives at a fixed offset from the root instance
+     * 预编译的属性路径，中间层都是内联的结构体，叶子属性所在容器相对根实例的偏移是固定的
+     */
+    struct FPropertyPath
+    {
+        void *ClassHandle;
+        int32 Offset;                   // offset of the container of the leaf property
+        int32 NumProperties;
+        void *PropertyHandles[1];       // the chain, the last one is the leaf
+    };
+
+    static FClassDesc* GetInstance(lua_State *L, int32 Index, void *&OutContainer);
+    static FClassDesc* GetType(lua_State *L, int32 Index);
+    static FPropertySet* ToPropertySet(lua_State *L, int32 Index);
+    static FClassDesc* CheckClass(lua_State *L, void *ClassHandle, FClassDesc *InstanceClass);
+    static FPropertyDesc* ResolvePath(lua_State *L, const FPropertyPath *Path, int32 InstanceIndex, void *&OutContainer);
+
+    static void PushStructTable(lua_State *L, FClassDesc *ClassDesc, const void *Container);
+    static void SetFromTable(lua_State *L, FClassDesc *ClassDesc, void *Container, int32 TableIndex);
+    static void SetValue(lua_State *L, FPropertyDesc *Property, void *Container, int32 IndexInStack);
+
+    static int32 PropertySet_Get(lua_State *L);
+    static int32 PropertySet_Set(lua_State *L);
+    static int32 PropertySet_Len(lua_State *L);
+    static int32 PropertyPath_Get(lua_State *L);
+    static int32 PropertyPath_Set(lua_State *L);
+};
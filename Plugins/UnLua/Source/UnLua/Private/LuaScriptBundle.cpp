@@ -0,0 +1,243 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaScriptBundle.h"
+#include "LuaCore.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+IMappedFileHandle* FLuaScriptBundle::MappedFile = nullptr;
+IMappedFileRegion* FLuaScriptBundle::MappedRegion = nullptr;
+TArray<uint8> FLuaScriptBundle::FileData;
+const uint8* FLuaScriptBundle::Data = nullptr;
+int64 FLuaScriptBundle::DataSize = 0;
+const FLuaScriptBundle::FEntry* FLuaScriptBundle::Entries = nullptr;
+uint32 FLuaScriptBundle::NumEntries = 0;
+TSet<FString> FLuaScriptBundle::PatchedModules;
+
+namespace
+{
+    // feeds the whole chunk to 'lua_load' in one piece, without copying it
+    struct FChunkReader
+    {
+        const char *Chunk;
+        size_t ChunkSize;
+    };
+
+    static const char* ReadChunk(lua_State *L, void *UserData, size_t *Size)
+    {
+        FChunkReader *Reader = (FChunkReader*)UserData;
+        *Size = Reader->ChunkSize;
+        Reader->ChunkSize = 0;
+        return *Size > 0 ? Reader->Chunk : nullptr;
+    }
+}
+
+/**
+ * Map a script bundle into memory and validate its index
+ */
+bool FLuaScriptBundle::Mount(const FString &InPath)
+{
+    if (IsMounted())
+    {
+        return true;
+    }
+
+    FString Path = InPath;
+    if (Path.IsEmpty() && !FParse::Value(FCommandLine::Get(), TEXT("-LuaBundle="), Path))
+    {
+        // 编辑器里直接加载源码，避免旧的脚本包盖住正在修改的脚本
+        if (!FPlatformProperties::RequiresCookedData())
+        {
+            return false;
+        }
+        Path = FPaths::ProjectContentDir() / TEXT("ScriptBundle/Script.ulb");
+    }
+
+    IPlatformFile &PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    if (!PlatformFile.FileExists(*Path))
+    {
+        return false;
+    }
+
+    MappedFile = PlatformFile.OpenMapped(*Path);
+    MappedRegion = MappedFile ? MappedFile->MapRegion() : nullptr;
+    if (MappedRegion)
+    {
+        Data = MappedRegion->GetMappedPtr();
+        DataSize = MappedRegion->GetMappedSize();
+    }
+    else
+    {
+        // 平台不支持内存映射时整个读进来
+        delete MappedFile;
+        MappedFile = nullptr;
+        if (!FFileHelper::LoadFileToArray(FileData, *Path, FILEREAD_Silent))
+        {
+            return false;
+        }
+        Data = FileData.GetData();
+        DataSize = FileData.Num();
+    }
+
+    const FHeader *Header = (const FHeader*)Data;
+    bool bValid = DataSize >= (int64)sizeof(FHeader) && Header->Magic == Magic && Header->FormatVersion == FormatVersion
+        && Header->LuaVersion == LUA_VERSION_RELEASE_NUM && DataSize >= (int64)(sizeof(FHeader) + (uint64)Header->NumEntries * sizeof(FEntry));
+    if (bValid)
+    {
+        const FEntry *FirstEntry = (const FEntry*)(Data + sizeof(FHeader));
+        for (uint32 i = 0; i < Header->NumEntries && bValid; ++i)
+        {
+            const FEntry &Entry = FirstEntry[i];
+            bValid = (uint64)Entry.NameOffset + Entry.NameSize <= (uint64)DataSize && (uint64)Entry.DataOffset + Entry.DataSize <= (uint64)DataSize;
+        }
+    }
+    if (!bValid)
+    {
+        UE_LOG(LogUnLua, Warning, TEXT("%s: Invalid Lua script bundle %s!"), ANSI_TO_TCHAR(__FUNCTION__), *Path);
+        Unmount();
+        return false;
+    }
+
+    Entries = (const FEntry*)(Data + sizeof(FHeader));
+    NumEntries = Header->NumEntries;
+    ScanPatchedModules();
+    UE_LOG(LogUnLua, Log, TEXT("Mounted Lua script bundle %s, %u modules, %d patched"), *Path, NumEntries, PatchedModules.Num());
+    return true;
+}
+
+void FLuaScriptBundle::ScanPatchedModules()
+{
+    PatchedModules.Empty();
+    if (!IsMounted())
+    {
+        return;
+    }
+
+    const FString PatchDir = GetDownloadPathFromRelativePath(FString());
+    TArray<FString> Files;
+    IFileManager::Get().FindFilesRecursive(Files, *PatchDir, TEXT("*.lua"), true, false);
+    for (FString &File : Files)
+    {
+        // '.../Script/Weapon/BP_Rifle.lua' -> 'Weapon/BP_Rifle'
+        FPaths::NormalizeFilename(File);
+        FPaths::MakePathRelativeTo(File, *PatchDir);
+        PatchedModules.Add(FPaths::ChangeExtension(File, FString()));
+    }
+}
+
+void FLuaScriptBundle::Unmount()
+{
+    delete MappedRegion;
+    MappedRegion = nullptr;
+    delete MappedFile;
+    MappedFile = nullptr;
+    FileData.Empty();
+    PatchedModules.Empty();
+    Data = nullptr;
+    DataSize = 0;
+    Entries = nullptr;
+    NumEntries = 0;
+}
+
+/**
+ * Binary search the sorted index
+ */
+const FLuaScriptBundle::FEntry* FLuaScriptBundle::FindEntry(const char *Name, int32 NameSize)
+{
+    uint32 Low = 0, High = NumEntries;
+    while (Low < High)
+    {
+        const uint32 Mid = Low + (High - Low) / 2;
+        const FEntry &Entry = Entries[Mid];
+        const int32 Result = CompareNames((const char*)Data + Entry.NameOffset, Entry.NameSize, Name, NameSize);
+        if (Result == 0)
+        {
+            return &Entry;
+        }
+        if (Result < 0)
+        {
+            Low = Mid + 1;
+        }
+        else
+        {
+            High = Mid;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Searcher for 'require', loads a module from the mounted bundle
+ */
+int FLuaScriptBundle::LoadFromBundle(lua_State *L)
+{
+    if (!IsMounted())
+    {
+        return 0;
+    }
+
+    // 'Weapon.BP_Rifle' -> 'Weapon/BP_Rifle'
+    size_t NameSize = 0;
+    const char *ModuleName = lua_tolstring(L, 1, &NameSize);
+    char Name[1024];
+    if (!ModuleName || NameSize + sizeof(".lua") > sizeof(Name))
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < NameSize; ++i)
+    {
+        Name[i] = ModuleName[i] == '.' ? '/' : ModuleName[i];
+    }
+    Name[NameSize] = '\0';
+
+    const FEntry *Entry = FindEntry(Name, (int32)NameSize);
+    if (!Entry)
+    {
+        return 0;
+    }
+
+    // 热更新下载的脚本优先，交给后面的'LoadFromFileSystem'加载
+    if (PatchedModules.Num() > 0 && PatchedModules.Contains(UTF8_TO_TCHAR(Name)))
+    {
+        return 0;
+    }
+    FMemory::Memcpy(Name + NameSize, ".lua", sizeof(".lua"));  // chunk name, same as 'LoadFromFileSystem'
+
+    FChunkReader Reader = { (const char*)Data + Entry->DataOffset, Entry->DataSize };
+    TArray<uint8> Uncompressed;
+    if (Entry->Flags & EntryFlag_LZ4)
+    {
+        Uncompressed.SetNumUninitialized(Entry->RawSize);
+        if (!FCompression::UncompressMemory(NAME_LZ4, Uncompressed.GetData(), Entry->RawSize, Reader.Chunk, Entry->DataSize))
+        {
+            Uncompressed.Empty();                           // luaL_error doesn't return
+            return luaL_error(L, "failed to decompress '%s' from Lua script bundle", ModuleName);
+        }
+        Reader.Chunk = (const char*)Uncompressed.GetData();
+        Reader.ChunkSize = Entry->RawSize;
+    }
+
+    if (lua_load(L, ReadChunk, &Reader, Name, "b") != LUA_OK)
+    {
+        Uncompressed.Empty();
+        return luaL_error(L, "file loading from Lua script bundle error: %s", lua_tostring(L, -1));
+    }
+    return 1;
+}
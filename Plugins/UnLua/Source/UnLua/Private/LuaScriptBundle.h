@@ -0,0 +1,94 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct lua_State;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ * Read-only bundle of precompiled Lua scripts, built by 'UnLuaBundleCommandlet' at cook time
+ * 只读的Lua脚本包，打包时由'UnLuaBundleCommandlet'生成
+ *
+ * 布局：FHeader | FEntry[NumEntries](按模块名字节序排序) | 模块名 | 字节码(可选LZ4压缩)
+ * 运行时整个文件以内存映射的方式打开，require时二分查找索引，字节码直接从映射内存喂给lua_load，不访问文件系统。
+ * 热更新下载的模块在Mount时收集到内存里，优先从下载目录加载。
+ * 同一台机器上的多个进程映射同一个文件时共享物理页。
+ */
+class FLuaScriptBundle
+{
+public:
+    static constexpr uint32 Magic = 0x42534C55;             // 'ULSB'
+    static constexpr uint32 FormatVersion = 1;
+    static constexpr uint32 EntryFlag_LZ4 = 1;
+
+    struct FHeader
+    {
+        uint32 Magic;
+        uint32 FormatVersion;
+        uint32 LuaVersion;                  // LUA_VERSION_RELEASE_NUM of the compiler
+        uint32 NumEntries;
+    };
+
+    struct FEntry
+    {
+        uint32 NameOffset;                  // module name, e.g. 'Weapon/BP_Rifle', offsets are from the beginning of the file
+        uint32 NameSize;
+        uint32 DataOffset;
+        uint32 DataSize;                    // size stored in the bundle
+        uint32 RawSize;                     // size of the bytecode after decompression
+        uint32 Flags;
+    };
+
+    /**
+     * Map a bundle into memory, the default one is 'Content/ScriptBundle/Script.ulb' in cooked builds, or the one given by '-LuaBundle='
+     * 映射脚本包，cooked版本默认使用'Content/ScriptBundle/Script.ulb'，也可以通过'-LuaBundle='指定
+     */
+    static bool Mount(const FString &Path = FString());
+    static void Unmount();
+    static bool IsMounted() { return Entries != nullptr; }
+
+    /**
+     * Collect the modules patched in ProjectPersistentDownloadDir, the bundle leaves them to 'LoadFromFileSystem'.
+     * Done at Mount, call it again after new scripts are downloaded so 'require' never probes the file system
+     * 收集ProjectPersistentDownloadDir中热更新的模块，这些模块交给'LoadFromFileSystem'加载。
+     * Mount时收集一次，下载了新的脚本后需要再调用，require时不访问文件系统
+     */
+    static void ScanPatchedModules();
+
+    // package.searchers中的加载器
+    static int LoadFromBundle(lua_State *L);
+
+    // order of entries in the index, the bundle builder must sort with it too
+    static FORCEINLINE int32 CompareNames(const char *A, int32 SizeA, const char *B, int32 SizeB)
+    {
+        const int32 Result = FMemory::Memcmp(A, B, FMath::Min(SizeA, SizeB));
+        return Result != 0 ? Result : SizeA - SizeB;
+    }
+
+private:
+    static const FEntry* FindEntry(const char *Name, int32 NameSize);
+
+    static IMappedFileHandle *MappedFile;
+    static IMappedFileRegion *MappedRegion;
+    static TArray<uint8> FileData;          // used instead when the platform can't map files
+    static const uint8 *Data;
+    static int64 DataSize;
+    static const FEntry *Entries;
+    static uint32 NumEntries;
+    static TSet<FString> PatchedModules;    // 'Weapon/BP_Rifle'
+};
@@ -0,0 +1,107 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+
+#include "LuaStringConv.h"
+
+#if !PLATFORM_TCHAR_IS_4_BYTES
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+#include <arm_neon.h>
+#define UNLUA_STRING_CONV_NEON 1
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+#include <emmintrin.h>
+#define UNLUA_STRING_CONV_SSE2 1
+#endif
+#endif
+
+#ifndef UNLUA_STRING_CONV_NEON
+#define UNLUA_STRING_CONV_NEON 0
+#endif
+#ifndef UNLUA_STRING_CONV_SSE2
+#define UNLUA_STRING_CONV_SSE2 0
+#endif
+
+namespace UnLuaStringConv
+{
+    int32 NarrowAscii(const TCHAR *Src, int32 Len, ANSICHAR *Dst)
+    {
+        int32 i = 0;
+#if UNLUA_STRING_CONV_SSE2
+        const __m128i NonAsciiMask = _mm_set1_epi16((int16)0xFF80);
+        for (; i + 16 <= Len; i += 16)
+        {
+            const __m128i A = _mm_loadu_si128((const __m128i*)(Src + i));
+            const __m128i B = _mm_loadu_si128((const __m128i*)(Src + i + 8));
+            const __m128i NonAscii = _mm_and_si128(_mm_or_si128(A, B), NonAsciiMask);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(NonAscii, _mm_setzero_si128())) != 0xFFFF)
+            {
+                break;
+            }
+            _mm_storeu_si128((__m128i*)(Dst + i), _mm_packus_epi16(A, B));
+        }
+#elif UNLUA_STRING_CONV_NEON
+        for (; i + 16 <= Len; i += 16)
+        {
+            const uint16x8_t A = vld1q_u16((const uint16*)(Src + i));
+            const uint16x8_t B = vld1q_u16((const uint16*)(Src + i + 8));
+            const uint8x8_t NonAscii = vqmovn_u16(vshrq_n_u16(vorrq_u16(A, B), 7));
+            if (vget_lane_u64(vreinterpret_u64_u8(NonAscii), 0) != 0)
+            {
+                break;
+            }
+            vst1q_u8((uint8*)(Dst + i), vcombine_u8(vmovn_u16(A), vmovn_u16(B)));
+        }
+#endif
+        for (; i < Len && (uint32)Src[i] < 0x80; ++i)
+        {
+            Dst[i] = (ANSICHAR)Src[i];
+        }
+        return i;
+    }
+
+    int32 WidenAscii(const ANSICHAR *Src, int32 Len, TCHAR *Dst)
+    {
+        int32 i = 0;
+#if UNLUA_STRING_CONV_SSE2
+        const __m128i Zero = _mm_setzero_si128();
+        for (; i + 16 <= Len; i += 16)
+        {
+            const __m128i V = _mm_loadu_si128((const __m128i*)(Src + i));
+            if (_mm_movemask_epi8(V) != 0)
+            {
+                break;
+            }
+            _mm_storeu_si128((__m128i*)(Dst + i), _mm_unpacklo_epi8(V, Zero));
+            _mm_storeu_si128((__m128i*)(Dst + i + 8), _mm_unpackhi_epi8(V, Zero));
+        }
+#elif UNLUA_STRING_CONV_NEON
+        for (; i + 16 <= Len; i += 16)
+        {
+            const uint8x16_t V = vld1q_u8((const uint8*)(Src + i));
+            const uint8x8_t NonAscii = vshr_n_u8(vorr_u8(vget_low_u8(V), vget_high_u8(V)), 7);
+            if (vget_lane_u64(vreinterpret_u64_u8(NonAscii), 0) != 0)
+            {
+                break;
+            }
+            vst1q_u16((uint16*)(Dst + i), vmovl_u8(vget_low_u8(V)));
+            vst1q_u16((uint16*)(Dst + i + 8), vmovl_u8(vget_high_u8(V)));
+        }
+#endif
+        for (; i < Len && (uint8)Src[i] < 0x80; ++i)
+        {
+            Dst[i] = (TCHAR)Src[i];
+        }
+        return i;
+    }
+}
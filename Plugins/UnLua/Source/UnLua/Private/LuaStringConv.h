@@ -0,0 +1,40 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * ASCII kernels for FString <-> Lua string (UTF-8) conversions, vectorized with SSE2/NEON
+ * FString和Lua字符串(UTF-8)互转的ASCII快速路径，SSE2/NEON向量化
+ *
+ * 游戏里绝大部分字符串都是ASCII，按16个字符一组检测并直接窄化/宽化，遇到第一个非ASCII字符时停下，
+ * 剩余部分再走完整的UTF-8转换。
+ */
+namespace UnLuaStringConv
+{
+    /**
+     * Narrow the leading ASCII characters of Src into Dst (at least Len bytes), returns the number converted
+     * 把Src开头的ASCII字符窄化到Dst，返回转换的字符数，遇到非ASCII字符停止
+     */
+    int32 NarrowAscii(const TCHAR *Src, int32 Len, ANSICHAR *Dst);
+
+    /**
+     * Widen the leading ASCII bytes of Src into Dst (at least Len characters), returns the number converted
+     * 把Src开头的ASCII字节宽化到Dst，返回转换的字节数，遇到非ASCII字节停止
+     */
+    int32 WidenAscii(const ANSICHAR *Src, int32 Len, TCHAR *Dst);
+}
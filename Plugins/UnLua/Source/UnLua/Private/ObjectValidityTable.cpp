@@ -0,0 +1,251 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "ObjectValidityTable.h"
+#include "Misc/ScopeLock.h"
+
+static constexpr uint32 MinTableCapacity = 1 << 16;
+
+// 被删除的槽位标记，查找时跳过，插入时可复用
+static UObjectBase* const TombstoneObject = (UObjectBase*)(UPTRINT)1;
+
+FObjectValidityTable::FTable::FTable(uint32 InCapacity)
+    : Slots(new FSlot[InCapacity]), Mask(InCapacity - 1)
+{
+    check(FMath::IsPowerOfTwo(InCapacity));
+}
+
+FObjectValidityTable::FTable::~FTable()
+{
+    delete[] Slots;
+}
+
+FObjectValidityTable::FObjectValidityTable()
+    : Table(new FTable(MinTableCapacity)), Epoch(0), NumObjects(0), NumTombstones(0)
+{
+    NumReaders[0] = 0;
+    NumReaders[1] = 0;
+}
+
+FObjectValidityTable::~FObjectValidityTable()
+{
+    delete Table.Load();
+    for (const FRetiredTable &Retired : RetiredTables)
+    {
+        delete Retired.Table;
+    }
+}
+
+/**
+ * Record a newly created UObject
+ */
+void FObjectValidityTable::Add(const UObjectBase *InObject, int32 Index)
+{
+    UObjectBase *Object = const_cast<UObjectBase*>(InObject);
+    FScopeLock Lock(&WriterCS);
+
+    FTable *Current = Table.Load();
+    // 包含墓碑在内的负载超过3/4时重建
+    if ((uint64)(NumObjects + NumTombstones + 1) * 4 > (uint64)(Current->Mask + 1) * 3)
+    {
+        Rehash(FMath::RoundUpToPowerOfTwo(FMath::Max<uint32>((uint32)(NumObjects + 1) * 2, MinTableCapacity)));
+        Current = Table.Load();
+    }
+
+    FSlot *FreeSlot = nullptr;
+    for (uint32 i = HashPointer(Object) & Current->Mask, Probes = 0; Probes <= Current->Mask; i = (i + 1) & Current->Mask, ++Probes)
+    {
+        FSlot &Slot = Current->Slots[i];
+        UObjectBase *SlotObject = Slot.Object.Load(EMemoryOrder::Relaxed);
+        if (SlotObject == Object)
+        {
+            Slot.Index.Store(Index);
+            return;
+        }
+        if (SlotObject == TombstoneObject)
+        {
+            FreeSlot = FreeSlot ? FreeSlot : &Slot;
+        }
+        else if (!SlotObject)
+        {
+            FreeSlot = FreeSlot ? FreeSlot : &Slot;
+            break;
+        }
+    }
+
+    check(FreeSlot);
+    if (FreeSlot->Object.Load(EMemoryOrder::Relaxed) == TombstoneObject)
+    {
+        --NumTombstones;
+    }
+    // publish index before the key, so a reader matching the key never sees an index older than the slot's previous owner
+    FreeSlot->Index.Store(Index);
+    FreeSlot->Object.Store(Object);
+    ++NumObjects;
+}
+
+/**
+ * Forget a deleted UObject
+ */
+void FObjectValidityTable::Remove(const UObjectBase *Object)
+{
+    FScopeLock Lock(&WriterCS);
+
+    FTable *Current = Table.Load();
+    for (uint32 i = HashPointer(Object) & Current->Mask, Probes = 0; Probes <= Current->Mask; i = (i + 1) & Current->Mask, ++Probes)
+    {
+        FSlot &Slot = Current->Slots[i];
+        UObjectBase *SlotObject = Slot.Object.Load(EMemoryOrder::Relaxed);
+        if (SlotObject == Object)
+        {
+            // keep the stale index, readers validate it against GUObjectArray anyway
+            Slot.Object.Store(TombstoneObject);
+            --NumObjects;
+            ++NumTombstones;
+            return;
+        }
+        if (!SlotObject)
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * Lock free lookup, returns INDEX_NONE if the UObject is unknown
+ */
+int32 FObjectValidityTable::Find(const UObjectBase *Object) const
+{
+    // enter the current epoch, retry if it moved on before we were counted
+    uint32 ReaderEpoch;
+    for (;;)
+    {
+        ReaderEpoch = Epoch.Load();
+        NumReaders[ReaderEpoch & 1].IncrementExchange();
+        if (Epoch.Load() == ReaderEpoch)
+        {
+            break;
+        }
+        NumReaders[ReaderEpoch & 1].DecrementExchange();
+    }
+
+    int32 Result = INDEX_NONE;
+    const FTable *Current = Table.Load();
+    for (uint32 i = HashPointer(Object) & Current->Mask, Probes = 0; Probes <= Current->Mask; i = (i + 1) & Current->Mask, ++Probes)
+    {
+        const FSlot &Slot = Current->Slots[i];
+        const UObjectBase *SlotObject = Slot.Object.Load();
+        if (SlotObject == Object)
+        {
+            Result = Slot.Index.Load();
+            break;
+        }
+        if (!SlotObject)
+        {
+            break;
+        }
+    }
+
+    NumReaders[ReaderEpoch & 1].DecrementExchange();
+    return Result;
+}
+
+void FObjectValidityTable::Empty()
+{
+    FScopeLock Lock(&WriterCS);
+
+    // a reader may still be probing the old table, it is released once its epoch is over like in 'Rehash'
+    Retire(Table.Exchange(new FTable(MinTableCapacity)));
+    NumObjects = 0;
+    NumTombstones = 0;
+}
+
+/**
+ * Release the replaced tables that no reader can be probing anymore, the others are kept for a later call
+ */
+void FObjectValidityTable::ReclaimRetiredTables()
+{
+    FScopeLock Lock(&WriterCS);
+    ReclaimRetiredTablesLocked();
+}
+
+/**
+ * Must be called with 'WriterCS' held. A reader entering in epoch E loads 'Table' after the epoch became E, so a table
+ * replaced in epoch R can only be seen by readers of epochs <= R. The epoch advances from E to E + 1 only when no reader
+ * of E - 1 (same parity as E + 1) is left, so once the epoch is R + 2 every reader that could see the table is gone.
+ * 在epoch R被替换的表只可能被epoch <= R的读者看到；epoch前进到R + 2时这些读者都已经离开，可以释放
+ */
+void FObjectValidityTable::ReclaimRetiredTablesLocked()
+{
+    for (int32 Step = 0; Step < 2 && RetiredTables.Num() > 0; ++Step)
+    {
+        const uint32 Current = Epoch.Load();
+        if (NumReaders[(Current + 1) & 1].Load() != 0)
+        {
+            break;                      // readers of the previous epoch are still probing, try again later
+        }
+        const uint32 Next = Current + 1;
+        Epoch.Store(Next);
+
+        RetiredTables.RemoveAll([Next](const FRetiredTable &Retired)
+        {
+            if (Next - Retired.Epoch >= 2)
+            {
+                delete Retired.Table;
+                return true;
+            }
+            return false;
+        });
+    }
+}
+
+void FObjectValidityTable::Retire(FTable *OldTable)
+{
+    RetiredTables.Add({ OldTable, Epoch.Load() });
+}
+
+void FObjectValidityTable::InsertNoGrow(FTable *InTable, UObjectBase *Object, int32 Index)
+{
+    uint32 i = HashPointer(Object) & InTable->Mask;
+    while (InTable->Slots[i].Object.Load(EMemoryOrder::Relaxed))
+    {
+        i = (i + 1) & InTable->Mask;
+    }
+    InTable->Slots[i].Index.Store(Index, EMemoryOrder::Relaxed);
+    InTable->Slots[i].Object.Store(Object, EMemoryOrder::Relaxed);
+}
+
+/**
+ * Rebuild the table without tombstones, must be called with 'WriterCS' held
+ * 重建表，丢弃墓碑。旧表不立即释放，正在无锁查找的读者还可能在访问它
+ */
+void FObjectValidityTable::Rehash(uint32 NewCapacity)
+{
+    FTable *OldTable = Table.Load();
+    FTable *NewTable = new FTable(NewCapacity);
+    for (uint32 i = 0; i <= OldTable->Mask; ++i)
+    {
+        UObjectBase *Object = OldTable->Slots[i].Object.Load(EMemoryOrder::Relaxed);
+        if (Object && Object != TombstoneObject)
+        {
+            InsertNoGrow(NewTable, Object, OldTable->Slots[i].Index.Load(EMemoryOrder::Relaxed));
+        }
+    }
+    Table.Store(NewTable);      // publish the fully built table
+    NumTombstones = 0;
+
+    // a reader may be anywhere inside the old table, it is released once its epoch is over, see 'ReclaimRetiredTablesLocked'
+    Retire(OldTable);
+    ReclaimRetiredTablesLocked();
+}
@@ -0,0 +1,102 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Atomic.h"
+#include "HAL/CriticalSection.h"
+
+class UObjectBase;
+
+/**
+ * UObject pointer -> index in GUObjectArray
+ * 记录所有存活UObject的指针和它在GUObjectArray中的下标，用于判断Object的有效性
+ *
+ * 开放寻址(线性探测)的哈希表，槽位都是原子变量：
+ * 读(Find)不加锁，写(Add/Remove)之间用一个只给写者用的锁串行化，读者永远不会被写者阻塞。
+ * 查到的下标还要再和GUObjectArray比对，所以读到瞬时的旧数据也只会返回无效，不会误判为有效。
+ * 读者不只有游戏线程(异步加载线程创建对象时也会检查有效性)，扩容后的旧表按epoch回收：读者进入时登记在当前epoch的计数上，
+ * 旧表记下被替换时的epoch，等该epoch及之前的读者全部离开后才释放，不需要调用者保证静止点。
+ */
+class UNLUA_API FObjectValidityTable
+{
+public:
+    FObjectValidityTable();
+    ~FObjectValidityTable();
+
+    // 记录一个新创建的UObject
+    void Add(const UObjectBase *Object, int32 Index);
+    // 移除一个被删除的UObject
+    void Remove(const UObjectBase *Object);
+    // 查找UObject在GUObjectArray中的下标，无锁
+    int32 Find(const UObjectBase *Object) const;
+    // 清空
+    void Empty();
+    // 释放被替换下来、已经没有读者的旧表，还有读者的留到下次调用，任何时候都可以调用
+    void ReclaimRetiredTables();
+
+    // 当前记录的UObject数量
+    FORCEINLINE int32 Num() const { return NumObjects; }
+
+private:
+    struct FSlot
+    {
+        FSlot() : Object(nullptr), Index(INDEX_NONE) {}
+
+        TAtomic<UObjectBase*> Object;
+        TAtomic<int32> Index;
+    };
+
+    struct FTable
+    {
+        explicit FTable(uint32 InCapacity);
+        ~FTable();
+
+        FSlot *Slots;
+        uint32 Mask;
+    };
+
+    static FORCEINLINE uint32 HashPointer(const UObjectBase *Object)
+    {
+        // UObject至少16字节对齐，低位没有信息，用64位混淆函数打散
+        uint64 Key = (uint64)(UPTRINT)Object;
+        Key ^= Key >> 33;
+        Key *= 0xff51afd7ed558ccdull;
+        Key ^= Key >> 33;
+        return (uint32)Key;
+    }
+
+    struct FRetiredTable
+    {
+        FTable *Table;
+        uint32 Epoch;                   // epoch when it was replaced
+    };
+
+    static void InsertNoGrow(FTable *Table, UObjectBase *Object, int32 Index);
+    void Rehash(uint32 NewCapacity);
+    void Retire(FTable *OldTable);
+    void ReclaimRetiredTablesLocked();
+
+    TAtomic<FTable*> Table;
+    TArray<FRetiredTable> RetiredTables;    // tables replaced by 'Rehash'/'Empty', kept alive while readers of their epoch may still be probing them
+
+    TAtomic<uint32> Epoch;
+    mutable TAtomic<int32> NumReaders[2];   // readers inside 'Find', by the parity of the epoch they entered in
+
+    int32 NumObjects;
+    int32 NumTombstones;
+
+    FCriticalSection WriterCS;          // serializes writers only, readers never take it
+};
@@ -27,9 +27,9 @@
  * Class descriptor constructor
  */
 FClassDesc::FClassDesc(UStruct *InStruct, const FString &InName, EType InType)
-    : Struct(InStruct), ClassName(InName), Type(InType), UserdataPadding(0), Size(0), RefCount(0), Locked(false),FunctionCollection(nullptr)
+    : Struct(InStruct), ClassName(InName), Type(InType), UserdataPadding(0), Size(0), RefCount(0), Locked(false), Handle(nullptr), MetatableRef(LUA_NOREF), StructIndex(GUObjectArray.ObjectToIndex(InStruct)), FunctionCollection(nullptr)
 {   
-	GReflectionRegistry.AddToDescSet(this, DESC_CLASS);
+    Handle = GReflectionRegistry.AddToDescSet(this, DESC_CLASS);
 
     if (InType == EType::CLASS)
     {
@@ -81,6 +81,11 @@ FClassDesc::~FClassDesc()
 
     // remove lua side class tables
     // 移除Lua侧表
+    lua_State *L = *GLuaCxt;
+    if (L && MetatableRef != LUA_NOREF)
+    {
+        luaL_unref(L, LUA_REGISTRYINDEX, MetatableRef);
+    }
     FTCHARToUTF8 Utf8ClassName(*ClassName);
     // 清理关联的Lua元表
     ClearLibrary(*GLuaCxt, Utf8ClassName.Get());            // clean up related Lua meta table
@@ -112,57 +117,80 @@ FClassDesc::~FClassDesc()
     Functions.Empty();
 }
 
-void FClassDesc::AddRef()
-{   
-    TArray<FClassDesc*> DescChain;
-    GetInheritanceChain(DescChain);
+/**
+ * Build the inheritance chain on first use, returns false if the UStruct is gone
+ */
+bool FClassDesc::UpdateInheritanceChain()
+{
+    if (!GLuaCxt->IsUObjectValid(Struct))
+    {
+        return false;
+    }
 
-    // 新增自身
-    DescChain.Insert(this, 0);   // add self
-    for (int i = 0; i < DescChain.Num(); ++i)
+    if (NameChain.Num() <= 0)
     {
-        DescChain[i]->RefCount++;
+        UStruct* SuperStruct = Struct->GetInheritanceSuper();
+        while (SuperStruct)
+        {
+            FString Name = FString::Printf(TEXT("%s%s"), SuperStruct->GetPrefixCPP(), *SuperStruct->GetName());
+            NameChain.Add(Name);
+            StructChain.Add(SuperStruct);
+            SuperStruct = SuperStruct->GetInheritanceSuper();
+        }
     }
+    return true;
 }
 
-void FClassDesc::SubRef()
-{ 
-    TArray<FClassDesc*> DescChain;
-    GetInheritanceChain(DescChain);
-
-    // 新增自身
-    DescChain.Insert(this, 0);   // add self
-    for (int i = 0; i < DescChain.Num(); ++i)
+/**
+ * Call Func for the descriptor of each super class. Super classes are looked up by UStruct, the class name
+ * is only used if the super class isn't in the registry's struct cache (or this UStruct is gone)
+ * 遍历父类描述，先按UStruct查找，AddRef/SubRef在每次push对象时都会调用，不能每次都按类名查找
+ */
+template <typename FuncType>
+void FClassDesc::ForEachSuperClass(FuncType Func)
+{
+    const bool bStructValid = UpdateInheritanceChain();
+    for (int32 i = 0; i < NameChain.Num(); ++i)
     {
-        DescChain[i]->RefCount--;
+        FClassDesc* ClassDesc = bStructValid ? GReflectionRegistry.FindClassByStruct(StructChain[i]) : nullptr;
+        if (!ClassDesc)
+        {
+            ClassDesc = GReflectionRegistry.FindClass(TCHAR_TO_UTF8(*NameChain[i]));
+        }
+        if (ClassDesc)
+        {
+            Func(ClassDesc);
+        }
+        else
+        {
+            UE_LOG(LogUnLua,Warning,TEXT("GetInheritanceChain : ClassDesc %s in inheritance chain %s not found"), *NameChain[i],*GetName());
+        }
     }
 }
 
+void FClassDesc::AddRef()
+{   
+    ++RefCount;
+    ForEachSuperClass([](FClassDesc *SuperClass) { ++SuperClass->RefCount; });
+}
+
+void FClassDesc::SubRef()
+{ 
+    --RefCount;
+    ForEachSuperClass([](FClassDesc *SuperClass) { --SuperClass->RefCount; });
+}
+
 
 void FClassDesc::AddLock()
 {
-    TArray<FClassDesc*> DescChain;
-    GetInheritanceChain(DescChain);
-
-    // 新增自身
-    DescChain.Insert(this, 0);   // add self
-    for (int i = 0; i < DescChain.Num(); ++i)
-    {
-        DescChain[i]->Locked = true;
-    }
+    Locked = true;
+    ForEachSuperClass([](FClassDesc *SuperClass) { SuperClass->Locked = true; });
 }
 
 void FClassDesc::ReleaseLock()
 {
-    TArray<FClassDesc*> DescChain;
-    GetInheritanceChain(DescChain);
-
-    // 新增自身
-    DescChain.Insert(this, 0);   // add self
-    for (int i = 0; i < DescChain.Num(); ++i)
-    {
-        DescChain[i]->Locked = false;
-    }
+    Locked = false;
+    ForEachSuperClass([](FClassDesc *SuperClass) { SuperClass->Locked = false; });
 }
 
 bool FClassDesc::IsLocked()
@@ -286,20 +314,8 @@ void FClassDesc::GetInheritanceChain(TArray<FString> &InNameChain, TArray<UStruc
     InNameChain.Empty();
     InStructChain.Empty();
 
-    if (GLuaCxt->IsUObjectValid(Struct))
+    if (UpdateInheritanceChain())
     {   
-        if (NameChain.Num() <= 0)
-        {
-            UStruct* SuperStruct = Struct->GetInheritanceSuper();
-            while (SuperStruct)
-            {
-                FString Name = FString::Printf(TEXT("%s%s"), SuperStruct->GetPrefixCPP(), *SuperStruct->GetName());
-                NameChain.Add(Name);
-                StructChain.Add(SuperStruct);
-                SuperStruct = SuperStruct->GetInheritanceSuper();
-            }
-        }
-
         InNameChain = NameChain;
         InStructChain = StructChain;
     }
@@ -307,22 +323,7 @@ void FClassDesc::GetInheritanceChain(TArray<FString> &InNameChain, TArray<UStruc
 
 void FClassDesc::GetInheritanceChain(TArray<FClassDesc*>& DescChain)
 {
-    TArray<FString> InNameChain;
-    TArray<UStruct*> InStructChain;
-    GetInheritanceChain(InNameChain, InStructChain);
-
-    for (int i = 0; i < NameChain.Num(); ++i)
-    {
-        FClassDesc* ClassDesc = GReflectionRegistry.FindClass(TCHAR_TO_UTF8(*NameChain[i]));
-        if (ClassDesc)
-        {
-            DescChain.Add(ClassDesc);
-        }
-        else
-        {
-            UE_LOG(LogUnLua,Warning,TEXT("GetInheritanceChain : ClassDesc %s in inheritance chain %s not found"), *NameChain[i],*GetName());
-        }
-    }
+    ForEachSuperClass([&DescChain](FClassDesc *SuperClass) { DescChain.Add(SuperClass); });
 }
 
 FClassDesc::EType FClassDesc::GetType(UStruct* InStruct)
@@ -69,6 +69,14 @@ public:
 
     FORCEINLINE int32 GetRefCount() const { return RefCount; }
 
+    // 描述句柄，Lua侧持有的是句柄而不是裸指针
+    FORCEINLINE void* GetHandle() const { return Handle; }
+
+    // 元表在注册表里的引用，第一次按名字设置元表时缓存，之后push对象不需要再按名字查找
+    FORCEINLINE int32 GetMetatableRef() const { return MetatableRef; }
+
+    FORCEINLINE void SetMetatableRef(int32 InMetatableRef) { MetatableRef = InMetatableRef; }
+
     FORCEINLINE FPropertyDesc* GetProperty(int32 Index) { return Index > INDEX_NONE && Index < Properties.Num() ? Properties[Index] : nullptr; }
 
     FORCEINLINE FFunctionDesc* GetFunction(int32 Index) { return Index > INDEX_NONE && Index < Functions.Num() ? Functions[Index] : nullptr; }
@@ -101,6 +109,11 @@ public:
     static EType GetType(UStruct* InStruct);
 
 private:
+    bool UpdateInheritanceChain();
+
+    template <typename FuncType>
+    void ForEachSuperClass(FuncType Func);
+
     union
     {
         UStruct *Struct;
@@ -116,6 +129,10 @@ private:
     int32 RefCount;
     bool  Locked;
 
+    void *Handle;
+    int32 MetatableRef;
+    int32 StructIndex;                    // internal index of the UStruct, key of the registry's struct cache
+
     //FClassDesc *Parent;
     // 接口
     TArray<FClassDesc*> Interfaces;
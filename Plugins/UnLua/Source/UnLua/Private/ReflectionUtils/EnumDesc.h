@@ -49,6 +49,12 @@ public:
         return (Func[(int32)Type])(Enum, FName(EntryName));
     }
 
+    FORCEINLINE int64 GetValue(FName EntryName) const
+    {
+        static int64 (*Func[2])(UEnum*, FName) = { FEnumDesc::GetEnumValue, FEnumDesc::GetUserDefinedEnumValue };
+        return (Func[(int32)Type])(Enum, EntryName);
+    }
+
     // 获取Enum
     FORCEINLINE UEnum* GetEnum() const { return Enum; }
 
@@ -21,15 +21,18 @@
 #include "DefaultParamCollection.h"
 #include "UnLua.h"
 #include "UnLuaLatentAction.h"
+#include "Misc/MemStack.h"
 
 /**
  * Function descriptor constructor
  */
 FFunctionDesc::FFunctionDesc(UFunction *InFunction, FParameterCollection *InDefaultParams, int32 InFunctionRef)
-    : Function(InFunction), DefaultParams(InDefaultParams), ReturnPropertyIndex(INDEX_NONE), LatentPropertyIndex(INDEX_NONE)
-    , FunctionRef(InFunctionRef), NumRefProperties(0), NumCalls(0), bStaticFunc(false), bInterfaceFunc(false)
+    : Function(InFunction), Handle(nullptr), DefaultParams(InDefaultParams), ReturnPropertyIndex(INDEX_NONE), LatentPropertyIndex(INDEX_NONE)
+    , DispatchCacheEpoch(0), FunctionRef(InFunctionRef), NumRefProperties(0), NumCalls(0), NextDispatchCacheEntry(0), bStaticFunc(false), bInterfaceFunc(false)
 {
-	GReflectionRegistry.AddToDescSet(this, DESC_FUNCTION);
+    FMemory::Memzero(DispatchCache);
+
+    Handle = GReflectionRegistry.AddToDescSet(this, DESC_FUNCTION);
 
     check(InFunction);
 
@@ -45,6 +48,11 @@ FFunctionDesc::FFunctionDesc(UFunction *InFunction, FParameterCollection *InDefa
         bInterfaceFunc = true;                                          // a function in interface?
     }
 
+    // GetFunctionCallspace of engine classes depends on net mode and role only for net/authority only/cosmetic functions,
+    // callspace of other functions can be cached per UClass
+    // 非网络、非AuthorityOnly、非Cosmetic的方法，callspace只和UClass有关，可以缓存
+    bCacheableCallspace = !InFunction->HasAnyFunctionFlags(FUNC_Net | FUNC_BlueprintAuthorityOnly | FUNC_BlueprintCosmetic);
+
     bHasDelegateParams = false;
     // create persistent parameter buffer. memory for speed
     // 创建持久化参数缓冲区
@@ -220,6 +228,7 @@ bool FFunctionDesc::CallLua(UObject *Context, FFrame &Stack, void *RetValueAddre
     {
         if (bUnpackParams)
         {
+            FMemMark Mark(FMemStack::Get());
             void* Params = nullptr;
 #if ENABLE_PERSISTENT_PARAM_BUFFER
             if (!bHasDelegateParams)
@@ -227,9 +236,9 @@ bool FFunctionDesc::CallLua(UObject *Context, FFrame &Stack, void *RetValueAddre
                 Params = Buffer;
             }
 #endif      
-            if (!Params)
+            if (!Params && Function->ParmsSize > 0)
             {
-                Params = Function->ParmsSize > 0 ? FMemory::Malloc(Function->ParmsSize, 16) : nullptr;
+                Params = New<uint8>(FMemStack::Get(), Function->ParmsSize, 16);
             }
 
             // 填充参数
@@ -241,15 +250,6 @@ bool FFunctionDesc::CallLua(UObject *Context, FFrame &Stack, void *RetValueAddre
             Stack.SkipCode(1);          // skip EX_EndFunctionParms
 
             bSuccess = CallLuaInternal(L, Params, Stack.OutParms, RetValueAddress);             // call Lua function...
-
-            if (Params)
-            {
-#if ENABLE_PERSISTENT_PARAM_BUFFER
-                if (bHasDelegateParams)
-#endif
-                FMemory::Free(Params);
-            }
-
         }
         else
         {
@@ -296,66 +296,33 @@ int32 FFunctionDesc::CallUE(lua_State *L, int32 NumParams, void *Userdata)
         return 0;
     }
 
-#if SUPPORTS_RPC_CALL
-    int32 Callspace = Object->GetFunctionCallspace(Function, nullptr);
-    bool bRemote = Callspace & FunctionCallspace::Remote;
-    bool bLocal = Callspace & FunctionCallspace::Local;
-#else
-    bool bRemote = false;
-    bool bLocal = true;
-#endif
-
-    // 创建一个以Function 参数个数(包含返回类型)为长度的bool数组，用作后续清除标记
-    TArray<bool> CleanupFlags;
-    CleanupFlags.AddZeroed(Properties.Num());
-    // 准备参数值
-    void *Params = PreCall(L, NumParams, FirstParamIndex, CleanupFlags, Userdata);      // prepare values of properties
-
     // 记录调用的Function到FinalFunction中
-    UFunction *FinalFunction = Function;
     // 如果Function是接口或有重写的情况，会去找相应更准确的函数赋值给FinalFunction
-    if (bInterfaceFunc)
+    UFunction *FinalFunction = nullptr;
+    int32 Callspace = FunctionCallspace::Local;
+    if (!ResolveDispatch(Object, FinalFunction, Callspace))
     {
-        // get target UFunction if it's a function in Interface
-        FName FunctionName = Function->GetFName();
-        FinalFunction = Object->GetClass()->FindFunctionByName(FunctionName);
-        if (!FinalFunction)
-        {
-            UNLUA_LOGERROR(L, LogUnLua, Error, TEXT("ERROR! Can't find UFunction '%s' in target object!"), *FuncName);
-
-            if (Params)
-            {
-#if ENABLE_PERSISTENT_PARAM_BUFFER
-                if (NumCalls > 0 || bHasDelegateParams)
-#endif	
-                    FMemory::Free(Params);
-            }
-
-            return 0;
-        }
-#if UE_BUILD_DEBUG
-        else if (FinalFunction != Function)
-        {
-            // todo: 'FinalFunction' must have the same signature with 'Function', check more parameters here
-            check(FinalFunction->NumParms == Function->NumParms && FinalFunction->ParmsSize == Function->ParmsSize && FinalFunction->ReturnValueOffset == Function->ReturnValueOffset);
-        }
-#endif
+        UNLUA_LOGERROR(L, LogUnLua, Error, TEXT("ERROR! Can't find UFunction '%s' in target object!"), *FuncName);
+        return 0;
     }
-#if ENABLE_CALL_OVERRIDDEN_FUNCTION
-    {   
-        // 被Lua覆盖的方法
-        if (IsOverridable(Function) 
-            && !Function->HasAnyFunctionFlags(FUNC_Net))
-        {
-            UFunction *OverriddenFunc = GReflectionRegistry.FindOverriddenFunction(Function);
-            if (OverriddenFunc)
-            {
-                FinalFunction = OverriddenFunc;
-            }
-        }
+#if UE_BUILD_DEBUG
+    if (bInterfaceFunc && FinalFunction != Function)
+    {
+        // todo: 'FinalFunction' must have the same signature with 'Function', check more parameters here
+        check(FinalFunction->NumParms == Function->NumParms && FinalFunction->ParmsSize == Function->ParmsSize && FinalFunction->ReturnValueOffset == Function->ReturnValueOffset);
     }
 #endif
 
+    bool bRemote = Callspace & FunctionCallspace::Remote;
+    bool bLocal = Callspace & FunctionCallspace::Local;
+
+    // 创建一个以Function 参数个数(包含返回类型)为长度的位数组，用作后续清除标记
+    FCleanupFlags CleanupFlags(false, Properties.Num());
+    // 递归调用的参数帧从FMemStack分配，函数返回时整体弹出
+    FMemMark Mark(FMemStack::Get());
+    // 准备参数值
+    void *Params = PreCall(L, NumParams, FirstParamIndex, CleanupFlags, Userdata);      // prepare values of properties
+
     // call the UFuncton...
 #if !SUPPORTS_RPC_CALL
     if (FinalFunction == Function && FinalFunction->HasAnyFunctionFlags(FUNC_Native) && NumCalls == 1)
@@ -388,6 +355,75 @@ int32 FFunctionDesc::CallUE(lua_State *L, int32 NumParams, void *Userdata)
     return NumReturnValues;
 }
 
+/**
+ * Resolve the UFunction to call and its callspace for the target object
+ */
+bool FFunctionDesc::ResolveDispatch(UObject *Object, UFunction *&OutFinalFunction, int32 &OutCallspace)
+{
+    const uint32 Epoch = GReflectionRegistry.GetDispatchEpoch();
+    if (DispatchCacheEpoch != Epoch)
+    {
+        FMemory::Memzero(DispatchCache);
+        DispatchCacheEpoch = Epoch;
+        NextDispatchCacheEntry = 0;
+    }
+
+    UClass *Class = Object->GetClass();
+    const FDispatchCacheEntry *CachedEntry = nullptr;
+    for (const FDispatchCacheEntry &Entry : DispatchCache)
+    {
+        if (Entry.Class == Class)
+        {
+            CachedEntry = &Entry;
+            break;
+        }
+    }
+
+    if (!CachedEntry)
+    {
+        UFunction *FinalFunction = Function;
+        if (bInterfaceFunc)
+        {
+            // get target UFunction if it's a function in Interface
+            FinalFunction = Class->FindFunctionByName(Function->GetFName());
+            if (!FinalFunction)
+            {
+                return false;
+            }
+        }
+#if ENABLE_CALL_OVERRIDDEN_FUNCTION
+        // 被Lua覆盖的方法
+        if (IsOverridable(Function) && !Function->HasAnyFunctionFlags(FUNC_Net))
+        {
+            UFunction *OverriddenFunc = GReflectionRegistry.FindOverriddenFunction(Function);
+            if (OverriddenFunc)
+            {
+                FinalFunction = OverriddenFunc;
+            }
+        }
+#endif
+
+        FDispatchCacheEntry &NewEntry = DispatchCache[NextDispatchCacheEntry];
+        NextDispatchCacheEntry = (NextDispatchCacheEntry + 1) % NumDispatchCacheEntries;    // round robin replacement
+        NewEntry.Class = Class;
+        NewEntry.FinalFunction = FinalFunction;
+#if SUPPORTS_RPC_CALL
+        NewEntry.Callspace = bCacheableCallspace ? Object->GetFunctionCallspace(Function, nullptr) : FunctionCallspace::Local;
+#else
+        NewEntry.Callspace = FunctionCallspace::Local;
+#endif
+        CachedEntry = &NewEntry;
+    }
+
+    OutFinalFunction = CachedEntry->FinalFunction;
+#if SUPPORTS_RPC_CALL
+    OutCallspace = bCacheableCallspace ? CachedEntry->Callspace : Object->GetFunctionCallspace(Function, nullptr);
+#else
+    OutCallspace = FunctionCallspace::Local;
+#endif
+    return true;
+}
+
 /**
  * Fire a delegate
  * 提供参数和获取返回值给lua
@@ -399,8 +435,8 @@ int32 FFunctionDesc::ExecuteDelegate(lua_State *L, int32 NumParams, int32 FirstP
         return 0;
     }
 
-    TArray<bool> CleanupFlags;
-    CleanupFlags.AddZeroed(Properties.Num());
+    FCleanupFlags CleanupFlags(false, Properties.Num());
+    FMemMark Mark(FMemStack::Get());
     // 向Params填充参数，参数来自lua栈
     void *Params = PreCall(L, NumParams, FirstParamIndex, CleanupFlags);
     // 执行关联的回调函数
@@ -420,8 +456,8 @@ void FFunctionDesc::BroadcastMulticastDelegate(lua_State *L, int32 NumParams, in
         return;
     }
 
-    TArray<bool> CleanupFlags;
-    CleanupFlags.AddZeroed(Properties.Num());
+    FCleanupFlags CleanupFlags(false, Properties.Num());
+    FMemMark Mark(FMemStack::Get());
     void *Params = PreCall(L, NumParams, FirstParamIndex, CleanupFlags);
     ScriptDelegate->ProcessMulticastDelegate<UObject>(Params);
     // 多播没有返回值
@@ -432,11 +468,10 @@ void FFunctionDesc::BroadcastMulticastDelegate(lua_State *L, int32 NumParams, in
  * Prepare values of properties for the UFunction
  * 主要是把传入的Lua参数转换成C++对象，放入Params缓存区中，然后返回这个缓存区
  */
-void* FFunctionDesc::PreCall(lua_State *L, int32 NumParams, int32 FirstParamIndex, TArray<bool> &CleanupFlags, void *Userdata)
+void* FFunctionDesc::PreCall(lua_State *L, int32 NumParams, int32 FirstParamIndex, FCleanupFlags &CleanupFlags, void *Userdata)
 {
-    // !!!Fix!!!
-    // use simple pool
     // 为Function的参数提前开辟一块内存，用作后续缓存每个参数的值
+    // 非递归调用使用持久化缓冲区，递归调用和带代理参数的调用从FMemStack分配参数帧，由调用者的FMemMark释放
     void *Params = nullptr;
 #if ENABLE_PERSISTENT_PARAM_BUFFER
     if (NumCalls < 1 && !bHasDelegateParams)
@@ -445,7 +480,10 @@ void* FFunctionDesc::PreCall(lua_State *L, int32 NumParams, int32 FirstParamInde
     }
     else
 #endif
-    Params = Function->ParmsSize > 0 ? FMemory::Malloc(Function->ParmsSize, 16) : nullptr;
+    if (Function->ParmsSize > 0)
+    {
+        Params = New<uint8>(FMemStack::Get(), Function->ParmsSize, 16);
+    }
 
     // 记录递归调用次数
     ++NumCalls;
@@ -530,7 +568,7 @@ void* FFunctionDesc::PreCall(lua_State *L, int32 NumParams, int32 FirstParamInde
 /**
  * Handling 'out' properties
  */
-int32 FFunctionDesc::PostCall(lua_State *L, int32 NumParams, int32 FirstParamIndex, void *Params, const TArray<bool> &CleanupFlags)
+int32 FFunctionDesc::PostCall(lua_State *L, int32 NumParams, int32 FirstParamIndex, void *Params, const FCleanupFlags &CleanupFlags)
 {
     int32 NumReturnValues = 0;
 
@@ -577,14 +615,6 @@ int32 FFunctionDesc::PostCall(lua_State *L, int32 NumParams, int32 FirstParamInd
 
     --NumCalls;
 
-    if (Params)
-    {
-#if ENABLE_PERSISTENT_PARAM_BUFFER
-        if (NumCalls > 0 || bHasDelegateParams)
-#endif	
-        FMemory::Free(Params);
-    }
-
     return NumReturnValues;
 }
 
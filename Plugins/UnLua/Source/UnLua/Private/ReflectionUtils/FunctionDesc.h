@@ -23,6 +23,10 @@ struct lua_State;
 struct FParameterCollection;
 class FPropertyDesc;
 
+// cleanup flags of a call, a UFunction has at most 255 parameters so 8 inline words never touch the heap
+// 调用时的参数清理标记，UFunction最多255个参数，内联存储不分配堆内存
+typedef TBitArray<TInlineAllocator<8>> FCleanupFlags;
+
 /**
  * Function descriptor
  * 方法描述
@@ -99,6 +103,14 @@ public:
      */
     FORCEINLINE UFunction* GetFunction() const { return Function; }
 
+    /**
+     * Get the handle of this descriptor, Lua closures hold the handle instead of a raw pointer
+     * 获取描述句柄，Lua闭包持有的是句柄而不是裸指针
+     *
+     * @return - the descriptor handle
+     */
+    FORCEINLINE void* GetHandle() const { return Handle; }
+
     /**
      * Call Lua function that overrides this UFunction
      * 调用覆盖了UFunction的Lua方法
@@ -144,22 +156,41 @@ public:
 
 private:
     // 为调用UFunction准备参数
-    void* PreCall(lua_State *L, int32 NumParams, int32 FirstParamIndex, TArray<bool> &CleanupFlags, void *Userdata = nullptr);
+    // 参数内存来自持久化缓冲区或者FMemStack，调用者需要在PreCall之前建立FMemMark
+    void* PreCall(lua_State *L, int32 NumParams, int32 FirstParamIndex, FCleanupFlags &CleanupFlags, void *Userdata = nullptr);
     // 实际调用
-    int32 PostCall(lua_State *L, int32 NumParams, int32 FirstParamIndex, void *Params, const TArray<bool> &CleanupFlags);
+    int32 PostCall(lua_State *L, int32 NumParams, int32 FirstParamIndex, void *Params, const FCleanupFlags &CleanupFlags);
 
     // 调用Lua内部实现
     bool CallLuaInternal(lua_State *L, void *InParams, FOutParmRec *OutParams, void *RetValueAddress) const;
 
+    // 解析最终调用的UFunction(接口实现、被覆盖的原方法)和callspace，结果按UClass缓存
+    bool ResolveDispatch(UObject *Object, UFunction *&OutFinalFunction, int32 &OutCallspace);
+
+    /**
+     * Polymorphic inline cache of dispatch results, keyed on the UClass of target object
+     * 分派结果的多态内联缓存，以目标Object的UClass为键，版本号过期时整体失效
+     */
+    struct FDispatchCacheEntry
+    {
+        UClass *Class;
+        UFunction *FinalFunction;
+        int32 Callspace;
+    };
+    static constexpr int32 NumDispatchCacheEntries = 4;
+
     // 对应UFunction信息
     UFunction *Function;
     FString FuncName;
+    void *Handle;
 #if ENABLE_PERSISTENT_PARAM_BUFFER
     void *Buffer;
 #endif
 #if !SUPPORTS_RPC_CALL
     FOutParmRec *OutParmRec;
 #endif
+    FDispatchCacheEntry DispatchCache[NumDispatchCacheEntries];
+    uint32 DispatchCacheEpoch;
     // 函数的参数描述列表
     TArray<FPropertyDesc*> Properties;
     // 记录哪些属性是引用传递变量
@@ -172,7 +203,9 @@ private:
     int32 FunctionRef;
     uint8 NumRefProperties;
     uint8 NumCalls;                 // RECURSE_LIMIT is 120 or 250 which is less than 256, so use a byte...
+    uint8 NextDispatchCacheEntry;
     uint8 bStaticFunc : 1;
     uint8 bInterfaceFunc : 1;
     uint8 bHasDelegateParams : 1;
+    uint8 bCacheableCallspace : 1;  // callspace only depends on the UClass, see constructor
 };
@@ -26,7 +26,7 @@ TMap<FProperty*,FPropertyDesc*> FPropertyDesc::Property2Desc;
 
 FPropertyDesc::FPropertyDesc(FProperty *InProperty) : Property(InProperty) 
 { 
-	GReflectionRegistry.AddToDescSet(this, DESC_PROPERTY); 
+    Handle = GReflectionRegistry.AddToDescSet(this, DESC_PROPERTY);
     Property2Desc.Add(Property,this);
     PropertyType = CPT_None;
 }
@@ -347,7 +347,7 @@ public:
             else
             {
                 // 一个UObject如果与lua进行了绑定，那么lua中会有一张对应的table，该UObject指针在lua中对应的数据就是这个table
-                // 绑定及table创建可见NewLuaObject函数，table被创建后，会在lua中被保存到"ObjectMap"表中进行记录，键为该UObject的地址，值为table
+                // 绑定及table创建可见NewLuaObject函数，table被创建后，会在代理索引FLuaObjectIndex中按该UObject记录
                 // 而如果UObject没有实现UnLuaInterface或没有被动态绑定，那Object本身与lua没有关系，在lua中不会创建table
                 // 这个UObject被传递到lua中时，会创建一个UserData，UserData值就是UObject的地址，并且设置metatable为对应Class的ClassMetatable
                 UnLua::PushUObject(L, ObjectBaseProperty->GetObjectPropertyValue(ValuePtr));
@@ -609,13 +609,13 @@ public:
         }
         else
         {
-            lua_pushstring(L, TCHAR_TO_UTF8(*NameProperty->GetPropertyValue(ValuePtr).ToString()));
+            GLuaCxt->GetNameCache().PushName(L, NameProperty->GetPropertyValue(ValuePtr));
         }
     }
 
     virtual bool SetValueInternal(lua_State *L, void *ValuePtr, int32 IndexInStack, bool bCopyValue) const override
     {
-        NameProperty->SetPropertyValue(ValuePtr, FName(lua_tostring(L, IndexInStack)));
+        NameProperty->SetPropertyValue(ValuePtr, GLuaCxt->GetNameCache().ToName(L, IndexInStack));
         return true;
     }
 
@@ -653,13 +653,13 @@ public:
         }
         else
         {
-            lua_pushstring(L, TCHAR_TO_UTF8(*StringProperty->GetPropertyValue(ValuePtr)));
+            UnLua::PushFString(L, StringProperty->GetPropertyValue(ValuePtr));
         }
     }
 
     virtual bool SetValueInternal(lua_State *L, void *ValuePtr, int32 IndexInStack, bool bCopyValue) const override
     {
-        StringProperty->SetPropertyValue(ValuePtr, UTF8_TO_TCHAR(lua_tostring(L, IndexInStack)));
+        UnLua::GetFString(L, IndexInStack, *StringProperty->GetPropertyValuePtr(ValuePtr));      // reuse the allocation of the FString
         return true;
     }
 
@@ -697,13 +697,15 @@ public:
         }
         else
         {
-            lua_pushstring(L, TCHAR_TO_UTF8(*TextProperty->GetPropertyValue(ValuePtr).ToString()));
+            UnLua::PushFString(L, TextProperty->GetPropertyValue(ValuePtr).ToString());
         }
     }
 
     virtual bool SetValueInternal(lua_State* L, void* ValuePtr, int32 IndexInStack, bool bCopyValue) const override
     {
-        TextProperty->SetPropertyValue(ValuePtr, FText::FromString(UTF8_TO_TCHAR(lua_tostring(L, IndexInStack))));
+        FString String;
+        UnLua::GetFString(L, IndexInStack, String);
+        TextProperty->SetPropertyValue(ValuePtr, FText::FromString(MoveTemp(String)));
         return true;
     }
 
@@ -796,10 +798,20 @@ public:
         int32 Type = lua_type(L, IndexInStack);
         if (Type == LUA_TTABLE)
         {
+            // 先转换到临时数组(表里可能有引用目标数组元素的userdata)，再整体移动给目标，不再逐元素深拷贝
             FScriptArray ScriptArray;
             FLuaArray LuaArray(&ScriptArray, InnerProperty, FLuaArray::OwnedByOther);
-            TraverseTable(L, IndexInStack, &LuaArray, FArrayPropertyDesc::FillArray);       // fill table elements
-            ArrayProperty->CopyCompleteValue(ValuePtr, &ScriptArray);
+            LuaArray.FromTable(L, IndexInStack);                                            // presized, typed loops for numbers
+            if (UsesHeapAllocator())
+            {
+                ArrayProperty->ClearValue(ValuePtr);
+                FScriptArrayHelper(ArrayProperty, ValuePtr).MoveAssign(&ScriptArray);      // 'ScriptArray' is left empty
+            }
+            else
+            {
+                ArrayProperty->CopyCompleteValue(ValuePtr, &ScriptArray);
+                LuaArray.Clear();
+            }
         }
         else if (Type == LUA_TUSERDATA)
         {
@@ -863,16 +875,21 @@ public:
     // interfaces from 'TLuaContainerInterface<FLuaArray>'
     virtual TSharedPtr<UnLua::ITypeInterface> GetInnerInterface() const override { return InnerProperty; }
     virtual TSharedPtr<UnLua::ITypeInterface> GetExtraInterface() const override { return TSharedPtr<UnLua::ITypeInterface>(); }
-    static bool FillArray(lua_State *L, void *Userdata)
-    {
-        FLuaArray *Array = (FLuaArray*)Userdata;
-        int32 Index = Array->AddDefaulted();
-        uint8 *Data = Array->GetData(Index);
-        Array->Inner->Write(L, Data, -1);
+
+private:
+    /**
+     * The temporary FScriptArray can only be moved into arrays with the same (heap) allocator, memory image arrays are copied
+     * 只有同样使用堆分配器的数组才能直接移动临时数组，memory image数组需要拷贝
+     */
+    bool UsesHeapAllocator() const
+    {
+#if ENGINE_MAJOR_VERSION > 4 || ENGINE_MINOR_VERSION > 24
+        return !EnumHasAnyFlags(ArrayProperty->ArrayFlags, EArrayPropertyFlags::UsesMemoryImageAllocator);
+#else
         return true;
+#endif
     }
 
-private:
     TSharedPtr<UnLua::ITypeInterface> InnerProperty;
 };
 
@@ -945,8 +962,17 @@ public:
         {
             FScriptMap ScriptMap;
             FLuaMap LuaMap(&ScriptMap, KeyProperty, ValueProperty, FLuaMap::OwnedByOther);
-            TraverseTable(L, IndexInStack, &LuaMap, FMapPropertyDesc::FillMap);
-            ArrayProperty->CopyCompleteValue(ValuePtr, &ScriptMap);
+            LuaMap.FromTable(L, IndexInStack);                                              // allocated once
+            if (UsesHeapAllocator())
+            {
+                MapProperty->ClearValue(ValuePtr);                                          // MoveAssign doesn't destruct the elements
+                ((FScriptMap*)ValuePtr)->MoveAssign(ScriptMap, MapProperty->MapLayout);     // 'ScriptMap' is left empty
+            }
+            else
+            {
+                MapProperty->CopyCompleteValue(ValuePtr, &ScriptMap);
+                LuaMap.Clear();
+            }
         }
         else if (Type == LUA_TUSERDATA)
         {
@@ -1009,19 +1035,18 @@ public:
     // interfaces from 'TLuaContainerInterface<FLuaMap>'
     virtual TSharedPtr<UnLua::ITypeInterface> GetInnerInterface() const override { return KeyProperty; }
     virtual TSharedPtr<UnLua::ITypeInterface> GetExtraInterface() const override { return ValueProperty; }
-    static bool FillMap(lua_State *L, void *Userdata)
-    {
-        FLuaMap *Map = (FLuaMap*)Userdata;
-        void *ValueCache = (uint8*)Map->ElementCache + Map->MapLayout.ValueOffset;
-        Map->KeyInterface->Initialize(Map->ElementCache);
-        Map->ValueInterface->Initialize(ValueCache);
-        Map->KeyInterface->Write(L, Map->ElementCache, -2);
-        Map->ValueInterface->Write(L, Map->ValueInterface->GetOffset() > 0 ? Map->ElementCache : ValueCache, -1);
-        Map->Add(Map->ElementCache, ValueCache);
+
+private:
+    // @see FArrayPropertyDesc::UsesHeapAllocator()
+    bool UsesHeapAllocator() const
+    {
+#if ENGINE_MAJOR_VERSION > 4 || ENGINE_MINOR_VERSION > 24
+        return !EnumHasAnyFlags(MapProperty->MapFlags, EMapPropertyFlags::UsesMemoryImageAllocator);
+#else
         return true;
+#endif
     }
 
-private:
     TSharedPtr<UnLua::ITypeInterface> KeyProperty;
     TSharedPtr<UnLua::ITypeInterface> ValueProperty;
 };
@@ -1093,8 +1118,9 @@ public:
         {
             FScriptSet ScriptSet;
             FLuaSet LuaSet(&ScriptSet, InnerProperty, FLuaSet::OwnedByOther);
-            TraverseTable(L, IndexInStack, &LuaSet, FSetPropertyDesc::FillSet);
-            ArrayProperty->CopyCompleteValue(ValuePtr, &ScriptSet);
+            LuaSet.FromTable(L, IndexInStack);                                              // allocated once
+            SetProperty->ClearValue(ValuePtr);                                              // MoveAssign doesn't destruct the elements
+            ((FScriptSet*)ValuePtr)->MoveAssign(ScriptSet, SetProperty->SetLayout);         // 'ScriptSet' is left empty
         }
         else if (Type == LUA_TUSERDATA)
         {
@@ -1157,14 +1183,6 @@ public:
     // interfaces from 'TLuaContainerInterface<FLuaSet>'
     virtual TSharedPtr<UnLua::ITypeInterface> GetInnerInterface() const override { return InnerProperty; }
     virtual TSharedPtr<UnLua::ITypeInterface> GetExtraInterface() const override { return TSharedPtr<UnLua::ITypeInterface>(); }
-    static bool FillSet(lua_State *L, void *Userdata)
-    {
-        FLuaSet *Set = (FLuaSet*)Userdata;
-        Set->ElementInterface->Initialize(Set->ElementCache);
-        Set->ElementInterface->Write(L, Set->ElementCache, -1);
-        Set->Add(Set->ElementCache);
-        return true;
-    }
 
 private:
     TSharedPtr<UnLua::ITypeInterface> InnerProperty;
@@ -1279,7 +1297,8 @@ public:
             {
                 // FStruct并不是指针，因此可以选择把FStruct整个复制到lua中，作为一个UserData，并设置ClassMetatable，这样lua的修改就不会影响原属性
                 // 平常访问属性的操作，都会使用原始地址，并不会复制一份
-                UnLua::PushPointer(L, (void*)ValuePtr, StructName.Get(), bFirstPropOfScriptStruct);
+                FClassDesc *ClassDesc = GReflectionRegistry.FindClassByStruct(StructProperty->Struct);
+                PushPointerCore(L, (void*)ValuePtr, StructName.Get(), ClassDesc, bFirstPropOfScriptStruct);
             }
         }
     }
@@ -223,6 +223,9 @@ public:
     virtual bool CheckPropertyType(lua_State* L, int32 IndexInStack, FString& ErrorMsg, void* UserData = nullptr) { return true; };
 #endif
 
+	// 描述句柄，Lua侧持有的是句柄而不是裸指针
+    FORCEINLINE void* GetHandle() const { return Handle; }
+
 	// 设置属性类型
     void SetPropertyType(int8 Type);
 	// 获取属性类型
@@ -252,6 +255,7 @@ protected:
     };
 
     int8 PropertyType;
+    void *Handle;
 public:
     static TMap<FProperty*,FPropertyDesc*> Property2Desc;
 };
@@ -44,16 +44,24 @@ void FReflectionRegistry::Cleanup()
     }
     Name2Classes.Empty();
     Struct2Classes.Empty();
+    StructIndex2Classes.Empty();
     Enums.Empty();
     Functions.Empty();
 	DescSet.Empty();
+    DescSlots.Empty();
+    FreeDescSlots.Empty();
     GCSet.Empty();
     ClassWhiteSet.Empty();
+    InvalidateDispatchCaches();
 }
 
 FClassDesc* FReflectionRegistry::FindClass(const char* InName)
 {
-    FName ClassName = InName;
+    return FindClass(FName(InName));
+}
+
+FClassDesc* FReflectionRegistry::FindClass(FName ClassName)
+{
     FClassDesc** ClassDesc = Name2Classes.Find(ClassName);
     if (ClassDesc)
     {
@@ -141,6 +149,7 @@ bool FReflectionRegistry::UnRegisterClass(FClassDesc *ClassDesc)
     {   
         FName Name(ClassDesc->GetName());
         UStruct* Struct = ClassDesc->AsStruct();
+        const int32 StructIndex = ClassDesc->StructIndex;
 
         delete ClassDesc;
 
@@ -148,6 +157,10 @@ bool FReflectionRegistry::UnRegisterClass(FClassDesc *ClassDesc)
         // 清理类描述
         Name2Classes.Remove(Name);
         Struct2Classes.Remove(Struct);
+        if (StructIndex2Classes.IsValidIndex(StructIndex) && StructIndex2Classes[StructIndex] == ClassDesc)
+        {
+            StructIndex2Classes[StructIndex] = nullptr;
+        }
     }
 
     return true;
@@ -208,7 +221,11 @@ FClassDesc* FReflectionRegistry::RegisterClass(UStruct *InStruct)
 
 FEnumDesc* FReflectionRegistry::FindEnum(const char* InName)
 {
-    FName EnumName(InName);
+    return FindEnum(FName(InName));
+}
+
+FEnumDesc* FReflectionRegistry::FindEnum(FName EnumName)
+{
     FEnumDesc** EnumDesc = Enums.Find(EnumName);
     if (EnumDesc)
     {
@@ -382,6 +399,8 @@ bool FReflectionRegistry::NotifyUObjectDeleted(const UObjectBase* InObject)
         // class,ignore ref count
         // 类,忽略引用计数
         UnRegisterClass(ClassDesc);
+        // the address may be reused by another UClass
+        InvalidateDispatchCaches();
 
         return true;
     }
@@ -401,12 +420,11 @@ bool FReflectionRegistry::NotifyUObjectDeleted(const UObjectBase* InObject)
             lua_State* L = UnLua::GetState();
             if (L)
             {
-                lua_getfield(UnLua::GetState(), LUA_REGISTRYINDEX, "ObjectMap");            // get the object instance from 'ObjectMap'
-                lua_pushlightuserdata(L, Object);
-                int32 Type = lua_rawget(L, -2);
-                lua_pop(L, 2);
-
-                bNeedProcess = (Type == LUA_TTABLE || Type == LUA_TUSERDATA);
+                bNeedProcess = GLuaCxt->GetObjectIndex().PushObject(L, Object);     // get the object instance from the object index
+                if (bNeedProcess)
+                {
+                    lua_pop(L, 1);
+                }
             }
         }
 
@@ -415,14 +433,13 @@ bool FReflectionRegistry::NotifyUObjectDeleted(const UObjectBase* InObject)
             UClass* Class = Object->GetClass();
             if (GLuaCxt->IsUObjectValid(Class))
             {
-                FString ClassName = FString::Printf(TEXT("%s%s"), Class->GetPrefixCPP(), *Class->GetName());
-                ClassDesc = FindClass(TCHAR_TO_UTF8(*ClassName));
+                ClassDesc = FindClassByStruct(Class);
                 if (ClassDesc)
                 {
                     ClassDesc->SubRef();
 
 #if UNLUA_ENABLE_DEBUG != 0
-                    UE_LOG(LogUnLua, Log, TEXT("FReflectionRegistry::NotifyUObjectDeleted:%p,%s"),Object, *ClassName);
+                    UE_LOG(LogUnLua, Log, TEXT("FReflectionRegistry::NotifyUObjectDeleted:%p,%s"),Object, *ClassDesc->GetName());
 #endif
                     TryUnRegisterClass(ClassDesc);
                 }
@@ -442,6 +459,7 @@ bool FReflectionRegistry::AddOverriddenFunction(UFunction *NewFunc, UFunction *O
     {
         // 存储了原UFunction和CopyUFunction的键值对，之后有需要可以在里面查找并调用原UFunction
         OverriddenFunctions.Add(NewFunc, OverriddenFunc);
+        InvalidateDispatchCaches();
         return true;
     }
     return false;
@@ -450,7 +468,10 @@ bool FReflectionRegistry::AddOverriddenFunction(UFunction *NewFunc, UFunction *O
 UFunction* FReflectionRegistry::RemoveOverriddenFunction(UFunction *NewFunc)
 {
     UFunction *OverriddenFunc = nullptr;
-    OverriddenFunctions.RemoveAndCopyValue(NewFunc, OverriddenFunc);
+    if (OverriddenFunctions.RemoveAndCopyValue(NewFunc, OverriddenFunc))
+    {
+        InvalidateDispatchCaches();
+    }
     return OverriddenFunc;
 }
 
@@ -462,47 +483,73 @@ UFunction* FReflectionRegistry::FindOverriddenFunction(UFunction *NewFunc)
 #endif
 
 
-void FReflectionRegistry::AddToDescSet(void* Desc, EDescType type)
+void* FReflectionRegistry::AddToDescSet(void* Desc, EDescType type)
 {
-	DescSet.Add(Desc, type);
+    int32 Slot = INDEX_NONE;
+    if (FreeDescSlots.Num() > 0)
+    {
+        Slot = FreeDescSlots.Pop(false);
+    }
+    else
+    {
+        check((UPTRINT)DescSlots.Num() <= DescSlotMask);
+        Slot = DescSlots.AddZeroed();
+    }
+
+    FDescSlot& DescSlot = DescSlots[Slot];
+    DescSlot.Desc = Desc;
+    DescSlot.Type = type;
+	DescSet.Add(Desc, { type, Slot });
+
+    return (void*)(((UPTRINT)DescSlot.Generation << DescGenerationShift) | ((UPTRINT)Slot << 1) | 1);
 }
 
 void FReflectionRegistry::RemoveFromDescSet(void* Desc)
 {
-	DescSet.Remove(Desc);
+    FDescSetEntry Entry;
+	if (DescSet.RemoveAndCopyValue(Desc, Entry))
+    {
+        // bump the generation, all handles still held by Lua become stale
+        FDescSlot& DescSlot = DescSlots[Entry.Slot];
+        DescSlot.Desc = nullptr;
+        DescSlot.Type = DESC_NONE;
+        DescSlot.Generation = (DescSlot.Generation + 1) & DescGenerationMask;
+        FreeDescSlots.Add(Entry.Slot);
+    }
 }
 
 bool FReflectionRegistry::IsDescValid(void* Desc, EDescType type)
 {   
-    EDescType* TypePtr = DescSet.Find(Desc);
-    return TypePtr && (*TypePtr == type);
+    FDescSetEntry* Entry = DescSet.Find(Desc);
+    return Entry && (Entry->Type == type);
 }
 
 bool FReflectionRegistry::IsDescValidWithObjectCheck(void* Desc, EDescType type)
 {
-    bool bValid = IsDescValid(Desc, type);
-    if (bValid)
+    return IsDescValid(Desc, type) && IsDescObjectValid(Desc, type);
+}
+
+void* FReflectionRegistry::FindDescByHandleWithObjectCheck(const void* Handle, EDescType type) const
+{
+    void* Desc = FindDescByHandle(Handle, type);
+    return Desc && IsDescObjectValid(Desc, type) ? Desc : nullptr;
+}
+
+bool FReflectionRegistry::IsDescObjectValid(void* Desc, EDescType type)
+{
+    switch (type)
     {
-        switch (type)
-        {
-        case DESC_CLASS:
-            bValid = bValid && ((FClassDesc*)Desc)->IsValid();
-            break;
-        case DESC_FUNCTION:
-            bValid = bValid && ((FFunctionDesc*)Desc)->IsValid();
-            break;
-        case DESC_PROPERTY:
-            bValid = bValid && ((FPropertyDesc*)Desc)->IsValid();
-            break;
-        case DESC_ENUM:
-            bValid = bValid && ((FEnumDesc*)Desc)->IsValid();
-            break;
-        default:
-            bValid = false;
-        }
+    case DESC_CLASS:
+        return ((FClassDesc*)Desc)->IsValid();
+    case DESC_FUNCTION:
+        return ((FFunctionDesc*)Desc)->IsValid();
+    case DESC_PROPERTY:
+        return ((FPropertyDesc*)Desc)->IsValid();
+    case DESC_ENUM:
+        return ((FEnumDesc*)Desc)->IsValid();
+    default:
+        return false;
     }
-
-    return bValid;
 }
 
 void FReflectionRegistry::AddToGCSet(const UObject* InObject)
@@ -550,8 +597,7 @@ FClassDesc* FReflectionRegistry::RegisterClassInternal(const FString &ClassName,
     // desc pool is needed
     check(Struct && Type != FClassDesc::EType::UNKNOWN);
     FClassDesc *ClassDesc = new FClassDesc(Struct, ClassName, Type);
-    Name2Classes.Add(FName(*ClassName), ClassDesc);
-    Struct2Classes.Add(Struct, ClassDesc);
+    AddClass(FName(*ClassName), ClassDesc);
     
     FClassDesc *CurrentClass = ClassDesc;
     TArray<FString> NameChain;
@@ -563,8 +609,7 @@ FClassDesc* FReflectionRegistry::RegisterClassInternal(const FString &ClassName,
         if (!ClassDescParent)
         {   
             ClassDescParent = new FClassDesc(StructChain[i], NameChain[i], Type);
-            Name2Classes.Add(*NameChain[i], ClassDescParent);
-            Struct2Classes.Add(StructChain[i], ClassDescParent);
+            AddClass(*NameChain[i], ClassDescParent);
         }
     }
 
@@ -575,4 +620,17 @@ FClassDesc* FReflectionRegistry::RegisterClassInternal(const FString &ClassName,
     return ClassDesc;
 }
 
+void FReflectionRegistry::AddClass(FName ClassName, FClassDesc *ClassDesc)
+{
+    Name2Classes.Add(ClassName, ClassDesc);
+    Struct2Classes.Add(ClassDesc->AsStruct(), ClassDesc);
+
+    const int32 StructIndex = ClassDesc->StructIndex;
+    if (StructIndex >= StructIndex2Classes.Num())
+    {
+        StructIndex2Classes.SetNumZeroed(FMath::RoundUpToPowerOfTwo(StructIndex + 1));
+    }
+    StructIndex2Classes[StructIndex] = ClassDesc;
+}
+
 FReflectionRegistry GReflectionRegistry;        // global reflection registry
@@ -41,6 +41,7 @@ enum EDescType
 class FReflectionRegistry
 {
 public:
+    FReflectionRegistry() : DispatchEpoch(0) {}
     ~FReflectionRegistry() { Cleanup(); }
 
 	// 清理
@@ -49,6 +50,18 @@ public:
     // all other place should use this to found desc!
 	// 获取类描述
     FClassDesc* FindClass(const char* InName);
+    FClassDesc* FindClass(FName InName);
+
+	/**
+	 * Find a registered class by its UStruct, an array lookup by the internal index, no class name is built or hashed
+	 * 按UStruct查找已注册的类描述，用InternalIndex直接下标访问，不需要拼接和哈希类名
+	 */
+	FORCEINLINE FClassDesc* FindClassByStruct(const UStruct* InStruct) const
+	{
+		const int32 Index = GUObjectArray.ObjectToIndex(InStruct);
+		FClassDesc* ClassDesc = StructIndex2Classes.IsValidIndex(Index) ? StructIndex2Classes[Index] : nullptr;
+		return ClassDesc && ClassDesc->AsStruct() == InStruct ? ClassDesc : nullptr;
+	}
 
 	// 反注册类描述
     void TryUnRegisterClass(FClassDesc* ClassDesc);
@@ -62,6 +75,7 @@ public:
     // all other place should use this to found desc!
 	// 获取Enum描述
     FEnumDesc* FindEnum(const char* InName);
+    FEnumDesc* FindEnum(FName InName);
 
 	// 反注册Enum描述
     bool UnRegisterEnum(const FEnumDesc* EnumDesc);
@@ -86,8 +100,16 @@ public:
 	// 通知UObject删除
     bool NotifyUObjectDeleted(const UObjectBase* InObject);
 
-	// 新增到描述Set
-	void AddToDescSet(void* Desc, EDescType type);
+	/**
+	 * Dispatch caches of function descriptors are stamped with this epoch, bump it whenever the result of
+	 * resolving a UFunction for a UClass may change (overrides added/removed, UClass released)
+	 * 方法描述的分派缓存以此版本号为准，覆盖方法增删或者UClass释放时递增，所有缓存随之失效
+	 */
+	FORCEINLINE void InvalidateDispatchCaches() { ++DispatchEpoch; }
+	FORCEINLINE uint32 GetDispatchEpoch() const { return DispatchEpoch; }
+
+	// 新增到描述Set，返回描述句柄
+	void* AddToDescSet(void* Desc, EDescType type);
 	// 从描述Set移除
 	void RemoveFromDescSet(void* Desc);
 	// 描述是否有效
@@ -95,6 +117,33 @@ public:
 	// 描述是否有效同时检测Object
     bool IsDescValidWithObjectCheck(void* Desc, EDescType type);
 
+	/**
+	 * Descriptor handles, {slot, generation} packed into a light userdata. The lowest bit is always set,
+	 * so a handle never collides with a (aligned) pointer to a statically exported property
+	 * 描述句柄：{槽位, 代数}打包成lightuserdata，最低位总是1，和静态导出属性(ITypeOps)的指针区分开
+	 * 描述释放时槽位的代数+1，Lua侧残留的旧句柄就自然失效了，校验只需要一次数组下标和一次比较
+	 */
+	static FORCEINLINE bool IsDescHandle(const void* Handle) { return ((UPTRINT)Handle & 1) != 0; }
+
+	// 通过句柄获取描述，句柄失效则返回nullptr
+	FORCEINLINE void* FindDescByHandle(const void* Handle, EDescType type) const
+	{
+		const UPTRINT Value = (UPTRINT)Handle;
+		const uint32 Slot = (uint32)((Value >> 1) & DescSlotMask);
+		if (IsDescHandle(Handle) && Slot < (uint32)DescSlots.Num())
+		{
+			const FDescSlot& DescSlot = DescSlots[Slot];
+			if (DescSlot.Generation == (uint32)(Value >> DescGenerationShift) && DescSlot.Type == type)
+			{
+				return DescSlot.Desc;
+			}
+		}
+		return nullptr;
+	}
+
+	// 通过句柄获取描述同时检测Object
+	void* FindDescByHandleWithObjectCheck(const void* Handle, EDescType type) const;
+
 	// 新增到GCSet
     void AddToGCSet(const UObject* InObject);
 	// 从GCSet移除
@@ -110,20 +159,47 @@ public:
     bool IsInClassWhiteSet(const FString& ClassName);
 
 private:
+	struct FDescSlot
+	{
+		void* Desc;
+		uint32 Generation;
+		EDescType Type;
+	};
+
+	struct FDescSetEntry
+	{
+		EDescType Type;
+		int32 Slot;
+	};
+
+	// 64位平台：31位槽位 + 32位代数；32位平台：20位槽位 + 11位代数
+	static constexpr uint32 DescSlotBits = sizeof(UPTRINT) == 8 ? 31 : 20;
+	static constexpr UPTRINT DescSlotMask = ((UPTRINT)1 << DescSlotBits) - 1;
+	static constexpr uint32 DescGenerationShift = DescSlotBits + 1;
+	static constexpr uint32 DescGenerationMask = (uint32)(~(UPTRINT)0 >> DescGenerationShift);
+
+	static bool IsDescObjectValid(void* Desc, EDescType type);
+
 	// 注册类内部实现
     FClassDesc* RegisterClassInternal(const FString &ClassName, UStruct *Struct, FClassDesc::EType Type);
+	// 记录类描述到Name2Classes、Struct2Classes和StructIndex2Classes
+    void AddClass(FName ClassName, FClassDesc *ClassDesc);
 
     TMap<FName, FClassDesc*> Name2Classes;
     TMap<UStruct*, FClassDesc*> Struct2Classes;
+    TArray<FClassDesc*> StructIndex2Classes;          // UStruct internal index -> class descriptor
     TMap<FName, FEnumDesc*> Enums;
     TMap<UFunction*, FFunctionDesc*> Functions;
 #if ENABLE_CALL_OVERRIDDEN_FUNCTION
     TMap<UFunction*, UFunction*> OverriddenFunctions;
 #endif
 
-	TMap<void*, EDescType> DescSet;
+	TMap<void*, FDescSetEntry> DescSet;
+	TArray<FDescSlot> DescSlots;
+	TArray<int32> FreeDescSlots;
     TMap<const UObject*, bool> GCSet;
     TMap<const FString, bool> ClassWhiteSet;
+    uint32 DispatchEpoch;
 };
 
 extern FReflectionRegistry GReflectionRegistry;
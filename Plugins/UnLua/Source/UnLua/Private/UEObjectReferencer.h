@@ -59,6 +59,20 @@ public:
         return ReferencedObjects.Empty();
     }
 
+    const TSet<UObject*>& GetReferencedObjects() const
+    {
+        return ReferencedObjects;
+    }
+
+    /**
+     * Temporarily stop referencing some objects, used to test whether anything else references them
+     * 临时不引用一部分对象，用于检查是否还有其他引用
+     */
+    void SetExcludedObjects(const TSet<UObject*> *InExcludedObjects)
+    {
+        ExcludedObjects = InExcludedObjects;
+    }
+
 #if UE_BUILD_DEBUG
     void Debug()
     {
@@ -68,7 +82,19 @@ public:
 
     virtual void AddReferencedObjects(FReferenceCollector& Collector) override
     {
-        Collector.AddReferencedObjects(ReferencedObjects);
+        if (!ExcludedObjects)
+        {
+            Collector.AddReferencedObjects(ReferencedObjects);
+            return;
+        }
+
+        for (UObject *Object : ReferencedObjects)
+        {
+            if (!ExcludedObjects->Contains(Object))
+            {
+                Collector.AddReferencedObject(Object);
+            }
+        }
     }
 
     virtual FString GetReferencerName() const
@@ -77,9 +103,10 @@ public:
     }
 
 private:
-    FObjectReferencer() {}
+    FObjectReferencer() : ExcludedObjects(nullptr) {}
 
     TSet<UObject*> ReferencedObjects;
+    const TSet<UObject*> *ExcludedObjects;
 };
 
 #define GObjectReferencer FObjectReferencer::Instance()
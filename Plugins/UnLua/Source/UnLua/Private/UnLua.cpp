@@ -16,10 +16,28 @@
 #include "UnLuaPrivate.h"
 #include "UnLuaDelegates.h"
 #include "LuaContext.h"
+#include "LuaCore.h"
+#include "LuaClassCache.h"
+#include "LuaScriptBundle.h"
 
 DEFINE_STAT(STAT_UnLua_Lua_Memory);
 DEFINE_STAT(STAT_UnLua_PersistentParamBuffer_Memory);
 DEFINE_STAT(STAT_UnLua_OutParmRec_Memory);
+DEFINE_STAT(STAT_UnLua_BytecodeCache_Hits);
+DEFINE_STAT(STAT_UnLua_BytecodeCache_Misses);
+DEFINE_STAT(STAT_UnLua_BytecodeCache_MsSaved);
+DEFINE_STAT(STAT_UnLua_GC_Time);
+DEFINE_STAT(STAT_UnLua_GC_Steps);
+DEFINE_STAT(STAT_UnLua_GC_Heap);
+DEFINE_STAT(STAT_UnLua_GC_MaxPause);
+DEFINE_STAT(STAT_UnLua_GC_MinorCollections);
+DEFINE_STAT(STAT_UnLua_GC_MajorCollections);
+DEFINE_STAT(STAT_UnLua_GC_Mode);
+DEFINE_STAT(STAT_UnLua_GC_MinorMul);
+DEFINE_STAT(STAT_UnLua_GC_PauseParam);
+DEFINE_STAT(STAT_UnLua_GC_StepMul);
+DEFINE_STAT(STAT_UnLua_CrossGC_Objects);
+DEFINE_STAT(STAT_UnLua_CrossGC_Memory);
 
 namespace UnLua
 {
@@ -374,13 +392,18 @@ bool HotfixLua()
 {
     if (GLuaCxt)
     {
+        FLuaScriptBundle::ScanPatchedModules();                     // the hotfix may require newly downloaded scripts
         if (FUnLuaDelegates::HotfixLua.IsBound())
         {
             FUnLuaDelegates::HotfixLua.Execute(*GLuaCxt);
+            FLuaClassCache::Invalidate();
+            InvalidateUdataInlineCache(*GLuaCxt);
             return true;
         }
 
         UnLua::FLuaRetValues RetValues = UnLua::Call(*GLuaCxt, "HotFix");
+        FLuaClassCache::Invalidate();
+        InvalidateUdataInlineCache(*GLuaCxt);
         return RetValues.IsValid();
     }
     return false;
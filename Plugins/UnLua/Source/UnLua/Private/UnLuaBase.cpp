@@ -14,6 +14,9 @@
 
 #include "LuaCore.h"
 #include "LuaContext.h"
+#include "LuaBytecodeCache.h"
+#include "LuaStringConv.h"
+#include "LuaMemoryTracker.h"
 #include "UnLuaDelegates.h"
 #include "UEObjectReferencer.h"
 #include "Containers/LuaSet.h"
@@ -118,7 +121,7 @@ namespace UnLua
         }
 
         int32 SkipLen = (3 < Data.Num()) && (0xEF == Data[0]) && (0xBB == Data[1]) && (0xBF == Data[2]) ? 3 : 0;        // skip UTF-8 BOM mark
-        return LoadChunk(L, (const char*)(Data.GetData() + SkipLen), Data.Num() - SkipLen, TCHAR_TO_UTF8(*RelativeFilePath), Mode, Env);    // loads the buffer as a Lua chunk
+        return FLuaBytecodeCache::LoadChunk(L, (const char*)(Data.GetData() + SkipLen), Data.Num() - SkipLen, TCHAR_TO_UTF8(*RelativeFilePath), Mode, Env);    // loads the buffer as a Lua chunk, or the cached bytecode
     }
 
     /**
@@ -187,7 +190,8 @@ namespace UnLua
             return false;
         }
 
-        bool bSuccess = !luaL_dostring(L, Chunk);       // loads and runs the given chunk
+        // loads and runs the given chunk, same as luaL_dostring
+        bool bSuccess = luaL_loadstring(L, Chunk) == LUA_OK && PCall(L, 0, LUA_MULTRET, 0) == LUA_OK;
         if (!bSuccess)
         {
             ReportLuaCallError(L);
@@ -197,6 +201,15 @@ namespace UnLua
         return bSuccess;
     }
 
+    /**
+     * Call a Lua function in protected mode
+     */
+    int32 PCall(lua_State *L, int32 NumArgs, int32 NumResults, int32 MessageHandlerIdx)
+    {
+        FLuaMemoryTracker::FScope MemoryScope(L, NumArgs);      // attribute allocations to the called function, only when tracking
+        return lua_pcall(L, NumArgs, NumResults, MessageHandlerIdx);
+    }
+
     /**
      * Report Lua error
      */
@@ -237,95 +250,74 @@ namespace UnLua
      */
     int32 PushPointer(lua_State *L, void *Value, const char *MetatableName, bool bAlwaysCreate)
     {
-        if (!Value
-            || !MetatableName)
-        {
-            lua_pushnil(L);
-            return 1;
-        }
+        return PushPointerCore(L, Value, MetatableName, nullptr, bAlwaysCreate);
+    }
 
-        bool bCreateUserdata = bAlwaysCreate;
-        if (!bAlwaysCreate)
-        {
-            // find the pointer from 'StructMap' first
-            // 由于FStruct不被GC管理，因此UnLua不需要像UObject一样添加引用
-            lua_getfield(L, LUA_REGISTRYINDEX, "StructMap");
-            lua_pushlightuserdata(L, Value);
-            int32 Type = lua_rawget(L, -2);
-            if (Type == LUA_TUSERDATA)
-            {
-                lua_remove(L, -2);
-
-                // check metatable is same?
-                bool bMTSame = false;
-                if (lua_getmetatable(L, -1))
-                {   
-                    luaL_getmetatable(L, MetatableName);
-                    if (lua_rawequal(L,-1,-2))
-                    {   
-                        bMTSame = true;
-                    }
-
-                    lua_pop(L, 2);
-                }
+    /**
+     * Push a FName as a Lua string
+     */
+    int32 PushFName(lua_State *L, FName Name)
+    {
+        GLuaCxt->GetNameCache().PushName(L, Name);
+        return 1;
+    }
 
-				if (!bMTSame)
-                {
-#if UNLUA_ENABLE_DEBUG != 0
-                    FString CurMetatableName;
-                    if (lua_getmetatable(L, -1))
-                    {
-                        lua_pushstring(L, "__name");
-                        Type = lua_rawget(L,-2);
-                        if (LUA_TSTRING == Type)
-                        {
-                            CurMetatableName = UTF8_TO_TCHAR(lua_tostring(L,-1));
-                        }
-                        lua_pop(L, 2);
-                    }
-					UE_LOG(LogTemp, Log, TEXT("%s : userdata with difference metatable finded! need %s,get %s,may be local or stack variable pushed to lua..."),
-                        ANSI_TO_TCHAR(__FUNCTION__), UTF8_TO_TCHAR(MetatableName), *CurMetatableName);
-#endif
-                    bool bSuccess = TryToSetMetatable(L, MetatableName);        // set metatable
-                    if (!bSuccess)
-                    {
-                        UNLUA_LOGERROR(L, LogUnLua, Warning, TEXT("%s, Invalid metatable, metatable name: !"),  UTF8_TO_TCHAR(MetatableName));
-                        return 1;
-                    }
-                }
-            }
-            else
-            {
-                check(Type == LUA_TNIL);
-                lua_pop(L, 1);
-                bCreateUserdata = true;     // create a new userdata if the value is not found
-            }
-        }
+    /**
+     * Get a FName at the given stack index
+     */
+    FName GetFName(lua_State *L, int32 Index)
+    {
+        return GLuaCxt->GetNameCache().ToName(L, Index);
+    }
 
-        if (bCreateUserdata)
-        {
-            NewUserdataWithTwoLvPtrTag(L, sizeof(void*), Value);
-            if (MetatableName)
-            {
-                bool bSuccess = TryToSetMetatable(L, MetatableName);        // set metatable
-                if (!bSuccess)
-                {
-                    UNLUA_LOGERROR(L, LogUnLua, Warning, TEXT("%s, Invalid metatable, metatable name: !"), ANSI_TO_TCHAR(__FUNCTION__), UTF8_TO_TCHAR(MetatableName));
-                    return 1;
-                }
-            }
+    /**
+     * Push a FString as a Lua string
+     */
+    int32 PushFString(lua_State *L, const FString &String)
+    {
+        const int32 Len = String.Len();
+        const TCHAR *Src = *String;
+        luaL_Buffer Buffer;
+        char *Dst = luaL_buffinitsize(L, &Buffer, Len);
+        const int32 NumAscii = UnLuaStringConv::NarrowAscii(Src, Len, Dst);
+        luaL_addsize(&Buffer, NumAscii);
+        if (NumAscii < Len)
+        {
+            // 从第一个非ASCII字符开始走完整的UTF-8转换
+            FTCHARToUTF8 Utf8(Src + NumAscii, Len - NumAscii);
+            luaL_addlstring(&Buffer, Utf8.Get(), Utf8.Length());
+        }
+        luaL_pushresult(&Buffer);
+        return 1;
+    }
 
-            if (!bAlwaysCreate)
-            {
-                // cache the new userdata in 'StructMap
-                lua_pushlightuserdata(L, Value);
-                lua_pushvalue(L, -2);
-                lua_rawset(L, -4);
-                lua_remove(L, -2);
-            }
+    /**
+     * Get a FString at the given stack index
+     */
+    bool GetFString(lua_State *L, int32 Index, FString &OutString)
+    {
+        size_t Len = 0;
+        const char *Src = lua_tolstring(L, Index, &Len);
+        TArray<TCHAR> &Chars = OutString.GetCharArray();
+        if (!Src || Len == 0)
+        {
+            Chars.Reset();
+            return Src != nullptr;
         }
 
-        return 1;
+        Chars.SetNumUninitialized((int32)Len + 1, false);
+        const int32 NumAscii = UnLuaStringConv::WidenAscii(Src, (int32)Len, Chars.GetData());
+        int32 NumChars = NumAscii;
+        if (NumAscii < (int32)Len)
+        {
+            // 从第一个非ASCII字节开始走完整的UTF-8转换，宽字符数不会超过字节数
+            FUTF8ToTCHAR Wide(Src + NumAscii, (int32)Len - NumAscii);
+            FMemory::Memcpy(Chars.GetData() + NumAscii, Wide.Get(), Wide.Length() * sizeof(TCHAR));
+            NumChars += Wide.Length();
+        }
+        Chars[NumChars] = TEXT('\0');
+        Chars.SetNum(NumChars + 1, false);
+        return true;
     }
 
     /**
@@ -357,26 +349,19 @@ namespace UnLua
             return 1;
         }
 
-        // 从LuaRegistry表中获取ObjectMap，执行完lua栈从底到顶情况：ObjectMap表
-        lua_getfield(L, LUA_REGISTRYINDEX, "ObjectMap");
-        // 将Object指针作为lightuserdata Push到栈顶，执行完lua栈从底到顶情况：ObjectMap表、lightuserdata
-        lua_pushlightuserdata(L, Object);
-        // 获取ObjectMap.lightuserdata，在NewLuaObject函数分析时，Lua对象和C++对象绑定在了ObjectMap中，
+        // 先从代理索引中查找，在NewLuaObject函数分析时，Lua对象和C++对象绑定在了索引中，
         // 所以此时会获取到之前绑定的LuaInstance，即路径对应lua对象实例
-        // 或者没有绑定Lua对象，得到nil
-        // 执行完lua栈从底到顶情况：ObjectMap表、LuaInstance或者nil
-        int32 Type = lua_rawget(L, -2);     // find the object from 'ObjectMap' first
-        if (Type == LUA_TNIL)
+        FLuaObjectIndex &ObjectIndex = GLuaCxt->GetObjectIndex();
+        if (!ObjectIndex.PushObject(L, Object))             // find the object from the object index first
         {
-            // 创建一个userdata返回给lua，并在ObjectMap中和属性对象进行绑定
+            // 创建一个userdata返回给lua，并在索引中和属性对象进行绑定
             // 也就是说，有lua绑定的UObject传LuaInstance给Lua，没lua绑定的UObject传userdata给Lua
-            // 1. create a new userdata for the object if it's not found; 2. cache it in 'ObjectMap'
-            // 创建完UserData后，同样会被记录到"ObjectMap"表中
-            lua_pop(L, 1);
+            // 1. create a new userdata for the object if it's not found; 2. cache it in the object index
             PushObjectCore(L, Object);
-            lua_pushlightuserdata(L, Object);
-            lua_pushvalue(L, -2);
-            lua_rawset(L, -4);
+            if (!lua_isnil(L, -1))
+            {
+                ObjectIndex.AddObject(L, Object, -1);
+            }
 
             if (bAddRef && !Object->IsNative())
             {
@@ -384,7 +369,6 @@ namespace UnLua
                 GObjectReferencer.AddObjectRef((UObject*)Object);       // add a reference for the object if it's a non-native object
             }
         }
-        lua_remove(L, -2);
 
         return 1;
     }
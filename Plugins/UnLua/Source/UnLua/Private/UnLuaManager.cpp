@@ -16,6 +16,7 @@
 #include "UnLua.h"
 #include "UnLuaInterface.h"
 #include "LuaCore.h"
+#include "LuaClassCache.h"
 #include "LuaContext.h"
 #include "LuaFunctionInjection.h"
 #include "DelegateHelper.h"
@@ -65,9 +66,9 @@ UUnLuaManager::UUnLuaManager()
  *（2）为新UObject 注册（RegisterClass）元表
  *（3）根据Lua模块，重写新UObject中可被重写的UFunction的反射信息，注意这里是直接在UFunction上改写
  *（4）创建Lua对象，并做设元表、设Object等变量、放入全局引用等初始化，
- * 并把Lua对象和lightuserdata（UObject指针）的映射放入ObjectMap中，ObjectMap是Lua中的对象
- *（5）使新UObject被全局持有，并把Lua对象索引和UObject映射放入AttachedObjects中，AttachedObjects是C++中的对象，
- * 和Lua中的ObjectMap对象相似
+ * 并把UObject到Lua对象的映射放入FLuaObjectIndex代理索引中
+ *（5）使新UObject被全局持有，并把Lua对象索引和UObject映射放入AttachedObjects中，AttachedObjects是强引用，
+ * 而代理索引中的Lua对象是弱引用
  */
 bool UUnLuaManager::Bind(UObjectBaseUtility *Object, UClass *Class, const TCHAR *InModuleName, int32 InitializerTableRef)
 {   
@@ -227,7 +228,9 @@ bool UUnLuaManager::OnModuleHotfixed(const TCHAR *InModuleName)
             }
         }
     }
-        
+
+    FLuaClassCache::Invalidate();
+    InvalidateUdataInlineCache(*GLuaCxt);
     return true;
 }
 
@@ -382,6 +385,8 @@ void UUnLuaManager::OnClassCleanup(UClass *Class)
             DerivedClass->ClearFunctionMapsCaches();            // clean up cached UFunctions of super class
         }
     }
+
+    GReflectionRegistry.InvalidateDispatchCaches();
 }
 
 /**
@@ -425,6 +430,7 @@ void UUnLuaManager::ResetUFunction(UFunction *Function, FNativeFuncPtr NativeFun
  */
 void UUnLuaManager::RemoveDuplicatedFunctions(UClass *Class, TArray<UFunction*> &Functions)
 {
+    GReflectionRegistry.InvalidateDispatchCaches();
     for (UFunction *Function : Functions)
     {
         RemoveUFunction(Function, Class);                       // clean up duplicated UFunction
@@ -799,6 +805,8 @@ void UUnLuaManager::AddFunction(UFunction *TemplateFunction, UClass *OuterClass,
         OverrideUFunction(NewFunc, (FNativeFuncPtr)&FLuaInvoker::execCallLua, GReflectionRegistry.RegisterFunction(NewFunc));   // replace thunk function and insert opcodes
         TArray<UFunction*> &DuplicatedFuncs = DuplicatedFunctions.FindOrAdd(OuterClass);
         DuplicatedFuncs.AddUnique(NewFunc);
+        // FindFunctionByName的结果变了
+        GReflectionRegistry.InvalidateDispatchCaches();         // function map of 'OuterClass' changed
 #if ENABLE_CALL_OVERRIDDEN_FUNCTION
         GReflectionRegistry.AddOverriddenFunction(NewFunc, TemplateFunction);
 #else
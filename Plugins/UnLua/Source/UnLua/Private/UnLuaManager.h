@@ -58,6 +58,9 @@ public:
     // 释放一个Lua引用的UObject引用
     void ReleaseAttachedObjectLuaRef(UObjectBaseUtility* Object);
 
+    // 已绑定的UObject及其LuaInstance的引用
+    const TMap<UObjectBaseUtility*, int32>& GetAttachedObjects() const { return AttachedObjects; }
+
     // 当地图加载
     void OnMapLoaded(UWorld *World);
 
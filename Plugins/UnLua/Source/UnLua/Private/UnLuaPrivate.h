@@ -46,6 +46,21 @@ DECLARE_STATS_GROUP(TEXT("UnLua"), STATGROUP_UnLua, STATCAT_Advanced);
 DECLARE_MEMORY_STAT_EXTERN(TEXT("Lua Memory"), STAT_UnLua_Lua_Memory, STATGROUP_UnLua, /*UNLUA_API*/);
 DECLARE_MEMORY_STAT_EXTERN(TEXT("Persistent Parameter Buffer Memory"), STAT_UnLua_PersistentParamBuffer_Memory, STATGROUP_UnLua, /*UNLUA_API*/);
 DECLARE_MEMORY_STAT_EXTERN(TEXT("OutParmRec Memory"), STAT_UnLua_OutParmRec_Memory, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Bytecode Cache Hits"), STAT_UnLua_BytecodeCache_Hits, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Bytecode Cache Misses"), STAT_UnLua_BytecodeCache_Misses, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Bytecode Cache Parse Time Saved (ms)"), STAT_UnLua_BytecodeCache_MsSaved, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Lua GC Time (ms)"), STAT_UnLua_GC_Time, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Lua GC Steps"), STAT_UnLua_GC_Steps, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Lua GC Heap"), STAT_UnLua_GC_Heap, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Lua GC Max Pause (ms)"), STAT_UnLua_GC_MaxPause, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Lua GC Minor Collections"), STAT_UnLua_GC_MinorCollections, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Lua GC Major Collections"), STAT_UnLua_GC_MajorCollections, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Lua GC Generational"), STAT_UnLua_GC_Mode, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Lua GC Minor Multiplier"), STAT_UnLua_GC_MinorMul, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Lua GC Pause"), STAT_UnLua_GC_PauseParam, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Lua GC Step Multiplier"), STAT_UnLua_GC_StepMul, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Cross Heap GC Reclaimed Objects"), STAT_UnLua_CrossGC_Objects, STATGROUP_UnLua, /*UNLUA_API*/);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Cross Heap GC Reclaimed Memory"), STAT_UnLua_CrossGC_Memory, STATGROUP_UnLua, /*UNLUA_API*/);
 #endif
 
 UNLUA_API bool HotfixLua();
@@ -276,56 +276,47 @@ namespace UnLua
 
     FORCEINLINE int32 Push(lua_State *L, FString &V, bool bCopy = false)
     {
-        lua_pushstring(L, TCHAR_TO_UTF8(*V));
-        return 1;
+        return PushFString(L, V);
     }
 
     FORCEINLINE int32 Push(lua_State *L, const FString &V, bool bCopy = false)
     {
-        lua_pushstring(L, TCHAR_TO_UTF8(*V));
-        return 1;
+        return PushFString(L, V);
     }
 
     FORCEINLINE int32 Push(lua_State *L, FString &&V, bool bCopy = false)
     {
-        lua_pushstring(L, TCHAR_TO_UTF8(*V));
-        return 1;
+        return PushFString(L, V);
     }
 
     FORCEINLINE int32 Push(lua_State *L, FName &V, bool bCopy = false)
     {
-        lua_pushstring(L, TCHAR_TO_UTF8(*V.ToString()));
-        return 1;
+        return PushFName(L, V);
     }
 
     FORCEINLINE int32 Push(lua_State *L, const FName &V, bool bCopy = false)
     {
-        lua_pushstring(L, TCHAR_TO_UTF8(*V.ToString()));
-        return 1;
+        return PushFName(L, V);
     }
 
     FORCEINLINE int32 Push(lua_State *L, FName &&V, bool bCopy = false)
     {
-        lua_pushstring(L, TCHAR_TO_UTF8(*V.ToString()));
-        return 1;
+        return PushFName(L, V);
     }
 
     FORCEINLINE int32 Push(lua_State *L, FText &V, bool bCopy = false)
     {
-        lua_pushstring(L, TCHAR_TO_UTF8(*V.ToString()));
-        return 1;
+        return PushFString(L, V.ToString());
     }
 
     FORCEINLINE int32 Push(lua_State *L, const FText &V, bool bCopy = false)
     {
-        lua_pushstring(L, TCHAR_TO_UTF8(*V.ToString()));
-        return 1;
+        return PushFString(L, V.ToString());
     }
 
     FORCEINLINE int32 Push(lua_State *L, FText &&V, bool bCopy = false)
     {
-        lua_pushstring(L, TCHAR_TO_UTF8(*V.ToString()));
-        return 1;
+        return PushFString(L, V.ToString());
     }
 
     FORCEINLINE int32 Push(lua_State *L, void *V, bool bCopy = false)
@@ -702,17 +693,21 @@ namespace UnLua
 
     FORCEINLINE FString Get(lua_State *L, int32 Index, TType<FString>)
     {
-        return UTF8_TO_TCHAR(lua_tostring(L, Index));
+        FString String;
+        GetFString(L, Index, String);
+        return String;
     }
 
     FORCEINLINE FName Get(lua_State *L, int32 Index, TType<FName>)
     {
-        return FName(lua_tostring(L, Index));
+        return GetFName(L, Index);
     }
 
     FORCEINLINE FText Get(lua_State *L, int32 Index, TType<FText>)
     {
-        return FText::FromString(UTF8_TO_TCHAR(lua_tostring(L, Index)));
+        FString String;
+        GetFString(L, Index, String);
+        return FText::FromString(MoveTemp(String));
     }
 
     FORCEINLINE UObject* Get(lua_State *L, int32 Index, TType<UObject*>)
@@ -271,6 +271,16 @@ namespace UnLua
      */
     UNLUA_API bool RunChunk(lua_State *L, const char *Chunk);
 
+    /**
+     * Call the Lua function at -(NumArgs + 1) in protected mode, same as lua_pcall. Allocations during the call are
+     * attributed to the function when 'unlua.MemTrack.Start' is on
+     * 保护模式调用Lua函数，和lua_pcall一致，开启内存追踪时把调用期间的分配归属到被调函数
+     *
+     * @param MessageHandlerIdx - Lua stack index of the message handler, 0 if there is none
+     * @return - status code of lua_pcall
+     */
+    UNLUA_API int32 PCall(lua_State *L, int32 NumArgs, int32 NumResults, int32 MessageHandlerIdx);
+
     /**
      * Report Lua error
      * Lua调用错误报告
@@ -300,6 +310,43 @@ namespace UnLua
      */
     UNLUA_API void* GetPointer(lua_State *L, int32 Index, bool *OutTwoLvlPtr = nullptr);
 
+    /**
+     * Push a FName as a Lua string, the string is cached so pushing the same FName again doesn't convert or allocate
+     * Push一个FName，转换后的Lua字符串会被缓存
+     *
+     * @param Name - the FName
+     * @return - the number of results on Lua stack
+     */
+    UNLUA_API int32 PushFName(lua_State *L, FName Name);
+
+    /**
+     * Get a FName at the given stack index, short Lua strings are mapped to FNames through a cache
+     * 获取给定栈位置的FName，短字符串通过缓存转换
+     *
+     * @param Index - Lua stack index
+     * @return - the FName, NAME_None if the value isn't a string or a number
+     */
+    UNLUA_API FName GetFName(lua_State *L, int32 Index);
+
+    /**
+     * Push a FString as a Lua string, ASCII strings are narrowed straight into the Lua buffer
+     * Push一个FString，ASCII字符串直接窄化到Lua的缓冲区，不需要临时的转换缓冲
+     *
+     * @param String - the FString
+     * @return - the number of results on Lua stack
+     */
+    UNLUA_API int32 PushFString(lua_State *L, const FString &String);
+
+    /**
+     * Get a FString at the given stack index, the characters are written into OutString's allocation
+     * 获取给定栈位置的FString，直接写入OutString已有的内存
+     *
+     * @param Index - Lua stack index
+     * @param[out] OutString - the FString, empty if the value isn't a string or a number
+     * @return - whether the value is a string or a number
+     */
+    UNLUA_API bool GetFString(lua_State *L, int32 Index, FString &OutString);
+
     /**
      * Push a UObject
      * PushUObject
@@ -145,6 +145,38 @@ public class UnLua : ModuleRules
             PublicDefinitions.Add("UNLUA_ENABLE_DEBUG=0");
         }
 
+        // loads unverified bytecode from Saved/, never compiled into Shipping/Test builds
+        bool bEnableBytecodeCache = false;
+        if (bEnableBytecodeCache && Target.Configuration != UnrealTargetConfiguration.Shipping && Target.Configuration != UnrealTargetConfiguration.Test)
+        {
+            PublicDefinitions.Add("ENABLE_BYTECODE_CACHE=1");
+        }
+        else
+        {
+            PublicDefinitions.Add("ENABLE_BYTECODE_CACHE=0");
+        }
+
+        bool bEnableGCScheduler = false;
+        if (bEnableGCScheduler)
+        {
+            PublicDefinitions.Add("ENABLE_GC_SCHEDULER=1");
+        }
+        else
+        {
+            PublicDefinitions.Add("ENABLE_GC_SCHEDULER=0");
+        }
+
+        // size-class pooled allocator for the main Lua state, not thread safe, opt-in until it has more production use
+        bool bEnableSmallObjectAllocator = false;
+        if (bEnableSmallObjectAllocator)
+        {
+            PublicDefinitions.Add("ENABLE_SMALL_OBJECT_ALLOCATOR=1");
+        }
+        else
+        {
+            PublicDefinitions.Add("ENABLE_SMALL_OBJECT_ALLOCATOR=0");
+        }
+
     }
 
     private void SetupScripts()
@@ -0,0 +1,34 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+// 
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License"); 
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, 
+// software distributed under the License is distributed on an "AS IS" BASIS, 
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. 
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "UnLuaBundleCommandlet.generated.h"
+
+/**
+ * Pack all scripts under 'Content/Script' into a bundle of precompiled bytecode, see FLuaScriptBundle
+ * 把'Content/Script'下的所有脚本编译打包成一个脚本包，见FLuaScriptBundle
+ *
+ * Usage: UE4Editor-Cmd.exe <Project> -run=UnLuaBundle [-Output=<Path>] [-Compress] [-KeepDebugInfo]
+ * 默认输出到'Content/ScriptBundle/Script.ulb'，需要把'ScriptBundle'加到'DirectoriesToAlwaysStageAsNonUFS'里，运行时才能内存映射
+ */
+UCLASS()
+class UUnLuaBundleCommandlet : public UCommandlet
+{
+    GENERATED_UCLASS_BODY()
+
+public:
+    virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,153 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+// 
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License"); 
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, 
+// software distributed under the License is distributed on an "AS IS" BASIS, 
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. 
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "Commandlets/UnLuaBundleCommandlet.h"
+#include "UnLuaPrivate.h"
+#include "LuaScriptBundle.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "lua.hpp"
+
+namespace
+{
+    struct FBundleModule
+    {
+        TArray<ANSICHAR> Name;              // 'Weapon/BP_Rifle', not null terminated
+        TArray<uint8> Data;
+        uint32 RawSize;
+        uint32 Flags;
+    };
+
+    static int WriteBytecode(lua_State *L, const void *Data, size_t Size, void *Buffer)
+    {
+        ((TArray<uint8>*)Buffer)->Append((const uint8*)Data, Size);
+        return 0;
+    }
+}
+
+UUnLuaBundleCommandlet::UUnLuaBundleCommandlet(const FObjectInitializer& ObjectInitializer)
+    : Super(ObjectInitializer)
+{
+}
+
+int32 UUnLuaBundleCommandlet::Main(const FString &Params)
+{
+    FString OutputPath = FPaths::ProjectContentDir() / TEXT("ScriptBundle/Script.ulb");
+    FParse::Value(*Params, TEXT("Output="), OutputPath);
+    const bool bCompress = FParse::Param(*Params, TEXT("Compress"));
+    const bool bStrip = !FParse::Param(*Params, TEXT("KeepDebugInfo"));
+
+    TArray<FString> Files;
+    IFileManager::Get().FindFilesRecursive(Files, *GLuaSrcFullPath, TEXT("*.lua"), true, false);
+
+    // 只编译不运行，用一个独立的虚拟机即可
+    lua_State *L = luaL_newstate();
+    TArray<FBundleModule> Modules;
+    int32 NumErrors = 0;
+    for (const FString &File : Files)
+    {
+        FString RelativePath = File;
+        FPaths::MakePathRelativeTo(RelativePath, *GLuaSrcFullPath);
+
+        TArray<uint8> Source;
+        if (!FFileHelper::LoadFileToArray(Source, *File))
+        {
+            UE_LOG(LogUnLua, Error, TEXT("Failed to read %s"), *File);
+            ++NumErrors;
+            continue;
+        }
+
+        int32 SkipLen = (3 < Source.Num()) && (0xEF == Source[0]) && (0xBB == Source[1]) && (0xBF == Source[2]) ? 3 : 0;        // skip UTF-8 BOM mark
+        if (luaL_loadbufferx(L, (const char*)Source.GetData() + SkipLen, Source.Num() - SkipLen, TCHAR_TO_UTF8(*RelativePath), "t") != LUA_OK)
+        {
+            UE_LOG(LogUnLua, Error, TEXT("Failed to compile %s: %s"), *File, UTF8_TO_TCHAR(lua_tostring(L, -1)));
+            lua_pop(L, 1);
+            ++NumErrors;
+            continue;
+        }
+
+        FBundleModule &Module = Modules.AddDefaulted_GetRef();
+        lua_dump(L, WriteBytecode, &Module.Data, bStrip);
+        lua_pop(L, 1);
+        Module.RawSize = Module.Data.Num();
+        Module.Flags = 0;
+
+        FTCHARToUTF8 ModuleName(*FPaths::GetBaseFilename(RelativePath, false));
+        Module.Name.Append(ModuleName.Get(), ModuleName.Length());
+
+        if (bCompress)
+        {
+            int32 CompressedSize = FCompression::CompressMemoryBound(NAME_LZ4, Module.RawSize);
+            TArray<uint8> Compressed;
+            Compressed.SetNumUninitialized(CompressedSize);
+            if (FCompression::CompressMemory(NAME_LZ4, Compressed.GetData(), CompressedSize, Module.Data.GetData(), Module.RawSize) && (uint32)CompressedSize < Module.RawSize)
+            {
+                Compressed.SetNum(CompressedSize);
+                Module.Data = MoveTemp(Compressed);
+                Module.Flags |= FLuaScriptBundle::EntryFlag_LZ4;
+            }
+        }
+    }
+    lua_close(L);
+
+    if (NumErrors > 0)
+    {
+        UE_LOG(LogUnLua, Error, TEXT("%d Lua scripts failed, bundle not written"), NumErrors);
+        return 1;
+    }
+
+    // 索引按模块名排序，运行时二分查找
+    Modules.Sort([](const FBundleModule &A, const FBundleModule &B)
+    {
+        return FLuaScriptBundle::CompareNames(A.Name.GetData(), A.Name.Num(), B.Name.GetData(), B.Name.Num()) < 0;
+    });
+
+    TArray<uint8> Bundle;
+    Bundle.AddZeroed(sizeof(FLuaScriptBundle::FHeader) + Modules.Num() * sizeof(FLuaScriptBundle::FEntry));
+    TArray<FLuaScriptBundle::FEntry> Entries;
+    Entries.SetNumZeroed(Modules.Num());
+    for (int32 i = 0; i < Modules.Num(); ++i)
+    {
+        Entries[i].NameOffset = Bundle.Num();
+        Entries[i].NameSize = Modules[i].Name.Num();
+        Bundle.Append((const uint8*)Modules[i].Name.GetData(), Modules[i].Name.Num());
+    }
+    for (int32 i = 0; i < Modules.Num(); ++i)
+    {
+        Bundle.AddZeroed(Align(Bundle.Num(), 8) - Bundle.Num());
+        Entries[i].DataOffset = Bundle.Num();
+        Entries[i].DataSize = Modules[i].Data.Num();
+        Entries[i].RawSize = Modules[i].RawSize;
+        Entries[i].Flags = Modules[i].Flags;
+        Bundle.Append(Modules[i].Data);
+    }
+
+    FLuaScriptBundle::FHeader Header;
+    Header.Magic = FLuaScriptBundle::Magic;
+    Header.FormatVersion = FLuaScriptBundle::FormatVersion;
+    Header.LuaVersion = LUA_VERSION_RELEASE_NUM;
+    Header.NumEntries = Modules.Num();
+    FMemory::Memcpy(Bundle.GetData(), &Header, sizeof(Header));
+    FMemory::Memcpy(Bundle.GetData() + sizeof(Header), Entries.GetData(), Entries.Num() * sizeof(FLuaScriptBundle::FEntry));
+
+    if (!FFileHelper::SaveArrayToFile(Bundle, *OutputPath))
+    {
+        UE_LOG(LogUnLua, Error, TEXT("Failed to write Lua script bundle %s"), *OutputPath);
+        return 1;
+    }
+
+    UE_LOG(LogUnLua, Display, TEXT("Wrote Lua script bundle %s, %d modules, %d bytes"), *OutputPath, Modules.Num(), Bundle.Num());
+    return 0;
+}
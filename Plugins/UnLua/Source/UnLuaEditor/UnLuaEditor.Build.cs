@@ -65,7 +65,8 @@ public class UnLuaEditor : ModuleRules
                 "UMG",
                 "Slate",
                 "SlateCore",
-                "UnLua"
+                "UnLua",
+                "Lua"
             }
         );
 
@@ -0,0 +1,193 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaAllocator.h"
+#include "UnLuaBase.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+#include "UnLuaBenchmark.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace UnLuaAllocatorBenchmark
+{
+    static constexpr int32 NumSlots = 100000;
+    static constexpr int32 NumOps = 4000000;
+
+    // the previous 'FLuaContext::LuaAllocator' without stats
+    static void* FMemoryAlloc(void* ud, void* ptr, size_t osize, size_t nsize)
+    {
+        if (nsize == 0)
+        {
+            FMemory::Free(ptr);
+            return nullptr;
+        }
+        return FMemory::Realloc(ptr, nsize);
+    }
+
+    static void* PooledAlloc(void* ud, void* ptr, size_t osize, size_t nsize)
+    {
+        return ((FLuaAllocator*)ud)->Realloc(ptr, osize, nsize);
+    }
+
+    // mostly 16~128 bytes like tables, closures, short strings and userdata, sometimes an array part or a long string
+    static int32 RandomSize(FRandomStream& Random)
+    {
+        return Random.FRand() < 0.9f ? Random.RandRange(16, 128) : Random.RandRange(129, 2048);
+    }
+
+    struct FResult
+    {
+        double NsPerOp;
+        uint64 LiveBytes;
+    };
+
+    static FResult RunSynthetic(lua_Alloc Alloc, void* ud)
+    {
+        TArray<void*> Blocks;
+        TArray<int32> Sizes;
+        Blocks.SetNumZeroed(NumSlots);
+        Sizes.SetNumZeroed(NumSlots);
+
+        FRandomStream Random(1234);
+        uint64 LiveBytes = 0;
+        const double NsPerOp = UnLuaBenchmark::MeasureNs(NumOps, [&](int64)
+        {
+            const int32 Slot = Random.RandHelper(NumSlots);
+            if (!Blocks[Slot])
+            {
+                Sizes[Slot] = RandomSize(Random);
+                Blocks[Slot] = Alloc(ud, nullptr, LUA_TTABLE, Sizes[Slot]);
+                LiveBytes += Sizes[Slot];
+            }
+            else if (Random.FRand() < 0.2f)
+            {
+                const int32 NewSize = RandomSize(Random);
+                Blocks[Slot] = Alloc(ud, Blocks[Slot], Sizes[Slot], NewSize);
+                LiveBytes += NewSize - Sizes[Slot];
+                Sizes[Slot] = NewSize;
+            }
+            else
+            {
+                Alloc(ud, Blocks[Slot], Sizes[Slot], 0);
+                Blocks[Slot] = nullptr;
+                LiveBytes -= Sizes[Slot];
+            }
+        });
+
+        FResult Result = { NsPerOp, LiveBytes };
+        for (int32 Slot = 0; Slot < NumSlots; ++Slot)
+        {
+            if (Blocks[Slot])
+            {
+                Alloc(ud, Blocks[Slot], Sizes[Slot], 0);
+            }
+        }
+        return Result;
+    }
+
+    static const char* Script = R"(
+        local t = {}
+        for i = 1, 200000 do
+            local v = { x = i, y = i * 2, name = "item" .. (i % 1000) }
+            v.f = function() return v.x end
+            t[i % 5000 + 1] = v
+        end
+        collectgarbage("collect")
+    )";
+
+    static double RunScript(lua_Alloc Alloc, void* ud, bool& bOutOk)
+    {
+        lua_State* L = lua_newstate(Alloc, ud);
+        luaL_openlibs(L);
+        const double Ms = UnLuaBenchmark::MeasureNs(1, [L, &bOutOk](int64) { bOutOk = luaL_dostring(L, Script) == LUA_OK; }) / 1e6;
+        lua_close(L);
+        return Ms;
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FUnLuaBenchmark_LuaAllocator, TEXT("UnLua.Benchmark.LuaAllocator Lua内存分配器，分级小对象池对比FMemory"),
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter);
+
+bool FUnLuaBenchmark_LuaAllocator::RunTest(const FString& Parameters)
+{
+    using namespace UnLuaAllocatorBenchmark;
+
+    // correctness
+    {
+        FLuaAllocator Allocator;
+        uint8* Block = (uint8*)Allocator.Realloc(nullptr, LUA_TSTRING, 24);
+        FMemory::Memset(Block, 0xAB, 24);
+        Block = (uint8*)Allocator.Realloc(Block, 24, 300);                  // small -> large keeps the content
+        TestEqual(TEXT("Realloc keeps content"), (int32)Block[23], 0xAB);
+        TestEqual(TEXT("Large live bytes"), Allocator.GetLargeStats().LiveBytes, (uint64)300);
+        Block = (uint8*)Allocator.Realloc(Block, 300, 20);
+        TestEqual(TEXT("Small live bytes"), Allocator.GetSizeClassStats(1).LiveBytes, (uint64)20);
+        Allocator.Realloc(Block, 20, 0);
+        TestEqual(TEXT("No live bytes"), Allocator.GetLiveBytes(), (uint64)0);
+    }
+
+    const FResult MallocResult = RunSynthetic(FMemoryAlloc, nullptr);
+
+    FLuaAllocator Allocator;
+    const FResult PooledResult = RunSynthetic(PooledAlloc, &Allocator);
+
+    // 碎片：分配一批块后释放一半，FMemory只能统计到分级带来的内部碎片(GetAllocSize)
+    FRandomStream Random(5678);
+    TArray<TPair<void*, int32>> Survivors;
+    TArray<void*> MallocSurvivors;
+    for (int32 i = 0; i < NumSlots; ++i)
+    {
+        const int32 Size = RandomSize(Random);
+        Survivors.Emplace(Allocator.Realloc(nullptr, LUA_TTABLE, Size), Size);
+        MallocSurvivors.Add(FMemory::Malloc(Size));
+    }
+    uint64 MallocRequested = 0, MallocReserved = 0;
+    for (int32 i = 0; i < Survivors.Num(); ++i)
+    {
+        if (i % 2 == 0)
+        {
+            Allocator.Realloc(Survivors[i].Key, Survivors[i].Value, 0);
+            FMemory::Free(MallocSurvivors[i]);
+        }
+        else
+        {
+            MallocRequested += Survivors[i].Value;
+            MallocReserved += FMemory::GetAllocSize(MallocSurvivors[i]);
+        }
+    }
+    const double PooledFragmentation = (double)Allocator.GetReservedBytes() / FMath::Max<uint64>(Allocator.GetLiveBytes(), 1);
+    const double MallocFragmentation = (double)MallocReserved / FMath::Max<uint64>(MallocRequested, 1);
+    for (int32 i = 1; i < Survivors.Num(); i += 2)
+    {
+        Allocator.Realloc(Survivors[i].Key, Survivors[i].Value, 0);
+        FMemory::Free(MallocSurvivors[i]);
+    }
+
+    bool bMallocScriptOk = false, bPooledScriptOk = false;
+    const double MallocScriptMs = RunScript(FMemoryAlloc, nullptr, bMallocScriptOk);
+    const double PooledScriptMs = RunScript(PooledAlloc, &Allocator, bPooledScriptOk);
+    TestTrue(TEXT("Script with FMemory"), bMallocScriptOk);
+    TestTrue(TEXT("Script with FLuaAllocator"), bPooledScriptOk);
+
+    UnLuaBenchmark::AddComparison(*this, TEXT("random alloc/realloc/free"), TEXT("ns/op"), TEXT("FMemory"), MallocResult.NsPerOp, TEXT("FLuaAllocator"), PooledResult.NsPerOp);
+    AddInfo(FString::Printf(TEXT("reserved/live after freeing every other block: FMemory %.2f (size class slack only), FLuaAllocator %.2f"), MallocFragmentation, PooledFragmentation));
+    UnLuaBenchmark::AddComparison(*this, TEXT("table/closure/string script"), TEXT("ms"), TEXT("FMemory"), MallocScriptMs, TEXT("FLuaAllocator"), PooledScriptMs);
+
+    TestEqual(TEXT("Same workload"), PooledResult.LiveBytes, MallocResult.LiveBytes);
+    TestEqual(TEXT("Everything freed"), Allocator.GetLiveBytes(), (uint64)0);
+    return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,199 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+
+#include "UnLuaBase.h"
+#include "Containers/LuaMap.h"
+#include "Containers/LuaSet.h"
+#include "ReflectionUtils/PropertyCreator.h"
+#include "Misc/AutomationTest.h"
+#include "UnLuaBenchmark.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace UnLuaContainerBenchmark
+{
+    static constexpr int32 NumKeys = 10000;
+    static constexpr int32 NumLookups = 2000000;
+
+    struct FResult
+    {
+        double GenericNs;
+        double FastNs;
+        int32 FoundGeneric;
+        int32 FoundFast;
+    };
+
+    // the previous path: marshal the key to ElementCache through the ITypeInterface, then hash and compare with virtual calls
+    static bool FindGeneric(lua_State* L, FLuaMap& Map, int32 KeyIndex)
+    {
+        Map.KeyInterface->Initialize(Map.ElementCache);
+        Map.KeyInterface->Write(L, Map.ElementCache, KeyIndex);
+        const bool bFound = Map.Find(Map.ElementCache) != nullptr;
+        Map.KeyInterface->Destruct(Map.ElementCache);
+        return bFound;
+    }
+
+    static bool FindFast(lua_State* L, FLuaMap& Map, int32 KeyIndex)
+    {
+        // a key missing the fast path counts as not found, so the results differ from FindGeneric
+        uint8* Value = nullptr;
+        return Map.FindFromLua(L, KeyIndex, Value) && Value != nullptr;
+    }
+
+    static bool ContainsGeneric(lua_State* L, FLuaSet& Set, int32 Index)
+    {
+        Set.ElementInterface->Initialize(Set.ElementCache);
+        Set.ElementInterface->Write(L, Set.ElementCache, Index);
+        const bool bFound = Set.Contains(Set.ElementCache);
+        Set.ElementInterface->Destruct(Set.ElementCache);
+        return bFound;
+    }
+
+    static bool ContainsFast(lua_State* L, FLuaSet& Set, int32 Index)
+    {
+        int32 FoundIndex = INDEX_NONE;
+        return Set.FindFromLua(L, Index, FoundIndex) && FoundIndex != INDEX_NONE;
+    }
+
+    // 平均每次查找的耗时，Lua值从KeysIndex处的数组表里轮流取
+    template <typename ContainerType, typename GenericType, typename FastType>
+    static FResult Run(lua_State* L, ContainerType& Container, int32 KeysIndex, GenericType Generic, FastType Fast)
+    {
+        const int32 Num = (int32)lua_rawlen(L, KeysIndex);
+
+        FResult Result = { 0.0, 0.0, 0, 0 };
+        Result.GenericNs = UnLuaBenchmark::MeasureNs(NumLookups, [&](int64 i)
+        {
+            lua_rawgeti(L, KeysIndex, i % Num + 1);
+            Result.FoundGeneric += Generic(L, Container, lua_gettop(L));
+            lua_pop(L, 1);
+        });
+        Result.FastNs = UnLuaBenchmark::MeasureNs(NumLookups, [&](int64 i)
+        {
+            lua_rawgeti(L, KeysIndex, i % Num + 1);
+            Result.FoundFast += Fast(L, Container, lua_gettop(L));
+            lua_pop(L, 1);
+        });
+        return Result;
+    }
+
+    // 一半命中一半不命中
+    template <typename KeyFuncType>
+    static int32 PushKeys(lua_State* L, KeyFuncType KeyFunc)
+    {
+        lua_createtable(L, NumKeys * 2, 0);
+        for (int32 i = 0; i < NumKeys * 2; ++i)
+        {
+            KeyFunc(i % 2 == 0 ? i / 2 : NumKeys + i);
+            lua_rawseti(L, -2, i + 1);
+        }
+        return lua_gettop(L);
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FUnLuaBenchmark_LuaContainer, TEXT("UnLua.Benchmark.LuaContainer TMap/TSet查找，按类型直接由Lua值计算hash对比经过ElementCache和虚函数"),
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter);
+
+bool FUnLuaBenchmark_LuaContainer::RunTest(const FString& Parameters)
+{
+    using namespace UnLuaContainerBenchmark;
+
+    UnLua::Startup();
+    lua_State* L = UnLua::CreateState();
+
+    // the containers only live in this scope, they are gone before the property interfaces are cleaned up
+    {
+        TMap<int32, int32> IntMap;
+        TMap<FName, int32> NameMap;
+        TMap<FString, int32> StringMap;
+        TSet<int32> IntSet;
+        for (int32 i = 0; i < NumKeys; ++i)
+        {
+            IntMap.Add(i * 3, i);
+            NameMap.Add(FName(*FString::Printf(TEXT("ContainerBenchmark_%d"), i)), i);
+            StringMap.Add(FString::Printf(TEXT("Key_%d"), i), i);
+            IntSet.Add(i * 3);
+        }
+
+        const TSharedPtr<UnLua::ITypeInterface> IntInterface = GPropertyCreator.CreateIntProperty();
+        FLuaMap LuaIntMap((const FScriptMap*)&IntMap, IntInterface, IntInterface);
+        FLuaMap LuaNameMap((const FScriptMap*)&NameMap, GPropertyCreator.CreateNameProperty(), IntInterface);
+        FLuaMap LuaStringMap((const FScriptMap*)&StringMap, GPropertyCreator.CreateStringProperty(), IntInterface);
+        FLuaSet LuaIntSet((const FScriptSet*)&IntSet, IntInterface);
+
+        // correctness: the fast path finds the same keys as C++, FString keys are case-insensitive, missing FNames aren't added
+        {
+            uint8* Value = nullptr;
+            lua_pushinteger(L, 30);
+            TestTrue(TEXT("Int"), LuaIntMap.FindFromLua(L, -1, Value) && Value && *(int32*)Value == 10);
+            lua_pop(L, 1);
+
+            lua_pushstring(L, "ContainerBenchmark_7");
+            TestTrue(TEXT("Name"), LuaNameMap.FindFromLua(L, -1, Value) && Value && *(int32*)Value == 7);
+            lua_pop(L, 1);
+
+            lua_pushstring(L, "ContainerBenchmark_NotAName");
+            TestTrue(TEXT("Missing name"), LuaNameMap.FindFromLua(L, -1, Value) && !Value);
+            TestTrue(TEXT("Missing name"), FName(TEXT("ContainerBenchmark_NotAName"), FNAME_Find).IsNone());
+            lua_pop(L, 1);
+
+            lua_pushstring(L, "KEY_42");
+            TestTrue(TEXT("String"), LuaStringMap.FindFromLua(L, -1, Value) && Value && *(int32*)Value == 42);
+            lua_pop(L, 1);
+
+            StringMap.Add(TEXT("键_1"), -1);
+            lua_pushstring(L, TCHAR_TO_UTF8(TEXT("键_1")));
+            TestTrue(TEXT("Non-ASCII string"), LuaStringMap.FindFromLua(L, -1, Value) && Value && *(int32*)Value == -1);
+            lua_pop(L, 1);
+            StringMap.Remove(TEXT("键_1"));
+
+            lua_pushinteger(L, 12345 * 3 + 1);
+            TestTrue(TEXT("Add"), LuaIntSet.AddFromLua(L, -1) && IntSet.Contains(12345 * 3 + 1));
+            bool bRemoved = false;
+            TestTrue(TEXT("Remove"), LuaIntSet.RemoveFromLua(L, -1, bRemoved) && bRemoved && !IntSet.Contains(12345 * 3 + 1));
+            lua_pop(L, 1);
+        }
+
+        struct FCase
+        {
+            const TCHAR* Name;
+            FResult Result;
+        };
+        TArray<FCase> Cases;
+
+        const int32 IntKeys = PushKeys(L, [L](int32 i) { lua_pushinteger(L, i * 3); });
+        Cases.Add({ TEXT("TMap<int32, int32>::Find"), Run(L, LuaIntMap, IntKeys, &FindGeneric, &FindFast) });
+        Cases.Add({ TEXT("TSet<int32>::Contains"), Run(L, LuaIntSet, IntKeys, &ContainsGeneric, &ContainsFast) });
+
+        const int32 NameKeys = PushKeys(L, [L](int32 i) { lua_pushstring(L, TCHAR_TO_UTF8(*FString::Printf(TEXT("ContainerBenchmark_%d"), i))); });
+        Cases.Add({ TEXT("TMap<FName, int32>::Find"), Run(L, LuaNameMap, NameKeys, &FindGeneric, &FindFast) });
+
+        const int32 StringKeys = PushKeys(L, [L](int32 i) { lua_pushstring(L, TCHAR_TO_UTF8(*FString::Printf(TEXT("Key_%d"), i))); });
+        Cases.Add({ TEXT("TMap<FString, int32>::Find"), Run(L, LuaStringMap, StringKeys, &FindGeneric, &FindFast) });
+
+        for (const FCase& Case : Cases)
+        {
+            TestEqual(FString::Printf(TEXT("%s finds the same keys"), Case.Name), Case.Result.FoundFast, Case.Result.FoundGeneric);
+            TestEqual(FString::Printf(TEXT("%s finds half of the keys"), Case.Name), Case.Result.FoundFast, NumLookups / 2);
+            UnLuaBenchmark::AddComparison(*this, FString::Printf(TEXT("%s, %d keys, half hits"), Case.Name, NumKeys), TEXT("ns"),
+                TEXT("ElementCache + ITypeInterface"), Case.Result.GenericNs, TEXT("typed hash from the Lua value"), Case.Result.FastNs);
+        }
+    }
+
+    UnLua::Shutdown();
+    return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,181 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "LuaObjectIndex.h"
+#include "UnLuaBase.h"
+#include "UnLuaTestHelpers.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+#include "UnLuaBenchmark.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace UnLuaObjectIndexBenchmark
+{
+    static constexpr int32 NumObjects = 100000;
+    static constexpr int32 NumLookups = 4000000;
+
+    // the previous 'ObjectMap': weak-valued table in the registry keyed by lightuserdata
+    struct FWeakTableMap
+    {
+        explicit FWeakTableMap(lua_State* InL)
+            : L(InL)
+        {
+            lua_newtable(L);
+            lua_newtable(L);
+            lua_pushstring(L, "__mode");
+            lua_pushstring(L, "v");
+            lua_rawset(L, -3);
+            lua_setmetatable(L, -2);
+            lua_setfield(L, LUA_REGISTRYINDEX, "ObjectMap");
+        }
+
+        bool Push(UObject* Object)
+        {
+            lua_getfield(L, LUA_REGISTRYINDEX, "ObjectMap");
+            lua_pushlightuserdata(L, Object);
+            if (lua_rawget(L, -2) == LUA_TNIL)
+            {
+                lua_pop(L, 2);
+                return false;
+            }
+            lua_remove(L, -2);
+            return true;
+        }
+
+        void Add(UObject* Object)
+        {
+            lua_getfield(L, LUA_REGISTRYINDEX, "ObjectMap");
+            lua_pushlightuserdata(L, Object);
+            lua_pushvalue(L, -3);
+            lua_rawset(L, -3);
+            lua_pop(L, 1);
+        }
+
+        lua_State* L;
+    };
+
+    struct FIndexMap
+    {
+        explicit FIndexMap(lua_State* InL)
+            : L(InL)
+        {
+            Index.Initialize(L);
+        }
+
+        bool Push(UObject* Object) { return Index.PushObject(L, Object); }
+        void Add(UObject* Object) { Index.AddObject(L, Object, -1); }
+
+        lua_State* L;
+        FLuaObjectIndex Index;
+    };
+
+    struct FResult
+    {
+        double AddNs;
+        double PushNs;
+        double FullGCMs;
+        int32 Found;
+    };
+
+    // 代理userdata被一张普通表强引用，保证都是存活的
+    template <typename T>
+    static FResult Run(const TArray<UObject*>& Objects)
+    {
+        lua_State* L = luaL_newstate();
+        T Map(L);
+        lua_createtable(L, Objects.Num(), 0);
+        const int32 Anchor = lua_gettop(L);
+
+        FResult Result = { 0.0, 0.0, 0.0, 0 };
+        Result.AddNs = UnLuaBenchmark::MeasureNs(Objects.Num(), [&](int64 i)
+        {
+            *(UObject**)lua_newuserdatauv(L, sizeof(void*), 0) = Objects[i];
+            Map.Add(Objects[i]);
+            lua_rawseti(L, Anchor, i + 1);
+        });
+
+        Result.PushNs = UnLuaBenchmark::MeasureNs(NumLookups, [&](int64 i)
+        {
+            if (Map.Push(Objects[(int32)(i * 7919 % Objects.Num())]))
+            {
+                ++Result.Found;
+                lua_pop(L, 1);
+            }
+        });
+
+        lua_gc(L, LUA_GCCOLLECT, 0);
+        Result.FullGCMs = UnLuaBenchmark::MeasureNs(1, [L](int64) { lua_gc(L, LUA_GCCOLLECT, 0); }) / 1e6;
+
+        lua_close(L);
+        return Result;
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FUnLuaBenchmark_LuaObjectIndex, TEXT("UnLua.Benchmark.LuaObjectIndex 对象代理索引，FLuaObjectIndex对比ObjectMap弱表"),
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter);
+
+bool FUnLuaBenchmark_LuaObjectIndex::RunTest(const FString& Parameters)
+{
+    using namespace UnLuaObjectIndexBenchmark;
+
+    TArray<UObject*> Objects;
+    Objects.Reserve(NumObjects);
+    for (int32 i = 0; i < NumObjects; ++i)
+    {
+        Objects.Add(NewObject<UUnLuaTestStub>(GetTransientPackage()));
+    }
+
+    // correctness: collected proxies and removed objects are misses, their slots are reused
+    {
+        lua_State* L = luaL_newstate();
+        FLuaObjectIndex Index;
+        Index.Initialize(L);
+        for (int32 i = 0; i < 3; ++i)
+        {
+            *(UObject**)lua_newuserdatauv(L, sizeof(void*), 0) = Objects[i];
+            Index.AddObject(L, Objects[i], -1);
+        }
+        lua_pop(L, 1);                                                  // the proxy of Objects[2] is only in the index now
+        Index.RemoveObject(L, Objects[0]);
+        lua_gc(L, LUA_GCCOLLECT, 0);
+        TestFalse(TEXT("Removed"), Index.PushObject(L, Objects[0]));
+        TestTrue(TEXT("Alive"), Index.PushObject(L, Objects[1]) && lua_rawequal(L, -1, -2));
+        lua_pop(L, 1);
+        TestFalse(TEXT("Collected"), Index.PushObject(L, Objects[2]));
+        TestEqual(TEXT("Slots"), Index.GetNumSlots(), 1);
+        lua_close(L);
+    }
+
+    const FResult WeakTableResult = Run<FWeakTableMap>(Objects);
+    const FResult IndexResult = Run<FIndexMap>(Objects);
+
+    TestEqual(TEXT("ObjectMap finds every proxy"), WeakTableResult.Found, NumLookups);
+    TestEqual(TEXT("FLuaObjectIndex finds every proxy"), IndexResult.Found, NumLookups);
+
+    UnLuaBenchmark::AddComparison(*this, FString::Printf(TEXT("%d live proxies, cache a new proxy"), NumObjects), TEXT("ns"),
+        TEXT("ObjectMap"), WeakTableResult.AddNs, TEXT("FLuaObjectIndex"), IndexResult.AddNs);
+    UnLuaBenchmark::AddComparison(*this, FString::Printf(TEXT("%d live proxies, push a cached proxy"), NumObjects), TEXT("ns"),
+        TEXT("ObjectMap"), WeakTableResult.PushNs, TEXT("FLuaObjectIndex"), IndexResult.PushNs);
+    UnLuaBenchmark::AddComparison(*this, FString::Printf(TEXT("%d live proxies, full Lua GC"), NumObjects), TEXT("ms"),
+        TEXT("ObjectMap"), WeakTableResult.FullGCMs, TEXT("FLuaObjectIndex"), IndexResult.FullGCMs);
+
+    for (UObject* Object : Objects)
+    {
+        Object->MarkPendingKill();
+    }
+    return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,139 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "ObjectValidityTable.h"
+#include "Async/Async.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/ScopeLock.h"
+#include "UnLuaBenchmark.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace UnLuaObjectValidityBenchmark
+{
+    static constexpr int32 NumObjects = 200000;
+    static constexpr int32 NumLookups = 4000000;
+
+    // fake object addresses, neither container dereferences them
+    static UObjectBase* MakeObject(int32 Index)
+    {
+        return (UObjectBase*)(UPTRINT)(0x10000000ull + (uint64)Index * 64);
+    }
+
+    // the previous implementation: TMap guarded by a critical section shared by readers and writers
+    struct FLockedMap
+    {
+        void Add(const UObjectBase* Object, int32 Index)
+        {
+            FScopeLock Lock(&CS);
+            Map.Add(const_cast<UObjectBase*>(Object), Index);
+        }
+
+        void Remove(const UObjectBase* Object)
+        {
+            FScopeLock Lock(&CS);
+            Map.Remove(Object);
+        }
+
+        int32 Find(const UObjectBase* Object)
+        {
+            FScopeLock Lock(&CS);
+            const int32* Index = Map.Find(Object);
+            return Index ? *Index : INDEX_NONE;
+        }
+
+        TMap<UObjectBase*, int32> Map;
+        FCriticalSection CS;
+    };
+
+    template <typename T>
+    static double MeasureLookups(T& Container, bool bWithWriter, int64& OutFound)
+    {
+        TAtomic<bool> bStop(false);
+        TFuture<void> Writer;
+        if (bWithWriter)
+        {
+            // simulate the async loading thread creating/deleting objects while the game thread validates
+            Writer = Async(EAsyncExecution::Thread, [&Container, &bStop]()
+            {
+                int32 Serial = NumObjects;
+                while (!bStop.Load(EMemoryOrder::Relaxed))
+                {
+                    UObjectBase* Object = MakeObject(Serial);
+                    Container.Add(Object, Serial);
+                    Container.Remove(Object);
+                    Serial = Serial + 1 < NumObjects * 2 ? Serial + 1 : NumObjects;
+                }
+            });
+        }
+
+        int64 Found = 0;
+        const double Ns = UnLuaBenchmark::MeasureNs(NumLookups, [&Container, &Found](int64 i)
+        {
+            Found += Container.Find(MakeObject((int32)(i * 7919 % NumObjects))) != INDEX_NONE;
+        });
+
+        if (bWithWriter)
+        {
+            bStop.Store(true);
+            Writer.Wait();
+        }
+
+        OutFound = Found;
+        return Ns;
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FUnLuaBenchmark_ObjectValidity, TEXT("UnLua.Benchmark.ObjectValidity 对象有效性检查，无锁表对比TMap+临界区"),
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter);
+
+bool FUnLuaBenchmark_ObjectValidity::RunTest(const FString& Parameters)
+{
+    using namespace UnLuaObjectValidityBenchmark;
+
+    FLockedMap LockedMap;
+    FObjectValidityTable Table;
+    for (int32 i = 0; i < NumObjects; ++i)
+    {
+        LockedMap.Add(MakeObject(i), i);
+        Table.Add(MakeObject(i), i);
+    }
+
+    // correctness
+    TestEqual(TEXT("Num"), Table.Num(), NumObjects);
+    TestEqual(TEXT("Find"), Table.Find(MakeObject(1234)), 1234);
+    Table.Remove(MakeObject(1234));
+    TestEqual(TEXT("Find removed"), Table.Find(MakeObject(1234)), (int32)INDEX_NONE);
+    Table.Add(MakeObject(1234), 1234);
+
+    int64 LockedFound = 0, TableFound = 0;
+    const double LockedNs = MeasureLookups(LockedMap, false, LockedFound);
+    const double TableNs = MeasureLookups(Table, false, TableFound);
+    TestEqual(TEXT("Found"), TableFound, LockedFound);
+    TestEqual(TEXT("Found"), TableFound, (int64)NumLookups);
+    const double LockedContendedNs = MeasureLookups(LockedMap, true, LockedFound);
+    const double TableContendedNs = MeasureLookups(Table, true, TableFound);
+    TestEqual(TEXT("Found with async writer"), TableFound, LockedFound);
+    TestEqual(TEXT("Found with async writer"), TableFound, (int64)NumLookups);
+    Table.ReclaimRetiredTables();
+
+    UnLuaBenchmark::AddComparison(*this, TEXT("IsUObjectValid lookup, uncontended"), TEXT("ns"),
+        TEXT("TMap+FCriticalSection"), LockedNs, TEXT("FObjectValidityTable"), TableNs);
+    UnLuaBenchmark::AddComparison(*this, TEXT("IsUObjectValid lookup, with async writer"), TEXT("ns"),
+        TEXT("TMap+FCriticalSection"), LockedContendedNs, TEXT("FObjectValidityTable"), TableContendedNs);
+
+    return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,130 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+
+#include "UnLuaBase.h"
+#include "Misc/AutomationTest.h"
+#include "UnLuaBenchmark.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace UnLuaStringConvBenchmark
+{
+    static constexpr int64 TotalChars = 64 * 1024 * 1024;
+
+    struct FResult
+    {
+        double PushMacroNs;
+        double PushNs;
+        double GetMacroNs;
+        double GetNs;
+    };
+
+    // 平均每个字符的耗时
+    static FResult Run(lua_State* L, const FString& String)
+    {
+        const int32 NumChars = FMath::Max(1, String.Len());
+        const int32 NumIterations = (int32)FMath::Max<int64>(1, TotalChars / NumChars);
+
+        FResult Result;
+        Result.PushMacroNs = UnLuaBenchmark::MeasureNs(NumIterations, [L, &String](int64)
+        {
+            lua_pushstring(L, TCHAR_TO_UTF8(*String));
+            lua_pop(L, 1);
+        }) / NumChars;
+        Result.PushNs = UnLuaBenchmark::MeasureNs(NumIterations, [L, &String](int64)
+        {
+            UnLua::PushFString(L, String);
+            lua_pop(L, 1);
+        }) / NumChars;
+
+        UnLua::PushFString(L, String);
+        FString Value;
+        Result.GetMacroNs = UnLuaBenchmark::MeasureNs(NumIterations, [L, &Value](int64)
+        {
+            Value = UTF8_TO_TCHAR(lua_tostring(L, -1));
+        }) / NumChars;
+        Result.GetNs = UnLuaBenchmark::MeasureNs(NumIterations, [L, &Value](int64)
+        {
+            UnLua::GetFString(L, -1, Value);
+        }) / NumChars;
+        lua_pop(L, 1);
+
+        return Result;
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FUnLuaBenchmark_StringConv, TEXT("UnLua.Benchmark.StringConv FString和Lua字符串互转，ASCII快速路径对比TCHAR_TO_UTF8/UTF8_TO_TCHAR"),
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter);
+
+bool FUnLuaBenchmark_StringConv::RunTest(const FString& Parameters)
+{
+    using namespace UnLuaStringConvBenchmark;
+
+    lua_State* L = luaL_newstate();
+
+    // correctness: round trips across the 16 character blocks, non-ASCII in the middle and at the end
+    {
+        const TCHAR* Cases[] = {
+            TEXT(""),
+            TEXT("a"),
+            TEXT("0123456789abcde"),
+            TEXT("0123456789abcdef"),
+            TEXT("0123456789abcdef0123456789abcdef!"),
+            TEXT("0123456789abcdef虚幻引擎0123456789"),
+            TEXT("0123456789abcdefghijklmnopqrstué"),
+            TEXT("emoji \U0001F600 in a string"),
+        };
+        for (const TCHAR* Case : Cases)
+        {
+            const FString Expected(Case);
+            UnLua::PushFString(L, Expected);
+            TestEqual(TEXT("Push"), FString(UTF8_TO_TCHAR(lua_tostring(L, -1))), Expected);
+            FString Value(TEXT("a longer previous value that is overwritten"));
+            TestTrue(TEXT("Get"), UnLua::GetFString(L, -1, Value));
+            TestEqual(TEXT("Get"), Value, Expected);
+            TestEqual(TEXT("Len"), Value.Len(), Expected.Len());
+            lua_pop(L, 1);
+        }
+
+        FString Value(TEXT("x"));
+        lua_pushnil(L);
+        TestFalse(TEXT("Nil"), UnLua::GetFString(L, -1, Value));
+        TestTrue(TEXT("Nil"), Value.IsEmpty());
+        lua_pop(L, 1);
+    }
+
+    struct FCase
+    {
+        const TCHAR* Name;
+        FString String;
+    };
+    const FCase Cases[] = {
+        { TEXT("ASCII 16"), FString::ChrN(16, TEXT('a')) },
+        { TEXT("ASCII 256"), FString::ChrN(256, TEXT('a')) },
+        { TEXT("ASCII 64K"), FString::ChrN(64 * 1024, TEXT('a')) },
+        { TEXT("CJK 256"), FString::ChrN(256, TEXT('中')) },
+    };
+    for (const FCase& Case : Cases)
+    {
+        const FResult Result = Run(L, Case.String);
+        UnLuaBenchmark::AddComparison(*this, FString::Printf(TEXT("%s, push"), Case.Name), TEXT("ns/char"), TEXT("TCHAR_TO_UTF8"), Result.PushMacroNs, TEXT("PushFString"), Result.PushNs);
+        UnLuaBenchmark::AddComparison(*this, FString::Printf(TEXT("%s, get"), Case.Name), TEXT("ns/char"), TEXT("UTF8_TO_TCHAR"), Result.GetMacroNs, TEXT("GetFString"), Result.GetNs);
+    }
+
+    lua_close(L);
+    return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
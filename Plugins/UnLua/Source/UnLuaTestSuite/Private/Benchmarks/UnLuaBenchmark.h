@@ -0,0 +1,54 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Helpers shared by the benchmarks under 'UnLua.Benchmark', each of them compares a previous implementation (the baseline)
+ * with its replacement. Correctness is checked with TestXXX so that a wrong result fails the test instead of asserting
+ * 'UnLua.Benchmark'下的性能测试共用的辅助函数，每个测试对比旧实现(baseline)和替换它的新实现
+ */
+namespace UnLuaBenchmark
+{
+    /**
+     * Call 'Func' with the index of each iteration and return the average time of one call in nanoseconds
+     * 循环调用Func，返回平均每次的耗时(ns)
+     */
+    template <typename FuncType>
+    double MeasureNs(int64 NumIterations, FuncType&& Func)
+    {
+        const double StartTime = FPlatformTime::Seconds();
+        for (int64 i = 0; i < NumIterations; ++i)
+        {
+            Func(i);
+        }
+        return (FPlatformTime::Seconds() - StartTime) * 1e9 / FMath::Max<int64>(NumIterations, 1);
+    }
+
+    /**
+     * Report the baseline and the replacement of a case on one line, with the ratio of the two
+     * 在一行里输出一个用例的旧实现和新实现的结果，以及两者的比值
+     */
+    inline void AddComparison(FAutomationTestBase& Test, const FString& Case, const TCHAR* Unit, const TCHAR* BaselineName, double Baseline, const TCHAR* Name, double Value)
+    {
+        Test.AddInfo(FString::Printf(TEXT("%s: %s %.2f %s, %s %.2f %s (x%.2f)"),
+            *Case, BaselineName, Baseline, Unit, Name, Value, Unit, Baseline / FMath::Max(Value, 1e-9)));
+    }
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
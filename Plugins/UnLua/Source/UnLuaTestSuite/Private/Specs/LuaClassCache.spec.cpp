@@ -0,0 +1,103 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "UnLuaBase.h"
+#include "Misc/AutomationTest.h"
+#include "UnLuaTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+BEGIN_DEFINE_SPEC(FUnLuaClassCacheSpec, "UnLua.API.ClassCache", EAutomationTestFlags::ProductFilter | EAutomationTestFlags::ApplicationContextMask)
+    lua_State* L;
+END_DEFINE_SPEC(FUnLuaClassCacheSpec)
+
+void FUnLuaClassCacheSpec::Define()
+{
+    BeforeEach([this]
+    {
+        UnLua::Startup();
+        L = UnLua::CreateState();
+    });
+
+    Describe(TEXT("Index"), [this]()
+    {
+        It(TEXT("方法沿Super链查找，不拷贝到实例表里"), EAsyncExecution::TaskGraphMainThread, [this]()
+        {
+            const char* Chunk = "\
+            local Base = Class()\
+            function Base:Foo() return 1 end\
+            local Derived = Class()\
+            Derived.Super = Base\
+            local Instance = setmetatable({}, Derived)\
+            return Instance:Foo(), Instance:Foo(), rawget(Instance, 'Foo') == nil\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_EQUAL(lua_tointeger(L, -3), 1LL);
+            TEST_EQUAL(lua_tointeger(L, -2), 1LL);
+            TEST_TRUE(!!lua_toboolean(L, -1));
+        });
+
+        It(TEXT("第一次没找到之后再给Lua类定义的字段能被找到"), EAsyncExecution::TaskGraphMainThread, [this]()
+        {
+            const char* Chunk = "\
+            local Class = Class()\
+            local Instance = setmetatable({}, Class)\
+            local Before = Instance.Foo\
+            function Class:Foo() return 2 end\
+            return Before == nil, Instance:Foo()\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_TRUE(!!lua_toboolean(L, -2));
+            TEST_EQUAL(lua_tointeger(L, -1), 2LL);
+        });
+
+        It(TEXT("第一次没找到之后再给子类定义的字段能被找到"), EAsyncExecution::TaskGraphMainThread, [this]()
+        {
+            const char* Chunk = "\
+            local Base = Class()\
+            local Derived = Class()\
+            Derived.Super = Base\
+            local Instance = setmetatable({}, Derived)\
+            local Before = Instance.Bar\
+            Derived.Bar = 3\
+            return Before == nil, Instance.Bar\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_TRUE(!!lua_toboolean(L, -2));
+            TEST_EQUAL(lua_tointeger(L, -1), 3LL);
+        });
+
+        It(TEXT("第一次没找到之后再给绑定UClass的Lua类定义的字段能被找到"), EAsyncExecution::TaskGraphMainThread, [this]()
+        {
+            const char* Chunk = "\
+            local Stub = NewObject(UE.UUnLuaTestStub, nil, nil, 'Tests.ClassCache.TestStub')\
+            local Before = Stub.Foo\
+            local Module = require('Tests.ClassCache.TestStub')\
+            function Module:Foo() return 4 end\
+            return Before == nil, Stub:Foo(), Stub.Counter\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_TRUE(!!lua_toboolean(L, -3));
+            TEST_EQUAL(lua_tointeger(L, -2), 4LL);
+            TEST_EQUAL(lua_tointeger(L, -1), 0LL);
+        });
+    });
+
+    AfterEach([this]
+    {
+        UnLua::Shutdown();
+    });
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,90 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "UnLuaBase.h"
+#include "LuaCrossHeapGC.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/StrongObjectPtr.h"
+#include "UnLuaTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+BEGIN_DEFINE_SPEC(FUnLuaCrossHeapGCSpec, "UnLua.API.CrossHeapGC", EAutomationTestFlags::ProductFilter | EAutomationTestFlags::ApplicationContextMask)
+    lua_State* L;
+
+    // 动态绑定一个对象，LuaInstance引用自己，Lua侧不再保留其他引用
+    UObject* NewBoundStub()
+    {
+        const char* Chunk = "\
+        local Stub = NewObject(UE.UUnLuaTestStub, nil, nil, 'Tests.CrossHeapGC.TestStub')\
+        Stub.Self = Stub\
+        Stub.Tag = 42\
+        return Stub\
+        ";
+        UnLua::RunChunk(L, Chunk);
+        UObject* Stub = UnLua::GetUObject(L, -1);
+        lua_pop(L, 1);
+        lua_gc(L, LUA_GCCOLLECT, 0);
+        return Stub;
+    }
+END_DEFINE_SPEC(FUnLuaCrossHeapGCSpec)
+
+void FUnLuaCrossHeapGCSpec::Define()
+{
+    BeforeEach([this]
+    {
+        UnLua::Startup();
+        L = UnLua::CreateState();
+    });
+
+    Describe(TEXT("Collect"), [this]()
+    {
+        It(TEXT("回收只被自己的LuaInstance引用的对象"), EAsyncExecution::TaskGraphMainThread, [this]()
+        {
+            TWeakObjectPtr<UObject> Stub = NewBoundStub();
+            TEST_TRUE(Stub.IsValid());
+
+            // LuaInstance -> 代理 -> GObjectReferencer -> UObject -> LuaInstance，两边的GC都回收不了
+            CollectGarbage(RF_NoFlags, true);
+            TEST_TRUE(Stub.IsValid());
+
+            TEST_TRUE(FLuaCrossHeapGC::Collect() >= 1);
+            CollectGarbage(RF_NoFlags, true);
+            TEST_FALSE(Stub.IsValid());
+        });
+
+        It(TEXT("UE仍然引用的对象保留绑定"), EAsyncExecution::TaskGraphMainThread, [this]()
+        {
+            UObject* Stub = NewBoundStub();
+            TStrongObjectPtr<UObject> Holder(Stub);
+
+            TEST_EQUAL(FLuaCrossHeapGC::Collect(), 0);
+            CollectGarbage(RF_NoFlags, true);
+            TEST_TRUE(IsValid(Stub));
+
+            // 绑定还在，推到Lua的仍然是原来的LuaInstance
+            UnLua::PushUObject(L, Stub);
+            TEST_TRUE(!!lua_istable(L, -1));
+            lua_getfield(L, -1, "Tag");
+            TEST_EQUAL(lua_tointeger(L, -1), 42LL);
+        });
+    });
+
+    AfterEach([this]
+    {
+        UnLua::Shutdown();
+    });
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -582,6 +582,151 @@ void FUnLuaLibArraySpec::Define()
         });
     });
 
+    Describe(TEXT("FromTable"), [this]
+    {
+        It(TEXT("由LuaTable创建数组"), EAsyncExecution::ThreadPool, [this]()
+        {
+            const char* Chunk = "\
+            local Numbers = UE.TArray.FromTable(0, {3, 1, 2})\
+            local Strings = UE.TArray.FromTable('', {'a', 'b'})\
+            local Vectors = UE.TArray.FromTable(UE.FVector, {UE.FVector(1, 2, 3), UE.FVector(4, 5, 6)})\
+            return table.concat(Numbers:ToTable(), ','), table.concat(Strings:ToTable(), ','), Vectors:Length(), Vectors:Get(2).Z\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_EQUAL(FString(UTF8_TO_TCHAR(lua_tostring(L, -4))), FString(TEXT("3,1,2")));
+            TEST_EQUAL(FString(UTF8_TO_TCHAR(lua_tostring(L, -3))), FString(TEXT("a,b")));
+            TEST_EQUAL(lua_tointeger(L, -2), 2LL);
+            TEST_EQUAL(lua_tonumber(L, -1), 6.0);
+        });
+
+        It(TEXT("不是严格序列的LuaTable，按遍历顺序取出所有值"), EAsyncExecution::ThreadPool, [this]()
+        {
+            const char* Chunk = "\
+            local Holes = UE.TArray.FromTable(0, {1, nil, 3})\
+            local Mixed = UE.TArray.FromTable(0, {1, 2, x = 3})\
+            local Sum = 0\
+            for _, v in ipairs(Mixed:ToTable()) do Sum = Sum + v end\
+            return Holes:Length(), Holes:Contains(0), Mixed:Length(), Sum\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_EQUAL(lua_tointeger(L, -4), 2LL);
+            TEST_FALSE(lua_toboolean(L, -3));
+            TEST_EQUAL(lua_tointeger(L, -2), 3LL);
+            TEST_EQUAL(lua_tointeger(L, -1), 6LL);
+        });
+    });
+
+    Describe(TEXT("Sort"), [this]
+    {
+        It(TEXT("按内置顺序排序并二分查找"), EAsyncExecution::ThreadPool, [this]()
+        {
+            const char* Chunk = "\
+            local Array = UE.TArray(0)\
+            for _, v in ipairs({5, 3, 9, 1, 7}) do Array:Add(v) end\
+            Array:Sort()\
+            local Ascending = table.concat(Array:ToTable(), ',')\
+            Array:Sort(true)\
+            return Ascending, table.concat(Array:ToTable(), ','), Array:BinarySearch(3, true), Array:BinarySearch(4, true)\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_EQUAL(FString(UTF8_TO_TCHAR(lua_tostring(L, -4))), FString(TEXT("1,3,5,7,9")));
+            TEST_EQUAL(FString(UTF8_TO_TCHAR(lua_tostring(L, -3))), FString(TEXT("9,7,5,3,1")));
+            TEST_EQUAL(lua_tointeger(L, -2), 4LL);
+            TEST_EQUAL(lua_tointeger(L, -1), 0LL);
+        });
+
+        It(TEXT("使用Lua比较函数排序"), EAsyncExecution::ThreadPool, [this]()
+        {
+            const char* Chunk = "\
+            local Array = UE.TArray('')\
+            Array:Add('bb')\
+            Array:Add('a')\
+            Array:Add('ccc')\
+            Array:Sort(function(A, B) return #A > #B end)\
+            return table.concat(Array:ToTable(), ',')\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_EQUAL(FString(UTF8_TO_TCHAR(lua_tostring(L, -1))), FString(TEXT("ccc,bb,a")));
+        });
+    });
+
+    Describe(TEXT("IndexOfBy/FilterByPredicate"), [this]
+    {
+        It(TEXT("按条件查找和过滤元素"), EAsyncExecution::ThreadPool, [this]()
+        {
+            const char* Chunk = "\
+            local Array = UE.TArray(0)\
+            for i = 1, 6 do Array:Add(i * 10) end\
+            local Index = Array:IndexOfBy(function(v) return v > 25 end)\
+            local Even = Array:FilterByPredicate(function(v, i) return i % 2 == 0 end)\
+            return Index, table.concat(Even:ToTable(), ','), Array:Find(40), Array:IndexOfBy(function(v) return v > 100 end)\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_EQUAL(lua_tointeger(L, -4), 3LL);
+            TEST_EQUAL(FString(UTF8_TO_TCHAR(lua_tostring(L, -3))), FString(TEXT("20,40,60")));
+            TEST_EQUAL(lua_tointeger(L, -2), 4LL);
+            TEST_EQUAL(lua_tointeger(L, -1), 0LL);
+        });
+    });
+
+    Describe(TEXT("pairs"), [this]
+    {
+        It(TEXT("按顺序直接遍历数组元素"), EAsyncExecution::ThreadPool, [this]()
+        {
+            const char* Chunk = "\
+            local Array = UE.TArray(0)\
+            Array:Add(3)\
+            Array:Add(4)\
+            local Sum = 0\
+            for i, v in pairs(Array) do\
+                Sum = Sum * 10 + i * v\
+            end\
+            return Sum\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_EQUAL(lua_tointeger(L, -1), 38LL);
+        });
+
+        It(TEXT("遍历时先移除再添加元素，长度和存储地址不变也能检测到"), EAsyncExecution::ThreadPool, [this]()
+        {
+            AddExpectedError(TEXT("TArray_Next: TArray is modified during iteration!"));
+            const char* Chunk = "\
+            local Array = UE.TArray(0)\
+            Array:Add(3)\
+            Array:Add(4)\
+            Array:Add(5)\
+            local Count = 0\
+            for i, v in pairs(Array) do\
+                Count = Count + 1\
+                Array:Remove(1)\
+                Array:Add(6)\
+            end\
+            return Count, Array:Length()\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_EQUAL(lua_tointeger(L, -2), 1LL);
+            TEST_EQUAL(lua_tointeger(L, -1), 3LL);
+        });
+    });
+
+    Describe(TEXT("View"), [this]
+    {
+        It(TEXT("按分量直接读写TArray<FVector>的存储"), EAsyncExecution::ThreadPool, [this]()
+        {
+            const char* Chunk = "\
+            local Array = UE.TArray(UE.FVector)\
+            local View = Array:View()\
+            View:FromTable({1, 2, 3, 4, 5, 6})\
+            View[6] = 7\
+            local X, Y, Z = View:Get(2)\
+            local Table = View:ToTable()\
+            return Array:Length() == 2 and #View == 6 and View[1] == 1 and X == 4 and Z == 7 and #Table == 6 and Array:Get(2).Z == 7\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_TRUE(!!lua_toboolean(L, -1));
+        });
+    });
+
     AfterEach([this]
     {
         UnLua::Shutdown();
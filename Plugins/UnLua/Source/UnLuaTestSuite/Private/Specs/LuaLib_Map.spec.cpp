@@ -176,6 +176,40 @@ void FUnLuaLibMapSpec::Define()
             UnLua::RunChunk(L, Chunk);
             TEST_EQUAL(lua_tointeger(L, -1), 1LL);
         });
+
+        It(TEXT("查找FString类型的Key，不区分大小写"), EAsyncExecution::ThreadPool, [this]()
+        {
+            // 元素足够多时才会分出多个hash桶，Lua里查找的hash和FString不一致就找不到
+            const char* Chunk = "\
+            local Map = UE.TMap('',0)\
+            for i = 1, 64 do Map:Add('Key' .. i, i) end\
+            for i = 1, 64 do\
+                if Map:Find('Key' .. i) ~= i or Map:Find('KEY' .. i) ~= i or Map:FindRef('key' .. i) ~= i then return false end\
+            end\
+            return Map:Find('Key65') == nil and Map:Remove('kEY7') and Map:Find('Key7') == nil\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_TRUE(lua_toboolean(L, -1));
+        });
+
+        It(TEXT("查找C++中添加的FString类型的Key"), EAsyncExecution::ThreadPool, [this]()
+        {
+            UnLua::RunChunk(L, "return UE.TMap('',0)");
+            const auto Map = (TMap<FString, int32>*)UnLua::GetMap(L, -1);
+            for (int32 i = 1; i <= 64; ++i)
+            {
+                Map->Add(FString::Printf(TEXT("Key%d"), i), i);
+            }
+            lua_setglobal(L, "Map");
+            const char* Chunk = "\
+            for i = 1, 64 do\
+                if Map:Find('Key' .. i) ~= i then return false end\
+            end\
+            return true\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_TRUE(lua_toboolean(L, -1));
+        });
     });
 
     Describe(TEXT("FindRef"), [this]()
@@ -279,6 +313,67 @@ void FUnLuaLibMapSpec::Define()
         });
     });
 
+    Describe(TEXT("pairs"), [this]()
+    {
+        It(TEXT("直接遍历Map的键值对"), EAsyncExecution::ThreadPool, [this]()
+        {
+            const char* Chunk = "\
+            local Map = UE.TMap(0,0)\
+            Map:Add(1,3)\
+            Map:Add(2,4)\
+            Map:Remove(1)\
+            Map:Add(5,6)\
+            local Count, Sum = 0, 0\
+            for K, V in pairs(Map) do\
+                Count = Count + 1\
+                Sum = Sum + K * V\
+            end\
+            return Count, Sum\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_EQUAL(lua_tointeger(L, -1), 38LL);
+            TEST_EQUAL(lua_tointeger(L, -2), 2LL);
+        });
+
+        It(TEXT("遍历时先移除再添加键值对，数量和存储地址不变也能检测到"), EAsyncExecution::ThreadPool, [this]()
+        {
+            AddExpectedError(TEXT("TMap_Next: TMap is modified during iteration!"));
+            const char* Chunk = "\
+            local Map = UE.TMap(0,0)\
+            Map:Add(1,3)\
+            Map:Add(2,4)\
+            local Count = 0\
+            for K, V in pairs(Map) do\
+                Count = Count + 1\
+                Map:Remove(K)\
+                Map:Add(K + 10, V)\
+            end\
+            return Count, Map:Length()\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_EQUAL(lua_tointeger(L, -2), 1LL);
+            TEST_EQUAL(lua_tointeger(L, -1), 2LL);
+        });
+
+        It(TEXT("遍历时修改已有键的值不影响遍历"), EAsyncExecution::ThreadPool, [this]()
+        {
+            const char* Chunk = "\
+            local Map = UE.TMap(0,0)\
+            Map:Add(1,3)\
+            Map:Add(2,4)\
+            local Count = 0\
+            for K, V in pairs(Map) do\
+                Count = Count + 1\
+                Map:Add(K, V * 2)\
+            end\
+            return Count, Map:FindRef(1) + Map:FindRef(2)\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_EQUAL(lua_tointeger(L, -2), 2LL);
+            TEST_EQUAL(lua_tointeger(L, -1), 14LL);
+        });
+    });
+
     AfterEach([this]
     {
         UnLua::Shutdown();
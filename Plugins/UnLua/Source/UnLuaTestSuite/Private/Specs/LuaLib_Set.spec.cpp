@@ -176,6 +176,21 @@ void FUnLuaLibSetSpec::Define()
             UnLua::RunChunk(L, Chunk);
             TEST_FALSE(lua_toboolean(L, -1));
         });
+
+        It(TEXT("查找FString类型的元素，不区分大小写"), EAsyncExecution::ThreadPool, [this]()
+        {
+            // 元素足够多时才会分出多个hash桶，Lua里查找的hash和FString不一致就找不到
+            const char* Chunk = "\
+            local Set = UE.TSet('')\
+            for i = 1, 64 do Set:Add('Key' .. i) end\
+            for i = 1, 64 do\
+                if not Set:Contains('Key' .. i) or not Set:Contains('kEY' .. i) then return false end\
+            end\
+            return not Set:Contains('Key65') and Set:Remove('KEY7') and not Set:Contains('Key7')\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_TRUE(lua_toboolean(L, -1));
+        });
     });
 
     Describe(TEXT("Clear"), [this]()
@@ -231,6 +246,47 @@ void FUnLuaLibSetSpec::Define()
         });
     });
 
+    Describe(TEXT("pairs"), [this]()
+    {
+        It(TEXT("直接遍历Set的元素"), EAsyncExecution::ThreadPool, [this]()
+        {
+            const char* Chunk = "\
+            local Set = UE.TSet(0)\
+            Set:Add(1)\
+            Set:Add(2)\
+            local Count, Sum = 0, 0\
+            for I, Element in pairs(Set) do\
+                Count = Count + I\
+                Sum = Sum + Element\
+            end\
+            return Count, Sum\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_EQUAL(lua_tointeger(L, -1), 3LL);
+            TEST_EQUAL(lua_tointeger(L, -2), 3LL);
+        });
+
+        It(TEXT("遍历时先移除再添加元素，数量和存储地址不变也能检测到"), EAsyncExecution::ThreadPool, [this]()
+        {
+            AddExpectedError(TEXT("TSet_Next: TSet is modified during iteration!"));
+            const char* Chunk = "\
+            local Set = UE.TSet(0)\
+            Set:Add(1)\
+            Set:Add(2)\
+            local Count = 0\
+            for I, Element in pairs(Set) do\
+                Count = Count + 1\
+                Set:Remove(Element)\
+                Set:Add(Element + 10)\
+            end\
+            return Count, Set:Length()\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_EQUAL(lua_tointeger(L, -2), 1LL);
+            TEST_EQUAL(lua_tointeger(L, -1), 2LL);
+        });
+    });
+
     AfterEach([this]
     {
         UnLua::Shutdown();
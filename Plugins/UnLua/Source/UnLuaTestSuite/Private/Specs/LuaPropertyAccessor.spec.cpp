@@ -0,0 +1,102 @@
+// Tencent is pleased to support the open source community by making UnLua available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the MIT License (the "License");
+// you may not use this file except in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and limitations under the License.
+
+#include "UnLuaBase.h"
+#include "UnLuaTemplate.h"
+#include "Misc/AutomationTest.h"
+#include "UnLuaTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+BEGIN_DEFINE_SPEC(FUnLuaPropertyAccessorSpec, "UnLua.API.PropertyAccessor", EAutomationTestFlags::ProductFilter | EAutomationTestFlags::ApplicationContextMask)
+    lua_State* L;
+END_DEFINE_SPEC(FUnLuaPropertyAccessorSpec)
+
+void FUnLuaPropertyAccessorSpec::Define()
+{
+    BeforeEach([this]
+    {
+        UnLua::Startup();
+        L = UnLua::CreateState();
+    });
+
+    Describe(TEXT("GetProperties/SetProperties"), [this]()
+    {
+        It(TEXT("按名字批量读写对象的属性"), EAsyncExecution::TaskGraphMainThread, [this]()
+        {
+            const char* Chunk = "\
+            local Actor = NewObject(UE.AActor)\
+            UE.SetProperties(Actor, {InitialLifeSpan = 2, CustomTimeDilation = 0.5})\
+            local A, B, C = UE.GetProperties(Actor, 'InitialLifeSpan', 'CustomTimeDilation', 'NotExists')\
+            return A == 2 and B == 0.5 and C == nil\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_TRUE(!!lua_toboolean(L, -1));
+        });
+
+        It(TEXT("使用预编译的PropertySet读写"), EAsyncExecution::TaskGraphMainThread, [this]()
+        {
+            const char* Chunk = "\
+            local Set = UE.PropertySet(UE.AActor, 'InitialLifeSpan', 'CustomTimeDilation')\
+            local Actor = NewObject(UE.AActor)\
+            Set:Set(Actor, 3, 0.25)\
+            local A, B = UE.GetProperties(Actor, Set)\
+            return #Set == 2 and A == 3 and B == 0.25\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_TRUE(!!lua_toboolean(L, -1));
+        });
+    });
+
+    Describe(TEXT("CompilePath"), [this]()
+    {
+        It(TEXT("通过预编译的属性路径读写嵌套结构体的字段"), EAsyncExecution::TaskGraphMainThread, [this]()
+        {
+            const char* Chunk = "\
+            local Path = UE.CompilePath(UE.FTransform, 'Translation.Z')\
+            local Transform = UE.FTransform(UE.FQuat(0, 0, 0, 1), UE.FVector(1, 2, 3))\
+            local Before = Path:Get(Transform)\
+            Path:Set(Transform, 5)\
+            return Before == 3 and Path:Get(Transform) == 5 and Transform.Translation.Z == 5 and UE.CompilePath(UE.FTransform, 'Translation.Z.W') == nil\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_TRUE(!!lua_toboolean(L, -1));
+        });
+    });
+
+    Describe(TEXT("StructToTable/TableToStruct"), [this]()
+    {
+        It(TEXT("结构体和普通表互相转换，嵌套的结构体也转换"), EAsyncExecution::TaskGraphMainThread, [this]()
+        {
+            const char* Chunk = "\
+            local T = UE.StructToTable(UE.FTransform(UE.FQuat(0, 0, 0, 1), UE.FVector(1, 2, 3)))\
+            T.Translation.Z = 4\
+            local Transform = UE.TableToStruct(T, UE.FTransform)\
+            local V = UE.FVector(0, 0, 7)\
+            UE.TableToStruct({X = 5, Y = 6}, V)\
+            local Translation = Transform.Translation\
+            return getmetatable(T.Translation) == nil and Translation.X == 1 and Translation.Z == 4 and V.X == 5 and V.Y == 6 and V.Z == 7\
+            ";
+            UnLua::RunChunk(L, Chunk);
+            TEST_TRUE(!!lua_toboolean(L, -1));
+        });
+    });
+
+    AfterEach([this]
+    {
+        UnLua::Shutdown();
+    });
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
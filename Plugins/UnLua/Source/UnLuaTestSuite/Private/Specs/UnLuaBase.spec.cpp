@@ -16,6 +16,7 @@
 #include "UnLuaTemplate.h"
 #include "Misc/AutomationTest.h"
 #include "UnLuaTestHelpers.h"
+#include "LuaNameCache.h"
 
 #if WITH_DEV_AUTOMATION_TESTS
 
@@ -138,6 +139,46 @@ void FUnLuaBaseSpec::Define()
             TEST_EQUAL(lua_tostring(L, -1), "Foo");
         });
 
+        It(TEXT("重复传入FName命中缓存，并能转换回FName"), EAsyncExecution::ThreadPool, [this]()
+        {
+            FLuaNameCache Cache;
+            Cache.Initialize(L);
+
+            Cache.PushName(L, FName("Foo_3"));
+            Cache.PushName(L, FName("Foo_3"));
+            TEST_EQUAL(Cache.GetNumNames(), 1);
+            TEST_EQUAL(Cache.GetNumStrings(), 1);
+            TEST_EQUAL(lua_tostring(L, -1), "Foo_3");
+            TEST_TRUE(Cache.ToName(L, -1).IsEqual(FName("Foo_3"), ENameCase::CaseSensitive));
+            TEST_EQUAL(Cache.GetNumStrings(), 1);
+
+            lua_pushstring(L, "bar");
+            TEST_EQUAL(Cache.ToName(L, -1), FName("bar"));
+            TEST_EQUAL(Cache.GetNumStrings(), 2);
+            TEST_EQUAL(Cache.ToName(L, -1), FName("bar"));
+            TEST_EQUAL(Cache.GetNumStrings(), 2);
+
+            Cache.Reset();
+        });
+
+        It(TEXT("缓存满了之后释放固定的字符串"), EAsyncExecution::ThreadPool, [this]()
+        {
+            FLuaNameCache Cache;
+            Cache.Initialize(L);
+
+            const int32 Top = lua_gettop(L);
+            const int32 MaxNames = FLuaNameCache::GetMaxNames();
+            for (int32 i = 0; i <= MaxNames; ++i)
+            {
+                Cache.PushName(L, FName(*FString::Printf(TEXT("Name_%d"), i)));
+                lua_settop(L, Top);
+            }
+            TEST_EQUAL(Cache.GetNumNames(), 1);
+            TEST_EQUAL(Cache.GetNumStrings(), 1);
+
+            Cache.Reset();
+        });
+
         It(TEXT("正确传入void*到Lua堆栈"), EAsyncExecution::ThreadPool, [this]()
         {
             UnLua::Push(L, static_cast<void*>(L));